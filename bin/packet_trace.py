@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+
+"""Decode a packet trace recorded by the firmware (src/mesh/PacketTrace.h)
+
+The trace is either the binary /packettrace.bin downloaded over XModem, or a log which contains the "ptrace" hex lines
+written when a critical error is recorded or a reboot is requested. For a log, only the last dump in it is decoded.
+
+$ bin/packet_trace.py packettrace.bin
+$ bin/packet_trace.py --id 0x1a2b3c4d device.log
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+MAGIC = 0x43525450
+VERSION = 1
+HEADER = struct.Struct("<IBBHII")
+RECORD = struct.Struct("<IIIIBBBBBbBB")
+
+EVENTS = [
+    "NONE",
+    "RX",
+    "RX_QUEUE_DROP",
+    "DUPE",
+    "DECODE_FAIL",
+    "HANDLED",
+    "RELAY",
+    "TX_QUEUED",
+    "TX_QUEUE_FULL",
+    "TX_EVICTED",
+    "TX_CANCEL",
+    "TX_START",
+    "TX_DONE",
+    "RETRANSMIT",
+    "RETRANSMIT_END",
+]
+
+
+def from_log(text):
+    """Return the bytes of the last dump in a log, which starts with a header line"""
+    dump = None
+    for line in text.splitlines():
+        m = re.search(r"ptrace ([0-9a-f]+)", line)
+        if not m:
+            continue
+        data = bytes.fromhex(m.group(1))
+        if len(data) == HEADER.size and HEADER.unpack(data)[0] == MAGIC:
+            dump = bytearray()
+        if dump is not None:
+            dump += data
+    if dump is None:
+        sys.exit("No packet trace found in the log")
+    return bytes(dump)
+
+
+def decode(data):
+    magic, version, record_size, num_records, total, now = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("Not a packet trace")
+    if version != VERSION or record_size != RECORD.size:
+        sys.exit(f"Unsupported trace version {version} with {record_size} byte records")
+    available = (len(data) - HEADER.size) // RECORD.size
+    if available < num_records:
+        print(f"warning: trace is truncated, {available} of {num_records} records", file=sys.stderr)
+    records = [RECORD.unpack_from(data, HEADER.size + i * RECORD.size) for i in range(min(available, num_records))]
+    return total, now, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a Meshtastic packet trace")
+    parser.add_argument("file", help="packettrace.bin, or a log containing ptrace lines")
+    parser.add_argument("--id", help="only show events for this packet id")
+    parser.add_argument("--node", help="only show packets from or to this node, in hex as in !deadbeef")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        raw = f.read()
+    data = raw if raw[:4] == struct.pack("<I", MAGIC) else from_log(raw.decode("utf-8", "replace"))
+
+    total, now, records = decode(data)
+    print(f"{len(records)} of {total} events, snapshot at {now} ms")
+    print(f"{'age ms':>9} {'event':<14} {'from':>10} {'to':>10} {'id':>10} hops relay next {'snr':>6} ch  queue")
+
+    want_id = int(args.id, 0) if args.id else None
+    want_node = int(args.node.lstrip("!"), 16) if args.node else None
+    for msec, frm, to, pid, event, hop_limit, hop_start, relay, next_hop, snr, depth, channel in records:
+        if want_id is not None and pid != want_id:
+            continue
+        if want_node is not None and want_node not in (frm, to):
+            continue
+        name = EVENTS[event] if event < len(EVENTS) else str(event)
+        snr_text = f"{snr / 4:6.2f}" if name == "RX" else " " * 6
+        print(
+            f"{(now - msec) & 0xFFFFFFFF:>9} {name:<14} {frm:#010x} {to:#010x} {pid:#010x} "
+            f"{hop_limit}/{hop_start}  {relay:#04x} {next_hop:#04x} {snr_text} {channel:<3} {depth}"
+        )
+
+
+if __name__ == "__main__":
+    main()
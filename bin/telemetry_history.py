@@ -0,0 +1,139 @@
+#!/usr/bin/env python3
+
+"""Decode the telemetry history kept by the firmware (src/modules/Telemetry/TelemetryHistory.h)
+
+Download /telemetryhist.bin over XModem, or /telemetryhist.bin?since=<unix time> for only the newer part, then print its
+points as CSV:
+
+$ bin/telemetry_history.py telemetryhist.bin
+$ bin/telemetry_history.py --metric temperature --tier minute telemetryhist.bin
+"""
+
+import argparse
+import struct
+import sys
+
+MAGIC = 0x54534854
+VERSION = 1
+HEADER = struct.Struct("<IBBHI")
+BLOCK = struct.Struct("<IIfHHBBH")
+
+METRICS = [
+    "none",
+    "battery_level",
+    "voltage",
+    "channel_utilization",
+    "air_util_tx",
+    "temperature",
+    "relative_humidity",
+    "barometric_pressure",
+    "gas_resistance",
+    "iaq",
+    "lux",
+    "env_voltage",
+    "env_current",
+    "ch1_voltage",
+    "ch1_current",
+    "ch2_voltage",
+    "ch2_current",
+    "ch3_voltage",
+    "ch3_current",
+    "pm10_standard",
+    "pm25_standard",
+    "pm100_standard",
+    "co2",
+    "heart_bpm",
+    "spo2",
+    "body_temperature",
+]
+
+TIERS = ["raw", "minute", "quarter"]
+
+
+class Bits:
+    def __init__(self, data, nbits):
+        self.data = data
+        self.nbits = nbits
+        self.pos = 0
+
+    def read(self, n):
+        if self.pos + n > self.nbits:
+            raise EOFError
+        v = 0
+        for _ in range(n):
+            v = (v << 1) | ((self.data[self.pos >> 3] >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return v
+
+
+def signed(v, n):
+    return v - (1 << n) if v & (1 << (n - 1)) else v
+
+
+def decode_block(start, first, count, bits, data):
+    """Yield the (time, value) points of a block, the inverse of GorillaBlock::append()"""
+    time, value = start, struct.unpack("<I", struct.pack("<f", first))[0]
+    yield time, first
+    r = Bits(data, bits)
+    delta = leading = trailing = 0
+    for _ in range(count - 1):
+        prefix = 0
+        while prefix < 4 and r.read(1):
+            prefix += 1
+        if prefix == 4:
+            delta = r.read(32)
+        elif prefix:
+            n = (0, 7, 9, 12)[prefix]
+            delta += signed(r.read(n), n)
+        time += delta
+        if r.read(1):
+            if r.read(1):
+                leading = r.read(5)
+                trailing = 32 - leading - (r.read(5) + 1)
+            value ^= r.read(32 - leading - trailing) << trailing
+        yield time, struct.unpack("<f", struct.pack("<I", value))[0]
+
+
+def decode(data):
+    magic, version, _, num_blocks, now = HEADER.unpack_from(data)
+    if magic != MAGIC:
+        sys.exit("Not a telemetry history")
+    if version != VERSION:
+        sys.exit(f"Unsupported telemetry history version {version}")
+    pos = HEADER.size
+    blocks = []
+    for _ in range(num_blocks):
+        if pos + BLOCK.size > len(data):
+            print(f"warning: history is truncated, {len(blocks)} of {num_blocks} blocks", file=sys.stderr)
+            break
+        start, _, first, count, bits, metric, tier, _ = BLOCK.unpack_from(data, pos)
+        pos += BLOCK.size
+        payload = data[pos : pos + (bits + 7) // 8]
+        pos += len(payload)
+        blocks.append((metric, tier, list(decode_block(start, first, count, bits, payload))))
+    return now, blocks
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode a Meshtastic telemetry history")
+    parser.add_argument("file", help="telemetryhist.bin downloaded over XModem")
+    parser.add_argument("--metric", choices=METRICS[1:], help="only show this metric")
+    parser.add_argument("--tier", choices=TIERS, help="only show this resolution")
+    args = parser.parse_args()
+
+    with open(args.file, "rb") as f:
+        now, blocks = decode(f.read())
+
+    print(f"# snapshot at {now}")
+    print("metric,tier,time,value")
+    for metric, tier, points in blocks:
+        metric_name = METRICS[metric] if metric < len(METRICS) else str(metric)
+        tier_name = TIERS[tier] if tier < len(TIERS) else str(tier)
+        if args.metric and metric_name != args.metric or args.tier and tier_name != args.tier:
+            continue
+        for time, value in points:
+            print(f"{metric_name},{tier_name},{time},{value:g}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+
+"""Load meshtasticd's webserver API with many concurrent clients, like a user with lots of browser tabs open
+
+Every tab either polls /api/v1/fromradio?all=true the way the web client does, or holds a long-poll stream open on
+/api/v1/fromradio/stream. The first tab asks for the config so there is a burst of frames to move. With --pid we also
+report how much CPU meshtasticd burned while doing it, which is the interesting number for idle tabs.
+
+$ bin/web_stream_bench.py --tabs 20 --mode poll --pid $(pidof meshtasticd)
+$ bin/web_stream_bench.py --tabs 20 --mode stream --pid $(pidof meshtasticd)
+"""
+
+import argparse
+import http.client
+import os
+import ssl
+import struct
+import threading
+import time
+
+START = b"\x94\xc3"
+HEADER_LEN = 4
+WANT_CONFIG_ID = 0x1234
+# ToRadio with only want_config_id (field 3) set
+WANT_CONFIG = bytes([3 << 3]) + bytes([WANT_CONFIG_ID & 0x7F | 0x80, WANT_CONFIG_ID >> 7])
+
+
+class Tab(threading.Thread):
+    def __init__(self, args, deadline):
+        super().__init__(daemon=True)
+        self.args = args
+        self.deadline = deadline
+        self.requests = 0
+        self.frames = 0
+        self.bytes = 0
+        self.errors = 0
+
+    def connect(self):
+        ctx = ssl.create_default_context()
+        ctx.check_hostname = False
+        ctx.verify_mode = ssl.CERT_NONE
+        return http.client.HTTPSConnection(self.args.host, self.args.port, context=ctx, timeout=60)
+
+    def run(self):
+        conn = self.connect()
+        while time.monotonic() < self.deadline:
+            try:
+                if self.args.mode == "stream":
+                    self.stream(conn)
+                else:
+                    self.poll(conn)
+            except (OSError, http.client.HTTPException):
+                self.errors += 1
+                conn.close()
+                time.sleep(0.1)
+                conn = self.connect()
+        conn.close()
+
+    def poll(self, conn):
+        conn.request("GET", "/api/v1/fromradio?all=true")
+        body = conn.getresponse().read()
+        self.requests += 1
+        self.bytes += len(body)
+        # Frames aren't delimited in this response, so count non-empty responses instead
+        self.frames += 1 if body else 0
+        time.sleep(self.args.poll_interval)
+
+    def stream(self, conn):
+        conn.request("GET", "/api/v1/fromradio/stream")
+        res = conn.getresponse()
+        self.requests += 1
+        pending = b""
+        while time.monotonic() < self.deadline:
+            data = res.read1(65536)
+            if not data:
+                break
+            self.bytes += len(data)
+            pending += data
+            while len(pending) >= HEADER_LEN and pending[:2] == START:
+                length = struct.unpack(">H", pending[2:4])[0]
+                if len(pending) < HEADER_LEN + length:
+                    break
+                pending = pending[HEADER_LEN + length :]
+                self.frames += 1
+        if time.monotonic() >= self.deadline:
+            # Don't wait for the server to end an idle stream, just drop it
+            conn.close()
+
+
+def cpu_seconds(pid):
+    with open(f"/proc/{pid}/stat") as f:
+        fields = f.read().rsplit(")", 1)[1].split()
+    # utime and stime, fields 14 and 15 of stat
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def want_config(args):
+    ctx = ssl.create_default_context()
+    ctx.check_hostname = False
+    ctx.verify_mode = ssl.CERT_NONE
+    conn = http.client.HTTPSConnection(args.host, args.port, context=ctx, timeout=10)
+    conn.request("PUT", "/api/v1/toradio", body=WANT_CONFIG, headers={"Content-Type": "application/x-protobuf"})
+    conn.getresponse().read()
+    conn.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Benchmark many concurrent web API clients")
+    parser.add_argument("--host", default="localhost")
+    parser.add_argument("--port", type=int, default=9443)
+    parser.add_argument("--tabs", type=int, default=20, help="number of concurrent clients")
+    parser.add_argument("--seconds", type=float, default=30)
+    parser.add_argument("--mode", choices=["poll", "stream"], default="stream")
+    parser.add_argument("--poll-interval", type=float, default=0.2, help="seconds between polls of each tab")
+    parser.add_argument("--pid", type=int, help="meshtasticd pid, to report its CPU use")
+    args = parser.parse_args()
+
+    cpu_before = cpu_seconds(args.pid) if args.pid else None
+    start = time.monotonic()
+    tabs = [Tab(args, start + args.seconds) for _ in range(args.tabs)]
+    for tab in tabs:
+        tab.start()
+    want_config(args)
+    for tab in tabs:
+        tab.join()
+    elapsed = time.monotonic() - start
+
+    requests = sum(t.requests for t in tabs)
+    print(f"{args.tabs} tabs, {args.mode}, {elapsed:.1f} s")
+    print(f"requests {requests} ({requests / elapsed:.1f}/s), frames {sum(t.frames for t in tabs)}, "
+          f"bytes {sum(t.bytes for t in tabs)}, errors {sum(t.errors for t in tabs)}")
+    if cpu_before is not None:
+        cpu = cpu_seconds(args.pid) - cpu_before
+        print(f"meshtasticd cpu {cpu:.2f} s ({100 * cpu / elapsed:.1f}% of one core)")
+
+
+if __name__ == "__main__":
+    main()
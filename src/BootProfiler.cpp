@@ -0,0 +1,46 @@
+#include "BootProfiler.h"
+#include "configuration.h"
+
+BootProfiler bootProfiler;
+
+void BootProfiler::endPhase(uint32_t now)
+{
+    if (numPhases)
+        phases[numPhases - 1].msec += now - phaseStartMsec;
+    phaseStartMsec = now;
+}
+
+void BootProfiler::startPhase(const char *name)
+{
+    if (finished)
+        return;
+    uint32_t now = millis();
+    if (!numPhases) {
+        // Whatever ran before setup(), bootloader and static constructors included
+        phases[numPhases++] = {"pre-setup", now};
+        phaseStartMsec = now;
+    }
+    endPhase(now);
+    if (numPhases < BOOT_PROFILER_MAX_PHASES)
+        phases[numPhases++] = {name, 0};
+}
+
+void BootProfiler::finish()
+{
+    if (finished)
+        return;
+    uint32_t now = millis();
+    endPhase(now);
+    totalMsec = now;
+    finished = true;
+    log();
+}
+
+void BootProfiler::log() const
+{
+    if (!finished)
+        return;
+    LOG_INFO("Boot took %u ms", totalMsec);
+    for (size_t i = 0; i < numPhases; i++)
+        LOG_INFO("  %-12s %5u ms", phases[i].name, phases[i].msec);
+}
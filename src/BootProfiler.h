@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Phases we keep timings for, any later ones are added to the last
+#ifndef BOOT_PROFILER_MAX_PHASES
+#define BOOT_PROFILER_MAX_PHASES 16
+#endif
+
+struct BootPhase {
+    const char *name; // always a string literal
+    uint32_t msec;
+};
+
+/**
+ * Measures how long each part of setup() takes, so we can see what keeps the radio from starting to receive.
+ *
+ * setup() calls startPhase() at the start of each part, which also ends the one before. finish() ends the last part and
+ * logs all of them. They are logged again for each API client once it has its config, so debug_log_api_enabled clients see
+ * them on every platform. The ESP32 web server also has them in /json/report, and meshtasticd in /json/boot.
+ */
+class BootProfiler
+{
+  public:
+    /** End the current phase, if any, and start timing the next one */
+    void startPhase(const char *name);
+
+    /** End the last phase and log the timings, called at the end of setup() */
+    void finish();
+
+    /** Log the timings, if setup() is done */
+    void log() const;
+
+    bool isFinished() const { return finished; }
+    size_t getNumPhases() const { return numPhases; }
+    const BootPhase &getPhase(size_t i) const { return phases[i]; }
+
+    /// millis() when setup() was done, including the time before it was called
+    uint32_t getTotalMsec() const { return totalMsec; }
+
+  private:
+    BootPhase phases[BOOT_PROFILER_MAX_PHASES];
+    size_t numPhases = 0;
+    uint32_t phaseStartMsec = 0;
+    uint32_t totalMsec = 0;
+    bool finished = false;
+
+    void endPhase(uint32_t now);
+};
+
+extern BootProfiler bootProfiler;
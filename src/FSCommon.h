@@ -12,6 +12,7 @@
 #define FSBegin() true
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #endif
 
 #if defined(ARCH_STM32WL)
@@ -19,6 +20,7 @@
 #include "LittleFS.h"
 #define FSCom InternalFS
 #define FSBegin() FSCom.begin()
+#define FILE_O_APPEND FILE_O_WRITE // Adafruit LittleFS opens for writing at the end of the file
 using namespace STM32_LittleFS_Namespace;
 #endif
 
@@ -29,6 +31,7 @@ using namespace STM32_LittleFS_Namespace;
 #define FSBegin() FSCom.begin() // set autoformat
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #endif
 
 #if defined(ARCH_ESP32)
@@ -38,6 +41,7 @@ using namespace STM32_LittleFS_Namespace;
 #define FSBegin() FSCom.begin(true) // format on failure
 #define FILE_O_WRITE "w"
 #define FILE_O_READ "r"
+#define FILE_O_APPEND "a"
 #endif
 
 #if defined(ARCH_NRF52)
@@ -45,6 +49,7 @@ using namespace STM32_LittleFS_Namespace;
 #include "InternalFileSystem.h"
 #define FSCom InternalFS
 #define FSBegin() FSCom.begin() // InternalFS formats on failure
+#define FILE_O_APPEND FILE_O_WRITE // Adafruit LittleFS opens for writing at the end of the file
 using namespace Adafruit_LittleFS_Namespace;
 #endif
 
@@ -49,6 +49,9 @@ size_t RedirectablePrint::write(uint8_t c)
 
 size_t RedirectablePrint::vprintf(const char *logLevel, const char *format, va_list arg)
 {
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::recursive_mutex> guard(logLock);
+#endif
     va_list copy;
 #if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
     static char printBuf[512];
@@ -277,6 +280,9 @@ meshtastic_LogRecord_Level RedirectablePrint::getLogLevel(const char *logLevel)
 
 void RedirectablePrint::log(const char *logLevel, const char *format, ...)
 {
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::recursive_mutex> guard(logLock);
+#endif
 
     // append \n to format
     size_t len = strlen(format);
@@ -346,6 +352,9 @@ void RedirectablePrint::log(const char *logLevel, const char *format, ...)
 
 void RedirectablePrint::hexDump(const char *logLevel, unsigned char *buf, uint16_t len)
 {
+#ifdef ARCH_PORTDUINO
+    std::lock_guard<std::recursive_mutex> guard(logLock);
+#endif
     const char alphabet[17] = "0123456789abcdef";
     log(logLevel, "    +------------------------------------------------+ +----------------+");
     log(logLevel, "    |.0 .1 .2 .3 .4 .5 .6 .7 .8 .9 .a .b .c .d .e .f | |      ASCII     |");
@@ -5,6 +5,9 @@
 #include <Print.h>
 #include <stdarg.h>
 #include <string>
+#ifdef ARCH_PORTDUINO
+#include <mutex>
+#endif
 
 /**
  * A Printable that can be switched to squirt its bytes to a different sink.
@@ -20,6 +23,11 @@ class RedirectablePrint : public Print
     StaticSemaphore_t _MutexStorageSpace;
 #else
     volatile bool inDebugPrint = false;
+#endif
+#ifdef ARCH_PORTDUINO
+    /// Other threads (DecodePool, PrefsWriter) log too, so each log line and the shared printBuf are held by one thread at a
+    /// time. Recursive, so logging from within logging still gets as far as the inDebugPrint check
+    std::recursive_mutex logLock;
 #endif
   public:
     explicit RedirectablePrint(Print *_dest) : dest(_dest) {}
@@ -46,6 +46,13 @@ SerialConsole::SerialConsole() : StreamAPI(&Port), RedirectablePrint(&Port), con
     Port.setRX(SERIAL2_RX);
 #endif
     Port.begin(SERIAL_BAUD);
+    owner = this;
+#if defined(ARCH_ESP32) && !ARDUINO_USB_CDC_ON_BOOT && !defined(USER_DEBUG_PORT) &&                                             \
+    ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 5)
+    // A hardware UART tells us when bytes arrive (on a FIFO threshold or a gap in the data), so we needn't poll for them
+    Port.onReceive([this]() { concurrency::wakeThread(this); });
+    rxWakesOwner = true;
+#endif
 #if defined(ARCH_NRF52) || defined(CONFIG_IDF_TARGET_ESP32S2) || defined(CONFIG_IDF_TARGET_ESP32S3) || defined(ARCH_RP2040) ||   \
     defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32C6)
     time_t timeout = millis();
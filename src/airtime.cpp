@@ -9,6 +9,12 @@ AirTime *airTime = NULL;
 uint32_t air_period_tx[PERIODS_TO_LOG];
 uint32_t air_period_rx[PERIODS_TO_LOG];
 
+#if ARCH_PORTDUINO
+#define LOCK_SKETCHES() std::lock_guard<std::mutex> guard(sketchLock)
+#else
+#define LOCK_SKETCHES()
+#endif
+
 void AirTime::logAirtime(reportTypes reportType, uint32_t airtime_ms)
 {
 
@@ -31,6 +37,45 @@ void AirTime::logAirtime(reportTypes reportType, uint32_t airtime_ms)
     this->channelUtilization[this->getPeriodUtilMinute()] = channelUtilization[this->getPeriodUtilMinute()] + airtime_ms;
 }
 
+void AirTime::logSourceAirtime(NodeNum from, meshtastic_PortNum portnum, uint32_t airtime_ms)
+{
+    LOCK_SKETCHES();
+    sources.add(sourceKey(from, portnum), airtime_ms);
+}
+
+void AirTime::logRelayAirtime(uint8_t relayNode, uint32_t airtime_ms)
+{
+    LOCK_SKETCHES();
+    relayers.add(relayNode, airtime_ms);
+}
+
+size_t AirTime::getTopSources(SourceSketch::Entry *out, size_t n)
+{
+    LOCK_SKETCHES();
+    return sources.top(out, n);
+}
+
+size_t AirTime::getTopRelayers(RelayerSketch::Entry *out, size_t n)
+{
+    LOCK_SKETCHES();
+    return relayers.top(out, n);
+}
+
+void AirTime::logTopTalkers()
+{
+    SourceSketch::Entry top[5];
+    size_t n = getTopSources(top, 5);
+    for (size_t i = 0; i < n; i++)
+        LOG_INFO("Top airtime %u: node 0x%x port %d, %ums, %u packets", (unsigned)i + 1, sourceNode(top[i].key),
+                 sourcePortnum(top[i].key), top[i].weight, top[i].count);
+
+    RelayerSketch::Entry topRelayers[5];
+    n = getTopRelayers(topRelayers, 5);
+    for (size_t i = 0; i < n; i++)
+        LOG_INFO("Top relayer %u: 0x%02x, %ums, %u packets", (unsigned)i + 1, topRelayers[i].key, topRelayers[i].weight,
+                 topRelayers[i].count);
+}
+
 uint8_t AirTime::currentPeriodIndex()
 {
     return ((getSecondsSinceBoot() / SECONDS_PER_PERIOD) % PERIODS_TO_LOG);
@@ -69,6 +114,12 @@ void AirTime::airtimeRotatePeriod()
         air_period_rx[0] = 0;
 
         this->airtimes.lastPeriodIndex = this->currentPeriodIndex();
+
+        // Report who used the airtime, then let the older half of it fade out
+        logTopTalkers();
+        LOCK_SKETCHES();
+        sources.decay();
+        relayers.decay();
     }
 }
 
@@ -3,8 +3,12 @@
 #include "MeshRadio.h"
 #include "concurrency/OSThread.h"
 #include "configuration.h"
+#include "HeavyHitters.h"
 #include <Arduino.h>
 #include <functional>
+#if ARCH_PORTDUINO
+#include <mutex>
+#endif
 
 /*
   TX_LOG      - Time on air this device has transmitted
@@ -33,6 +37,16 @@
 #define MS_IN_MINUTE (SECONDS_IN_MINUTE * 1000)
 #define MS_IN_HOUR (MINUTES_IN_HOUR * SECONDS_IN_MINUTE * 1000)
 
+// How many (source node, portnum) pairs and relayers we keep RX airtime for. Whoever uses more than 1/AIRTIME_TOP_TALKERS of
+// the airtime is guaranteed to be in there
+#ifndef AIRTIME_TOP_TALKERS
+#if ARCH_PORTDUINO
+#define AIRTIME_TOP_TALKERS 32
+#else
+#define AIRTIME_TOP_TALKERS 16
+#endif
+#endif
+
 enum reportTypes { TX_LOG, RX_LOG, RX_ALL_LOG };
 
 void logAirtime(reportTypes reportType, uint32_t airtime_ms);
@@ -62,6 +76,23 @@ class AirTime : private concurrency::OSThread
     bool isTxAllowedChannelUtil(bool polite = false);
     bool isTxAllowedAirUtil();
 
+    typedef HeavyHitters<uint64_t, AIRTIME_TOP_TALKERS> SourceSketch;
+    typedef HeavyHitters<uint8_t, AIRTIME_TOP_TALKERS> RelayerSketch;
+
+    /// Key of a (source node, portnum) pair in the sources sketch
+    static uint64_t sourceKey(NodeNum from, meshtastic_PortNum portnum) { return ((uint64_t)from << 16) | (uint16_t)portnum; }
+    static NodeNum sourceNode(uint64_t key) { return (NodeNum)(key >> 16); }
+    static meshtastic_PortNum sourcePortnum(uint64_t key) { return (meshtastic_PortNum)(key & 0xffff); }
+
+    /// Account the airtime of a received packet to its original sender and portnum (UNKNOWN_APP if we can't decode it)
+    void logSourceAirtime(NodeNum from, meshtastic_PortNum portnum, uint32_t airtime_ms);
+    /// Account the airtime of a received packet to the node which put it on the air, by the last byte in relay_node
+    void logRelayAirtime(uint8_t relayNode, uint32_t airtime_ms);
+
+    /// Copy the n heaviest (source node, portnum) pairs, heaviest first. Weights are in msec and halve every period
+    size_t getTopSources(SourceSketch::Entry *out, size_t n);
+    size_t getTopRelayers(RelayerSketch::Entry *out, size_t n);
+
   private:
     bool firstTime = true;
     uint8_t lastUtilPeriod = 0;
@@ -78,9 +109,18 @@ class AirTime : private concurrency::OSThread
         uint8_t lastPeriodIndex;
     } airtimes;
 
+    // RX airtime by who is responsible for it, decayed every period so it follows recent traffic
+    SourceSketch sources;
+    RelayerSketch relayers;
+#if ARCH_PORTDUINO
+    // The web server reads the sketches from its own thread
+    std::mutex sketchLock;
+#endif
+
     uint8_t getPeriodUtilMinute();
     uint8_t getPeriodUtilHour();
     uint8_t currentPeriodIndex();
+    void logTopTalkers();
 
   protected:
     virtual int32_t runOnce() override;
@@ -1,4 +1,5 @@
 #include "concurrency/BinarySemaphorePosix.h"
+#include "concurrency/Reactor.h"
 #include "configuration.h"
 
 #ifndef HAS_FREE_RTOS
@@ -15,14 +16,29 @@ BinarySemaphorePosix::~BinarySemaphorePosix() {}
  */
 bool BinarySemaphorePosix::take(uint32_t msec)
 {
+#ifdef ARCH_PORTDUINO
+    // Our only user is mainDelay, so sleeping in the reactor also lets readable sockets wake the loop
+    return reactor.wait(msec);
+#else
     delay(msec); // FIXME
     return false;
+#endif
 }
 
-void BinarySemaphorePosix::give() {}
+void BinarySemaphorePosix::give()
+{
+#ifdef ARCH_PORTDUINO
+    reactor.wake();
+#endif
+}
 
-IRAM_ATTR void BinarySemaphorePosix::giveFromISR(BaseType_t *pxHigherPriorityTaskWoken) {}
+IRAM_ATTR void BinarySemaphorePosix::giveFromISR(BaseType_t *pxHigherPriorityTaskWoken)
+{
+#ifdef ARCH_PORTDUINO
+    reactor.wake();
+#endif
+}
 
 } // namespace concurrency
 
-#endif
\ No newline at end of file
+#endif
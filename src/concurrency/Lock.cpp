@@ -27,6 +27,18 @@ void Lock::unlock()
         abort();
     }
 }
+#elif defined(ARCH_PORTDUINO)
+Lock::Lock() {}
+
+void Lock::lock()
+{
+    mutex.lock();
+}
+
+void Lock::unlock()
+{
+    mutex.unlock();
+}
 #else
 Lock::Lock() {}
 
@@ -2,11 +2,15 @@
 
 #include "../freertosinc.h"
 
+#if defined(ARCH_PORTDUINO) && !defined(HAS_FREE_RTOS)
+#include <mutex>
+#endif
+
 namespace concurrency
 {
 
 /**
- * @brief Simple wrapper around FreeRTOS API for implementing a mutex lock
+ * @brief Simple wrapper around FreeRTOS API for implementing a mutex lock, a std::recursive_mutex on portduino
  */
 class Lock
 {
@@ -29,6 +33,10 @@ class Lock
   private:
 #ifdef HAS_FREE_RTOS
     SemaphoreHandle_t handle;
+#elif defined(ARCH_PORTDUINO)
+    // meshtasticd has threads too (PrefsWriter, DecodePool). Recursive, as code written while this was a no-op may take a lock
+    // it already holds
+    std::recursive_mutex mutex;
 #endif
 };
 
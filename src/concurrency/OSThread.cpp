@@ -1,5 +1,6 @@
 #include "OSThread.h"
 #include "configuration.h"
+#include "main.h"
 #include "memGet.h"
 #include <assert.h>
 
@@ -99,6 +100,13 @@ void OSThread::run()
     currentThread = NULL;
 }
 
+void wakeThread(OSThread *t)
+{
+    t->setInterval(0);
+    runASAP = true;
+    mainDelay.interrupt();
+}
+
 int32_t OSThread::disable()
 {
     enabled = false;
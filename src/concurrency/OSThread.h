@@ -73,6 +73,9 @@ class OSThread : public Thread
     virtual void run();
 };
 
+/// Make t run on the next pass of the main loop, waking the loop if it is sleeping in mainDelay
+void wakeThread(OSThread *t);
+
 /**
  * This flag is set **only** when setup() starts, to provide a way for us to check for sloppy static constructor calls.
  * Call assertIsSetup() to force a crash if someone tries to create an instance too early.
@@ -0,0 +1,99 @@
+#include "concurrency/Reactor.h"
+
+#ifdef ARCH_PORTDUINO
+
+#include "concurrency/OSThread.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+/// How many ready fds we handle per wait(), any more are reported by the next one
+#define REACTOR_MAX_EVENTS 8
+
+namespace concurrency
+{
+
+Reactor reactor;
+
+Reactor::Reactor()
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || eventFd < 0) {
+        // Can't log yet, we are constructed before the console. wait() falls back to a plain delay.
+        if (epollFd >= 0)
+            ::close(epollFd);
+        epollFd = -1;
+        return;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, eventFd, &ev);
+}
+
+Reactor::~Reactor()
+{
+    if (epollFd >= 0)
+        ::close(epollFd);
+    if (eventFd >= 0)
+        ::close(eventFd);
+}
+
+bool Reactor::watch(int fd, OSThread *owner)
+{
+    if (epollFd < 0 || fd < 0)
+        return false;
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = owner;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) == 0)
+        return true;
+    // Already watched, perhaps for someone else
+    return errno == EEXIST && epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void Reactor::unwatch(int fd)
+{
+    if (epollFd >= 0 && fd >= 0)
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+bool Reactor::wait(uint32_t msec)
+{
+    if (epollFd < 0) {
+        ::delay(msec);
+        return false;
+    }
+
+    epoll_event events[REACTOR_MAX_EVENTS];
+    int n = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, msec > INT32_MAX ? -1 : (int)msec);
+    for (int i = 0; i < n; i++) {
+        OSThread *owner = (OSThread *)events[i].data.ptr;
+        if (owner) {
+            // We are on the main thread and about to return to the loop, so no need for the full wakeThread()
+            owner->setInterval(0);
+        } else {
+            uint64_t count;
+            while (::read(eventFd, &count, sizeof(count)) > 0)
+                ;
+        }
+    }
+    // n < 0 is EINTR, which counts as a timeout so the caller just goes around the loop again
+    return n > 0;
+}
+
+void Reactor::wake()
+{
+    if (eventFd >= 0) {
+        uint64_t one = 1;
+        ssize_t r = ::write(eventFd, &one, sizeof(one));
+        (void)r; // only fails if the counter would overflow, in which case a wakeup is pending anyway
+    }
+}
+
+} // namespace concurrency
+
+#endif
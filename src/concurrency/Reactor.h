@@ -0,0 +1,53 @@
+#pragma once
+
+#include "configuration.h"
+
+#ifdef ARCH_PORTDUINO
+
+#include <stdint.h>
+
+namespace concurrency
+{
+
+class OSThread;
+
+/**
+ * Lets meshtasticd sleep until a socket has something for us instead of polling it.
+ *
+ * The main loop's idle delay (mainDelay) is an epoll_wait() on this reactor. A watched fd becoming readable (or being hung
+ * up on) schedules its owning OSThread to run immediately, and wake() ends the wait early from any thread, which is what
+ * makes mainDelay.interrupt() work on Linux.
+ *
+ * Watches are edge triggered: the owner is woken once per arrival, so it must drain what it can when it runs (a short
+ * fallback interval is still a good idea in case it can't). Everything except wake() must be called from the main thread.
+ */
+class Reactor
+{
+    int epollFd = -1;
+    /// Written by wake(), watched with a NULL owner
+    int eventFd = -1;
+
+  public:
+    Reactor();
+    ~Reactor();
+
+    /** Run owner as soon as fd is readable, until unwatch(fd). Returns false if fd can't be watched */
+    bool watch(int fd, OSThread *owner);
+
+    void unwatch(int fd);
+
+    /**
+     * Sleep for up to msec, waking early for wake() or readable fds.
+     * Returns false if we timed out
+     */
+    bool wait(uint32_t msec);
+
+    /** End the current (or next) wait(), safe from any thread or a signal handler */
+    void wake();
+};
+
+extern Reactor reactor;
+
+} // namespace concurrency
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace concurrency
+{
+
+/**
+ * A bounded ring for passing elements from exactly one producer to exactly one consumer without locks.
+ *
+ * Unlike TypedQueue this never takes a mutex (portduino) or enters a FreeRTOS critical section, so pushing costs a couple of
+ * stores. Each push wakes the reader thread set with setReader(), which replaces polling or setReceivedMessage() style
+ * hacks.
+ *
+ * Only push() may be called by the producer and only pop() by the consumer. size() and empty() are a snapshot which is
+ * exact only from the consumer's side.
+ */
+template <class T, size_t N> class SpscRing
+{
+    static_assert(N && (N & (N - 1)) == 0, "SpscRing size must be a power of 2");
+
+    T slots[N];
+    /// Number of elements ever popped, only written by the consumer
+    std::atomic<uint32_t> head{0};
+    /// Number of elements ever pushed, only written by the producer
+    std::atomic<uint32_t> tail{0};
+    OSThread *reader = NULL;
+
+  public:
+    /** Add x, returns false if the ring is full */
+    bool push(const T &x)
+    {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) >= N)
+            return false;
+        slots[t & (N - 1)] = x;
+        tail.store(t + 1, std::memory_order_release);
+        if (reader)
+            wakeThread(reader);
+        return true;
+    }
+
+    /** Take the oldest element, returns false if the ring is empty */
+    bool pop(T *out)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return false;
+        *out = slots[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+    /** Set the thread which pops, to be scheduled ASAP whenever something is pushed */
+    void setReader(OSThread *t) { reader = t; }
+};
+
+} // namespace concurrency
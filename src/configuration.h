@@ -224,6 +224,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define GPS_THREAD_INTERVAL 200
 #endif
 
+// Have U-blox M8 and later report their solution as binary UBX-NAV-PVT instead of NMEA GGA and RMC text
+#ifndef GPS_UBX_NAV_PVT
+#define GPS_UBX_NAV_PVT 0
+#endif
+
 /* Step #2: follow with defines common to the architecture;
    also enable HAS_ option not specifically disabled by variant.h */
 #include "architecture.h"
@@ -2,6 +2,9 @@
 
 #if !MESHTASTIC_EXCLUDE_I2C
 
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "SafeFile.h"
 #include "concurrency/LockGuard.h"
 #if defined(ARCH_PORTDUINO)
 #include "linux/LinuxHardwareI2C.h"
@@ -80,6 +83,18 @@ ScanI2C::DeviceType ScanI2CTwoWire::probeOLED(ScanI2C::DeviceAddress addr) const
 }
 uint16_t ScanI2CTwoWire::getRegisterValue(const ScanI2CTwoWire::RegisterLocation &registerLocation,
                                           ScanI2CTwoWire::ResponseWidth responseWidth, bool zeropad = false) const
+{
+    uint16_t value = readRegister(registerLocation, responseWidth, zeropad, 20);
+    if (!lastSignature.width && !zeropad) {
+        lastSignature.reg = registerLocation.registerAddress;
+        lastSignature.width = responseWidth;
+        lastSignature.value = value;
+    }
+    return value;
+}
+
+uint16_t ScanI2CTwoWire::readRegister(const ScanI2CTwoWire::RegisterLocation &registerLocation,
+                                      ScanI2CTwoWire::ResponseWidth responseWidth, bool zeropad, uint32_t waitMs) const
 {
     uint16_t value = 0x00;
     TwoWire *i2cBus = fetchI2CBus(registerLocation.i2cAddress);
@@ -92,7 +107,7 @@ uint16_t ScanI2CTwoWire::getRegisterValue(const ScanI2CTwoWire::RegisterLocation
         i2cBus->write((int)0);
     }
     i2cBus->endTransmission();
-    delay(20);
+    delay(waitMs);
     i2cBus->requestFrom(registerLocation.i2cAddress.address, responseWidth);
     if (i2cBus->available() > 1) {
         // Read MSB, then LSB
@@ -151,6 +166,9 @@ void ScanI2CTwoWire::scanPort(I2CPort port, uint8_t *address, uint8_t asize)
     // 0x78-0x7B 10-bit slave addressing
     // 0x7C-0x7F Reserved for future purposes
 
+    // First see which addresses answer, that's quick compared to working out what each device is
+    uint8_t answered[120 - 8];
+    uint8_t numAnswered = 0;
     for (addr.address = 8; addr.address < 120; addr.address++) {
         if (asize != 0) {
             if (!in_array(address, asize, (uint8_t)addr.address))
@@ -171,8 +189,36 @@ void ScanI2CTwoWire::scanPort(I2CPort port, uint8_t *address, uint8_t asize)
 #else
         err = i2cBus->endTransmission();
 #endif
-        type = NONE;
         if (err == 0) {
+            answered[numAnswered++] = addr.address;
+        } else if (err == 4) {
+            LOG_ERROR("Unknown error at address 0x%x", (uint8_t)addr.address);
+        }
+    }
+
+    // If the same addresses answer as last time, it's the same hardware as last time
+    bool useCache = asize == 0 && numAnswered > 0 && cacheMatches(port, answered, numAnswered);
+    if (useCache)
+        LOG_INFO("Same I2C addresses as the last scan on port %d, skip identifying the devices", port);
+
+    for (uint8_t i = 0; i < numAnswered; i++) {
+        addr.address = answered[i];
+        type = NONE;
+        auto cached = cachedDevices.find(cacheKey(addr));
+        // The RV3028 is set up while we scan, and probing an OLED is as quick as checking it, so both always take the long
+        // way. Other addresses are shared by several chips, so make sure it's still the same one
+        bool fromCache = useCache && cached->second.type != RTC_RV3028 && addr.address != SSD1306_ADDRESS;
+        if (fromCache && !signatureMatches(addr, cached->second.signature)) {
+            LOG_INFO("Device at address 0x%x changed since the last scan", (uint8_t)addr.address);
+            fromCache = false;
+        }
+        lastSignature = ScanSignature();
+        if (fromCache) {
+            type = cached->second.type;
+            lastSignature = cached->second.signature;
+            if (type != NONE)
+                LOG_INFO("Device type %d at address 0x%x, as in the last scan", type, (uint8_t)addr.address);
+        } else {
             switch (addr.address) {
             case SSD1306_ADDRESS:
                 type = probeOLED(addr);
@@ -504,10 +550,11 @@ void ScanI2CTwoWire::scanPort(I2CPort port, uint8_t *address, uint8_t asize)
             default:
                 LOG_INFO("Device found at address 0x%x was not able to be enumerated", (uint8_t)addr.address);
             }
-        } else if (err == 4) {
-            LOG_ERROR("Unknown error at address 0x%x", (uint8_t)addr.address);
         }
 
+        if (asize == 0)
+            scannedDevices[cacheKey(addr)] = {type, lastSignature};
+
         // Check if a type was found for the enumerated device - save, if so
         if (type != NONE) {
             deviceAddresses[type] = addr;
@@ -543,4 +590,116 @@ void ScanI2CTwoWire::logFoundDevice(const char *device, uint8_t address)
 {
     LOG_INFO("%s found at address 0x%x", device, address);
 }
+
+/// What the full scans found last time, so we don't have to identify the same devices on every boot
+static const char *i2cScanCacheFileName = "/prefs/i2c.dat";
+#define I2C_SCAN_CACHE_MAGIC 0x49324332 // "I2C2"
+#define I2C_SCAN_CACHE_MAX 64
+
+struct I2CScanCacheHeader {
+    uint32_t magic;
+    char firmwareVersion[18]; // Identification changes between releases, so a new one scans from scratch
+    uint8_t count;
+    uint8_t reserved;
+};
+
+struct I2CScanCacheEntry {
+    uint8_t port;
+    uint8_t address;
+    uint8_t type; // DeviceType, NONE for a device we couldn't identify
+    uint8_t signatureReg;
+    uint8_t signatureWidth;
+    uint8_t reserved;
+    uint16_t signatureValue;
+};
+
+void ScanI2CTwoWire::loadScanCache()
+{
+    cacheLoaded = true;
+#ifdef FSCom
+    I2CScanCacheHeader header;
+    I2CScanCacheEntry entries[I2C_SCAN_CACHE_MAX];
+    concurrency::LockGuard g(spiLock);
+    auto file = FSCom.open(i2cScanCacheFileName, FILE_O_READ);
+    if (!file)
+        return;
+    bool okay = file.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == I2C_SCAN_CACHE_MAGIC &&
+                strncmp(header.firmwareVersion, optstr(APP_VERSION), sizeof(header.firmwareVersion)) == 0 &&
+                header.count <= I2C_SCAN_CACHE_MAX &&
+                file.read((uint8_t *)entries, header.count * sizeof(entries[0])) == header.count * sizeof(entries[0]);
+    file.close();
+    if (!okay)
+        return;
+    for (uint8_t i = 0; i < header.count; i++) {
+        ScannedDevice &d = cachedDevices[cacheKey(DeviceAddress((I2CPort)entries[i].port, entries[i].address))];
+        d.type = (DeviceType)entries[i].type;
+        d.signature.reg = entries[i].signatureReg;
+        d.signature.width = entries[i].signatureWidth;
+        d.signature.value = entries[i].signatureValue;
+    }
+#endif
+}
+
+bool ScanI2CTwoWire::cacheMatches(I2CPort port, const uint8_t *addresses, uint8_t count)
+{
+    if (!cacheLoaded)
+        loadScanCache();
+
+    uint8_t cachedOnPort = 0;
+    for (auto &d : cachedDevices)
+        if (d.first >> 8 == port)
+            cachedOnPort++;
+    if (cachedOnPort != count)
+        return false;
+    for (uint8_t i = 0; i < count; i++)
+        if (cachedDevices.find(cacheKey(DeviceAddress(port, addresses[i]))) == cachedDevices.end())
+            return false;
+    return true;
+}
+
+bool ScanI2CTwoWire::signatureMatches(ScanI2C::DeviceAddress addr, const ScanSignature &signature) const
+{
+    if (!signature.width)
+        return true; // Whatever answers at this address would be taken for the same device
+    // ID registers read back at once, the 20 ms getRegisterValue() waits is for devices which run a command first. If one of
+    // those isn't ready yet, we only lose the time of identifying it again
+    return readRegister(RegisterLocation(addr, signature.reg), signature.width, false, 2) == signature.value;
+}
+
+void ScanI2CTwoWire::saveScanCache()
+{
+#ifdef FSCom
+    concurrency::LockGuard guard((concurrency::Lock *)&lock);
+
+    if (!cacheLoaded)
+        loadScanCache();
+    // Only write flash if something changed, which is almost never
+    if (scannedDevices == cachedDevices || scannedDevices.size() > I2C_SCAN_CACHE_MAX)
+        return;
+
+    I2CScanCacheHeader header = {};
+    header.magic = I2C_SCAN_CACHE_MAGIC;
+    strncpy(header.firmwareVersion, optstr(APP_VERSION), sizeof(header.firmwareVersion));
+    header.count = scannedDevices.size();
+    auto file = SafeFile(i2cScanCacheFileName);
+    file.write((const uint8_t *)&header, sizeof(header));
+    for (auto &d : scannedDevices) {
+        I2CScanCacheEntry entry = {};
+        entry.port = d.first >> 8;
+        entry.address = d.first;
+        entry.type = d.second.type;
+        entry.signatureReg = d.second.signature.reg;
+        entry.signatureWidth = d.second.signature.width;
+        entry.signatureValue = d.second.signature.value;
+        file.write((const uint8_t *)&entry, sizeof(entry));
+    }
+    spiLock->lock();
+    bool okay = file.close();
+    spiLock->unlock();
+    if (okay)
+        cachedDevices = scannedDevices;
+    else
+        LOG_WARN("Can't write %s", i2cScanCacheFileName);
+#endif
+}
 #endif
\ No newline at end of file
@@ -29,6 +29,13 @@ class ScanI2CTwoWire : public ScanI2C
 
     size_t countDevices() const override;
 
+    /**
+     * Remember what the full scans found. On the next boot, a port where exactly the same addresses answer gets the device
+     * types from last time for each device whose first ID register still reads the same, instead of going through all the
+     * probes (and their 20 ms waits) again.
+     */
+    void saveScanCache();
+
   protected:
     FoundDevice firstOfOrNONE(size_t, DeviceType[]) const override;
 
@@ -53,8 +60,44 @@ class ScanI2CTwoWire : public ScanI2C
 
     concurrency::Lock lock;
 
+    /** The first register read while identifying a device, read again to check that a cached device is still the same chip */
+    struct ScanSignature {
+        RegisterAddress reg = 0;
+        ResponseWidth width = 0; // 0 if the device was identified by its address alone
+        uint16_t value = 0;
+
+        bool operator==(const ScanSignature &o) const { return reg == o.reg && width == o.width && value == o.value; }
+    };
+
+    struct ScannedDevice {
+        ScanI2C::DeviceType type; // NONE for a device we couldn't identify
+        ScanSignature signature;
+
+        bool operator==(const ScannedDevice &o) const { return type == o.type && signature == o.signature; }
+    };
+
+    // Keyed on port << 8 | address, every device which answered a full scan with what we identified it as
+    std::map<uint16_t, ScannedDevice> scannedDevices;
+    std::map<uint16_t, ScannedDevice> cachedDevices; // What the last boot found
+    bool cacheLoaded = false;
+
+    // Set by the first getRegisterValue() while identifying a device
+    mutable ScanSignature lastSignature;
+
+    static uint16_t cacheKey(const ScanI2C::DeviceAddress &addr) { return (uint16_t)addr.port << 8 | addr.address; }
+
+    void loadScanCache();
+
+    /** True if the addresses which answered on port are exactly those from the last boot */
+    bool cacheMatches(ScanI2C::I2CPort port, const uint8_t *addresses, uint8_t count);
+
+    /** True if the register in signature still reads the same, or there is nothing to read */
+    bool signatureMatches(ScanI2C::DeviceAddress addr, const ScanSignature &signature) const;
+
     uint16_t getRegisterValue(const RegisterLocation &, ResponseWidth, bool) const;
 
+    uint16_t readRegister(const RegisterLocation &, ResponseWidth, bool zeropad, uint32_t waitMs) const;
+
     DeviceType probeOLED(ScanI2C::DeviceAddress) const;
 
     static void logFoundDevice(const char *device, uint8_t address);
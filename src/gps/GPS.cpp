@@ -10,8 +10,10 @@
 #include "NodeDB.h"
 #include "PowerMon.h"
 #include "RTC.h"
+#include "SafeFile.h"
 #include "Throttle.h"
 #include "buzz.h"
+#include "concurrency/LockGuard.h"
 #include "concurrency/Periodic.h"
 #include "meshUtils.h"
 
@@ -222,48 +224,16 @@ uint8_t GPS::makeCASPacket(uint8_t class_id, uint8_t msg_id, uint8_t payload_siz
     return (payload_size + 10);
 }
 
-GPS_RESPONSE GPS::getACK(const char *message, uint32_t waitMillis)
+// Make the UBX-ACK-ACK we expect for a class and message id
+static void makeUBXAck(uint8_t *buf, uint8_t class_id, uint8_t msg_id)
 {
-    uint8_t buffer[768] = {0};
-    uint8_t b;
-    int bytesRead = 0;
-    uint32_t startTimeout = millis() + waitMillis;
-#ifdef GPS_DEBUG
-    std::string debugmsg = "";
-#endif
-    while (millis() < startTimeout) {
-        if (_serial_gps->available()) {
-            b = _serial_gps->read();
-
-#ifdef GPS_DEBUG
-            debugmsg += vformat("%c", (b >= 32 && b <= 126) ? b : '.');
-#endif
-            buffer[bytesRead] = b;
-            bytesRead++;
-            if ((bytesRead == 767) || (b == '\r')) {
-                if (strnstr((char *)buffer, message, bytesRead) != nullptr) {
-#ifdef GPS_DEBUG
-                    LOG_DEBUG("Found: %s", message); // Log the found message
-#endif
-                    return GNSS_RESPONSE_OK;
-                } else {
-                    bytesRead = 0;
-#ifdef GPS_DEBUG
-                    LOG_DEBUG(debugmsg.c_str());
-#endif
-                }
-            }
-        }
-    }
-    return GNSS_RESPONSE_NONE;
+    const uint8_t ack[10] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, class_id, msg_id, 0x00, 0x00};
+    memcpy(buf, ack, sizeof(ack));
+    UBXChecksum(buf, sizeof(ack));
 }
 
-GPS_RESPONSE GPS::getACKCas(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis)
+GPS_RESPONSE GPS::readACKCas(uint8_t class_id, uint8_t msg_id)
 {
-    uint32_t startTime = millis();
-    uint8_t buffer[CAS_ACK_NACK_MSG_SIZE] = {0};
-    uint8_t bufferPos = 0;
-
     // CAS-ACK-(N)ACK structure
     //         | H1   | H2   | Payload Len | cls  | msg  | Payload                   | Checksum (4)              |
     //         |      |      |             |      |      | Cls  | Msg  | Reserved    |                           |
@@ -271,203 +241,164 @@ GPS_RESPONSE GPS::getACKCas(uint8_t class_id, uint8_t msg_id, uint32_t waitMilli
     // ACK-NACK| 0xBA | 0xCE | 0x04 | 0x00 | 0x05 | 0x00 | 0xXX | 0xXX | 0x00 | 0x00 | 0xXX | 0xXX | 0xXX | 0xXX |
     // ACK-ACK | 0xBA | 0xCE | 0x04 | 0x00 | 0x05 | 0x01 | 0xXX | 0xXX | 0x00 | 0x00 | 0xXX | 0xXX | 0xXX | 0xXX |
 
-    while (Throttle::isWithinTimespanMs(startTime, waitMillis)) {
-        if (_serial_gps->available()) {
-            buffer[bufferPos++] = _serial_gps->read();
-
-            // keep looking at the first two bytes of buffer until
-            // we have found the CAS frame header (0xBA, 0xCE), if not
-            // keep reading bytes until we find a frame header or we run
-            // out of time.
-            if ((bufferPos == 2) && !(buffer[0] == 0xBA && buffer[1] == 0xCE)) {
-                buffer[0] = buffer[1];
-                buffer[1] = 0;
-                bufferPos = 1;
-            }
-        }
+    while (_serial_gps->available()) {
+        initRx.push_back(_serial_gps->read());
+
+        // keep looking at the first two bytes of the buffer until
+        // we have found the CAS frame header (0xBA, 0xCE)
+        if (initRx.size() == 2 && !(initRx[0] == 0xBA && initRx[1] == 0xCE))
+            initRx.erase(initRx.begin());
 
         // we have read all the bytes required for the Ack/Nack (14-bytes)
         // and we must have found a frame to get this far
-        if (bufferPos == sizeof(buffer) - 1) {
-            uint8_t msg_cls = buffer[4];     // message class should be 0x05
-            uint8_t msg_msg_id = buffer[5];  // message id should be 0x00 or 0x01
-            uint8_t payload_cls = buffer[6]; // payload class id
-            uint8_t payload_msg = buffer[7]; // payload message id
-
-            // Check for an ACK-ACK for the specified class and message id
-            if ((msg_cls == 0x05) && (msg_msg_id == 0x01) && payload_cls == class_id && payload_msg == msg_id) {
+        if (initRx.size() == CAS_ACK_NACK_MSG_SIZE) {
+            uint8_t msg_cls = initRx[4];     // message class should be 0x05
+            uint8_t msg_msg_id = initRx[5];  // message id should be 0x00 or 0x01
+            uint8_t payload_cls = initRx[6]; // payload class id
+            uint8_t payload_msg = initRx[7]; // payload message id
+            initRx.clear();
+
+            if (msg_cls == 0x05 && payload_cls == class_id && payload_msg == msg_id) {
+                if (msg_msg_id == 0x01) {
 #ifdef GPS_DEBUG
-                LOG_INFO("Got ACK for class %02X message %02X in %dms", class_id, msg_id, millis() - startTime);
+                    LOG_INFO("Got ACK for class %02X message %02X in %dms", class_id, msg_id, millis() - initStepMsec);
 #endif
-                return GNSS_RESPONSE_OK;
-            }
-
-            // Check for an ACK-NACK for the specified class and message id
-            if ((msg_cls == 0x05) && (msg_msg_id == 0x00) && payload_cls == class_id && payload_msg == msg_id) {
+                    return GNSS_RESPONSE_OK;
+                }
+                if (msg_msg_id == 0x00) {
 #ifdef GPS_DEBUG
-                LOG_WARN("Got NACK for class %02X message %02X in %dms", class_id, msg_id, millis() - startTime);
+                    LOG_WARN("Got NACK for class %02X message %02X in %dms", class_id, msg_id, millis() - initStepMsec);
 #endif
-                return GNSS_RESPONSE_NAK;
+                    return GNSS_RESPONSE_NAK;
+                }
             }
-
-            // This isn't the frame we are looking for, clear the buffer
-            // and try again until we run out of time.
-            memset(buffer, 0x0, sizeof(buffer));
-            bufferPos = 0;
+            // This isn't the frame we are looking for, keep looking
         }
     }
     return GNSS_RESPONSE_NONE;
 }
 
-GPS_RESPONSE GPS::getACK(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis)
+GPS_RESPONSE GPS::readACK(uint8_t class_id, uint8_t msg_id)
 {
-    uint8_t b;
-    uint8_t ack = 0;
-    const uint8_t ackP[2] = {class_id, msg_id};
-    uint8_t buf[10] = {0xB5, 0x62, 0x05, 0x01, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00};
-    uint32_t startTime = millis();
-    const char frame_errors[] = "More than 100 frame errors";
-    int sCounter = 0;
+    uint8_t buf[10];
+    static const char frame_errors[] = "More than 100 frame errors";
+    makeUBXAck(buf, class_id, msg_id);
+
+    while (_serial_gps->available()) {
+        uint8_t b = _serial_gps->read();
+        if (b == frame_errors[initFrameErrors]) {
+            if (++initFrameErrors == sizeof(frame_errors) - 1)
+                return GNSS_RESPONSE_FRAME_ERRORS;
+        } else {
+            initFrameErrors = 0;
+        }
+        if (b == buf[initMatch]) {
+            if (++initMatch == sizeof(buf)) {
 #ifdef GPS_DEBUG
-    std::string debugmsg = "";
+                LOG_INFO("Got ACK for class %02X message %02X in %dms", class_id, msg_id, millis() - initStepMsec);
 #endif
-
-    for (int j = 2; j < 6; j++) {
-        buf[8] += buf[j];
-        buf[9] += buf[8];
+                return GNSS_RESPONSE_OK; // ACK received
+            }
+        } else {
+            if (initMatch == 3 && b == 0x00) { // UBX-ACK-NAK message
+                LOG_WARN("Got NAK for class %02X message %02X", class_id, msg_id);
+                return GNSS_RESPONSE_NAK; // NAK received
+            }
+            initMatch = 0; // Reset the acknowledgement counter
+        }
     }
+    return GNSS_RESPONSE_NONE;
+}
 
-    for (int j = 0; j < 2; j++) {
-        buf[6 + j] = ackP[j];
-        buf[8] += buf[6 + j];
-        buf[9] += buf[8];
-    }
+/// Largest UBX payload we read while probing, UBX-MON-VER is 40 bytes plus 30 per extension
+#define GPS_MAX_PROBE_PAYLOAD 768
 
-    while (Throttle::isWithinTimespanMs(startTime, waitMillis)) {
-        if (ack > 9) {
-#ifdef GPS_DEBUG
-            LOG_INFO("Got ACK for class %02X message %02X in %dms", class_id, msg_id, millis() - startTime);
-#endif
-            return GNSS_RESPONSE_OK; // ACK received
-        }
-        if (_serial_gps->available()) {
-            b = _serial_gps->read();
-            if (b == frame_errors[sCounter]) {
-                sCounter++;
-                if (sCounter == 26) {
-#ifdef GPS_DEBUG
+/// Longest line we look at while probing, NMEA sentences are at most 82 chars
+#define GPS_MAX_PROBE_LINE 128
 
-                    LOG_DEBUG(debugmsg.c_str());
-#endif
-                    return GNSS_RESPONSE_FRAME_ERRORS;
-                }
-            } else {
-                sCounter = 0;
-            }
-#ifdef GPS_DEBUG
-            debugmsg += vformat("%02X", b);
-#endif
-            if (b == buf[ack]) {
-                ack++;
-            } else {
-                if (ack == 3 && b == 0x00) { // UBX-ACK-NAK message
+/**
+ * @brief  Look for a UBX message of the requested class and message ID, and collect its payload in initRx
+ * @retval length of payload message once we have all of it, 0 until then
+ */
+uint16_t GPS::readPayload(uint8_t requestedClass, uint8_t requestedID)
+{
+    while (_serial_gps->available()) {
+        int c = _serial_gps->read();
+        switch (initMatch) {
+        case 0:
+            // ubxFrame 'μ'
+            if (c == 0xB5)
+                initMatch++;
+            break;
+        case 1:
+            // ubxFrame 'b'
+            initMatch = (c == 0x62) ? initMatch + 1 : 0;
+            break;
+        case 2:
+            // Class
+            initMatch = (c == requestedClass) ? initMatch + 1 : 0;
+            break;
+        case 3:
+            // Message ID
+            initMatch = (c == requestedID) ? initMatch + 1 : 0;
+            break;
+        case 4:
+            // Payload length lsb
+            initRxNeeded = c;
+            initMatch++;
+            break;
+        case 5:
+            // Payload length msb
+            initRxNeeded |= (c << 8);
+            initRx.clear();
+            // Check for buffer overflow
+            initMatch = (initRxNeeded && initRxNeeded < GPS_MAX_PROBE_PAYLOAD) ? initMatch + 1 : 0;
+            break;
+        default:
+            initRx.push_back(c);
+            if (initRx.size() == initRxNeeded) {
 #ifdef GPS_DEBUG
-                    LOG_DEBUG(debugmsg.c_str());
+                LOG_INFO("Got ACK for class %02X message %02X in %dms", requestedClass, requestedID, millis() - initStepMsec);
 #endif
-                    LOG_WARN("Got NAK for class %02X message %02X", class_id, msg_id);
-                    return GNSS_RESPONSE_NAK; // NAK received
-                }
-                ack = 0; // Reset the acknowledgement counter
+                initMatch = 0;
+                return initRxNeeded;
             }
+            break;
         }
     }
-#ifdef GPS_DEBUG
-    LOG_DEBUG(debugmsg.c_str());
-    LOG_WARN("No response for class %02X message %02X", class_id, msg_id);
-#endif
-    return GNSS_RESPONSE_NONE; // No response received within timeout
+    return 0;
 }
 
-/**
- * @brief
- * @note   New method, this method can wait for the specified class and message ID, and return the payload
- * @param  *buffer: The message buffer, if there is a response payload message, it will be returned through the buffer parameter
- * @param  size:    size of buffer
- * @param  requestedClass:  request class constant
- * @param  requestedID:     request message ID constant
- * @retval length of payload message
- */
-int GPS::getACK(uint8_t *buffer, uint16_t size, uint8_t requestedClass, uint8_t requestedID, uint32_t waitMillis)
+static const char *PROBE_MESSAGE = "Trying %s (%s)...";
+static const char *DETECTED_MESSAGE = "%s detected";
+
+/// Look for one of chips in the lines the module sent so far
+GnssModel_t GPS::readProbeResponse(const ChipInfo *chips, uint8_t numChips)
 {
-    uint16_t ubxFrameCounter = 0;
-    uint32_t startTime = millis();
-    uint16_t needRead = 0;
-
-    while (Throttle::isWithinTimespanMs(startTime, waitMillis)) {
-        if (_serial_gps->available()) {
-            int c = _serial_gps->read();
-            switch (ubxFrameCounter) {
-            case 0:
-                // ubxFrame 'μ'
-                if (c == 0xB5) {
-                    ubxFrameCounter++;
-                }
-                break;
-            case 1:
-                // ubxFrame 'b'
-                if (c == 0x62) {
-                    ubxFrameCounter++;
-                } else {
-                    ubxFrameCounter = 0;
-                }
-                break;
-            case 2:
-                // Class
-                if (c == requestedClass) {
-                    ubxFrameCounter++;
-                } else {
-                    ubxFrameCounter = 0;
-                }
-                break;
-            case 3:
-                // Message ID
-                if (c == requestedID) {
-                    ubxFrameCounter++;
-                } else {
-                    ubxFrameCounter = 0;
-                }
-                break;
-            case 4:
-                // Payload length lsb
-                needRead = c;
-                ubxFrameCounter++;
-                break;
-            case 5:
-                // Payload length msb
-                needRead |= (c << 8);
-                ubxFrameCounter++;
-                // Check for buffer overflow
-                if (needRead >= size) {
-                    ubxFrameCounter = 0;
-                    break;
-                }
-                if (_serial_gps->readBytes(buffer, needRead) != needRead) {
-                    ubxFrameCounter = 0;
-                } else {
-                    // return payload length
+    while (_serial_gps->available()) {
+        char c = _serial_gps->read();
+        if (initRx.size() < GPS_MAX_PROBE_LINE)
+            initRx.push_back(c);
+        bool endOfLine = (c == '\n');
+
+        if (c == ',' || endOfLine) {
+            initRx.push_back('\0');
 #ifdef GPS_DEBUG
-                    LOG_INFO("Got ACK for class %02X message %02X in %dms", requestedClass, requestedID, millis() - startTime);
+            LOG_DEBUG((const char *)initRx.data());
 #endif
-                    return needRead;
+            // check if we can see our chips
+            for (uint8_t i = 0; i < numChips; i++) {
+                if (strstr((const char *)initRx.data(), chips[i].detectionString) != nullptr) {
+                    LOG_INFO(DETECTED_MESSAGE, chips[i].chipName);
+                    return chips[i].driver;
                 }
-                break;
-
-            default:
-                break;
             }
+            initRx.pop_back();
         }
+        if (endOfLine)
+            initRx.clear(); // Start over for the next potential message
     }
-    return 0;
+    return GNSS_MODEL_UNKNOWN;
 }
 
 #if GPS_BAUDRATE_FIXED
@@ -483,330 +414,738 @@ static const int rareSerialSpeeds[3] = {4800, 57600, GPS_BAUDRATE};
 #define GPS_PROBETRIES 2
 #endif
 
-/**
- * @brief  Setup the GPS based on the model detected.
- *  We detect the GPS by cycling through a set of baud rates, first common then rare.
- *  For each baud rate, we run GPS::Probe to send commands and match the responses
- *  to known GPS responses.
- * @retval Whether setup reached the end of its potential to configure the GPS.
- */
-bool GPS::setup()
+/// How often we look for the answer to a command while detecting or configuring the module
+#ifndef GPS_INIT_POLL_MSEC
+#define GPS_INIT_POLL_MSEC 5
+#endif
+
+/// If we skipped the probe but hear nothing valid from the module for this long, we probe after all
+#define GPS_CACHE_CONFIRM_MSEC (15 * 1000)
+
+/// The model and baud rate we found last time
+static const char *gpsCacheFileName = "/prefs/gps.dat";
+#define GPS_CACHE_MAGIC 0x47505331 // "GPS1"
+
+struct GpsCacheRecord {
+    uint32_t magic;
+    uint32_t baud;
+    uint8_t model; // GnssModel_t
+    uint8_t protocolVersion;
+    uint8_t reserved[2];
+};
+
+bool GPS::loadCachedModel()
 {
-    if (!didSerialInit) {
-        int msglen = 0;
-        if (tx_gpio && gnssModel == GNSS_MODEL_UNKNOWN) {
-#ifdef TRACKER_T1000_E
-            // add power up/down strategy, improve ag3335 detection success
-            digitalWrite(PIN_GPS_EN, LOW);
-            delay(500);
-            digitalWrite(GPS_VRTC_EN, LOW);
-            delay(1000);
-            digitalWrite(GPS_VRTC_EN, HIGH);
-            delay(500);
-            digitalWrite(PIN_GPS_EN, HIGH);
-            delay(1000);
+#ifdef FSCom
+    GpsCacheRecord rec;
+    concurrency::LockGuard g(spiLock);
+    auto file = FSCom.open(gpsCacheFileName, FILE_O_READ);
+    if (!file)
+        return false;
+    bool okay = file.read((uint8_t *)&rec, sizeof(rec)) == sizeof(rec);
+    file.close();
+    if (!okay || rec.magic != GPS_CACHE_MAGIC || rec.model == GNSS_MODEL_UNKNOWN || rec.model > GNSS_MODEL_LS20031 || !rec.baud)
+        return false;
+
+    gnssModel = (GnssModel_t)rec.model;
+    initBaud = rec.baud;
+    ublox_info.protocol_version = rec.protocolVersion;
+    return true;
+#else
+    return false;
 #endif
-            if (probeTries < GPS_PROBETRIES) {
-                LOG_DEBUG("Probe for GPS at %d", serialSpeeds[speedSelect]);
-                gnssModel = probe(serialSpeeds[speedSelect]);
-                if (gnssModel == GNSS_MODEL_UNKNOWN) {
-                    if (++speedSelect == array_count(serialSpeeds)) {
-                        speedSelect = 0;
-                        ++probeTries;
-                    }
-                }
-            }
-            // Rare Serial Speeds
-            if (probeTries == GPS_PROBETRIES) {
-                LOG_DEBUG("Probe for GPS at %d", rareSerialSpeeds[speedSelect]);
-                gnssModel = probe(rareSerialSpeeds[speedSelect]);
-                if (gnssModel == GNSS_MODEL_UNKNOWN) {
-                    if (++speedSelect == array_count(rareSerialSpeeds)) {
-                        LOG_WARN("Give up on GPS probe and set to %d", GPS_BAUDRATE);
-                        return true;
-                    }
-                }
-            }
+}
+
+void GPS::saveCachedModel()
+{
+#ifdef FSCom
+    GpsCacheRecord rec = {GPS_CACHE_MAGIC, (uint32_t)initBaud, (uint8_t)gnssModel, ublox_info.protocol_version, {0, 0}};
+    auto file = SafeFile(gpsCacheFileName);
+    file.write((const uint8_t *)&rec, sizeof(rec));
+    spiLock->lock();
+    bool okay = file.close();
+    spiLock->unlock();
+    if (!okay)
+        LOG_WARN("Can't write %s", gpsCacheFileName);
+#endif
+}
+
+void GPS::forgetCachedModel()
+{
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+    FSCom.remove(gpsCacheFileName);
+#endif
+}
+
+GpsInitStep &GPS::queueStep(GpsInitStep::Kind kind, uint32_t arg)
+{
+    GpsInitStep s = {};
+    s.kind = kind;
+    s.arg = arg;
+    initSteps.push_back(s);
+    return initSteps.back();
+}
+
+/// Wait after the last step, like a delay() after sending a command
+void GPS::queueDelay(uint16_t msec)
+{
+    if (initSteps.empty())
+        queueStep(GpsInitStep::STEP_WAIT);
+    initSteps.back().delayMsec += msec;
+}
+
+void GPS::queueDetect(const char *family, const char *command, const ChipInfo *chips, uint8_t numChips, uint32_t timeout)
+{
+    GpsInitStep &s = queueStep(GpsInitStep::STEP_DETECT, timeout);
+    s.what = family;
+    s.data = command;
+    s.chips = chips;
+    s.len = numChips;
+}
+
+void GPS::queueUBX(uint8_t class_id, uint8_t msg_id, const uint8_t *msg, uint8_t payload_size, const char *what,
+                   uint32_t timeout)
+{
+    GpsInitStep &s = queueStep(GpsInitStep::STEP_UBX, timeout);
+    s.cls = class_id;
+    s.id = msg_id;
+    s.data = msg;
+    s.len = payload_size;
+    s.what = what;
+}
+
+void GPS::queueCAS(uint8_t class_id, uint8_t msg_id, const uint8_t *msg, uint8_t payload_size, const char *what,
+                   uint32_t timeout)
+{
+    queueUBX(class_id, msg_id, msg, payload_size, what, timeout);
+    initSteps.back().kind = GpsInitStep::STEP_CAS;
+}
+
+void GPS::startInitStep(const GpsInitStep &s)
+{
+    initMatch = 0;
+    initFrameErrors = 0;
+    initRx.clear();
+
+    int msglen;
+    switch (s.kind) {
+    case GpsInitStep::STEP_BAUD: {
+        int serialSpeed = s.arg;
+#if defined(ARCH_NRF52) || defined(ARCH_PORTDUINO) || defined(ARCH_STM32WL)
+        _serial_gps->end();
+        _serial_gps->begin(serialSpeed);
+#elif defined(ARCH_RP2040)
+        _serial_gps->end();
+        _serial_gps->setFIFOSize(256);
+        _serial_gps->begin(serialSpeed);
+#else
+        if (_serial_gps->baudRate() != serialSpeed) {
+            LOG_DEBUG("Set Baud to %i", serialSpeed);
+            _serial_gps->updateBaudRate(serialSpeed);
         }
+#endif
+        break;
+    }
+    case GpsInitStep::STEP_PIN:
+        digitalWrite(s.arg, s.cls);
+        break;
+    case GpsInitStep::STEP_CLEAR:
+        clearBuffer();
+        break;
+    case GpsInitStep::STEP_WRITE:
+        _serial_gps->write((const char *)s.data);
+        break;
+    case GpsInitStep::STEP_DETECT:
+        LOG_DEBUG(PROBE_MESSAGE, (const char *)s.data, s.what);
+        clearBuffer();
+        _serial_gps->write((const char *)s.data);
+        _serial_gps->write("\r\n");
+        break;
+    case GpsInitStep::STEP_UBX_PROBE:
+    case GpsInitStep::STEP_UBX_VERSION:
+        clearBuffer();
+        // fall through
+    case GpsInitStep::STEP_UBX:
+        msglen = makeUBXPacket(s.cls, s.id, s.len, (const uint8_t *)s.data);
+        _serial_gps->write(UBXscratch, msglen);
+        break;
+    case GpsInitStep::STEP_CAS:
+        msglen = makeCASPacket(s.cls, s.id, s.len, (const uint8_t *)s.data);
+        _serial_gps->write(UBXscratch, msglen);
+        break;
+    default:
+        break;
+    }
+}
 
-        if (gnssModel != GNSS_MODEL_UNKNOWN) {
-            setConnected();
-        } else {
-            return false;
+GpsInitStep::Result GPS::pollInitStep(const GpsInitStep &s)
+{
+    bool timedOut = !Throttle::isWithinTimespanMs(initStepMsec, s.arg);
+
+    switch (s.kind) {
+    case GpsInitStep::STEP_DETECT: {
+        GnssModel_t detectedDriver = readProbeResponse(s.chips, s.len);
+        if (detectedDriver != GNSS_MODEL_UNKNOWN) {
+            gnssModel = detectedDriver;
+            return GpsInitStep::STOP;
         }
+        return timedOut ? GpsInitStep::DONE : GpsInitStep::WAITING;
+    }
 
-        if (gnssModel == GNSS_MODEL_MTK) {
-            /*
-             * t-beam-s3-core uses the same L76K GNSS module as t-echo.
-             * Unlike t-echo, L76K uses 9600 baud rate for communication by default.
-             * */
-
-            // Initialize the L76K Chip, use GPS + GLONASS + BEIDOU
-            _serial_gps->write("$PCAS04,7*1E\r\n");
-            delay(250);
-            // only ask for RMC and GGA
-            _serial_gps->write("$PCAS03,1,0,0,0,1,0,0,0,0,0,,,0,0*02\r\n");
-            delay(250);
-            // Switch to Vehicle Mode, since SoftRF enables Aviation < 2g
-            _serial_gps->write("$PCAS11,3*1E\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_MTK_L76B) {
-            // Waveshare Pico-GPS hat uses the L76B with 9600 baud
-            // Initialize the L76B Chip, use GPS + GLONASS
-            // See note in L76_Series_GNSS_Protocol_Specification, chapter 3.29
-            _serial_gps->write("$PMTK353,1,1,0,0,0*2B\r\n");
-            // Above command will reset the GPS and takes longer before it will accept new commands
-            delay(1000);
-            // only ask for RMC and GGA (GNRMC and GNGGA)
-            // See note in L76_Series_GNSS_Protocol_Specification, chapter 2.1
-            _serial_gps->write("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
-            delay(250);
-            // Enable SBAS
-            _serial_gps->write("$PMTK301,2*2E\r\n");
-            delay(250);
-            // Enable PPS for 2D/3D fix only
-            _serial_gps->write("$PMTK285,3,100*3F\r\n");
-            delay(250);
-            // Switch to Fitness Mode, for running and walking purpose with low speed (<5 m/s)
-            _serial_gps->write("$PMTK886,1*29\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_MTK_PA1010D) {
-            // PA1010D is used in the Pimoroni GPS board.
-
-            // Enable all constellations.
-            _serial_gps->write("$PMTK353,1,1,1,1,1*2A\r\n");
-            // Above command will reset the GPS and takes longer before it will accept new commands
-            delay(1000);
-            // Only ask for RMC and GGA (GNRMC and GNGGA)
-            _serial_gps->write("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
-            delay(250);
-            // Enable SBAS / WAAS
-            _serial_gps->write("$PMTK301,2*2E\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_MTK_PA1616S) {
-            // PA1616S is used in some GPS breakout boards from Adafruit
-            // PA1616S does not have GLONASS capability. PA1616D does, but is not implemented here.
-            _serial_gps->write("$PMTK353,1,0,0,0,0*2A\r\n");
-            // Above command will reset the GPS and takes longer before it will accept new commands
-            delay(1000);
-            // Only ask for RMC and GGA (GNRMC and GNGGA)
-            _serial_gps->write("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
-            delay(250);
-            // Enable SBAS / WAAS
-            _serial_gps->write("$PMTK301,2*2E\r\n");
-            delay(250);
-        } else if (gnssModel == GNSS_MODEL_ATGM336H) {
-            // Set the intial configuration of the device - these _should_ work for most AT6558 devices
-            msglen = makeCASPacket(0x06, 0x07, sizeof(_message_CAS_CFG_NAVX_CONF), _message_CAS_CFG_NAVX_CONF);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACKCas(0x06, 0x07, 250) != GNSS_RESPONSE_OK) {
-                LOG_WARN("ATGM336H: Could not set Config");
-            }
+    case GpsInitStep::STEP_UBX:
+    case GpsInitStep::STEP_UBX_PROBE:
+    case GpsInitStep::STEP_CAS: {
+        GPS_RESPONSE response = (s.kind == GpsInitStep::STEP_CAS) ? readACKCas(s.cls, s.id) : readACK(s.cls, s.id);
+        if (response == GNSS_RESPONSE_NONE && !timedOut)
+            return GpsInitStep::WAITING;
 
-            // Set the update frequence to 1Hz
-            msglen = makeCASPacket(0x06, 0x04, sizeof(_message_CAS_CFG_RATE_1HZ), _message_CAS_CFG_RATE_1HZ);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACKCas(0x06, 0x04, 250) != GNSS_RESPONSE_OK) {
-                LOG_WARN("ATGM336H: Could not set Update Frequency");
+        if (response == GNSS_RESPONSE_OK) {
+            initAcked = true;
+            if (s.kind == GpsInitStep::STEP_UBX && s.cls == 0x06 && s.id == 0x09)
+                LOG_INFO("GNSS module config saved!");
+        } else if (s.kind == GpsInitStep::STEP_UBX_PROBE) {
+            // Check that the returned response class and message ID are correct
+            if (response == GNSS_RESPONSE_NONE) {
+                LOG_WARN("No GNSS Module (baudrate %d)", initBaud);
+                return GpsInitStep::STOP;
+            } else if (response == GNSS_RESPONSE_FRAME_ERRORS) {
+                LOG_INFO("UBlox Frame Errors (baudrate %d)", initBaud);
             }
+        } else if (s.what) {
+            LOG_WARN(failMessage, s.what);
+        }
+        return GpsInitStep::DONE;
+    }
 
-            // Set the NEMA output messages
-            // Ask for only RMC and GGA
-            uint8_t fields[] = {CAS_NEMA_RMC, CAS_NEMA_GGA};
-            for (unsigned int i = 0; i < sizeof(fields); i++) {
-                // Construct a CAS-CFG-MSG packet
-                uint8_t cas_cfg_msg_packet[] = {0x4e, fields[i], 0x01, 0x00};
-                msglen = makeCASPacket(0x06, 0x01, sizeof(cas_cfg_msg_packet), cas_cfg_msg_packet);
-                _serial_gps->write(UBXscratch, msglen);
-                if (getACKCas(0x06, 0x01, 250) != GNSS_RESPONSE_OK) {
-                    LOG_WARN("ATGM336H: Could not enable NMEA MSG: %d", fields[i]);
-                }
+    case GpsInitStep::STEP_UBX_VERSION: {
+        uint16_t len = readPayload(s.cls, s.id);
+        if (!len && !timedOut)
+            return GpsInitStep::WAITING;
+        if (len)
+            gnssModel = parseUbloxVersion(initRx.data(), len);
+        if (gnssModel == GNSS_MODEL_UNKNOWN)
+            LOG_WARN("No GNSS Module (baudrate %d)", initBaud);
+        return GpsInitStep::STOP;
+    }
+
+    default:
+        return GpsInitStep::DONE;
+    }
+}
+
+int32_t GPS::runInitSteps()
+{
+    while (initStep < initSteps.size()) {
+        const GpsInitStep &s = initSteps[initStep];
+        if (!initStepStarted) {
+            startInitStep(s);
+            initStepStarted = true;
+            initStepDone = false;
+            initStepMsec = millis();
+        }
+        if (!initStepDone) {
+            GpsInitStep::Result result = pollInitStep(s);
+            if (result == GpsInitStep::WAITING)
+                return GPS_INIT_POLL_MSEC;
+            initStepDone = true;
+            initStepMsec = millis();
+            if (result == GpsInitStep::STOP) {
+                initStep = initSteps.size();
+                break;
             }
-        } else if (gnssModel == GNSS_MODEL_UC6580) {
-            // The Unicore UC6580 can use a lot of sat systems, enable it to
-            // use GPS L1 & L5 + BDS B1I & B2a + GLONASS L1 + GALILEO E1 & E5a + SBAS + QZSS
-            // This will reset the receiver, so wait a bit afterwards
-            // The paranoid will wait for the OK*04 confirmation response after each command.
-            _serial_gps->write("$CFGSYS,h35155\r\n");
-            delay(750);
-            // Must be done after the CFGSYS command
-            // Turn off GSV messages, we don't really care about which and where the sats are, maybe someday.
-            _serial_gps->write("$CFGMSG,0,3,0\r\n");
-            delay(250);
-            // Turn off GSA messages, TinyGPS++ doesn't use this message.
-            _serial_gps->write("$CFGMSG,0,2,0\r\n");
-            delay(250);
-            // Turn off NOTICE __TXT messages, these may provide Unicore some info but we don't care.
-            _serial_gps->write("$CFGMSG,6,0,0\r\n");
-            delay(250);
-            _serial_gps->write("$CFGMSG,6,1,0\r\n");
-            delay(250);
-        } else if (IS_ONE_OF(gnssModel, GNSS_MODEL_AG3335, GNSS_MODEL_AG3352)) {
-
-            _serial_gps->write("$PAIR066,1,0,1,0,0,1*3B\r\n"); // Enable GPS+GALILEO+NAVIC
-
-            // Configure NMEA (sentences will output once per fix)
-            _serial_gps->write("$PAIR062,0,1*3F\r\n"); // GGA ON
-            _serial_gps->write("$PAIR062,1,0*3F\r\n"); // GLL OFF
-            _serial_gps->write("$PAIR062,2,0*3C\r\n"); // GSA OFF
-            _serial_gps->write("$PAIR062,3,0*3D\r\n"); // GSV OFF
-            _serial_gps->write("$PAIR062,4,1*3B\r\n"); // RMC ON
-            _serial_gps->write("$PAIR062,5,0*3B\r\n"); // VTG OFF
-            _serial_gps->write("$PAIR062,6,0*38\r\n"); // ZDA ON
-
-            delay(250);
-            _serial_gps->write("$PAIR513*3D\r\n"); // save configuration
-        } else if (gnssModel == GNSS_MODEL_UBLOX6) {
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x02, _message_DISABLE_TXT_INFO, "disable text info messages", 500);
-            SEND_UBX_PACKET(0x06, 0x39, _message_JAM_6_7, "enable interference resistance", 500);
-            SEND_UBX_PACKET(0x06, 0x23, _message_NAVX5, "configure NAVX5 settings", 500);
-
-            // Turn off unwanted NMEA messages, set update rate
-            SEND_UBX_PACKET(0x06, 0x08, _message_1HZ, "set GPS update rate", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GLL, "disable NMEA GLL", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GSA, "enable NMEA GSA", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GSV, "disable NMEA GSV", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_VTG, "disable NMEA VTG", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_RMC, "enable NMEA RMC", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GGA, "enable NMEA GGA", 500);
+        }
+        if (Throttle::isWithinTimespanMs(initStepMsec, s.delayMsec))
+            return s.delayMsec - (millis() - initStepMsec);
+        initStep++;
+        initStepStarted = false;
+    }
+    initSteps.clear();
+    initStep = 0;
+    initStepStarted = false;
+    initRx.clear();
+    initRx.shrink_to_fit();
+    return 0;
+}
 
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x11, _message_CFG_RXM_ECO, "enable powersave ECO mode for Neo-6", 500);
-            SEND_UBX_PACKET(0x06, 0x3B, _message_CFG_PM2, "enable powersave details for GPS", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_AID, "disable UBX-AID", 500);
-
-            msglen = makeUBXPacket(0x06, 0x09, sizeof(_message_SAVE), _message_SAVE);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACK(0x06, 0x09, 2000) != GNSS_RESPONSE_OK) {
-                LOG_WARN("Unable to save GNSS module config");
+bool GPS::queueNextProbe()
+{
+    int serialSpeed;
+    if (probeTries < GPS_PROBETRIES) {
+        serialSpeed = serialSpeeds[speedSelect];
+        if (++speedSelect == array_count(serialSpeeds)) {
+            speedSelect = 0;
+            ++probeTries;
+        }
+    } else {
+        // Rare Serial Speeds
+        if (speedSelect == array_count(rareSerialSpeeds))
+            return false;
+        serialSpeed = rareSerialSpeeds[speedSelect++];
+    }
+    LOG_DEBUG("Probe for GPS at %d", serialSpeed);
+    queueProbe(serialSpeed);
+    return true;
+}
+
+/**
+ * @brief  Detect and configure the GPS, a step at a time.
+ *  If we know the model from the last boot we go straight to configuring it. Otherwise we detect the GPS by cycling
+ *  through a set of baud rates, first common then rare. For each baud rate, we queue the probe commands and match the
+ *  responses to known GPS responses.
+ */
+int32_t GPS::runInit()
+{
+    while (!didSerialInit) {
+        int32_t wait = runInitSteps();
+        if (wait > 0)
+            return wait;
+
+        switch (initState) {
+        case GPS_INIT_START:
+            if (!tx_gpio)
+                return 2000; // We can't talk to it
+            if (loadCachedModel()) {
+                LOG_INFO("Skip GPS probe, use model %d at %d baud from last boot", gnssModel, initBaud);
+                queueStep(GpsInitStep::STEP_BAUD, initBaud);
+                queueDelay(100);
+                queueConfig();
+                cachedModelUnconfirmed = true;
+                initState = GPS_INIT_CONFIGURE;
             } else {
-                LOG_INFO("GNSS module config saved!");
-            }
-        } else if (IS_ONE_OF(gnssModel, GNSS_MODEL_UBLOX7, GNSS_MODEL_UBLOX8, GNSS_MODEL_UBLOX9)) {
-            if (gnssModel == GNSS_MODEL_UBLOX7) {
-                LOG_DEBUG("Set GPS+SBAS");
-                msglen = makeUBXPacket(0x06, 0x3e, sizeof(_message_GNSS_7), _message_GNSS_7);
-                _serial_gps->write(UBXscratch, msglen);
-            } else { // 8,9
-                msglen = makeUBXPacket(0x06, 0x3e, sizeof(_message_GNSS_8), _message_GNSS_8);
-                _serial_gps->write(UBXscratch, msglen);
+                queueNextProbe();
+                initState = GPS_INIT_PROBE;
             }
+            break;
 
-            if (getACK(0x06, 0x3e, 800) == GNSS_RESPONSE_NAK) {
-                // It's not critical if the module doesn't acknowledge this configuration.
-                LOG_DEBUG("reconfigure GNSS - defaults maintained. Is this module GPS-only?");
-            } else {
-                if (gnssModel == GNSS_MODEL_UBLOX7) {
-                    LOG_INFO("GPS+SBAS configured");
-                } else { // 8,9
-                    LOG_INFO("GPS+SBAS+GLONASS+Galileo configured");
-                }
-                // Documentation say, we need wait atleast 0.5s after reconfiguration of GNSS module, before sending next
-                // commands for the M8 it tends to be more... 1 sec should be enough ;>)
-                delay(1000);
+        case GPS_INIT_PROBE:
+            if (gnssModel != GNSS_MODEL_UNKNOWN) {
+                setConnected();
+                queueConfig();
+                initState = GPS_INIT_CONFIGURE;
+                break;
             }
+            if (!queueNextProbe()) {
+                LOG_WARN("Give up on GPS probe and set to %d", GPS_BAUDRATE);
+                return 0;
+            }
+            return 2000; // Give the module a moment before trying the next baud rate
 
-            // Disable Text Info messages //6,7,8,9
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x02, _message_DISABLE_TXT_INFO, "disable text info messages", 500);
+        case GPS_INIT_CONFIGURE:
+            if (!cachedModelUnconfirmed)
+                saveCachedModel();
+            else if (initAcked)
+                cachedModelUnconfirmed = false; // It's there, no need to wait for NMEA
+            setConnected();
+            didSerialInit = true;
+            break;
+        }
+    }
 
-            if (gnssModel == GNSS_MODEL_UBLOX8) { // 8
-                clearBuffer();
-                SEND_UBX_PACKET(0x06, 0x39, _message_JAM_8, "enable interference resistance", 500);
+    if (!observingDeepSleep) {
+        notifyDeepSleepObserver.observe(&notifyDeepSleep);
+        observingDeepSleep = true;
+    }
 
-                clearBuffer();
-                SEND_UBX_PACKET(0x06, 0x23, _message_NAVX5_8, "configure NAVX5_8 settings", 500);
-            } else { // 6,7,9
-                SEND_UBX_PACKET(0x06, 0x39, _message_JAM_6_7, "enable interference resistance", 500);
-                SEND_UBX_PACKET(0x06, 0x23, _message_NAVX5, "configure NAVX5 settings", 500);
-            }
-            // Turn off unwanted NMEA messages, set update rate
-            SEND_UBX_PACKET(0x06, 0x08, _message_1HZ, "set GPS update rate", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GLL, "disable NMEA GLL", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GSA, "enable NMEA GSA", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GSV, "disable NMEA GSV", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_VTG, "disable NMEA VTG", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_RMC, "enable NMEA RMC", 500);
-            SEND_UBX_PACKET(0x06, 0x01, _message_GGA, "enable NMEA GGA", 500);
-
-            if (ublox_info.protocol_version >= 18) {
-                clearBuffer();
-                SEND_UBX_PACKET(0x06, 0x86, _message_PMS, "enable powersave for GPS", 500);
-                SEND_UBX_PACKET(0x06, 0x3B, _message_CFG_PM2, "enable powersave details for GPS", 500);
+    return 0;
+}
 
-                // For M8 we want to enable NMEA vserion 4.10 so we can see the additional sats.
-                if (gnssModel == GNSS_MODEL_UBLOX8) {
-                    clearBuffer();
-                    SEND_UBX_PACKET(0x06, 0x17, _message_NMEA, "enable NMEA 4.10", 500);
-                }
-            } else {
-                SEND_UBX_PACKET(0x06, 0x11, _message_CFG_RXM_PSM, "enable powersave mode for GPS", 500);
-                SEND_UBX_PACKET(0x06, 0x3B, _message_CFG_PM2, "enable powersave details for GPS", 500);
-            }
+void GPS::restartInit()
+{
+    cachedModelUnconfirmed = false;
+    initAcked = false;
+    didSerialInit = false;
+    GPSInitFinished = false;
+    hasGPS = false;
+    gnssModel = GNSS_MODEL_UNKNOWN;
+    initState = GPS_INIT_START;
+    initStartMsec = 0;
+    // Start over with the common baud rates
+    speedSelect = 0;
+    probeTries = 0;
+}
 
-            msglen = makeUBXPacket(0x06, 0x09, sizeof(_message_SAVE), _message_SAVE);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACK(0x06, 0x09, 2000) != GNSS_RESPONSE_OK) {
-                LOG_WARN("Unable to save GNSS module config");
-            } else {
-                LOG_INFO("GNSS module configuration saved!");
-            }
-        } else if (gnssModel == GNSS_MODEL_UBLOX10) {
-            delay(1000);
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_NMEA_RAM, "disable NMEA messages in M10 RAM", 300);
-            delay(750);
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_NMEA_BBR, "disable NMEA messages in M10 BBR", 300);
-            delay(750);
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_TXT_INFO_RAM, "disable Info messages for M10 GPS RAM", 300);
-            delay(750);
-            // Next disable Info txt messages in BBR layer
-            clearBuffer();
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_TXT_INFO_BBR, "disable Info messages for M10 GPS BBR", 300);
-            delay(750);
-            // Do M10 configuration for Power Management.
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_PM_RAM, "enable powersave for M10 GPS RAM", 300);
-            delay(750);
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_PM_BBR, "enable powersave for M10 GPS BBR", 300);
-            delay(750);
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_ITFM_RAM, "enable jam detection M10 GPS RAM", 300);
-            delay(750);
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_ITFM_BBR, "enable jam detection M10 GPS BBR", 300);
-            delay(750);
-            // Here is where the init commands should go to do further M10 initialization.
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_SBAS_RAM, "disable SBAS M10 GPS RAM", 300);
-            delay(750); // will cause a receiver restart so wait a bit
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_SBAS_BBR, "disable SBAS M10 GPS BBR", 300);
-            delay(750); // will cause a receiver restart so wait a bit
-
-            // Done with initialization, Now enable wanted NMEA messages in BBR layer so they will survive a periodic
-            // sleep.
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_ENABLE_NMEA_BBR, "enable messages for M10 GPS BBR", 300);
-            delay(750);
-            // Next enable wanted NMEA messages in RAM layer
-            SEND_UBX_PACKET(0x06, 0x8A, _message_VALSET_ENABLE_NMEA_RAM, "enable messages for M10 GPS RAM", 500);
-            delay(750);
-
-            // As the M10 has no flash, the best we can do to preserve the config is to set it in RAM and BBR.
-            // BBR will survive a restart, and power off for a while, but modules with small backup
-            // batteries or super caps will not retain the config for a long power off time.
-            msglen = makeUBXPacket(0x06, 0x09, sizeof(_message_SAVE_10), _message_SAVE_10);
-            _serial_gps->write(UBXscratch, msglen);
-            if (getACK(0x06, 0x09, 2000) != GNSS_RESPONSE_OK) {
-                LOG_WARN("Unable to save GNSS module config");
+#define PROBE_SIMPLE(CHIP, TOWRITE, RESPONSE, DRIVER, TIMEOUT, ...)                                                              \
+    do {                                                                                                                         \
+        static const ChipInfo chip = {CHIP, RESPONSE, DRIVER};                                                                   \
+        queueDetect(CHIP, TOWRITE, &chip, 1, TIMEOUT);                                                                           \
+    } while (0)
+
+#define PROBE_FAMILY(FAMILY_NAME, COMMAND, RESPONSE_MAP, TIMEOUT)                                                                \
+    queueDetect(FAMILY_NAME, COMMAND, RESPONSE_MAP, array_count(RESPONSE_MAP), TIMEOUT)
+
+// Unicore UFirebirdII Series: UC6580, UM620, UM621, UM670A, UM680A, or UM681A
+static const ChipInfo unicoreChips[] = {{"UC6580", "UC6580", GNSS_MODEL_UC6580}, {"UM600", "UM600", GNSS_MODEL_UC6580}};
+
+static const ChipInfo atgmChips[] = {
+    {"ATGM336H", "$GPTXT,01,01,02,HW=ATGM336H", GNSS_MODEL_ATGM336H},
+    /* ATGM332D series (-11(GPS), -21(BDS), -31(GPS+BDS), -51(GPS+GLONASS), -71-0(GPS+BDS+GLONASS)) based on AT6558 */
+    {"ATGM332D", "$GPTXT,01,01,02,HW=ATGM332D", GNSS_MODEL_ATGM336H}};
+
+static const ChipInfo airohaChips[] = {{"AG3335", "$PAIR021,AG3335", GNSS_MODEL_AG3335},
+                                       {"AG3352", "$PAIR021,AG3352", GNSS_MODEL_AG3352},
+                                       {"RYS3520", "$PAIR021,REYAX_RYS3520_V2", GNSS_MODEL_AG3352}};
+
+static const ChipInfo mtkChips[] = {
+    {"L76B", "Quectel-L76B", GNSS_MODEL_MTK_L76B}, {"PA1010D", "1010D", GNSS_MODEL_MTK_PA1010D},
+    {"PA1616S", "1616S", GNSS_MODEL_MTK_PA1616S},  {"LS20031", "MC-1513", GNSS_MODEL_MTK_L76B},
+    {"L96", "Quectel-L96", GNSS_MODEL_MTK_L76B},   {"L80-R", "_3337_", GNSS_MODEL_MTK_L76B},
+    {"L80", "_3339_", GNSS_MODEL_MTK_L76B}};
+
+/// Queue the commands to find out what module we have at serialSpeed
+void GPS::queueProbe(int serialSpeed)
+{
+    memset(&ublox_info, 0, sizeof(ublox_info));
+    initBaud = serialSpeed;
+
+#ifdef TRACKER_T1000_E
+    // add power up/down strategy, improve ag3335 detection success
+    queueStep(GpsInitStep::STEP_PIN, PIN_GPS_EN).cls = LOW;
+    queueDelay(500);
+    queueStep(GpsInitStep::STEP_PIN, GPS_VRTC_EN).cls = LOW;
+    queueDelay(1000);
+    queueStep(GpsInitStep::STEP_PIN, GPS_VRTC_EN).cls = HIGH;
+    queueDelay(500);
+    queueStep(GpsInitStep::STEP_PIN, PIN_GPS_EN).cls = HIGH;
+    queueDelay(1000);
+#endif
+
+    queueStep(GpsInitStep::STEP_BAUD, serialSpeed);
+    queueDelay(100);
+
+    // Close all NMEA sentences, valid for L76K, ATGM336H (and likely other AT6558 devices)
+    queueWrite("$PCAS03,0,0,0,0,0,0,0,0,0,0,,,0,0*02\r\n");
+    queueDelay(20);
+    // Close NMEA sequences on Ublox
+    queueWrite("$PUBX,40,GLL,0,0,0,0,0,0*5C\r\n");
+    queueWrite("$PUBX,40,GSV,0,0,0,0,0,0*59\r\n");
+    queueWrite("$PUBX,40,VTG,0,0,0,0,0,0*5E\r\n");
+    queueDelay(20);
+
+    PROBE_FAMILY("Unicore Family", "$PDTINFO", unicoreChips, 500);
+    PROBE_FAMILY("ATGM33xx Family", "$PCAS06,1*1A", atgmChips, 500);
+
+    /* Airoha (Mediatek) AG3335A/M/S, A3352Q, Quectel L89 2.0, SimCom SIM65M */
+    queueWrite("$PAIR062,2,0*3C\r\n"); // GSA OFF to reduce volume
+    queueWrite("$PAIR062,3,0*3D\r\n"); // GSV OFF to reduce volume
+    queueWrite("$PAIR513*3D\r\n");     // save configuration
+    PROBE_FAMILY("Airoha Family", "$PAIR021*39", airohaChips, 1000);
+
+    PROBE_SIMPLE("LC86", "$PQTMVERNO*58", "$PQTMVERNO,LC86", GNSS_MODEL_AG3352, 500);
+    PROBE_SIMPLE("L76K", "$PCAS06,0*1B", "$GPTXT,01,01,02,SW=", GNSS_MODEL_MTK, 500);
+
+    // Close all NMEA sentences, valid for MTK3333 and MTK3339 platforms
+    queueWrite("$PMTK514,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*2E\r\n");
+    queueDelay(20);
+    PROBE_FAMILY("MTK Family", "$PMTK605*31", mtkChips, 500);
+
+    // A U-blox acks UBX-CFG-RATE, then tells us what it is with UBX-MON-VER
+    queueUBX(0x06, 0x08, NULL, 0, NULL, 750);
+    initSteps.back().kind = GpsInitStep::STEP_UBX_PROBE;
+    queueUBX(0x0A, 0x04, NULL, 0, NULL, 1200);
+    initSteps.back().kind = GpsInitStep::STEP_UBX_VERSION;
+}
+
+GnssModel_t GPS::parseUbloxVersion(const uint8_t *buffer, uint16_t len)
+{
+    char text[30];
+    uint16_t position = 0;
+    for (int i = 0; i < 30; i++) {
+        ublox_info.swVersion[i] = buffer[position];
+        position++;
+    }
+    for (int i = 0; i < 10; i++) {
+        ublox_info.hwVersion[i] = buffer[position];
+        position++;
+    }
+
+    while (len >= position + 30) {
+        for (int i = 0; i < 30; i++) {
+            ublox_info.extension[ublox_info.extensionNo][i] = buffer[position];
+            position++;
+        }
+        ublox_info.extensionNo++;
+        if (ublox_info.extensionNo > 9)
+            break;
+    }
+
+    LOG_DEBUG("Module Info : ");
+    LOG_DEBUG("Soft version: %s", ublox_info.swVersion);
+    LOG_DEBUG("Hard version: %s", ublox_info.hwVersion);
+    LOG_DEBUG("Extensions:%d", ublox_info.extensionNo);
+    for (int i = 0; i < ublox_info.extensionNo; i++) {
+        LOG_DEBUG("  %s", ublox_info.extension[i]);
+    }
+
+    // tips: extensionNo field is 0 on some 6M GNSS modules
+    for (int i = 0; i < ublox_info.extensionNo; ++i) {
+        if (!strncmp(ublox_info.extension[i], "PROTVER", 7)) {
+            char *ptr = nullptr;
+            memset(text, 0, sizeof(text));
+            strncpy(text, &(ublox_info.extension[i][8]), sizeof(text) - 8);
+            LOG_DEBUG("Protocol Version:%s", text);
+            if (strlen(text)) {
+                ublox_info.protocol_version = strtoul(text, &ptr, 10);
+                LOG_DEBUG("ProtVer=%d", ublox_info.protocol_version);
             } else {
-                LOG_INFO("GNSS module configuration saved!");
+                ublox_info.protocol_version = 0;
             }
         }
-        didSerialInit = true;
     }
+    if (strncmp(ublox_info.hwVersion, "00040007", 8) == 0) {
+        LOG_INFO(DETECTED_MESSAGE, "U-blox 6", "6");
+        return GNSS_MODEL_UBLOX6;
+    } else if (strncmp(ublox_info.hwVersion, "00070000", 8) == 0) {
+        LOG_INFO(DETECTED_MESSAGE, "U-blox 7", "7");
+        return GNSS_MODEL_UBLOX7;
+    } else if (strncmp(ublox_info.hwVersion, "00080000", 8) == 0) {
+        LOG_INFO(DETECTED_MESSAGE, "U-blox 8", "8");
+        return GNSS_MODEL_UBLOX8;
+    } else if (strncmp(ublox_info.hwVersion, "00190000", 8) == 0) {
+        LOG_INFO(DETECTED_MESSAGE, "U-blox 9", "9");
+        return GNSS_MODEL_UBLOX9;
+    } else if (strncmp(ublox_info.hwVersion, "000A0000", 8) == 0) {
+        LOG_INFO(DETECTED_MESSAGE, "U-blox 10", "10");
+        return GNSS_MODEL_UBLOX10;
+    }
+    return GNSS_MODEL_UNKNOWN;
+}
 
-    notifyDeepSleepObserver.observe(&notifyDeepSleep);
+// CAS-CFG-MSG payloads to turn on the NMEA messages we want
+static const uint8_t _message_CAS_CFG_MSG_RMC[] = {0x4e, CAS_NEMA_RMC, 0x01, 0x00};
+static const uint8_t _message_CAS_CFG_MSG_GGA[] = {0x4e, CAS_NEMA_GGA, 0x01, 0x00};
 
-    return true;
+/// Queue the configuration for gnssModel
+void GPS::queueConfig()
+{
+    if (gnssModel == GNSS_MODEL_MTK) {
+        /*
+         * t-beam-s3-core uses the same L76K GNSS module as t-echo.
+         * Unlike t-echo, L76K uses 9600 baud rate for communication by default.
+         * */
+
+        // Initialize the L76K Chip, use GPS + GLONASS + BEIDOU
+        queueWrite("$PCAS04,7*1E\r\n");
+        queueDelay(250);
+        // only ask for RMC and GGA
+        queueWrite("$PCAS03,1,0,0,0,1,0,0,0,0,0,,,0,0*02\r\n");
+        queueDelay(250);
+        // Switch to Vehicle Mode, since SoftRF enables Aviation < 2g
+        queueWrite("$PCAS11,3*1E\r\n");
+        queueDelay(250);
+    } else if (gnssModel == GNSS_MODEL_MTK_L76B) {
+        // Waveshare Pico-GPS hat uses the L76B with 9600 baud
+        // Initialize the L76B Chip, use GPS + GLONASS
+        // See note in L76_Series_GNSS_Protocol_Specification, chapter 3.29
+        queueWrite("$PMTK353,1,1,0,0,0*2B\r\n");
+        // Above command will reset the GPS and takes longer before it will accept new commands
+        queueDelay(1000);
+        // only ask for RMC and GGA (GNRMC and GNGGA)
+        // See note in L76_Series_GNSS_Protocol_Specification, chapter 2.1
+        queueWrite("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
+        queueDelay(250);
+        // Enable SBAS
+        queueWrite("$PMTK301,2*2E\r\n");
+        queueDelay(250);
+        // Enable PPS for 2D/3D fix only
+        queueWrite("$PMTK285,3,100*3F\r\n");
+        queueDelay(250);
+        // Switch to Fitness Mode, for running and walking purpose with low speed (<5 m/s)
+        queueWrite("$PMTK886,1*29\r\n");
+        queueDelay(250);
+    } else if (gnssModel == GNSS_MODEL_MTK_PA1010D) {
+        // PA1010D is used in the Pimoroni GPS board.
+
+        // Enable all constellations.
+        queueWrite("$PMTK353,1,1,1,1,1*2A\r\n");
+        // Above command will reset the GPS and takes longer before it will accept new commands
+        queueDelay(1000);
+        // Only ask for RMC and GGA (GNRMC and GNGGA)
+        queueWrite("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
+        queueDelay(250);
+        // Enable SBAS / WAAS
+        queueWrite("$PMTK301,2*2E\r\n");
+        queueDelay(250);
+    } else if (gnssModel == GNSS_MODEL_MTK_PA1616S) {
+        // PA1616S is used in some GPS breakout boards from Adafruit
+        // PA1616S does not have GLONASS capability. PA1616D does, but is not implemented here.
+        queueWrite("$PMTK353,1,0,0,0,0*2A\r\n");
+        // Above command will reset the GPS and takes longer before it will accept new commands
+        queueDelay(1000);
+        // Only ask for RMC and GGA (GNRMC and GNGGA)
+        queueWrite("$PMTK314,0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*28\r\n");
+        queueDelay(250);
+        // Enable SBAS / WAAS
+        queueWrite("$PMTK301,2*2E\r\n");
+        queueDelay(250);
+    } else if (gnssModel == GNSS_MODEL_ATGM336H) {
+        // Set the intial configuration of the device - these _should_ work for most AT6558 devices
+        QUEUE_CAS_PACKET(0x06, 0x07, _message_CAS_CFG_NAVX_CONF, "set ATGM336H config", 250);
+
+        // Set the update frequence to 1Hz
+        QUEUE_CAS_PACKET(0x06, 0x04, _message_CAS_CFG_RATE_1HZ, "set ATGM336H update frequency", 250);
+
+        // Set the NEMA output messages
+        // Ask for only RMC and GGA
+        QUEUE_CAS_PACKET(0x06, 0x01, _message_CAS_CFG_MSG_RMC, "enable ATGM336H NMEA RMC", 250);
+        QUEUE_CAS_PACKET(0x06, 0x01, _message_CAS_CFG_MSG_GGA, "enable ATGM336H NMEA GGA", 250);
+    } else if (gnssModel == GNSS_MODEL_UC6580) {
+        // The Unicore UC6580 can use a lot of sat systems, enable it to
+        // use GPS L1 & L5 + BDS B1I & B2a + GLONASS L1 + GALILEO E1 & E5a + SBAS + QZSS
+        // This will reset the receiver, so wait a bit afterwards
+        // The paranoid will wait for the OK*04 confirmation response after each command.
+        queueWrite("$CFGSYS,h35155\r\n");
+        queueDelay(750);
+        // Must be done after the CFGSYS command
+        // Turn off GSV messages, we don't really care about which and where the sats are, maybe someday.
+        queueWrite("$CFGMSG,0,3,0\r\n");
+        queueDelay(250);
+        // Turn off GSA messages, TinyGPS++ doesn't use this message.
+        queueWrite("$CFGMSG,0,2,0\r\n");
+        queueDelay(250);
+        // Turn off NOTICE __TXT messages, these may provide Unicore some info but we don't care.
+        queueWrite("$CFGMSG,6,0,0\r\n");
+        queueDelay(250);
+        queueWrite("$CFGMSG,6,1,0\r\n");
+        queueDelay(250);
+    } else if (IS_ONE_OF(gnssModel, GNSS_MODEL_AG3335, GNSS_MODEL_AG3352)) {
+
+        queueWrite("$PAIR066,1,0,1,0,0,1*3B\r\n"); // Enable GPS+GALILEO+NAVIC
+
+        // Configure NMEA (sentences will output once per fix)
+        queueWrite("$PAIR062,0,1*3F\r\n"); // GGA ON
+        queueWrite("$PAIR062,1,0*3F\r\n"); // GLL OFF
+        queueWrite("$PAIR062,2,0*3C\r\n"); // GSA OFF
+        queueWrite("$PAIR062,3,0*3D\r\n"); // GSV OFF
+        queueWrite("$PAIR062,4,1*3B\r\n"); // RMC ON
+        queueWrite("$PAIR062,5,0*3B\r\n"); // VTG OFF
+        queueWrite("$PAIR062,6,0*38\r\n"); // ZDA ON
+
+        queueDelay(250);
+        queueWrite("$PAIR513*3D\r\n"); // save configuration
+    } else if (gnssModel == GNSS_MODEL_UBLOX6) {
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x02, _message_DISABLE_TXT_INFO, "disable text info messages", 500);
+        QUEUE_UBX_PACKET(0x06, 0x39, _message_JAM_6_7, "enable interference resistance", 500);
+        QUEUE_UBX_PACKET(0x06, 0x23, _message_NAVX5, "configure NAVX5 settings", 500);
+
+        // Turn off unwanted NMEA messages, set update rate
+        QUEUE_UBX_PACKET(0x06, 0x08, _message_1HZ, "set GPS update rate", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GLL, "disable NMEA GLL", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GSA, "enable NMEA GSA", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GSV, "disable NMEA GSV", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_VTG, "disable NMEA VTG", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_RMC, "enable NMEA RMC", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GGA, "enable NMEA GGA", 500);
+
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x11, _message_CFG_RXM_ECO, "enable powersave ECO mode for Neo-6", 500);
+        QUEUE_UBX_PACKET(0x06, 0x3B, _message_CFG_PM2, "enable powersave details for GPS", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_AID, "disable UBX-AID", 500);
+
+        QUEUE_UBX_PACKET(0x06, 0x09, _message_SAVE, "save GNSS module config", 2000);
+    } else if (IS_ONE_OF(gnssModel, GNSS_MODEL_UBLOX7, GNSS_MODEL_UBLOX8, GNSS_MODEL_UBLOX9)) {
+        // It's not critical if the module doesn't acknowledge this configuration, so no error message
+        if (gnssModel == GNSS_MODEL_UBLOX7) {
+            LOG_DEBUG("Set GPS+SBAS");
+            QUEUE_UBX_PACKET(0x06, 0x3e, _message_GNSS_7, NULL, 800);
+        } else { // 8,9
+            QUEUE_UBX_PACKET(0x06, 0x3e, _message_GNSS_8, NULL, 800);
+        }
+        // Documentation say, we need wait atleast 0.5s after reconfiguration of GNSS module, before sending next
+        // commands for the M8 it tends to be more... 1 sec should be enough ;>)
+        queueDelay(1000);
+
+        // Disable Text Info messages //6,7,8,9
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x02, _message_DISABLE_TXT_INFO, "disable text info messages", 500);
+
+        if (gnssModel == GNSS_MODEL_UBLOX8) { // 8
+            queueStep(GpsInitStep::STEP_CLEAR);
+            QUEUE_UBX_PACKET(0x06, 0x39, _message_JAM_8, "enable interference resistance", 500);
+
+            queueStep(GpsInitStep::STEP_CLEAR);
+            QUEUE_UBX_PACKET(0x06, 0x23, _message_NAVX5_8, "configure NAVX5_8 settings", 500);
+        } else { // 6,7,9
+            QUEUE_UBX_PACKET(0x06, 0x39, _message_JAM_6_7, "enable interference resistance", 500);
+            QUEUE_UBX_PACKET(0x06, 0x23, _message_NAVX5, "configure NAVX5 settings", 500);
+        }
+        // Turn off unwanted NMEA messages, set update rate
+        QUEUE_UBX_PACKET(0x06, 0x08, _message_1HZ, "set GPS update rate", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GLL, "disable NMEA GLL", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GSA, "enable NMEA GSA", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GSV, "disable NMEA GSV", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_VTG, "disable NMEA VTG", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_RMC, "enable NMEA RMC", 500);
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_GGA, "enable NMEA GGA", 500);
+
+        if (ublox_info.protocol_version >= 18) {
+            queueStep(GpsInitStep::STEP_CLEAR);
+            QUEUE_UBX_PACKET(0x06, 0x86, _message_PMS, "enable powersave for GPS", 500);
+            QUEUE_UBX_PACKET(0x06, 0x3B, _message_CFG_PM2, "enable powersave details for GPS", 500);
+
+            // For M8 we want to enable NMEA vserion 4.10 so we can see the additional sats.
+            if (gnssModel == GNSS_MODEL_UBLOX8) {
+                queueStep(GpsInitStep::STEP_CLEAR);
+                QUEUE_UBX_PACKET(0x06, 0x17, _message_NMEA, "enable NMEA 4.10", 500);
+            }
+        } else {
+            QUEUE_UBX_PACKET(0x06, 0x11, _message_CFG_RXM_PSM, "enable powersave mode for GPS", 500);
+            QUEUE_UBX_PACKET(0x06, 0x3B, _message_CFG_PM2, "enable powersave details for GPS", 500);
+        }
+
+#if GPS_UBX_NAV_PVT
+        QUEUE_UBX_PACKET(0x06, 0x01, _message_NAV_PVT, "enable UBX-NAV-PVT", 500);
+#endif
+
+        QUEUE_UBX_PACKET(0x06, 0x09, _message_SAVE, "save GNSS module config", 2000);
+    } else if (gnssModel == GNSS_MODEL_UBLOX10) {
+        queueDelay(1000);
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_NMEA_RAM, "disable NMEA messages in M10 RAM", 300);
+        queueDelay(750);
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_NMEA_BBR, "disable NMEA messages in M10 BBR", 300);
+        queueDelay(750);
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_TXT_INFO_RAM, "disable Info messages for M10 GPS RAM", 300);
+        queueDelay(750);
+        // Next disable Info txt messages in BBR layer
+        queueStep(GpsInitStep::STEP_CLEAR);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_TXT_INFO_BBR, "disable Info messages for M10 GPS BBR", 300);
+        queueDelay(750);
+        // Do M10 configuration for Power Management.
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_PM_RAM, "enable powersave for M10 GPS RAM", 300);
+        queueDelay(750);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_PM_BBR, "enable powersave for M10 GPS BBR", 300);
+        queueDelay(750);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_ITFM_RAM, "enable jam detection M10 GPS RAM", 300);
+        queueDelay(750);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_ITFM_BBR, "enable jam detection M10 GPS BBR", 300);
+        queueDelay(750);
+        // Here is where the init commands should go to do further M10 initialization.
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_SBAS_RAM, "disable SBAS M10 GPS RAM", 300);
+        queueDelay(750); // will cause a receiver restart so wait a bit
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_DISABLE_SBAS_BBR, "disable SBAS M10 GPS BBR", 300);
+        queueDelay(750); // will cause a receiver restart so wait a bit
+
+        // Done with initialization, Now enable wanted NMEA messages in BBR layer so they will survive a periodic
+        // sleep.
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_ENABLE_NMEA_BBR, "enable messages for M10 GPS BBR", 300);
+        queueDelay(750);
+        // Next enable wanted NMEA messages in RAM layer
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_ENABLE_NMEA_RAM, "enable messages for M10 GPS RAM", 500);
+        queueDelay(750);
+#if GPS_UBX_NAV_PVT
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_ENABLE_NAV_PVT_BBR, "enable UBX-NAV-PVT for M10 GPS BBR", 300);
+        QUEUE_UBX_PACKET(0x06, 0x8A, _message_VALSET_ENABLE_NAV_PVT_RAM, "enable UBX-NAV-PVT for M10 GPS RAM", 300);
+#endif
+
+        // As the M10 has no flash, the best we can do to preserve the config is to set it in RAM and BBR.
+        // BBR will survive a restart, and power off for a while, but modules with small backup
+        // batteries or super caps will not retain the config for a long power off time.
+        QUEUE_UBX_PACKET(0x06, 0x09, _message_SAVE_10, "save GNSS module config", 2000);
+    }
 }
 
 GPS::~GPS()
@@ -1081,8 +1420,17 @@ int32_t GPS::runOnce()
             LOG_INFO("GPS set to not-present. Skip probe");
             return disable();
         }
-        if (!setup())
-            return 2000; // Setup failed, re-run in two seconds
+        if (!initStartMsec)
+            initStartMsec = millis();
+        uint32_t start = millis();
+        int32_t wait = runInit();
+        if (millis() - start > initLongestMsec)
+            initLongestMsec = millis() - start;
+        if (wait)
+            return wait;
+        initDoneMsec = millis();
+        LOG_INFO("GPS init took %u ms, holding up the main loop for at most %u ms at a time", initDoneMsec - initStartMsec,
+                 initLongestMsec);
 
         // We have now loaded our saved preferences from flash
         if (config.position.gps_mode != meshtastic_Config_PositionConfig_GpsMode_ENABLED) {
@@ -1100,6 +1448,14 @@ int32_t GPS::runOnce()
     if (whileActive()) {
         // if we have received valid NMEA claim we are connected
         setConnected();
+        cachedModelUnconfirmed = false;
+    } else if (cachedModelUnconfirmed && powerState == GPS_ACTIVE &&
+               !Throttle::isWithinTimespanMs(initDoneMsec, GPS_CACHE_CONFIRM_MSEC)) {
+        // The module we found last boot isn't there anymore, or not at that baud rate
+        LOG_WARN("No data from GPS model %d at %d baud, probe again", gnssModel, initBaud);
+        forgetCachedModel();
+        restartInit();
+        return GPS_THREAD_INTERVAL;
     }
 
     // If we're due for an update, wake the GPS
@@ -1171,219 +1527,6 @@ int GPS::prepareDeepSleep(void *unused)
     return 0;
 }
 
-static const char *PROBE_MESSAGE = "Trying %s (%s)...";
-static const char *DETECTED_MESSAGE = "%s detected";
-
-#define PROBE_SIMPLE(CHIP, TOWRITE, RESPONSE, DRIVER, TIMEOUT, ...)                                                              \
-    do {                                                                                                                         \
-        LOG_DEBUG(PROBE_MESSAGE, TOWRITE, CHIP);                                                                                 \
-        clearBuffer();                                                                                                           \
-        _serial_gps->write(TOWRITE "\r\n");                                                                                      \
-        if (getACK(RESPONSE, TIMEOUT) == GNSS_RESPONSE_OK) {                                                                     \
-            LOG_INFO(DETECTED_MESSAGE, CHIP);                                                                                    \
-            return DRIVER;                                                                                                       \
-        }                                                                                                                        \
-    } while (0)
-
-#define PROBE_FAMILY(FAMILY_NAME, COMMAND, RESPONSE_MAP, TIMEOUT)                                                                \
-    do {                                                                                                                         \
-        LOG_DEBUG(PROBE_MESSAGE, COMMAND, FAMILY_NAME);                                                                          \
-        clearBuffer();                                                                                                           \
-        _serial_gps->write(COMMAND "\r\n");                                                                                      \
-        GnssModel_t detectedDriver = getProbeResponse(TIMEOUT, RESPONSE_MAP);                                                    \
-        if (detectedDriver != GNSS_MODEL_UNKNOWN) {                                                                              \
-            return detectedDriver;                                                                                               \
-        }                                                                                                                        \
-    } while (0)
-
-GnssModel_t GPS::probe(int serialSpeed)
-{
-#if defined(ARCH_NRF52) || defined(ARCH_PORTDUINO) || defined(ARCH_STM32WL)
-    _serial_gps->end();
-    _serial_gps->begin(serialSpeed);
-#elif defined(ARCH_RP2040)
-    _serial_gps->end();
-    _serial_gps->setFIFOSize(256);
-    _serial_gps->begin(serialSpeed);
-#else
-    if (_serial_gps->baudRate() != serialSpeed) {
-        LOG_DEBUG("Set Baud to %i", serialSpeed);
-        _serial_gps->updateBaudRate(serialSpeed);
-    }
-#endif
-
-    memset(&ublox_info, 0, sizeof(ublox_info));
-    uint8_t buffer[768] = {0};
-    delay(100);
-
-    // Close all NMEA sentences, valid for L76K, ATGM336H (and likely other AT6558 devices)
-    _serial_gps->write("$PCAS03,0,0,0,0,0,0,0,0,0,0,,,0,0*02\r\n");
-    delay(20);
-    // Close NMEA sequences on Ublox
-    _serial_gps->write("$PUBX,40,GLL,0,0,0,0,0,0*5C\r\n");
-    _serial_gps->write("$PUBX,40,GSV,0,0,0,0,0,0*59\r\n");
-    _serial_gps->write("$PUBX,40,VTG,0,0,0,0,0,0*5E\r\n");
-    delay(20);
-
-    // Unicore UFirebirdII Series: UC6580, UM620, UM621, UM670A, UM680A, or UM681A
-    std::vector<ChipInfo> unicore = {{"UC6580", "UC6580", GNSS_MODEL_UC6580}, {"UM600", "UM600", GNSS_MODEL_UC6580}};
-    PROBE_FAMILY("Unicore Family", "$PDTINFO", unicore, 500);
-
-    std::vector<ChipInfo> atgm = {
-        {"ATGM336H", "$GPTXT,01,01,02,HW=ATGM336H", GNSS_MODEL_ATGM336H},
-        /* ATGM332D series (-11(GPS), -21(BDS), -31(GPS+BDS), -51(GPS+GLONASS), -71-0(GPS+BDS+GLONASS)) based on AT6558 */
-        {"ATGM332D", "$GPTXT,01,01,02,HW=ATGM332D", GNSS_MODEL_ATGM336H}};
-    PROBE_FAMILY("ATGM33xx Family", "$PCAS06,1*1A", atgm, 500);
-
-    /* Airoha (Mediatek) AG3335A/M/S, A3352Q, Quectel L89 2.0, SimCom SIM65M */
-    _serial_gps->write("$PAIR062,2,0*3C\r\n"); // GSA OFF to reduce volume
-    _serial_gps->write("$PAIR062,3,0*3D\r\n"); // GSV OFF to reduce volume
-    _serial_gps->write("$PAIR513*3D\r\n");     // save configuration
-    std::vector<ChipInfo> airoha = {{"AG3335", "$PAIR021,AG3335", GNSS_MODEL_AG3335},
-                                    {"AG3352", "$PAIR021,AG3352", GNSS_MODEL_AG3352},
-                                    {"RYS3520", "$PAIR021,REYAX_RYS3520_V2", GNSS_MODEL_AG3352}};
-    PROBE_FAMILY("Airoha Family", "$PAIR021*39", airoha, 1000);
-
-    PROBE_SIMPLE("LC86", "$PQTMVERNO*58", "$PQTMVERNO,LC86", GNSS_MODEL_AG3352, 500);
-    PROBE_SIMPLE("L76K", "$PCAS06,0*1B", "$GPTXT,01,01,02,SW=", GNSS_MODEL_MTK, 500);
-
-    // Close all NMEA sentences, valid for MTK3333 and MTK3339 platforms
-    _serial_gps->write("$PMTK514,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0*2E\r\n");
-    delay(20);
-    std::vector<ChipInfo> mtk = {{"L76B", "Quectel-L76B", GNSS_MODEL_MTK_L76B}, {"PA1010D", "1010D", GNSS_MODEL_MTK_PA1010D},
-                                 {"PA1616S", "1616S", GNSS_MODEL_MTK_PA1616S},  {"LS20031", "MC-1513", GNSS_MODEL_MTK_L76B},
-                                 {"L96", "Quectel-L96", GNSS_MODEL_MTK_L76B},   {"L80-R", "_3337_", GNSS_MODEL_MTK_L76B},
-                                 {"L80", "_3339_", GNSS_MODEL_MTK_L76B}};
-
-    PROBE_FAMILY("MTK Family", "$PMTK605*31", mtk, 500);
-
-    uint8_t cfg_rate[] = {0xB5, 0x62, 0x06, 0x08, 0x00, 0x00, 0x00, 0x00};
-    UBXChecksum(cfg_rate, sizeof(cfg_rate));
-    clearBuffer();
-    _serial_gps->write(cfg_rate, sizeof(cfg_rate));
-    // Check that the returned response class and message ID are correct
-    GPS_RESPONSE response = getACK(0x06, 0x08, 750);
-    if (response == GNSS_RESPONSE_NONE) {
-        LOG_WARN("No GNSS Module (baudrate %d)", serialSpeed);
-        return GNSS_MODEL_UNKNOWN;
-    } else if (response == GNSS_RESPONSE_FRAME_ERRORS) {
-        LOG_INFO("UBlox Frame Errors (baudrate %d)", serialSpeed);
-    }
-
-    memset(buffer, 0, sizeof(buffer));
-    uint8_t _message_MONVER[8] = {
-        0xB5, 0x62, // Sync message for UBX protocol
-        0x0A, 0x04, // Message class and ID (UBX-MON-VER)
-        0x00, 0x00, // Length of payload (we're asking for an answer, so no payload)
-        0x00, 0x00  // Checksum
-    };
-    //  Get Ublox gnss module hardware and software info
-    UBXChecksum(_message_MONVER, sizeof(_message_MONVER));
-    clearBuffer();
-    _serial_gps->write(_message_MONVER, sizeof(_message_MONVER));
-
-    uint16_t len = getACK(buffer, sizeof(buffer), 0x0A, 0x04, 1200);
-    if (len) {
-        uint16_t position = 0;
-        for (int i = 0; i < 30; i++) {
-            ublox_info.swVersion[i] = buffer[position];
-            position++;
-        }
-        for (int i = 0; i < 10; i++) {
-            ublox_info.hwVersion[i] = buffer[position];
-            position++;
-        }
-
-        while (len >= position + 30) {
-            for (int i = 0; i < 30; i++) {
-                ublox_info.extension[ublox_info.extensionNo][i] = buffer[position];
-                position++;
-            }
-            ublox_info.extensionNo++;
-            if (ublox_info.extensionNo > 9)
-                break;
-        }
-
-        LOG_DEBUG("Module Info : ");
-        LOG_DEBUG("Soft version: %s", ublox_info.swVersion);
-        LOG_DEBUG("Hard version: %s", ublox_info.hwVersion);
-        LOG_DEBUG("Extensions:%d", ublox_info.extensionNo);
-        for (int i = 0; i < ublox_info.extensionNo; i++) {
-            LOG_DEBUG("  %s", ublox_info.extension[i]);
-        }
-
-        memset(buffer, 0, sizeof(buffer));
-
-        // tips: extensionNo field is 0 on some 6M GNSS modules
-        for (int i = 0; i < ublox_info.extensionNo; ++i) {
-            if (!strncmp(ublox_info.extension[i], "MOD=", 4)) {
-                strncpy((char *)buffer, &(ublox_info.extension[i][4]), sizeof(buffer));
-            } else if (!strncmp(ublox_info.extension[i], "PROTVER", 7)) {
-                char *ptr = nullptr;
-                memset(buffer, 0, sizeof(buffer));
-                strncpy((char *)buffer, &(ublox_info.extension[i][8]), sizeof(buffer));
-                LOG_DEBUG("Protocol Version:%s", (char *)buffer);
-                if (strlen((char *)buffer)) {
-                    ublox_info.protocol_version = strtoul((char *)buffer, &ptr, 10);
-                    LOG_DEBUG("ProtVer=%d", ublox_info.protocol_version);
-                } else {
-                    ublox_info.protocol_version = 0;
-                }
-            }
-        }
-        if (strncmp(ublox_info.hwVersion, "00040007", 8) == 0) {
-            LOG_INFO(DETECTED_MESSAGE, "U-blox 6", "6");
-            return GNSS_MODEL_UBLOX6;
-        } else if (strncmp(ublox_info.hwVersion, "00070000", 8) == 0) {
-            LOG_INFO(DETECTED_MESSAGE, "U-blox 7", "7");
-            return GNSS_MODEL_UBLOX7;
-        } else if (strncmp(ublox_info.hwVersion, "00080000", 8) == 0) {
-            LOG_INFO(DETECTED_MESSAGE, "U-blox 8", "8");
-            return GNSS_MODEL_UBLOX8;
-        } else if (strncmp(ublox_info.hwVersion, "00190000", 8) == 0) {
-            LOG_INFO(DETECTED_MESSAGE, "U-blox 9", "9");
-            return GNSS_MODEL_UBLOX9;
-        } else if (strncmp(ublox_info.hwVersion, "000A0000", 8) == 0) {
-            LOG_INFO(DETECTED_MESSAGE, "U-blox 10", "10");
-            return GNSS_MODEL_UBLOX10;
-        }
-    }
-    LOG_WARN("No GNSS Module (baudrate %d)", serialSpeed);
-    return GNSS_MODEL_UNKNOWN;
-}
-
-GnssModel_t GPS::getProbeResponse(unsigned long timeout, const std::vector<ChipInfo> &responseMap)
-{
-    String response = "";
-    unsigned long start = millis();
-    while (millis() - start < timeout) {
-        if (_serial_gps->available()) {
-            response += (char)_serial_gps->read();
-
-            if (response.endsWith(",") || response.endsWith("\r\n")) {
-#ifdef GPS_DEBUG
-                LOG_DEBUG(response.c_str());
-#endif
-                // check if we can see our chips
-                for (const auto &chipInfo : responseMap) {
-                    if (strstr(response.c_str(), chipInfo.detectionString.c_str()) != nullptr) {
-                        LOG_INFO("%s detected", chipInfo.chipName.c_str());
-                        return chipInfo.driver;
-                    }
-                }
-            }
-            if (response.endsWith("\r\n")) {
-                response.trim();
-                response = ""; // Reset the response string for the next potential message
-            }
-        }
-    }
-#ifdef GPS_DEBUG
-    LOG_DEBUG(response.c_str());
-#endif
-    return GNSS_MODEL_UNKNOWN; // Return empty string on timeout
-}
-
 GPS *GPS::createGps()
 {
     int8_t _rx_gpio = config.position.rx_gpio;
@@ -1518,6 +1661,23 @@ bool GPS::lookForTime()
         return false;
     }
 #endif
+    if (hasNavPvt()) {
+        if (!navPvt.timeValid)
+            return false;
+        struct tm t;
+        t.tm_sec = navPvt.second + (millis() - navPvtMsec) / 1000;
+        t.tm_min = navPvt.minute;
+        t.tm_hour = navPvt.hour;
+        t.tm_mday = navPvt.day;
+        t.tm_mon = navPvt.month - 1;
+        t.tm_year = navPvt.year - 1900;
+        t.tm_isdst = false;
+        LOG_DEBUG("UBX GPS time %02d-%02d-%02d %02d:%02d:%02d", navPvt.year, navPvt.month, t.tm_mday, t.tm_hour, t.tm_min,
+                  t.tm_sec);
+        perhapsSetRTC(RTCQualityGPS, t);
+        return true;
+    }
+
     auto ti = reader.time;
     auto d = reader.date;
     if (ti.isValid() && d.isValid()) { // Note: we don't check for updated, because we'll only be called if needed
@@ -1571,6 +1731,9 @@ bool GPS::lookForLocation()
         }
     }
 #endif
+    if (hasNavPvt())
+        return lookForNavPvtLocation();
+
     // By default, TinyGPS++ does not parse GPGSA lines, which give us
     //   the 2D/3D fixType (see NMEAGPS.h)
     // At a minimum, use the fixQuality indicator in GPGGA (FIXME?)
@@ -1698,6 +1861,66 @@ bool GPS::lookForLocation()
     return true;
 }
 
+bool GPS::lookForNavPvtLocation()
+{
+    // Fill in what the NMEA path gets from GGA and GSA
+    fixQual = navPvt.fixOk ? (navPvt.diffSoln ? 2 : 1) : 0;
+#ifndef TINYGPS_OPTION_NO_CUSTOM_FIELDS
+    // GSA says 1 for no fix, 2 for 2D and 3 for 3D, NAV-PVT also has 4 for GNSS + dead reckoning
+    fixType = (navPvt.fixType == 2 || navPvt.fixType == 3) ? navPvt.fixType : (navPvt.fixType == 4 ? 3 : 1);
+#endif
+
+    // check if GPS has an acceptable lock, and if this is a new solution
+    if (!hasLock() || !navPvtUpdated)
+        return false;
+    navPvtUpdated = false;
+
+    // Discard incomplete or erroneous readings
+    if (navPvt.pDOP == 0) {
+        LOG_WARN("BOGUS pDOP REJECTED: %d", navPvt.pDOP);
+        return false;
+    }
+
+    p.location_source = meshtastic_Position_LocSource_LOC_INTERNAL;
+
+    // NAV-PVT has no HDOP, position DOP is the closest we have
+    p.PDOP = navPvt.pDOP;
+    p.HDOP = navPvt.pDOP;
+
+    p.latitude_i = navPvt.latitude_i;
+    p.longitude_i = navPvt.longitude_i;
+
+    p.altitude_geoidal_separation = (navPvt.heightMm - navPvt.hMSLMm) / 1000;
+    p.altitude_hae = navPvt.heightMm / 1000;
+    p.altitude = navPvt.hMSLMm / 1000;
+
+    p.fix_quality = fixQual;
+#ifndef TINYGPS_OPTION_NO_CUSTOM_FIELDS
+    p.fix_type = fixType;
+#endif
+
+    // positional timestamp
+    struct tm t;
+    t.tm_sec = navPvt.second;
+    t.tm_min = navPvt.minute;
+    t.tm_hour = navPvt.hour;
+    t.tm_mday = navPvt.day;
+    t.tm_mon = navPvt.month - 1;
+    t.tm_year = navPvt.year - 1900;
+    t.tm_isdst = false;
+    p.timestamp = gm_mktime(&t);
+
+    p.sats_in_view = navPvt.numSV;
+
+    // Both in degrees * 10^-5
+    if (navPvt.headMot >= 0 && navPvt.headMot < 36000000)
+        p.ground_track = navPvt.headMot;
+
+    p.ground_speed = navPvt.groundSpeedMmS * 36 / 10000; // mm/s to km/h
+
+    return true;
+}
+
 bool GPS::hasLock()
 {
     // Using GPGGA fix quality indicator
@@ -1714,7 +1937,7 @@ bool GPS::hasLock()
 
 bool GPS::hasFlow()
 {
-    return reader.passedChecksum() > 0;
+    return reader.passedChecksum() > 0 || ubxParser.frames() > 0;
 }
 
 bool GPS::whileActive()
@@ -1735,13 +1958,27 @@ bool GPS::whileActive()
     }
 #endif
     // First consume any chars that have piled up at the receiver
+    bool gotNmea = false;
     while (_serial_gps->available() > 0) {
         int c = _serial_gps->read();
+
+        // UBX frames don't go to TinyGPS++, it would only count them as checksum failures
+        UBXFrameParser::Result ubx = ubxParser.feed(c);
+        if (ubx == UBXFrameParser::UBX_FRAME) {
+            isValid |= handleUBXFrame();
+            continue;
+        } else if (ubx == UBXFrameParser::UBX_CONSUMED) {
+            continue;
+        }
+
         UBXscratch[charsInBuf] = c;
 #ifdef GPS_DEBUG
         debugmsg += vformat("%c", (c >= 32 && c <= 126) ? c : '.');
 #endif
-        isValid |= reader.encode(c);
+        if (reader.encode(c)) {
+            isValid = true;
+            gotNmea = true;
+        }
         if (charsInBuf > sizeof(UBXscratch) - 10 || c == '\r') {
             if (strnstr((char *)UBXscratch, "$GPTXT,01,01,02,u-blox ag - www.u-blox.com*50", charsInBuf)) {
                 rebootsSeen++;
@@ -1756,8 +1993,49 @@ bool GPS::whileActive()
         LOG_DEBUG(debugmsg.c_str());
     }
 #endif
+    if (gotNmea && hasNavPvt())
+        disableNmeaOutput();
     return isValid;
 }
+
+bool GPS::handleUBXFrame()
+{
+    if (ubxParser.msgClass() != UBX_CLASS_NAV || ubxParser.msgId() != UBX_NAV_PVT)
+        return false;
+    if (!decodeNavPvt(ubxParser.payload(), ubxParser.length(), navPvt))
+        return false;
+    if (!hasNavPvt())
+        LOG_INFO("Got UBX-NAV-PVT, use it instead of NMEA");
+    navPvtMsec = millis();
+    navPvtUpdated = true;
+    return true;
+}
+
+bool GPS::hasNavPvt() const
+{
+    return navPvtMsec && Throttle::isWithinTimespanMs(navPvtMsec, GPS_SOL_EXPIRY_MS);
+}
+
+/// Only in RAM, so after a power cycle the module sends NMEA until we see UBX-NAV-PVT again. If it never sends any, we
+/// never turn NMEA off, so modules which don't know UBX-NAV-PVT keep working.
+void GPS::disableNmeaOutput()
+{
+    if (lastNmeaOffMsec && Throttle::isWithinTimespanMs(lastNmeaOffMsec, GPS_SOL_EXPIRY_MS * 2))
+        return;
+    lastNmeaOffMsec = millis();
+    LOG_DEBUG("Turn off NMEA GGA and RMC");
+
+    uint8_t msglen;
+    if (gnssModel == GNSS_MODEL_UBLOX10) {
+        msglen = makeUBXPacket(0x06, 0x8A, sizeof(_message_VALSET_DISABLE_GGA_RMC_RAM), _message_VALSET_DISABLE_GGA_RMC_RAM);
+        _serial_gps->write(UBXscratch, msglen);
+    } else {
+        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_GGA_OFF), _message_GGA_OFF);
+        _serial_gps->write(UBXscratch, msglen);
+        msglen = makeUBXPacket(0x06, 0x01, sizeof(_message_RMC_OFF), _message_RMC_OFF);
+        _serial_gps->write(UBXscratch, msglen);
+    }
+}
 void GPS::enable()
 {
     // Clear the old scheduling info (reset the lock-time prediction)
@@ -6,10 +6,12 @@
 #include "GpioLogic.h"
 #include "Observer.h"
 #include "TinyGPS++.h"
+#include "UBXFrameParser.h"
 #include "concurrency/OSThread.h"
 #include "input/RotaryEncoderInterruptImpl1.h"
 #include "input/UpDownInterruptImpl1.h"
 #include "modules/PositionModule.h"
+#include <vector>
 
 // Allow defining the polarity of the ENABLE output.  default is active high
 #ifndef GPS_EN_ACTIVE
@@ -49,11 +51,54 @@ enum GPSPowerState : uint8_t {
     GPS_OFF        // Powered off indefinitely
 };
 
+enum GPSInitState : uint8_t {
+    GPS_INIT_START,     // Nothing done yet
+    GPS_INIT_PROBE,     // Looking for a module, one baud rate at a time
+    GPS_INIT_CONFIGURE, // Sending the configuration for the model we found
+};
+
 struct ChipInfo {
-    String chipName;        // The name of the chip (for logging)
-    String detectionString; // The string to match in the response
-    GnssModel_t driver;     // The driver to use
+    const char *chipName;        // The name of the chip (for logging)
+    const char *detectionString; // The string to match in the response
+    GnssModel_t driver;          // The driver to use
+};
+
+/**
+ * One step of detecting or configuring the GNSS module.
+ *
+ * Steps are queued up front and run by GPS::runInitSteps(), which returns to the main loop whenever a step has to wait for
+ * an answer or a delay, instead of blocking in delay() and busy-wait loops.
+ */
+struct GpsInitStep {
+    enum Kind : uint8_t {
+        STEP_WAIT,        // Nothing, just wait delayMsec
+        STEP_BAUD,        // Reopen the serial port at arg baud
+        STEP_PIN,         // digitalWrite(arg, cls)
+        STEP_CLEAR,       // Drop whatever the module sent so far
+        STEP_WRITE,       // Send the NUL terminated string data
+        STEP_DETECT,      // Send the command data, then look for one of len chips[] in the answer for up to arg msecs
+        STEP_UBX,         // Send a UBX packet, then wait for its ACK for up to arg msecs
+        STEP_UBX_PROBE,   // Like STEP_UBX, but if there is no answer at all we don't have a U-blox
+        STEP_UBX_VERSION, // Ask a U-blox for its version, which tells the model
+        STEP_CAS,         // Send a CASIC packet, then wait for its ACK for up to arg msecs
+    };
+
+    enum Result : uint8_t {
+        WAITING, // Not done yet, call again later
+        DONE,    // Go on with the next step
+        STOP,    // Skip the remaining steps
+    };
+
+    Kind kind;
+    uint8_t cls, id;  // Message class and ID for UBX and CASIC packets
+    uint8_t len;      // Payload length for UBX and CASIC packets, number of chips for STEP_DETECT
+    const void *data; // Payload or string to send
+    const ChipInfo *chips;
+    const char *what;   // What we are doing, to log if it fails
+    uint32_t arg;       // Timeout, baud rate or pin
+    uint16_t delayMsec; // How long to wait when done
 };
+
 /**
  * A gps class that only reads from the GPS periodically and keeps the gps powered down except when reading
  *
@@ -76,11 +121,6 @@ class GPS : private concurrency::OSThread
     /** We will notify this observable anytime GPS state has changed meaningfully */
     Observable<const meshtastic::GPSStatus *> newStatus;
 
-    /**
-     * Returns true if we succeeded
-     */
-    virtual bool setup();
-
     // re-enable the thread
     void enable();
 
@@ -118,6 +158,8 @@ class GPS : private concurrency::OSThread
     void down();
 
   private:
+    friend class GpsInitTest; // test/test_gps runs the init steps against a simulated serial port
+
     GPS() : concurrency::OSThread("GPS") {}
 
     /// Record that we have a GPS
@@ -159,6 +201,13 @@ class GPS : private concurrency::OSThread
     uint8_t fixType = 0;      // fix type from GPGSA
 #endif
 
+    // Binary solutions from a U-blox, see GPS_UBX_NAV_PVT
+    UBXFrameParser ubxParser;
+    UBXNavPvt navPvt = {};
+    uint32_t navPvtMsec = 0;      // millis() when we got navPvt, 0 if never
+    bool navPvtUpdated = false;   // lookForLocation() hasn't used navPvt yet
+    uint32_t lastNmeaOffMsec = 0; // millis() when we last asked the module to stop sending NMEA
+
     uint32_t lastWakeStartMsec = 0, lastSleepStartMsec = 0, lastFixStartMsec = 0;
     uint32_t rx_gpio = 0;
     uint32_t tx_gpio = 0;
@@ -166,6 +215,26 @@ class GPS : private concurrency::OSThread
     uint8_t speedSelect = 0;
     uint8_t probeTries = 0;
 
+    GPSInitState initState = GPS_INIT_START;
+    std::vector<GpsInitStep> initSteps;
+    size_t initStep = 0;          // index of the running step in initSteps
+    bool initStepStarted = false; // its command has been sent
+    bool initStepDone = false;    // and answered, now we only wait out its delay
+    uint32_t initStepMsec = 0;    // millis() when it was started, or done
+    int initBaud = 0;             // baud rate we are probing or configuring at
+
+    // State of the parser reading the answer to the running step
+    uint8_t initMatch = 0;       // bytes of the expected answer matched so far
+    uint8_t initFrameErrors = 0; // chars of the U-blox frame error message matched so far
+    uint16_t initRxNeeded = 0;   // payload bytes of the UBX frame we are reading
+    std::vector<uint8_t> initRx; // line or payload read so far
+
+    bool initAcked = false;              // The module answered one of our UBX or CASIC packets
+    bool cachedModelUnconfirmed = false; // We skipped the probe, but haven't heard from the module yet
+    uint32_t initStartMsec = 0, initDoneMsec = 0;
+    uint32_t initLongestMsec = 0; // longest we kept the main loop waiting
+    bool observingDeepSleep = false; // Init runs again when we probe anew, but must only register for deep sleep once
+
     /**
      * hasValidLocation - indicates that the position variables contain a complete
      *   GPS location, valid and fresh (< gps_update_interval + position_broadcast_secs)
@@ -203,11 +272,47 @@ class GPS : private concurrency::OSThread
 
     int rebootsSeen = 0;
 
-    int getACK(uint8_t *buffer, uint16_t size, uint8_t requestedClass, uint8_t requestedID, uint32_t waitMillis);
-    GPS_RESPONSE getACK(uint8_t c, uint8_t i, uint32_t waitMillis);
-    GPS_RESPONSE getACK(const char *message, uint32_t waitMillis);
+    // Non-blocking readers for the answer to the running init step, they consume what is available
+    GPS_RESPONSE readACK(uint8_t class_id, uint8_t msg_id);
+    GPS_RESPONSE readACKCas(uint8_t class_id, uint8_t msg_id);
+    uint16_t readPayload(uint8_t requestedClass, uint8_t requestedID);
+    GnssModel_t readProbeResponse(const ChipInfo *chips, uint8_t numChips);
 
-    GPS_RESPONSE getACKCas(uint8_t class_id, uint8_t msg_id, uint32_t waitMillis);
+    /**
+     * Detect and configure the module without holding up the main loop.
+     *
+     * Each call runs initSteps as far as it can, and queues the next batch once they are done: the probe for one baud rate
+     * after the other, then the configuration for the model we found.
+     * @return msecs until we want to be called again, 0 once we are done
+     */
+    int32_t runInit();
+
+    /// Forget the module we found, so the next runOnce() detects it again
+    void restartInit();
+
+    /// Run initSteps until one has to wait, returns how long or 0 if all are done
+    int32_t runInitSteps();
+    void startInitStep(const GpsInitStep &s);
+    GpsInitStep::Result pollInitStep(const GpsInitStep &s);
+
+    GpsInitStep &queueStep(GpsInitStep::Kind kind, uint32_t arg = 0);
+    void queueDelay(uint16_t msec);
+    void queueWrite(const char *nmea) { queueStep(GpsInitStep::STEP_WRITE).data = nmea; }
+    void queueDetect(const char *family, const char *command, const ChipInfo *chips, uint8_t numChips, uint32_t timeout);
+    void queueUBX(uint8_t class_id, uint8_t msg_id, const uint8_t *msg, uint8_t payload_size, const char *what, uint32_t timeout);
+    void queueCAS(uint8_t class_id, uint8_t msg_id, const uint8_t *msg, uint8_t payload_size, const char *what, uint32_t timeout);
+
+    /// Queue the probe for the next baud rate, false if we've tried them all
+    bool queueNextProbe();
+    void queueProbe(int serialSpeed);
+    void queueConfig();
+
+    GnssModel_t parseUbloxVersion(const uint8_t *buffer, uint16_t len);
+
+    /// Remember what we found, so the next boot can skip probing
+    bool loadCachedModel();
+    void saveCachedModel();
+    void forgetCachedModel();
 
     /// Prepare the GPS for the cpu entering deep sleep, expect to be gone for at least 100s of msecs
     /// always returns 0 to indicate okay to sleep
@@ -229,6 +334,18 @@ class GPS : private concurrency::OSThread
      */
     void setPowerUBLOX(bool on, uint32_t sleepMs = 0);
 
+    /// Take in a complete UBX frame from ubxParser, true if it was a navigation solution
+    bool handleUBXFrame();
+
+    /// True if we got a UBX-NAV-PVT recently, so we use that instead of NMEA
+    bool hasNavPvt() const;
+
+    /// lookForLocation() for UBX-NAV-PVT
+    bool lookForNavPvtLocation();
+
+    /// NMEA GGA and RMC are redundant once we get UBX-NAV-PVT, so ask the module to stop sending them
+    void disableNmeaOutput();
+
     /**
      * Tell users we have new GPS readings
      */
@@ -236,11 +353,6 @@ class GPS : private concurrency::OSThread
 
     virtual int32_t runOnce() override;
 
-    GnssModel_t getProbeResponse(unsigned long timeout, const std::vector<ChipInfo> &responseMap);
-
-    // Get GNSS model
-    GnssModel_t probe(int serialSpeed);
-
     // delay counter to allow more sats before fixed position stops GPS thread
     uint8_t fixeddelayCtr = 0;
 };
@@ -0,0 +1,109 @@
+#include "UBXFrameParser.h"
+
+UBXFrameParser::Result UBXFrameParser::feed(uint8_t c)
+{
+    switch (state) {
+    case SYNC1:
+        if (c != 0xB5)
+            return UBX_PASS;
+        state = SYNC2;
+        return UBX_CONSUMED;
+    case SYNC2:
+        if (c == 0x62) {
+            ckA = ckB = 0;
+            state = CLASS;
+            return UBX_CONSUMED;
+        }
+        // 0xB5 never shows up in NMEA, so nothing is lost by dropping it
+        if (c == 0xB5)
+            return UBX_CONSUMED;
+        state = SYNC1;
+        return UBX_PASS;
+    case CLASS:
+        header[0] = c;
+        addToChecksum(c);
+        state = ID;
+        return UBX_CONSUMED;
+    case ID:
+        header[1] = c;
+        addToChecksum(c);
+        state = LEN1;
+        return UBX_CONSUMED;
+    case LEN1:
+        len = c;
+        addToChecksum(c);
+        state = LEN2;
+        return UBX_CONSUMED;
+    case LEN2:
+        len |= (uint16_t)c << 8;
+        addToChecksum(c);
+        if (len > UBX_MAX_FRAME_PAYLOAD) {
+            // Nothing we might get is this long, we must have synced on noise
+            badFrames++;
+            state = SYNC1;
+            return UBX_CONSUMED;
+        }
+        pos = 0;
+        state = len ? PAYLOAD : CK_A;
+        return UBX_CONSUMED;
+    case PAYLOAD:
+        // Frames too long for us are still checksummed and consumed, just not kept
+        if (pos < UBX_MAX_PAYLOAD)
+            buf[pos] = c;
+        addToChecksum(c);
+        if (++pos == len)
+            state = CK_A;
+        return UBX_CONSUMED;
+    case CK_A:
+        rxCkA = c;
+        state = CK_B;
+        return UBX_CONSUMED;
+    case CK_B:
+        state = SYNC1;
+        if (rxCkA != ckA || c != ckB) {
+            badFrames++;
+            return UBX_CONSUMED;
+        }
+        goodFrames++;
+        return len <= UBX_MAX_PAYLOAD ? UBX_FRAME : UBX_CONSUMED;
+    }
+    return UBX_PASS;
+}
+
+static uint16_t readU2(const uint8_t *p)
+{
+    return p[0] | (uint16_t)p[1] << 8;
+}
+
+static uint32_t readU4(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+bool decodeNavPvt(const uint8_t *payload, uint16_t len, UBXNavPvt &out)
+{
+    if (len < UBX_NAV_PVT_LEN)
+        return false;
+
+    // Offsets are from the u-blox M8/M9/M10 interface descriptions
+    out.year = readU2(payload + 4);
+    out.month = payload[6];
+    out.day = payload[7];
+    out.hour = payload[8];
+    out.minute = payload[9];
+    out.second = payload[10];
+    out.timeValid = (payload[11] & 0x07) == 0x07; // validDate, validTime and fullyResolved
+    out.fixType = payload[20];
+    out.fixOk = payload[21] & 0x01;
+    out.diffSoln = payload[21] & 0x02;
+    out.numSV = payload[23];
+    out.longitude_i = (int32_t)readU4(payload + 24);
+    out.latitude_i = (int32_t)readU4(payload + 28);
+    out.heightMm = (int32_t)readU4(payload + 32);
+    out.hMSLMm = (int32_t)readU4(payload + 36);
+    out.hAccMm = readU4(payload + 40);
+    out.groundSpeedMmS = readU4(payload + 60);
+    out.headMot = (int32_t)readU4(payload + 64);
+    out.pDOP = readU2(payload + 76);
+    return true;
+}
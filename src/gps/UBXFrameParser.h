@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+
+/// Largest UBX payload we keep, UBX-NAV-PVT is 92 bytes. Longer frames are skipped.
+#define UBX_MAX_PAYLOAD 100
+
+/// A longer length field means we mistook noise for a frame
+#define UBX_MAX_FRAME_PAYLOAD 1024
+
+/**
+ * Incremental parser for UBX frames mixed into the NMEA stream of a U-blox receiver.
+ *
+ * Bytes are fed one at a time as they come off the UART. Bytes of a UBX frame are kept by the parser, everything else is
+ * handed back so the caller can pass it on to TinyGPS++. Once a frame with a valid checksum is complete its payload can be
+ * decoded in place, there is no copy into another buffer.
+ */
+class UBXFrameParser
+{
+  public:
+    enum Result : uint8_t {
+        UBX_PASS,     // Not part of a UBX frame, feed it to the NMEA parser
+        UBX_CONSUMED, // Part of a UBX frame which isn't complete yet
+        UBX_FRAME,    // Completed a frame with a good checksum, see msgClass(), msgId() and payload()
+    };
+
+    Result feed(uint8_t c);
+
+    uint8_t msgClass() const { return header[0]; }
+    uint8_t msgId() const { return header[1]; }
+    uint16_t length() const { return len; }
+
+    /// Payload of the last complete frame, valid until the next feed()
+    const uint8_t *payload() const { return buf; }
+
+    /// Number of good frames we've seen, and bad checksums
+    uint32_t frames() const { return goodFrames; }
+    uint32_t checksumFailures() const { return badFrames; }
+
+  private:
+    enum State : uint8_t { SYNC1, SYNC2, CLASS, ID, LEN1, LEN2, PAYLOAD, CK_A, CK_B };
+
+    State state = SYNC1;
+    uint8_t header[2] = {0, 0};
+    uint16_t len = 0, pos = 0;
+    uint8_t ckA = 0, ckB = 0, rxCkA = 0;
+    uint8_t buf[UBX_MAX_PAYLOAD];
+    uint32_t goodFrames = 0, badFrames = 0;
+
+    void addToChecksum(uint8_t c)
+    {
+        ckA += c;
+        ckB += ckA;
+    }
+};
+
+/**
+ * The parts of a UBX-NAV-PVT solution we use, in the units of meshtastic_Position where there is a matching field
+ */
+struct UBXNavPvt {
+    uint16_t year;
+    uint8_t month, day, hour, minute, second;
+    bool timeValid;                  // date and time are valid and fully resolved
+    uint8_t fixType;                 // 0 none, 2 2D, 3 3D, ...
+    bool fixOk;                      // within the accuracy limits set on the receiver
+    bool diffSoln;                   // differential corrections were applied
+    uint8_t numSV;                   // satellites used
+    int32_t latitude_i, longitude_i; // 1e-7 degrees
+    int32_t heightMm, hMSLMm;        // above the ellipsoid and mean sea level
+    uint32_t hAccMm;
+    uint32_t groundSpeedMmS;
+    int32_t headMot; // 1e-5 degrees
+    uint16_t pDOP;   // 1e-2
+};
+
+#define UBX_CLASS_NAV 0x01
+#define UBX_NAV_PVT 0x07
+#define UBX_NAV_PVT_LEN 92
+
+/** Decode the payload of a UBX-NAV-PVT frame, false if it's too short */
+bool decodeNavPvt(const uint8_t *payload, uint16_t len, UBXNavPvt &out);
@@ -19,6 +19,8 @@
 // Size of a CAS-ACK-(N)ACK message (14 bytes)
 #define CAS_ACK_NACK_MSG_SIZE 0x0E
 
+#define QUEUE_CAS_PACKET(TYPE, ID, DATA, ERRMSG, TIMEOUT) queueCAS(TYPE, ID, DATA, sizeof(DATA), ERRMSG, TIMEOUT)
+
 // CFG-RST (0x06, 0x02)
 // Factory reset
 static const uint8_t _message_CAS_CFG_RST_FACTORY[] = {
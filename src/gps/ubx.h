@@ -1,13 +1,6 @@
 static const char *failMessage = "Unable to %s";
 
-#define SEND_UBX_PACKET(TYPE, ID, DATA, ERRMSG, TIMEOUT)                                                                         \
-    do {                                                                                                                         \
-        msglen = makeUBXPacket(TYPE, ID, sizeof(DATA), DATA);                                                                    \
-        _serial_gps->write(UBXscratch, msglen);                                                                                  \
-        if (getACK(TYPE, ID, TIMEOUT) != GNSS_RESPONSE_OK) {                                                                     \
-            LOG_WARN(failMessage, #ERRMSG);                                                                                      \
-        }                                                                                                                        \
-    } while (0)
+#define QUEUE_UBX_PACKET(TYPE, ID, DATA, ERRMSG, TIMEOUT) queueUBX(TYPE, ID, DATA, sizeof(DATA), ERRMSG, TIMEOUT)
 
 // Power Management
 
@@ -274,6 +267,21 @@ static const uint8_t _message_GGA[] = {
     0x00        // Reserved
 };
 
+// Enable UBX-NAV-PVT, which has everything we read from GGA and RMC in one 100 byte frame
+static const uint8_t _message_NAV_PVT[] = {
+    0x01, 0x07, // UBX-NAV-PVT
+    0x00,       // Rate for DDC
+    0x01,       // Rate for UART1
+    0x00,       // Rate for UART2
+    0x01,       // Rate for USB, useful for native linux
+    0x00,       // Rate for SPI
+    0x00        // Reserved
+};
+
+// Disable GGA and RMC, once we get UBX-NAV-PVT instead
+static const uint8_t _message_GGA_OFF[] = {0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+static const uint8_t _message_RMC_OFF[] = {0xF0, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+
 // Disable UBX-AID-ALPSRV as it may confuse TinyGPS. The Neo-6 seems to send this message
 // whether the AID Autonomous is enabled or not
 static const uint8_t _message_AID[] = {
@@ -441,6 +449,12 @@ static const uint8_t _message_VALSET_ENABLE_NMEA_RAM[] = {0x00, 0x01, 0x00, 0x00
                                                           0x20, 0x01, 0xac, 0x00, 0x91, 0x20, 0x01};
 static const uint8_t _message_VALSET_ENABLE_NMEA_BBR[] = {0x00, 0x02, 0x00, 0x00, 0xbb, 0x00, 0x91,
                                                           0x20, 0x01, 0xac, 0x00, 0x91, 0x20, 0x01};
+// CFG-MSGOUT-UBX_NAV_PVT_UART1 on
+static const uint8_t _message_VALSET_ENABLE_NAV_PVT_RAM[] = {0x00, 0x01, 0x00, 0x00, 0x07, 0x00, 0x91, 0x20, 0x01};
+static const uint8_t _message_VALSET_ENABLE_NAV_PVT_BBR[] = {0x00, 0x02, 0x00, 0x00, 0x07, 0x00, 0x91, 0x20, 0x01};
+// CFG-MSGOUT-NMEA_ID_GGA_UART1 and RMC_UART1 off, only in RAM
+static const uint8_t _message_VALSET_DISABLE_GGA_RMC_RAM[] = {0x00, 0x01, 0x00, 0x00, 0xbb, 0x00, 0x91,
+                                                              0x20, 0x00, 0xac, 0x00, 0x91, 0x20, 0x00};
 static const uint8_t _message_VALSET_DISABLE_SBAS_RAM[] = {0x00, 0x01, 0x00, 0x00, 0x20, 0x00, 0x31,
                                                            0x10, 0x00, 0x05, 0x00, 0x31, 0x10, 0x00};
 static const uint8_t _message_VALSET_DISABLE_SBAS_BBR[] = {0x00, 0x02, 0x00, 0x00, 0x20, 0x00, 0x31,
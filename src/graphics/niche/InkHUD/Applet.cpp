@@ -628,7 +628,6 @@ std::string InkHUD::Applet::getTimeString()
 
 // Calculate how many nodes have been seen within our preferred window of activity
 // This period is set by user, via the menu
-// Todo: optimize to calculate once only per WindowManager::render
 uint16_t InkHUD::Applet::getActiveNodeCount()
 {
     // Don't even try to count nodes if RTC isn't set
@@ -636,16 +635,13 @@ uint16_t InkHUD::Applet::getActiveNodeCount()
     if (getRTCQuality() == RTCQualityNone)
         return 0;
 
-    uint16_t count = 0;
+    // Nodes heard recently, only looking at the most recent ones
+    uint16_t count = nodeDB->getViews().countHeardWithin(getTime(), settings->recentlyActiveSeconds);
 
-    // For each node in db
-    for (uint16_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
-
-        // Check if heard recently, and not our own node
-        if (sinceLastSeen(node) < settings->recentlyActiveSeconds && node->num != nodeDB->getNodeNum())
-            count++;
-    }
+    // Not our own node
+    meshtastic_NodeInfoLite *ourNode = nodeDB->getMeshNode(nodeDB->getNodeNum());
+    if (ourNode && sinceLastSeen(ourNode) < settings->recentlyActiveSeconds && count > 0)
+        count--;
 
     return count;
 }
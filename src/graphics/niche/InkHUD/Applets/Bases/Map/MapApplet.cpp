@@ -17,6 +17,7 @@ void InkHUD::MapApplet::onRender()
     // - latitude and longitude
     // - will be placed at X(0.5), Y(0.5)
     getMapCenter(&latCenter, &lngCenter);
+    cosLatCenter = cos(latCenter * DEG_TO_RAD);
 
     // Calculate North+East distance of each node to map center
     // - which nodes to use controlled by virtual shouldDrawNode method
@@ -78,13 +79,10 @@ void InkHUD::MapApplet::getMapCenter(float *lat, float *lng)
     float yAvg = 0;
     float zAvg = 0;
 
-    // For each node in db
-    for (uint32_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
-
-        // Skip if no position
-        if (!nodeDB->hasValidPosition(node))
-            continue;
+    // For each node in db with a position
+    const NodeSpatialIndex &positions = nodeDB->getSpatialIndex();
+    for (size_t i = 0; i < positions.size(); i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(positions.at(i));
 
         // Skip if derived applet doesn't want to show this node on the map
         if (!shouldDrawNode(node))
@@ -172,12 +170,8 @@ void InkHUD::MapApplet::getMapCenter(float *lat, float *lng)
     float easternmost = lngCenter;
     float westernmost = lngCenter;
 
-    for (uint8_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
-
-        // Skip if no position
-        if (!nodeDB->hasValidPosition(node))
-            continue;
+    for (size_t i = 0; i < positions.size(); i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(positions.at(i));
 
         // Skip if derived applet doesn't want to show this node on the map
         if (!shouldDrawNode(node))
@@ -233,14 +227,13 @@ InkHUD::MapApplet::Marker InkHUD::MapApplet::calculateMarker(float lat, float ln
 {
     assert(lat != 0 || lng != 0); // Not null island. Applets should check this before calling.
 
-    // Bearing and distance from map center to node
-    float distanceFromCenter = GeoCoord::latLongToMeter(latCenter, lngCenter, lat, lng);
-    float bearingFromCenter = GeoCoord::bearing(latCenter, lngCenter, lat, lng); // in radians
-
-    // Split into meters north and meters east components (signed)
-    // - signedness of cos / sin automatically sets negative if south or west
-    float northMeters = cos(bearingFromCenter) * distanceFromCenter;
-    float eastMeters = sin(bearingFromCenter) * distanceFromCenter;
+    // Meters north and meters east of map center (signed, negative if south or west)
+    // - equirectangular: degrees of longitude shrink by cos(latitude) of the map center, so no trig per node
+    // - same earth radius as GeoCoord::latLongToMeter
+    constexpr float METERS_PER_DEGREE = 6366000 * DEG_TO_RAD;
+    float degEast = fmod(lng - lngCenter + 540, 360) - 180; // -180 to 180, the short way round
+    float northMeters = (lat - latCenter) * METERS_PER_DEGREE;
+    float eastMeters = degEast * METERS_PER_DEGREE * cosLatCenter;
 
     // Store this as a new marker
     Marker m;
@@ -349,11 +342,12 @@ void InkHUD::MapApplet::drawLabeledMarker(meshtastic_NodeInfoLite *node)
 bool InkHUD::MapApplet::enoughMarkers()
 {
     uint8_t count = 0;
-    for (uint8_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
+    const NodeSpatialIndex &positions = nodeDB->getSpatialIndex();
+    for (size_t i = 0; i < positions.size(); i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(positions.at(i));
 
         // Count nodes
-        if (nodeDB->hasValidPosition(node) && shouldDrawNode(node))
+        if (shouldDrawNode(node))
             count++;
 
         // We need to find two
@@ -371,13 +365,10 @@ void InkHUD::MapApplet::calculateAllMarkers()
     // Clear old markers
     markers.clear();
 
-    // For each node in db
-    for (uint32_t i = 0; i < nodeDB->getNumMeshNodes(); i++) {
-        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
-
-        // Skip if no position
-        if (!nodeDB->hasValidPosition(node))
-            continue;
+    // For each node in db with a position
+    const NodeSpatialIndex &positions = nodeDB->getSpatialIndex();
+    for (size_t i = 0; i < positions.size(); i++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(positions.at(i));
 
         // Skip if derived applet doesn't want to show this node on the map
         if (!shouldDrawNode(node))
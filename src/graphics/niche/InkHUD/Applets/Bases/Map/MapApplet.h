@@ -54,6 +54,8 @@ class MapApplet : public Applet
     float metersToPx = 0; // Conversion factor for meters to pixels
     float latCenter = 0;  // Map center: latitude
     float lngCenter = 0;  // Map center: longitude
+    // Map center: how much a degree of longitude shrinks at its latitude
+    float cosLatCenter = 1;
 
     std::list<Marker> markers;
     uint32_t widthMeters = 0;  // Map width: meters
@@ -2,7 +2,7 @@
 
 #include "RTC.h"
 
-#include "GeoCoord.h"
+#include "NodeSpatialIndex.h"
 #include "NodeDB.h"
 
 #include "./NodeListApplet.h"
@@ -57,14 +57,9 @@ ProcessMessage InkHUD::NodeListApplet::handleReceived(const meshtastic_MeshPacke
             c.hopsAway = node->hops_away;
 
         if (nodeDB->hasValidPosition(node) && nodeDB->hasValidPosition(ourNode)) {
-            // Get lat and long as float
-            // Meshtastic stores these as integers internally
-            float ourLat = ourNode->position.latitude_i * 1e-7;
-            float ourLong = ourNode->position.longitude_i * 1e-7;
-            float theirLat = node->position.latitude_i * 1e-7;
-            float theirLong = node->position.longitude_i * 1e-7;
-
-            c.distanceMeters = (int32_t)GeoCoord::latLongToMeter(theirLat, theirLong, ourLat, ourLong);
+            // Straight from the integer positions Meshtastic stores, only a cosf() per node for nearby nodes
+            c.distanceMeters = (int32_t)NodeSpatialIndex::distance(node->position.latitude_i, node->position.longitude_i,
+                                                                   ourNode->position.latitude_i, ourNode->position.longitude_i);
         }
     }
 
@@ -2,7 +2,7 @@
 
 #include "RTC.h"
 
-#include "gps/GeoCoord.h"
+#include "mesh/NodeSpatialIndex.h"
 
 #include "./HeardApplet.h"
 
@@ -55,31 +55,24 @@ void InkHUD::HeardApplet::handleParsed(CardInfo c)
 }
 
 // When applet is activated, pre-fill with stale data from NodeDB
-// We're sorting using the last_heard value. Susceptible to weirdness if node's RTC changes.
+// We're using the last_heard order kept by NodeDB. Susceptible to weirdness if node's RTC changes.
 // No SNR is available in node db, so we can't calculate signal either
 // These initial cards from node db will be gradually pushed out by new packets which originate from out base applet instead
 void InkHUD::HeardApplet::populateFromNodeDB()
 {
-    // Fill a collection with pointers to each node in db
+    // Collect the most recently heard nodes, just enough to fill the screen
     std::vector<meshtastic_NodeInfoLite *> ordered;
-    for (auto mn = nodeDB->meshNodes->begin(); mn != nodeDB->meshNodes->end(); ++mn) {
-        // Only copy if valid, and not our own node
-        if (mn->num != 0 && mn->num != nodeDB->getNodeNum())
-            ordered.push_back(&*mn);
+    const NodeViews &views = nodeDB->getViews();
+    for (size_t rank = 0; rank < views.numByLastHeard() && ordered.size() < maxCards(); rank++) {
+        meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(views.byLastHeard(rank));
+        // Only if valid, and not our own node
+        if (node->num != 0 && node->num != nodeDB->getNodeNum())
+            ordered.push_back(node);
     }
 
-    // Sort the collection by age
-    std::sort(ordered.begin(), ordered.end(), [](meshtastic_NodeInfoLite *top, meshtastic_NodeInfoLite *bottom) -> bool {
-        return (top->last_heard > bottom->last_heard);
-    });
-
-    // Keep the most recent entries only
-    // Just enough to fill the screen
-    if (ordered.size() > maxCards())
-        ordered.resize(maxCards());
-
     // Create card info for these (stale) node observations
     meshtastic_NodeInfoLite *ourNode = nodeDB->getMeshNode(nodeDB->getNodeNum());
+    uint16_t ourCosLat = nodeDB->hasValidPosition(ourNode) ? NodeSpatialIndex::cosLatOf(ourNode->position.latitude_i) : 0;
     for (meshtastic_NodeInfoLite *node : ordered) {
         CardInfo c;
         c.nodeNum = node->num;
@@ -88,14 +81,10 @@ void InkHUD::HeardApplet::populateFromNodeDB()
             c.hopsAway = node->hops_away;
 
         if (nodeDB->hasValidPosition(node) && nodeDB->hasValidPosition(ourNode)) {
-            // Get lat and long as float
-            // Meshtastic stores these as integers internally
-            float ourLat = ourNode->position.latitude_i * 1e-7;
-            float ourLong = ourNode->position.longitude_i * 1e-7;
-            float theirLat = node->position.latitude_i * 1e-7;
-            float theirLong = node->position.longitude_i * 1e-7;
-
-            c.distanceMeters = (int32_t)GeoCoord::latLongToMeter(theirLat, theirLong, ourLat, ourLong);
+            // Straight from the integer positions Meshtastic stores, only a cosf() per node for nearby nodes
+            c.distanceMeters = (int32_t)NodeSpatialIndex::distance(
+                node->position.latitude_i, node->position.longitude_i, NodeSpatialIndex::cosLatOf(node->position.latitude_i),
+                ourNode->position.latitude_i, ourNode->position.longitude_i, ourCosLat);
         }
 
         // Insert into the card collection (member of base class)
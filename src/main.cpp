@@ -1,4 +1,5 @@
 #include "configuration.h"
+#include "BootProfiler.h"
 #if !MESHTASTIC_EXCLUDE_GPS
 #include "GPS.h"
 #endif
@@ -329,6 +330,7 @@ void printInfo()
 #ifndef PIO_UNIT_TESTING
 void setup()
 {
+    bootProfiler.startPhase("early");
 
 #if defined(PIN_POWER_EN)
     pinMode(PIN_POWER_EN, OUTPUT);
@@ -456,6 +458,7 @@ void setup()
 #ifdef PERIPHERAL_WARMUP_MS
     // Some peripherals may require additional time to stabilize after power is connected
     // e.g. I2C on Heltec Vision Master
+    bootProfiler.startPhase("warmup");
     LOG_INFO("Wait for peripherals to stabilize");
     delay(PERIPHERAL_WARMUP_MS);
 #endif
@@ -490,6 +493,7 @@ void setup()
     ledPeriodic = new Periodic("Blink", ledBlinker);
 #endif
 
+    bootProfiler.startPhase("fs");
     fsInit();
 
 #if !MESHTASTIC_EXCLUDE_I2C
@@ -540,6 +544,8 @@ void setup()
     tftSetup();
 #endif
 
+    bootProfiler.startPhase("power");
+
     // Currently only the tbeam has a PMU
     // PMU initialization needs to be placed before i2c scanning
     power = new Power();
@@ -548,6 +554,8 @@ void setup()
     power->setup(); // Must be after status handler is installed, so that handler gets notified of the initial configuration
 
 #if !MESHTASTIC_EXCLUDE_I2C
+    bootProfiler.startPhase("i2c scan");
+
     // We need to scan here to decide if we have a screen for nodeDB.init() and because power has been applied to
     // accessories
     auto i2cScanner = std::unique_ptr<ScanI2CTwoWire>(new ScanI2CTwoWire());
@@ -584,6 +592,8 @@ void setup()
     i2cScanner->scanPort(ScanI2C::I2CPort::WIRE);
 #endif
 
+    i2cScanner->saveScanCache();
+
     auto i2cCount = i2cScanner->countDevices();
     if (i2cCount == 0) {
         LOG_INFO("No I2C devices found");
@@ -745,6 +755,8 @@ void setup()
     digitalWrite(LED_PIN, LED_STATE_ON); // turn on for now
 #endif
 
+    bootProfiler.startPhase("platform");
+
     // Hello
     printInfo();
 #ifdef BUILD_EPOCH
@@ -765,6 +777,7 @@ void setup()
 
     // We do this as early as possible because this loads preferences from flash
     // but we need to do this after main cpu init (esp32setup), because we need the random seed set
+    bootProfiler.startPhase("nodedb");
     nodeDB = new NodeDB;
 
     // If we're taking on the repeater role, use NextHopRouter and turn off 3V3_S rail because peripherals are not needed
@@ -862,6 +875,7 @@ void setup()
 #endif
 
     // Initialize the screen first so we can show the logo while we start up everything else.
+    bootProfiler.startPhase("screen");
 #if HAS_SCREEN
     screen = new graphics::Screen(screen_found, screen_model, screen_geometry);
 #endif
@@ -885,6 +899,7 @@ void setup()
 
     readFromRTC(); // read the main CPU RTC at first (in case we can't get GPS time)
 
+    bootProfiler.startPhase("gps");
 #if !MESHTASTIC_EXCLUDE_GPS
     // If we're taking on the repeater role, ignore GPS
 #ifdef SENSOR_GPS_CONFLICT
@@ -925,6 +940,7 @@ void setup()
     }
 #endif
 #endif
+    bootProfiler.startPhase("modules");
     service = new MeshService();
     service->init();
 
@@ -971,6 +987,8 @@ void setup()
 
     screen->print("Started...\n");
 
+    bootProfiler.startPhase("radio");
+
 #ifdef PIN_PWR_DELAY_MS
     // This may be required to give the peripherals time to power up.
     delay(PIN_PWR_DELAY_MS);
@@ -1236,6 +1254,7 @@ void setup()
         }
     }
 
+    bootProfiler.startPhase("network");
     lateInitVariant(); // Do board specific init (see extra_variants/README.md for documentation)
 
 #if !MESHTASTIC_EXCLUDE_MQTT
@@ -1299,6 +1318,8 @@ void setup()
     setCPUFast(false); // 80MHz is fine for our slow peripherals
 #endif
 
+    bootProfiler.finish();
+
 #ifdef ARDUINO_ARCH_ESP32
     LOG_DEBUG("Free heap  : %7d bytes", ESP.getFreeHeap());
     LOG_DEBUG("Free PSRAM : %7d bytes", ESP.getFreePsram());
@@ -286,6 +286,8 @@ void Channels::initDefaults()
 
 void Channels::onConfigChanged()
 {
+    version++;
+
     // Make sure the phone hasn't mucked anything up
     for (int i = 0; i < channelFile.channels_count; i++) {
         const meshtastic_Channel &ch = fixupChannel(i);
@@ -422,6 +424,14 @@ bool Channels::decryptForHash(ChannelIndex chIndex, ChannelHash channelHash)
     }
 }
 
+bool Channels::getKeyForHash(ChannelIndex chIndex, ChannelHash channelHash, CryptoKey &k)
+{
+    if (chIndex >= getNumChannels() || getHash(chIndex) != channelHash)
+        return false;
+    k = getKey(chIndex);
+    return k.length >= 0;
+}
+
 /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
  *
  * This method is called before encoding outbound packets
@@ -28,6 +28,9 @@ class Channels
     /// the precomputed hashes for each of our channels, or -1 for invalid
     int16_t hashes[MAX_NUM_CHANNELS] = {};
 
+    /// Bumped by onConfigChanged()
+    uint32_t version = 0;
+
   public:
     Channels() {}
 
@@ -59,6 +62,9 @@ class Channels
     /** The index of the primary channel */
     ChannelIndex getPrimaryIndex() const { return primaryIndex; }
 
+    /** Changes each time the channels (and so the keys used to decrypt) may have changed */
+    uint32_t getVersion() const { return version; }
+
     ChannelIndex getNumChannels() { return channelFile.channels_count; }
 
     /// Called by NodeDB on initial boot when the radio config settings are unset.  Set a default single channel config.
@@ -75,6 +81,13 @@ class Channels
      */
     bool decryptForHash(ChannelIndex chIndex, ChannelHash channelHash);
 
+    /** Like decryptForHash, but return the key instead of setting it on the crypto engine, so packets can be decoded on
+     * several threads at once
+     *
+     * @return false if the channel hash or channel is invalid
+     */
+    bool getKeyForHash(ChannelIndex chIndex, ChannelHash channelHash, CryptoKey &k);
+
     /** Given a channel index setup crypto for encoding that channel (or the primary channel if that channel is unsecured)
      *
      * This method is called before encoding outbound packets
@@ -79,8 +79,9 @@ void CryptoEngine::clearKeys()
  * @param bytes Buffer containing plaintext input.
  * @param bytesOut Output buffer to be populated with encrypted ciphertext.
  */
-bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic,
-                                     uint64_t packetNum, size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut)
+bool CryptoEngine::encryptCurve25519(CryptoContext &ctx, uint32_t toNode, uint32_t fromNode,
+                                     meshtastic_UserLite_public_key_t remotePublic, uint64_t packetNum, size_t numBytes,
+                                     const uint8_t *bytes, uint8_t *bytesOut)
 {
     uint8_t *auth;
     long extraNonceTmp = random();
@@ -92,16 +93,16 @@ bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtas
         LOG_DEBUG("Node %d or their public_key not found", toNode);
         return false;
     }
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!computeSharedKey(ctx, remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
-    initNonce(fromNode, packetNum, extraNonceTmp);
+    hash(ctx.shared_key, 32);
+    initNonce(ctx, fromNode, packetNum, extraNonceTmp);
 
     // Calculate the shared secret with the destination node and encrypt
-    printBytes("Attempt encrypt with nonce: ", nonce, 13);
-    printBytes("Attempt encrypt with shared_key starting with: ", shared_key, 8);
-    aes_ccm_ae(shared_key, 32, nonce, 8, bytes, numBytes, nullptr, 0, bytesOut,
+    printBytes("Attempt encrypt with nonce: ", ctx.nonce, 13);
+    printBytes("Attempt encrypt with shared_key starting with: ", ctx.shared_key, 8);
+    aes_ccm_ae(ctx.shared_key, 32, ctx.nonce, 8, bytes, numBytes, nullptr, 0, bytesOut,
                auth); // this can write up to 15 bytes longer than numbytes past bytesOut
     memcpy((uint8_t *)(auth + 8), &extraNonceTmp,
            sizeof(uint32_t)); // do not use dereference on potential non aligned pointers : *extraNonce = extraNonceTmp;
@@ -119,8 +120,8 @@ bool CryptoEngine::encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtas
  * @param bytes Buffer containing ciphertext input.
  * @param bytesOut Output buffer to be populated with decrypted plaintext.
  */
-bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic, uint64_t packetNum,
-                                     size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut)
+bool CryptoEngine::decryptCurve25519(CryptoContext &ctx, uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic,
+                                     uint64_t packetNum, size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut)
 {
     const uint8_t *auth = bytes + numBytes - 12; // set to last 8 bytes of text?
     uint32_t extraNonce;                         // pointer was not really used
@@ -134,15 +135,15 @@ bool CryptoEngine::decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_publ
     }
 
     // Calculate the shared secret with the sending node and decrypt
-    if (!crypto->setDHPublicKey(remotePublic.bytes)) {
+    if (!computeSharedKey(ctx, remotePublic.bytes)) {
         return false;
     }
-    crypto->hash(shared_key, 32);
+    hash(ctx.shared_key, 32);
 
-    initNonce(fromNode, packetNum, extraNonce);
-    printBytes("Attempt decrypt with nonce: ", nonce, 13);
-    printBytes("Attempt decrypt with shared_key starting with: ", shared_key, 8);
-    return aes_ccm_ad(shared_key, 32, nonce, 8, bytes, numBytes - 12, nullptr, 0, auth, bytesOut);
+    initNonce(ctx, fromNode, packetNum, extraNonce);
+    printBytes("Attempt decrypt with nonce: ", ctx.nonce, 13);
+    printBytes("Attempt decrypt with shared_key starting with: ", ctx.shared_key, 8);
+    return aes_ccm_ad(ctx.shared_key, 32, ctx.nonce, 8, bytes, numBytes - 12, nullptr, 0, auth, bytesOut);
 }
 
 void CryptoEngine::setDHPrivateKey(uint8_t *_private_key)
@@ -187,14 +188,14 @@ void CryptoEngine::aesEncrypt(uint8_t *in, uint8_t *out)
     aes->encryptBlock(out, in);
 }
 
-bool CryptoEngine::setDHPublicKey(uint8_t *pubKey)
+bool CryptoEngine::computeSharedKey(CryptoContext &ctx, const uint8_t *pubKey)
 {
     uint8_t local_priv[32];
-    memcpy(shared_key, pubKey, 32);
+    memcpy(ctx.shared_key, pubKey, 32);
     memcpy(local_priv, private_key, 32);
     // Calculate the shared secret with the specified node's public key and our private key
     // This includes an internal weak key check, which among other things looks for an all 0 public key and shared key.
-    if (!Curve25519::dh2(shared_key, local_priv)) {
+    if (!Curve25519::dh2(ctx.shared_key, local_priv)) {
         LOG_WARN("Curve25519DH step 2 failed!");
         return false;
     }
@@ -217,33 +218,39 @@ void CryptoEngine::setKey(const CryptoKey &k)
  */
 void CryptoEngine::encryptPacket(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes)
 {
-    if (key.length > 0) {
-        initNonce(fromNode, packetId);
-        if (numBytes <= MAX_BLOCKSIZE) {
-            encryptAESCtr(key, nonce, numBytes, bytes);
-        } else {
-            LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!", numBytes);
-        }
-    }
+    // For CTR, the implementation is the same
+    decrypt(key, defaultContext, fromNode, packetId, numBytes, bytes);
 }
 
 void CryptoEngine::decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes)
 {
     // For CTR, the implementation is the same
-    encryptPacket(fromNode, packetId, numBytes, bytes);
+    decrypt(key, defaultContext, fromNode, packetId, numBytes, bytes);
+}
+
+void CryptoEngine::decrypt(const CryptoKey &k, CryptoContext &ctx, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                           uint8_t *bytes)
+{
+    if (k.length > 0) {
+        initNonce(ctx, fromNode, packetId);
+        if (numBytes <= MAX_BLOCKSIZE) {
+            encryptAESCtr(k, ctx.nonce, numBytes, bytes);
+        } else {
+            LOG_ERROR("Packet too large for crypto engine: %d. noop encryption!", numBytes);
+        }
+    }
 }
 
-// Generic implementation of AES-CTR encryption.
+// Generic implementation of AES-CTR encryption. Only uses locals, so several threads can use it at once
 void CryptoEngine::encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numBytes, uint8_t *bytes)
 {
-    delete ctr;
-    ctr = nullptr;
+    CTRCommon *ctr;
     if (_key.length == 16)
         ctr = new CTR<AES128>();
     else
         ctr = new CTR<AES256>();
     ctr->setKey(_key.bytes, _key.length);
-    static uint8_t scratch[MAX_BLOCKSIZE];
+    uint8_t scratch[MAX_BLOCKSIZE];
     memcpy(scratch, bytes, numBytes);
     memset(scratch + numBytes, 0,
            sizeof(scratch) - numBytes); // Fill rest of buffer with zero (in case cypher looks at it)
@@ -251,20 +258,21 @@ void CryptoEngine::encryptAESCtr(CryptoKey _key, uint8_t *_nonce, size_t numByte
     ctr->setIV(_nonce, 16);
     ctr->setCounterSize(4);
     ctr->encrypt(bytes, scratch, numBytes);
+    delete ctr;
 }
 
 /**
  * Init our 128 bit nonce for a new packet
  */
-void CryptoEngine::initNonce(uint32_t fromNode, uint64_t packetId, uint32_t extraNonce)
+void CryptoEngine::initNonce(CryptoContext &ctx, uint32_t fromNode, uint64_t packetId, uint32_t extraNonce)
 {
-    memset(nonce, 0, sizeof(nonce));
+    memset(ctx.nonce, 0, sizeof(ctx.nonce));
 
     // use memcpy to avoid breaking strict-aliasing
-    memcpy(nonce, &packetId, sizeof(uint64_t));
-    memcpy(nonce + sizeof(uint64_t), &fromNode, sizeof(uint32_t));
+    memcpy(ctx.nonce, &packetId, sizeof(uint64_t));
+    memcpy(ctx.nonce + sizeof(uint64_t), &fromNode, sizeof(uint32_t));
     if (extraNonce)
-        memcpy(nonce + sizeof(uint32_t), &extraNonce, sizeof(uint32_t));
+        memcpy(ctx.nonce + sizeof(uint32_t), &extraNonce, sizeof(uint32_t));
 }
 #ifndef HAS_CUSTOM_CRYPTO_ENGINE
 CryptoEngine *crypto = new CryptoEngine;
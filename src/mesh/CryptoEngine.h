@@ -23,6 +23,17 @@ struct CryptoKey {
 #define MAX_BLOCKSIZE 256
 #define TEST_CURVE25519_FIELD_OPS // Exposes Curve25519::isWeakPoint() for testing keys
 
+/**
+ * The per packet state of an encrypt/decrypt. Callers which may run on several threads at once (see DecodePool) pass their
+ * own, everything else uses the engine's default context.
+ */
+struct CryptoContext {
+    uint8_t nonce[16];
+#if !(MESHTASTIC_EXCLUDE_PKI)
+    uint8_t shared_key[32];
+#endif
+};
+
 class CryptoEngine
 {
   public:
@@ -39,11 +50,24 @@ class CryptoEngine
 #endif
     void clearKeys();
     void setDHPrivateKey(uint8_t *_private_key);
-    virtual bool encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic,
+    bool encryptCurve25519(uint32_t toNode, uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic,
+                           uint64_t packetNum, size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut)
+    {
+        return encryptCurve25519(defaultContext, toNode, fromNode, remotePublic, packetNum, numBytes, bytes, bytesOut);
+    }
+    bool decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic, uint64_t packetNum,
+                           size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut)
+    {
+        return decryptCurve25519(defaultContext, fromNode, remotePublic, packetNum, numBytes, bytes, bytesOut);
+    }
+    virtual bool encryptCurve25519(CryptoContext &ctx, uint32_t toNode, uint32_t fromNode,
+                                   meshtastic_UserLite_public_key_t remotePublic, uint64_t packetNum, size_t numBytes,
+                                   const uint8_t *bytes, uint8_t *bytesOut);
+    virtual bool decryptCurve25519(CryptoContext &ctx, uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic,
                                    uint64_t packetNum, size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut);
-    virtual bool decryptCurve25519(uint32_t fromNode, meshtastic_UserLite_public_key_t remotePublic, uint64_t packetNum,
-                                   size_t numBytes, const uint8_t *bytes, uint8_t *bytesOut);
-    virtual bool setDHPublicKey(uint8_t *publicKey);
+    virtual bool setDHPublicKey(uint8_t *publicKey) { return computeSharedKey(defaultContext, publicKey); }
+    /// Compute the shared key with a remote node's public key into ctx.shared_key
+    bool computeSharedKey(CryptoContext &ctx, const uint8_t *publicKey);
     virtual void hash(uint8_t *bytes, size_t numBytes);
 
     virtual void aesSetKey(const uint8_t *key, size_t key_len);
@@ -71,16 +95,25 @@ class CryptoEngine
      */
     virtual void encryptPacket(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
     virtual void decrypt(uint32_t fromNode, uint64_t packetId, size_t numBytes, uint8_t *bytes);
+
+    /**
+     * Decrypt with an explicit channel key and context, rather than the key set by setKey(). Safe to call from several
+     * threads at once, as long as encryptAESCtr() is (it is for the default implementation used on portduino).
+     *
+     * @param bytes is updated in place
+     */
+    void decrypt(const CryptoKey &k, CryptoContext &ctx, uint32_t fromNode, uint64_t packetId, size_t numBytes,
+                 uint8_t *bytes);
     virtual void encryptAESCtr(CryptoKey key, uint8_t *nonce, size_t numBytes, uint8_t *bytes);
 #ifndef PIO_UNIT_TESTING
   protected:
 #endif
+    CryptoContext defaultContext = {};
     /** Our per packet nonce */
-    uint8_t nonce[16] = {0};
+    uint8_t (&nonce)[16] = defaultContext.nonce;
     CryptoKey key = {};
-    CTRCommon *ctr = NULL;
 #if !(MESHTASTIC_EXCLUDE_PKI)
-    uint8_t shared_key[32] = {0};
+    uint8_t (&shared_key)[32] = defaultContext.shared_key;
     uint8_t private_key[32] = {0};
 #endif
     /**
@@ -91,7 +124,11 @@ class CryptoEngine
      * a 32 bit sending node number (stored in little endian order)
      * a 32 bit block counter (starts at zero)
      */
-    void initNonce(uint32_t fromNode, uint64_t packetId, uint32_t extraNonce = 0);
+    void initNonce(CryptoContext &ctx, uint32_t fromNode, uint64_t packetId, uint32_t extraNonce = 0);
+    void initNonce(uint32_t fromNode, uint64_t packetId, uint32_t extraNonce = 0)
+    {
+        initNonce(defaultContext, fromNode, packetId, extraNonce);
+    }
 };
 
 extern CryptoEngine *crypto;
\ No newline at end of file
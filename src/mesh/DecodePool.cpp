@@ -0,0 +1,69 @@
+#include "DecodePool.h"
+
+#if ARCH_PORTDUINO
+
+DecodePool::DecodePool(unsigned numThreads)
+{
+    for (unsigned i = 0; i < numThreads; i++)
+        workers.emplace_back([this] { workerLoop(); });
+    LOG_INFO("Decode packets on %u worker threads", numThreads);
+}
+
+DecodePool::~DecodePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &t : workers)
+        t.join();
+}
+
+void DecodePool::work()
+{
+    size_t i;
+    while ((i = next.fetch_add(1)) < count)
+        states[i] = perhapsDecodeLocked(packets[i]);
+}
+
+void DecodePool::decodeAll(meshtastic_MeshPacket *const *_packets, DecodeState *_states, size_t _count)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        packets = _packets;
+        states = _states;
+        count = _count;
+        next = 0;
+        active = workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    work();
+
+    // Even once all packets are claimed, wait for the workers to finish the ones they are decoding
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return active == 0; });
+    count = 0;
+}
+
+void DecodePool::workerLoop()
+{
+    uint32_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [&] { return stopping || generation != seen; });
+        if (stopping)
+            return;
+        seen = generation;
+
+        lock.unlock();
+        work();
+        lock.lock();
+
+        if (--active == 0)
+            done.notify_one();
+    }
+}
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "configuration.h"
+
+#if ARCH_PORTDUINO
+#include "Router.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Worker threads which decrypt and decode a batch of received packets in parallel, for meshtasticd on multi-core hosts.
+ *
+ * Router hands over a batch it has already filtered for duplicates and waits for all of it, so packets are still handled by
+ * the single-threaded Router in arrival order. The calling thread works on the batch too.
+ *
+ * Decoding reads the NodeDB and channels, which nothing else changes while the main thread waits here. Its only shared writes
+ * are the log, which RedirectablePrint locks, and the list of packets which arrived compressed, see decompressReceived().
+ */
+class DecodePool
+{
+  public:
+    explicit DecodePool(unsigned numThreads);
+    ~DecodePool();
+
+    /// Run perhapsDecodeLocked() on each packet, storing the results in states
+    void decodeAll(meshtastic_MeshPacket *const *packets, DecodeState *states, size_t count);
+
+    unsigned getNumThreads() const { return workers.size(); }
+
+  private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    bool stopping = false;
+
+    // The batch being worked on
+    meshtastic_MeshPacket *const *packets = NULL;
+    DecodeState *states = NULL;
+    size_t count = 0;
+    uint32_t generation = 0;      // bumped for every batch, so workers can tell a new one from the one they finished
+    std::atomic<size_t> next{0};  // next packet to claim
+    size_t active = 0;            // workers still busy with the current batch
+
+    void workerLoop();
+    /// Claim and decode packets until the batch is exhausted
+    void work();
+};
+#endif
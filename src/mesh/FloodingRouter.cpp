@@ -1,4 +1,5 @@
 #include "FloodingRouter.h"
+#include "PacketTrace.h"
 
 #include "configuration.h"
 #include "mesh-pb-constants.h"
@@ -23,6 +24,7 @@ bool FloodingRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
 {
     if (wasSeenRecently(p)) { // Note: this will also add a recent packet record
         printPacket("Ignore dupe incoming msg", p);
+        packetTrace.record(PTRACE_DUPE, p);
         rxDupe++;
 
         /* If the original transmitter is doing retransmissions (hopStart equals hopLimit) for a reliable transmission, e.g., when
@@ -81,6 +83,7 @@ void FloodingRouter::perhapsRebroadcast(const meshtastic_MeshPacket *p)
                 tosend->next_hop = NO_NEXT_HOP_PREFERENCE; // this should already be the case, but just in case
 
                 LOG_INFO("Rebroadcast received floodmsg");
+                packetTrace.record(PTRACE_RELAY, tosend);
                 // Note: we are careful to resend using the original senders node id
                 // We are careful not to call our hooked version of send() - because we don't want to check this again
                 Router::send(tosend);
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A Space-Saving heavy hitters sketch (Metwally, Agrawal, El Abbadi 2005): keeps the keys with the largest total weight in
+ * N fixed slots, whatever the number of distinct keys.
+ *
+ * When a new key arrives and all slots are taken it replaces the lightest one and inherits its weight, which is recorded as
+ * the error. So a reported weight is at most error too high, and any key heavier than total / N is always present.
+ */
+template <class Key, size_t N> class HeavyHitters
+{
+  public:
+    struct Entry {
+        Key key;
+        uint32_t weight;
+        /// How much of weight may have belonged to the keys this slot held before
+        uint32_t error;
+        /// Number of add() calls since the key got its slot. Unlike weight, decay() leaves it alone
+        uint32_t count;
+    };
+
+    void add(Key key, uint32_t weight)
+    {
+        total += weight;
+
+        size_t lightest = 0;
+        for (size_t i = 0; i < used; i++) {
+            if (entries[i].key == key) {
+                entries[i].weight += weight;
+                entries[i].count++;
+                return;
+            }
+            if (entries[i].weight < entries[lightest].weight)
+                lightest = i;
+        }
+
+        if (used < N) {
+            entries[used++] = {key, weight, 0, 1};
+        } else {
+            Entry &e = entries[lightest];
+            e = {key, e.weight + weight, e.weight, 1};
+        }
+    }
+
+    /// Copy the up to n heaviest entries into out, heaviest first, returning how many were copied
+    size_t top(Entry *out, size_t n) const
+    {
+        size_t found = 0;
+        for (size_t i = 0; i < used; i++) {
+            // Insertion sort into out, which is only ever a handful of entries
+            size_t j = found < n ? found++ : n;
+            while (j > 0 && out[j - 1].weight < entries[i].weight) {
+                if (j < n)
+                    out[j] = out[j - 1];
+                j--;
+            }
+            if (j < n)
+                out[j] = entries[i];
+        }
+        return found;
+    }
+
+    /// Halve every weight, so traffic from long ago fades out. Keys whose weight reaches 0 are dropped
+    void decay()
+    {
+        total /= 2;
+        size_t kept = 0;
+        for (size_t i = 0; i < used; i++) {
+            Entry e = entries[i];
+            e.weight /= 2;
+            e.error /= 2;
+            if (e.weight)
+                entries[kept++] = e;
+        }
+        used = kept;
+    }
+
+    void clear()
+    {
+        used = 0;
+        total = 0;
+    }
+
+    /// Sum of all weights added (and decayed), including keys which lost their slot
+    uint32_t getTotal() const { return total; }
+
+    size_t size() const { return used; }
+
+  private:
+    Entry entries[N];
+    size_t used = 0;
+    uint32_t total = 0;
+};
@@ -2,11 +2,42 @@
 
 #include <Arduino.h>
 #include <assert.h>
+#include <atomic>
 #include <functional>
 #include <memory>
 
 #include "PointerQueue.h"
 
+#ifdef ARCH_PORTDUINO
+// Packets are allocated and released from several threads there (DecodePool workers, API and UDP threads)
+typedef std::atomic<uint32_t> AllocatorCounter;
+#else
+typedef uint32_t AllocatorCounter;
+#endif
+
+/// Counters kept by an Allocator, to see how much copying and how many live objects the mesh stack needs
+struct AllocatorStats {
+    AllocatorCounter live;        // Objects allocated and not yet released (only counted by MemoryRefCounted)
+    AllocatorCounter highWater;   // Most live objects at once
+    AllocatorCounter copies;      // allocCopy() calls
+    AllocatorCounter copiedBytes; // Bytes copied by them
+    AllocatorCounter shares;      // share() calls which didn't need a copy
+
+    /// Count one more live object
+    void addLive()
+    {
+        uint32_t now = ++live;
+#ifdef ARCH_PORTDUINO
+        uint32_t high = highWater;
+        while (now > high && !highWater.compare_exchange_weak(high, now)) {
+        }
+#else
+        if (now > highWater)
+            highWater = now;
+#endif
+    }
+};
+
 template <class T> class Allocator
 {
 
@@ -41,11 +72,20 @@ template <class T> class Allocator
         T *p = alloc(maxWait);
         assert(p);
 
-        if (p)
+        if (p) {
             *p = src;
+            stats.copies++;
+            stats.copiedBytes += sizeof(T);
+        }
         return p;
     }
 
+    /// Return another reference to p, which must be released separately. The object must not be changed while it is shared.
+    /// Allocators without reference counts return a copy.
+    virtual T *share(T *p) { return allocCopy(*p); }
+
+    const AllocatorStats &getStats() const { return stats; }
+
     /// Variations of the above methods that return std::unique_ptr instead of raw pointers.
     using UniqueAllocation = std::unique_ptr<T, const std::function<void(T *)> &>;
     /// Return a queable object which has been prefilled with zeros.
@@ -66,6 +106,8 @@ template <class T> class Allocator
     virtual void release(T *p) = 0;
 
   protected:
+    AllocatorStats stats = {};
+
     // Alloc some storage
     virtual T *alloc(TickType_t maxWait) = 0;
 
@@ -96,3 +138,48 @@ template <class T> class MemoryDynamic : public Allocator<T>
         return p;
     }
 };
+
+/**
+ * An allocator that uses the heap and keeps a reference count next to each object, so one copy can be held in several places
+ * with share(). The object is freed when the last reference is released.
+ */
+template <class T> class MemoryRefCounted : public Allocator<T>
+{
+  public:
+    virtual void release(T *p) override
+    {
+        assert(p);
+        Block *b = toBlock(p);
+        assert(b->refs > 0);
+        if (--b->refs == 0) {
+            delete b;
+            this->stats.live--;
+        }
+    }
+
+    virtual T *share(T *p) override
+    {
+        assert(p);
+        toBlock(p)->refs++;
+        this->stats.shares++;
+        return p;
+    }
+
+  protected:
+    virtual T *alloc(TickType_t maxWait) override
+    {
+        Block *b = new Block;
+        assert(b);
+        b->refs = 1;
+        this->stats.addLive();
+        return &b->obj;
+    }
+
+  private:
+    struct Block {
+        T obj; // Must be first, the pointers we hand out are to it
+        std::atomic<uint16_t> refs;
+    };
+
+    static Block *toBlock(T *p) { return reinterpret_cast<Block *>(p); }
+};
@@ -1,5 +1,6 @@
 #include "MeshPacketQueue.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
 #include "configuration.h"
 #include <assert.h>
 
@@ -72,6 +73,7 @@ bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
         bool replaced = replaceLowerPriorityPacket(p);
         if (!replaced) {
             LOG_WARN("TX queue is full, and there is no lower-priority packet available to evict in favour of 0x%08x", p->id);
+            packetTrace.record(PTRACE_TX_QUEUE_FULL, p, queue.size());
         }
         return replaced;
     }
@@ -79,6 +81,7 @@ bool MeshPacketQueue::enqueue(meshtastic_MeshPacket *p)
     // Find the correct position using upper_bound to maintain a stable order
     auto it = std::upper_bound(queue.begin(), queue.end(), p, CompareMeshPacketFunc);
     queue.insert(it, p); // Insert packet at the found position
+    packetTrace.record(PTRACE_TX_QUEUED, p, queue.size());
     return true;
 }
 
@@ -147,6 +150,7 @@ bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
         LOG_WARN("Dropping packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x", backPacket->id, p->id);
         // Remove the back packet
         queue.pop_back();
+        packetTrace.record(PTRACE_TX_EVICTED, backPacket, queue.size());
         packetPool.release(backPacket);
         // Insert the new packet in the correct order
         enqueue(p);
@@ -163,6 +167,7 @@ bool MeshPacketQueue::replaceLowerPriorityPacket(meshtastic_MeshPacket *p)
             LOG_WARN("Dropping non-late packet 0x%08x to make room in the TX queue for higher-priority packet 0x%08x",
                      refPacket->id, p->id);
             queue.erase(it);
+            packetTrace.record(PTRACE_TX_EVICTED, refPacket, queue.size());
             packetPool.release(refPacket);
             // Insert the new packet in the correct order
             enqueue(p);
@@ -1,4 +1,5 @@
 #include "NextHopRouter.h"
+#include "PacketTrace.h"
 
 NextHopRouter::NextHopRouter() {}
 
@@ -6,20 +7,32 @@ PendingPacket::PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmission
 {
     packet = p;
     this->numRetransmissions = numRetransmissions - 1; // We subtract one, because we assume the user just did the first send
+    packetLen = RadioInterface::getPacketLength(p);
 }
 
 /**
  * Send a packet
  */
 ErrorCode NextHopRouter::send(meshtastic_MeshPacket *p)
+{
+    return sendAvoiding(p, NO_NEXT_HOP_PREFERENCE);
+}
+
+ErrorCode NextHopRouter::sendAvoiding(meshtastic_MeshPacket *p, uint8_t failedHop)
 {
     // Add any messages _we_ send to the seen message list (so we will ignore all retransmissions we see)
     p->relay_node = nodeDB->getLastByteOfNodeNum(getNodeNum()); // First set the relayer to us
     wasSeenRecently(p);                                         // FIXME, move this to a sniffSent method
 
-    p->next_hop = getNextHop(p->to, p->relay_node); // set the next hop
+    // set the next hop, for a retransmission not the one which just failed us
+    p->next_hop = getNextHop(p->to, failedHop != NO_NEXT_HOP_PREFERENCE ? failedHop : p->relay_node);
     LOG_DEBUG("Setting next hop for packet with dest %x to %x", p->to, p->next_hop);
 
+    // ReliableRouter copies the packet for retransmission before we get here, remember who we asked so we can score them
+    auto rec = findPendingPacket(getFrom(p), p->id);
+    if (rec)
+        rec->packet->next_hop = p->next_hop;
+
     // If it's from us, ReliableRouter already handles retransmissions if want_ack is set. If a next hop is set and hop limit is
     // not 0 or want_ack is set, start retransmissions
     if ((!isFromUs(p) || !p->want_ack) && p->next_hop != NO_NEXT_HOP_PREFERENCE && (p->hop_limit > 0 || p->want_ack))
@@ -34,7 +47,9 @@ bool NextHopRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
     bool weWereNextHop = false;
     if (wasSeenRecently(p, true, &wasFallback, &weWereNextHop)) { // Note: this will also add a recent packet record
         printPacket("Ignore dupe incoming msg", p);
+        packetTrace.record(PTRACE_DUPE, p);
         rxDupe++;
+        noteRelayed(p);
         stopRetransmission(p->from, p->id);
 
         // If it was a fallback to flooding, try to relay again
@@ -75,9 +90,12 @@ void NextHopRouter::sniffReceived(const meshtastic_MeshPacket *p, const meshtast
                 // the destination
                 if (wasRelayer(p->relay_node, p->decoded.request_id, p->to) ||
                     (wasRelayer(ourRelayID, p->decoded.request_id, p->to) && p->hop_start != 0 && p->hop_start == p->hop_limit)) {
-                    if (origTx->next_hop != p->relay_node) { // Not already set
-                        LOG_INFO("Update next hop of 0x%x to 0x%x based on ACK/reply", p->from, p->relay_node);
-                        origTx->next_hop = p->relay_node;
+                    routes.recordSuccess(p->from, p->relay_node, p->rx_snr, millis());
+                    // NodeDB keeps the best one, which is what clients get to see
+                    uint8_t best = routes.getBest(p->from, NO_NEXT_HOP_PREFERENCE, millis());
+                    if (best != NO_NEXT_HOP_PREFERENCE && origTx->next_hop != best) { // Not already set
+                        LOG_INFO("Update next hop of 0x%x to 0x%x based on ACK/reply", p->from, best);
+                        origTx->next_hop = best;
                     }
                 }
             }
@@ -105,6 +123,7 @@ bool NextHopRouter::perhapsRelay(const meshtastic_MeshPacket *p)
                 LOG_INFO("Relaying received message coming from %x", p->relay_node);
 
                 tosend->hop_limit--; // bump down the hop count
+                packetTrace.record(PTRACE_RELAY, tosend);
                 NextHopRouter::send(tosend);
 
                 return true;
@@ -121,15 +140,19 @@ bool NextHopRouter::perhapsRelay(const meshtastic_MeshPacket *p)
  * Get the next hop for a destination, given the relay node
  * @return the node number of the next hop, 0 if no preference (fallback to FloodingRouter)
  */
-uint8_t NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node)
+uint8_t NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node, uint8_t minScore)
 {
     // When we're a repeater router->sniffReceived will call NextHopRouter directly without checking for broadcast
     if (isBroadcast(to))
         return NO_NEXT_HOP_PREFERENCE;
 
+    // We are careful not to return the relay node as the next hop
+    if (routes.find(to))
+        return routes.getBest(to, relay_node, millis(), minScore);
+
+    // Nothing learned since boot, use what NodeDB remembers
     meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(to);
     if (node && node->next_hop) {
-        // We are careful not to return the relay node as the next hop
         if (node->next_hop != relay_node) {
             // LOG_DEBUG("Next hop for 0x%x is 0x%x", to, node->next_hop);
             return node->next_hop;
@@ -139,6 +162,14 @@ uint8_t NextHopRouter::getNextHop(NodeNum to, uint8_t relay_node)
     return NO_NEXT_HOP_PREFERENCE;
 }
 
+void NextHopRouter::noteRelayed(const meshtastic_MeshPacket *p)
+{
+    auto rec = findPendingPacket(getFrom(p), p->id);
+    if (rec && !isBroadcast(rec->packet->to) && rec->packet->next_hop != NO_NEXT_HOP_PREFERENCE &&
+        rec->packet->next_hop == p->relay_node)
+        routes.recordRelayed(rec->packet->to, p->relay_node, millis());
+}
+
 PendingPacket *NextHopRouter::findPendingPacket(GlobalPacketId key)
 {
     auto old = pending.find(key); // If we have an old record, someone messed up because id got reused
@@ -204,73 +235,86 @@ PendingPacket *NextHopRouter::startRetransmission(meshtastic_MeshPacket *p, uint
 int32_t NextHopRouter::doRetransmissions()
 {
     uint32_t now = millis();
-    int32_t d = INT32_MAX;
-
-    // FIXME, we should use a better datastructure rather than walking through this map.
-    // for(auto el: pending) {
-    for (auto it = pending.begin(), nextIt = it; it != pending.end(); it = nextIt) {
-        ++nextIt; // we use this odd pattern because we might be deleting it...
-        auto &p = it->second;
-
-        bool stillValid = true; // assume we'll keep this record around
-
-        // FIXME, handle 51 day rolloever here!!!
-        if (p.nextTxMsec <= now) {
-            if (p.numRetransmissions == 0) {
-                if (isFromUs(p.packet)) {
-                    LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p.packet->from, p.packet->to,
-                              p.packet->id);
-                    sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
-                }
-                // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
-                stopRetransmission(it->first);
-                stillValid = false; // just deleted it
-            } else {
-                LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p.packet->from, p.packet->to,
-                          p.packet->id, p.numRetransmissions);
-
-                if (!isBroadcast(p.packet->to)) {
-                    if (p.numRetransmissions == 1) {
-                        // Last retransmission, reset next_hop (fallback to FloodingRouter)
-                        p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        // Also reset it in the nodeDB
-                        meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p.packet->to);
-                        if (sentTo) {
-                            LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
-                            sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
-                        }
-                        FloodingRouter::send(packetPool.allocCopy(*p.packet));
-                    } else {
-                        NextHopRouter::send(packetPool.allocCopy(*p.packet));
+
+    while (!retransmitSchedule.empty()) {
+        auto key = retransmitSchedule.nextKey();
+        auto ticket = retransmitSchedule.nextTicket();
+        auto rec = findPendingPacket(key);
+        if (!rec || rec->nextTxMsec != ticket) {
+            // Stopped or rescheduled since this entry was added
+            retransmitSchedule.pop();
+            continue;
+        }
+        if (RetransmitSchedule<GlobalPacketId>::isAfter(retransmitSchedule.deadline(ticket), now))
+            break;
+        retransmitSchedule.pop();
+
+        auto &p = *rec;
+        if (p.numRetransmissions == 0) {
+            if (isFromUs(p.packet)) {
+                LOG_DEBUG("Reliable send failed, returning a nak for fr=0x%x,to=0x%x,id=0x%x", p.packet->from, p.packet->to,
+                          p.packet->id);
+                sendAckNak(meshtastic_Routing_Error_MAX_RETRANSMIT, getFrom(p.packet), p.packet->id, p.packet->channel);
+            }
+            // Note: we don't stop retransmission here, instead the Nak packet gets processed in sniffReceived
+            packetTrace.record(PTRACE_RETRANSMIT_END, p.packet, pending.size() - 1);
+            stopRetransmission(key);
+        } else {
+            LOG_DEBUG("Sending retransmission fr=0x%x,to=0x%x,id=0x%x, tries left=%d", p.packet->from, p.packet->to,
+                      p.packet->id, p.numRetransmissions);
+            packetTrace.record(PTRACE_RETRANSMIT, p.packet, pending.size());
+
+            if (!isBroadcast(p.packet->to)) {
+                // The next hop didn't relay, or we would have stopped retransmitting by now. The last retransmission goes to
+                // another candidate only if it has been reliable lately, else it floods
+                uint8_t failedHop = p.packet->next_hop;
+                bool isLastTry = p.numRetransmissions == 1;
+                if (routes.retryHop(p.packet->to, failedHop, isLastTry, now) == NO_NEXT_HOP_PREFERENCE && isLastTry) {
+                    // Last retransmission, reset next_hop (fallback to FloodingRouter)
+                    p.packet->next_hop = NO_NEXT_HOP_PREFERENCE;
+                    // Also reset it in the nodeDB
+                    meshtastic_NodeInfoLite *sentTo = nodeDB->getMeshNode(p.packet->to);
+                    if (sentTo) {
+                        LOG_INFO("Resetting next hop for packet with dest 0x%x\n", p.packet->to);
+                        sentTo->next_hop = NO_NEXT_HOP_PREFERENCE;
                     }
-                } else {
-                    // Note: we call the superclass version because we don't want to have our version of send() add a new
-                    // retransmission record
                     FloodingRouter::send(packetPool.allocCopy(*p.packet));
+                } else {
+                    sendAvoiding(packetPool.allocCopy(*p.packet), isLastTry ? failedHop : NO_NEXT_HOP_PREFERENCE);
                 }
-
-                // Queue again
-                --p.numRetransmissions;
-                setNextTx(&p);
+            } else {
+                // Note: we call the superclass version because we don't want to have our version of send() add a new
+                // retransmission record
+                FloodingRouter::send(packetPool.allocCopy(*p.packet));
             }
-        }
 
-        if (stillValid) {
-            // Update our desired sleep delay
-            int32_t t = p.nextTxMsec - now;
-
-            d = min(t, d);
+            // Queue again. Sending might have replaced our record with a new one (for packets we relay), so look it up again
+            rec = findPendingPacket(key);
+            if (rec) {
+                --rec->numRetransmissions;
+                setNextTx(rec);
+            }
         }
     }
 
-    return d;
+    // Cancelled entries stay in the heap until they come due, don't let them pile up if lots of packets get ACKed early
+    if (retransmitSchedule.size() > 2 * pending.size() + 16)
+        retransmitSchedule.removeIf([this](const GlobalPacketId &key, uint32_t ticket) {
+            auto rec = findPendingPacket(key);
+            return !rec || rec->nextTxMsec != ticket;
+        });
+
+    if (retransmitSchedule.empty())
+        return INT32_MAX;
+    int32_t d = retransmitSchedule.deadline(retransmitSchedule.nextTicket()) - now;
+    return max(d, (int32_t)0);
 }
 
 void NextHopRouter::setNextTx(PendingPacket *pending)
 {
     assert(iface);
-    auto d = iface->getRetransmissionMsec(pending->packet);
-    pending->nextTxMsec = millis() + d;
+    auto d = iface->getRetransmissionMsec(pending->packetLen);
+    pending->nextTxMsec = retransmitSchedule.schedule(GlobalPacketId(pending->packet), millis() + d);
     LOG_DEBUG("Setting next retransmission in %u msecs: ", d);
     printPacket("", pending->packet);
     setReceivedMessage(); // Run ASAP, so we can figure out our correct sleep time
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "FloodingRouter.h"
+#include "NextHopTable.h"
+#include "RetransmitSchedule.h"
 #include <unordered_map>
 
 /**
@@ -32,12 +34,15 @@ struct GlobalPacketId {
 struct PendingPacket {
     meshtastic_MeshPacket *packet;
 
-    /** The next time we should try to retransmit this packet */
+    /** The next time we should try to retransmit this packet, as a ticket of NextHopRouter::retransmitSchedule */
     uint32_t nextTxMsec = 0;
 
     /** Starts at NUM_RETRANSMISSIONS -1 and counts down.  Once zero it will be removed from the list */
     uint8_t numRetransmissions = 0;
 
+    /** Bytes the packet takes on air, so retransmission delays don't need to encode it again */
+    uint16_t packetLen = 0;
+
     PendingPacket() {}
     explicit PendingPacket(meshtastic_MeshPacket *p, uint8_t numRetransmissions);
 };
@@ -53,10 +58,12 @@ class GlobalPacketIdHashFunction
   relayer of a packet, which bases this on information from a previous successful delivery to the destination via flooding.
   Namely, in the PacketHistory, we keep track of (up to 3) relayers of a packet. When the ACK is delivered back to us via a node
   that also relayed the original packet, we use that node as next hop for the destination from then on. This makes sure that only
-  when there’s a two-way connection, we assign a next hop. Both the ReliableRouter and NextHopRouter will do retransmissions (the
-  NextHopRouter only 1 time). For the final retry, if no one actually relayed the packet, it will reset the next hop in order to
-  fall back to the FloodingRouter again. Note that thus also intermediate hops will do a single retransmission if the intended
-  next-hop didn’t relay, in order to fix changes in the middle of the route.
+  when there’s a two-way connection, we assign a next hop. We keep a few such next hops per destination in a NextHopTable,
+  scored on how well they delivered lately, and a retransmission tries the next best one before falling back to flooding.
+  Both the ReliableRouter and NextHopRouter will do retransmissions (the NextHopRouter only 1 time). For the final retry, if
+  no one actually relayed the packet, it will reset the next hop in order to fall back to the FloodingRouter again. Note that
+  thus also intermediate hops will do a single retransmission if the intended next-hop didn’t relay, in order to fix changes
+  in the middle of the route.
 */
 class NextHopRouter : public FloodingRouter
 {
@@ -97,6 +104,16 @@ class NextHopRouter : public FloodingRouter
      */
     std::unordered_map<GlobalPacketId, PendingPacket, GlobalPacketIdHashFunction> pending;
 
+    /**
+     * When each pending packet is next due, so we don't need to walk all of them to find out
+     */
+    RetransmitSchedule<GlobalPacketId> retransmitSchedule;
+
+    /**
+     * Candidate next hops per destination
+     */
+    NextHopTable routes;
+
     /**
      * Should this incoming filter be dropped?
      *
@@ -138,12 +155,28 @@ class NextHopRouter : public FloodingRouter
 
     void setNextTx(PendingPacket *pending);
 
+    /**
+     * Push back all pending retransmissions, because we were busy on air for msec and couldn't have heard an ACK meanwhile
+     */
+    void delayRetransmissions(uint32_t msec) { retransmitSchedule.delayAll(msec); }
+
+    /**
+     * If p is the next hop we asked relaying one of our pending packets, count it as an implicit ACK for that next hop
+     */
+    void noteRelayed(const meshtastic_MeshPacket *p);
+
   private:
+    /**
+     * send(), but don't pick failedHop as the next hop again
+     */
+    ErrorCode sendAvoiding(meshtastic_MeshPacket *p, uint8_t failedHop);
+
     /**
      * Get the next hop for a destination, given the relay node
+     * @param minScore only consider next hops from the NextHopTable which score at least this
      * @return the node number of the next hop, 0 if no preference (fallback to FloodingRouter)
      */
-    uint8_t getNextHop(NodeNum to, uint8_t relay_node);
+    uint8_t getNextHop(NodeNum to, uint8_t relay_node, uint8_t minScore = NEXT_HOP_MIN_SCORE);
 
     /** Check if we should be relaying this packet if so, do so.
      *  @return true if we did relay */
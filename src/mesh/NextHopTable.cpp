@@ -0,0 +1,144 @@
+#include "NextHopTable.h"
+#include <algorithm>
+#include <string.h>
+
+const NextHopRoute *NextHopTable::find(NodeNum dest) const
+{
+    for (size_t i = 0; i < numRoutes; i++)
+        if (routes[i].dest == dest)
+            return &routes[i];
+    return NULL;
+}
+
+NextHopRoute *NextHopTable::findOrAdd(NodeNum dest, uint32_t now)
+{
+    auto found = const_cast<NextHopRoute *>(find(dest));
+    if (found)
+        return found;
+
+    NextHopRoute *r;
+    if (numRoutes < NEXT_HOP_TABLE_SIZE) {
+        r = &routes[numRoutes++];
+    } else {
+        // Take over the route we heard about least recently
+        r = &routes[0];
+        uint32_t oldestAge = 0;
+        for (size_t i = 0; i < numRoutes; i++) {
+            uint32_t age = UINT32_MAX;
+            for (uint8_t j = 0; j < routes[i].numCandidates; j++)
+                age = std::min(age, now - routes[i].candidates[j].updatedMsec);
+            if (age >= oldestAge) {
+                r = &routes[i];
+                oldestAge = age;
+            }
+        }
+    }
+    memset(r, 0, sizeof(*r));
+    r->dest = dest;
+    return r;
+}
+
+NextHopCandidate *NextHopTable::findCandidate(NextHopRoute *r, uint8_t relay, bool add, uint32_t now)
+{
+    for (uint8_t i = 0; i < r->numCandidates; i++)
+        if (r->candidates[i].relay == relay)
+            return &r->candidates[i];
+    if (!add)
+        return NULL;
+
+    NextHopCandidate *c;
+    if (r->numCandidates < NEXT_HOP_CANDIDATES) {
+        c = &r->candidates[r->numCandidates++];
+    } else {
+        c = &r->candidates[0];
+        for (uint8_t i = 1; i < r->numCandidates; i++)
+            if (score(r->candidates[i], now) < score(*c, now))
+                c = &r->candidates[i];
+    }
+    *c = {relay, NEXT_HOP_INITIAL_SCORE, 0, 0, now};
+    return c;
+}
+
+uint8_t NextHopTable::score(const NextHopCandidate &c, uint32_t now)
+{
+    uint32_t halvings = (now - c.updatedMsec) / NEXT_HOP_HALF_LIFE_MSEC;
+    return halvings >= 8 ? 0 : c.success >> halvings;
+}
+
+void NextHopTable::recordSuccess(NodeNum dest, uint8_t relay, float snr, uint32_t now)
+{
+    if (relay == NO_NEXT_HOP_PREFERENCE)
+        return;
+    auto r = findOrAdd(dest, now);
+    auto c = findCandidate(r, relay, false, now);
+    if (c) {
+        c->success = (3 * score(*c, now) + 255) / 4;
+        c->snr = (3 * c->snr + (int8_t)snr) / 4;
+    } else {
+        c = findCandidate(r, relay, true, now);
+        c->snr = (int8_t)snr;
+    }
+    c->failures = 0;
+    c->updatedMsec = now;
+}
+
+void NextHopTable::recordRelayed(NodeNum dest, uint8_t relay, uint32_t now)
+{
+    if (relay == NO_NEXT_HOP_PREFERENCE)
+        return;
+    // Also learn it if we only knew the next hop from NodeDB, e.g. after a reboot
+    auto c = findCandidate(findOrAdd(dest, now), relay, true, now);
+    c->success = (7 * score(*c, now) + 255) / 8;
+    c->failures = 0;
+    c->updatedMsec = now;
+}
+
+void NextHopTable::recordFailure(NodeNum dest, uint8_t relay, uint32_t now)
+{
+    auto r = const_cast<NextHopRoute *>(find(dest));
+    auto c = r ? findCandidate(r, relay, false, now) : NULL;
+    if (!c)
+        return;
+    c->success = 3 * score(*c, now) / 4;
+    if (c->failures < UINT8_MAX)
+        c->failures++;
+    c->updatedMsec = now;
+}
+
+uint8_t NextHopTable::retryHop(NodeNum dest, uint8_t asked, bool isLastTry, uint32_t now)
+{
+    if (asked != NO_NEXT_HOP_PREFERENCE)
+        recordFailure(dest, asked, now);
+    if (isLastTry)
+        return getBest(dest, asked, now, NEXT_HOP_LAST_TRY_SCORE, false);
+    // Before that a single failure is likely a collision, asked may get another chance
+    return getBest(dest, NO_NEXT_HOP_PREFERENCE, now);
+}
+
+uint8_t NextHopTable::getBest(NodeNum dest, uint8_t exclude, uint32_t now, uint8_t minScore, bool includeFailed) const
+{
+    auto r = find(dest);
+    if (!r)
+        return NO_NEXT_HOP_PREFERENCE;
+
+    const NextHopCandidate *best = NULL;
+    bool bestHeldOff = false;
+    uint8_t bestScore = 0;
+    for (uint8_t i = 0; i < r->numCandidates; i++) {
+        auto &c = r->candidates[i];
+        uint8_t s = score(c, now);
+        if (c.relay == exclude || s < minScore)
+            continue;
+        bool heldOff = c.failures >= NEXT_HOP_FAIL_HOLDOFF_COUNT && now - c.updatedMsec < NEXT_HOP_FAIL_HOLDOFF_MSEC;
+        if (heldOff && !includeFailed)
+            continue;
+        // Not held off beats held off, then higher score, then better SNR
+        if (!best || (bestHeldOff && !heldOff) ||
+            (bestHeldOff == heldOff && (s > bestScore || (s == bestScore && c.snr > best->snr)))) {
+            best = &c;
+            bestHeldOff = heldOff;
+            bestScore = s;
+        }
+    }
+    return best ? best->relay : NO_NEXT_HOP_PREFERENCE;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+/// Candidate next hops we remember per destination
+#ifndef NEXT_HOP_CANDIDATES
+#define NEXT_HOP_CANDIDATES 3
+#endif
+
+/// Number of destinations we keep routes for, the least recently updated one is dropped when full
+#ifndef NEXT_HOP_TABLE_SIZE
+#ifdef ARCH_PORTDUINO
+#define NEXT_HOP_TABLE_SIZE 256
+#else
+#define NEXT_HOP_TABLE_SIZE 64
+#endif
+#endif
+
+/// Score of a candidate we haven't heard anything about for this long is halved
+#define NEXT_HOP_HALF_LIFE_MSEC (60 * 60 * 1000UL)
+
+/// After a candidate failed to relay this many times in a row, it's probably gone for a while...
+#define NEXT_HOP_FAIL_HOLDOFF_COUNT 2
+
+/// ...so prefer the others for this long
+#define NEXT_HOP_FAIL_HOLDOFF_MSEC (10 * 60 * 1000UL)
+
+/// Score a newly learned candidate starts with, out of 255
+#define NEXT_HOP_INITIAL_SCORE 192
+
+/// Candidates scoring less than this are not used at all, so we flood instead
+#define NEXT_HOP_MIN_SCORE 40
+
+/// On the last retransmission we only try another candidate instead of flooding if it scores at least this
+#define NEXT_HOP_LAST_TRY_SCORE 160
+
+/**
+ * A relayer through which a destination has been reached before
+ */
+struct NextHopCandidate {
+    /// Last byte of the relayer's node number, as in MeshPacket.next_hop
+    uint8_t relay;
+    /// Exponentially weighted delivery success through this relay, 0-255
+    uint8_t success;
+    /// Exponentially weighted SNR in dB of packets we heard from this relay, used to break ties
+    int8_t snr;
+    /// Number of times in a row it didn't relay
+    uint8_t failures;
+    /// millis() of the last update
+    uint32_t updatedMsec;
+};
+
+struct NextHopRoute {
+    NodeNum dest;
+    NextHopCandidate candidates[NEXT_HOP_CANDIDATES];
+    uint8_t numCandidates;
+};
+
+/**
+ * Up to NEXT_HOP_CANDIDATES next hops per destination, scored on how well they delivered lately.
+ *
+ * NextHopRouter used to remember a single next hop per node, learned from one ACK and forgotten after one failed delivery,
+ * which meant a full flood. With a few scored candidates a retransmission can try the next best relay first.
+ *
+ * Scores move a quarter of the way towards 255 for each ACK or reply that came back through a relay, an eighth of the way
+ * for hearing it relay our packet (an implicit ACK, which says nothing about the rest of the route), and a quarter of the
+ * way towards 0 when it failed to relay. A score also halves for each NEXT_HOP_HALF_LIFE_MSEC without news. A single failure
+ * is usually a collision, so we only skip a candidate for a while after NEXT_HOP_FAIL_HOLDOFF_COUNT in a row.
+ *
+ * This is a plain fixed size table with no locking, only used from the router thread.
+ */
+class NextHopTable
+{
+  public:
+    /** An ACK or reply from dest reached us through relay */
+    void recordSuccess(NodeNum dest, uint8_t relay, float snr, uint32_t now);
+
+    /** We heard relay forward a packet we sent towards dest */
+    void recordRelayed(NodeNum dest, uint8_t relay, uint32_t now);
+
+    /** relay was asked to forward a packet towards dest, but didn't */
+    void recordFailure(NodeNum dest, uint8_t relay, uint32_t now);
+
+    /**
+     * asked didn't relay our packet towards dest, count that and pick the next hop for the retransmission. The last try never
+     * goes to asked again and only to a candidate scoring at least NEXT_HOP_LAST_TRY_SCORE, NO_NEXT_HOP_PREFERENCE means flood.
+     */
+    uint8_t retryHop(NodeNum dest, uint8_t asked, bool isLastTry, uint32_t now);
+
+    /**
+     * The best next hop towards dest other than exclude, or NO_NEXT_HOP_PREFERENCE if none scores at least minScore.
+     * Candidates which failed repeatedly only win if all others did too, and not at all unless includeFailed.
+     */
+    uint8_t getBest(NodeNum dest, uint8_t exclude, uint32_t now, uint8_t minScore = NEXT_HOP_MIN_SCORE,
+                    bool includeFailed = true) const;
+
+    /** Current score of a candidate, with aging applied */
+    static uint8_t score(const NextHopCandidate &c, uint32_t now);
+
+    /** The route to dest or NULL if we know nothing about it */
+    const NextHopRoute *find(NodeNum dest) const;
+
+    /** Number of destinations with a route */
+    size_t size() const { return numRoutes; }
+
+  private:
+    NextHopRoute routes[NEXT_HOP_TABLE_SIZE];
+    size_t numRoutes = 0;
+
+    NextHopRoute *findOrAdd(NodeNum dest, uint32_t now);
+
+    /** The candidate for relay, taking over the worst one if there is no slot left. NULL if we don't have dest. */
+    NextHopCandidate *findCandidate(NextHopRoute *r, uint8_t relay, bool add, uint32_t now);
+};
@@ -10,7 +10,9 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "NodeStore.h"
 #include "PacketHistory.h"
+#include "PacketTrace.h"
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
@@ -194,6 +196,7 @@ static uint8_t ourMacAddr[6];
 NodeDB::NodeDB()
 {
     LOG_INFO("Init NodeDB");
+    nodeStore = new NodeStore(nodeStoreFileName, nodeDatabaseFileName);
     loadFromDisk();
     cleanupMeshDB();
 
@@ -305,8 +308,8 @@ NodeDB::NodeDB()
 
     // If node database has not been saved for the first time, save it now
 #ifdef FSCom
-    if (!FSCom.exists(nodeDatabaseFileName)) {
-        saveNodeDatabaseToDisk();
+    if (!FSCom.exists(nodeStoreFileName) || nodeStore->needsCompaction()) {
+        saveToDisk(SEGMENT_NODEDATABASE);
     }
 #endif
 
@@ -386,6 +389,7 @@ NodeDB::NodeDB()
         config.has_position = true;
         info->has_position = true;
         info->position = TypeConversions::ConvertToPositionLite(fixedGPS);
+        updatePositionIndex(info);
         nodeDB->setLocalPosition(fixedGPS);
         config.position.fixed_position = true;
 #endif
@@ -459,6 +463,7 @@ bool NodeDB::factoryReset(bool eraseBleBonds)
     installDefaultChannels();
     // third, write everything to disk
     saveToDisk();
+    flushToDisk();
     if (eraseBleBonds) {
         LOG_INFO("Erase BLE bonds");
 #ifdef ARCH_ESP32
@@ -483,6 +488,7 @@ void NodeDB::installDefaultNodeDatabase()
     nodeDatabase.nodes = std::vector<meshtastic_NodeInfoLite>(MAX_NUM_NODES);
     numMeshNodes = 0;
     meshNodes = &nodeDatabase.nodes;
+    rebuildViews();
 }
 
 void NodeDB::installDefaultConfig(bool preserveKey = false)
@@ -936,10 +942,10 @@ void NodeDB::resetNodes()
         clearLocalPosition();
     numMeshNodes = 1;
     std::fill(nodeDatabase.nodes.begin() + 1, nodeDatabase.nodes.end(), meshtastic_NodeInfoLite());
+    rebuildViews();
     devicestate.has_rx_text_message = false;
     devicestate.has_rx_waypoint = false;
-    saveNodeDatabaseToDisk();
-    saveDeviceStateToDisk();
+    saveToDisk(SEGMENT_NODEDATABASE | SEGMENT_DEVICESTATE);
     if (neighborInfoModule && moduleConfig.neighbor_info.enabled)
         neighborInfoModule->resetNeighbors();
 }
@@ -956,8 +962,9 @@ void NodeDB::removeNodeByNum(NodeNum nodeNum)
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + 1,
               meshtastic_NodeInfoLite());
+    rebuildViews();
     LOG_DEBUG("NodeDB::removeNodeByNum purged %d entries. Save changes", removed);
-    saveNodeDatabaseToDisk();
+    saveToDisk(SEGMENT_NODEDATABASE);
 }
 
 void NodeDB::clearLocalPosition()
@@ -967,6 +974,7 @@ void NodeDB::clearLocalPosition()
     node->position.longitude_i = 0;
     node->position.altitude = 0;
     node->position.time = 0;
+    updatePositionIndex(node);
     setLocalPosition(meshtastic_Position_init_default);
 }
 
@@ -988,6 +996,7 @@ void NodeDB::cleanupMeshDB()
     numMeshNodes -= removed;
     std::fill(nodeDatabase.nodes.begin() + numMeshNodes, nodeDatabase.nodes.begin() + numMeshNodes + removed,
               meshtastic_NodeInfoLite());
+    rebuildViews();
     LOG_DEBUG("cleanupMeshDB purged %d entries", removed);
 }
 
@@ -1121,8 +1130,15 @@ void NodeDB::loadFromDisk()
     }
 
 #endif
-    auto state = loadProto(nodeDatabaseFileName, getMaxNodesAllocatedSize(), sizeof(meshtastic_NodeDatabase),
-                           &meshtastic_NodeDatabase_msg, &nodeDatabase);
+    auto state = nodeStore->load(nodeDatabase);
+    if (state != LoadFileResult::LOAD_SUCCESS) {
+        // No (usable) journal, convert the protobuf file written by older firmware if there is one
+        state = loadProto(nodeDatabaseFileName, getMaxNodesAllocatedSize(), sizeof(meshtastic_NodeDatabase),
+                          &meshtastic_NodeDatabase_msg, &nodeDatabase);
+        if (state == LoadFileResult::LOAD_SUCCESS)
+            LOG_INFO("Convert %s to %s", nodeDatabaseFileName, nodeStoreFileName);
+        nodeStore->requestCompaction();
+    }
     if (nodeDatabase.version < DEVICESTATE_MIN_VER) {
         LOG_WARN("NodeDatabase %d is old, discard", nodeDatabase.version);
         installDefaultNodeDatabase();
@@ -1301,54 +1317,36 @@ bool NodeDB::saveProto(const char *filename, size_t protoSize, const pb_msgdesc_
     if (!okay || !writeSucceeded) {
         LOG_ERROR("Can't write prefs!");
     }
+    prefsWriter.countBytesWritten(stream.bytes_written);
 #else
     LOG_ERROR("ERROR: Filesystem not implemented");
 #endif
     return okay;
 }
 
-bool NodeDB::saveChannelsToDisk()
+bool NodeDB::saveChannelsToDisk(const meshtastic_ChannelFile *channels)
 {
-#ifdef FSCom
-    spiLock->lock();
-    FSCom.mkdir("/prefs");
-    spiLock->unlock();
-#endif
-    return saveProto(channelFileName, meshtastic_ChannelFile_size, &meshtastic_ChannelFile_msg, &channelFile);
+    return saveProto(channelFileName, meshtastic_ChannelFile_size, &meshtastic_ChannelFile_msg, channels);
 }
 
-bool NodeDB::saveDeviceStateToDisk()
+bool NodeDB::saveDeviceStateToDisk(const meshtastic_DeviceState *state)
 {
-#ifdef FSCom
-    spiLock->lock();
-    FSCom.mkdir("/prefs");
-    spiLock->unlock();
-#endif
     // Note: if MAX_NUM_NODES=100 and meshtastic_NodeInfoLite_size=166, so will be approximately 17KB
     // Because so huge we _must_ not use fullAtomic, because the filesystem is probably too small to hold two copies of this
-    return saveProto(deviceStateFileName, meshtastic_DeviceState_size, &meshtastic_DeviceState_msg, &devicestate, true);
+    return saveProto(deviceStateFileName, meshtastic_DeviceState_size, &meshtastic_DeviceState_msg, state, true);
 }
 
-bool NodeDB::saveNodeDatabaseToDisk()
+bool NodeDB::saveNodeDatabaseToDisk(const meshtastic_NodeDatabase *nodes)
 {
-#ifdef FSCom
-    spiLock->lock();
-    FSCom.mkdir("/prefs");
-    spiLock->unlock();
-#endif
-    size_t nodeDatabaseSize;
-    pb_get_encoded_size(&nodeDatabaseSize, meshtastic_NodeDatabase_fields, &nodeDatabase);
-    return saveProto(nodeDatabaseFileName, nodeDatabaseSize, &meshtastic_NodeDatabase_msg, &nodeDatabase, false);
+    // Only the nodes which changed since the last save get written, see NodeStore
+    size_t bytesWritten = 0;
+    bool success = nodeStore->save(*nodes, bytesWritten);
+    prefsWriter.countBytesWritten(bytesWritten);
+    return success;
 }
 
-bool NodeDB::saveToDiskNoRetry(int saveWhat)
+void NodeDB::prepareForSave(int saveWhat)
 {
-    bool success = true;
-#ifdef FSCom
-    spiLock->lock();
-    FSCom.mkdir("/prefs");
-    spiLock->unlock();
-#endif
     if (saveWhat & SEGMENT_CONFIG) {
         config.has_device = true;
         config.has_display = true;
@@ -1358,8 +1356,6 @@ bool NodeDB::saveToDiskNoRetry(int saveWhat)
         config.has_network = true;
         config.has_bluetooth = true;
         config.has_security = true;
-
-        success &= saveProto(configFileName, meshtastic_LocalConfig_size, &meshtastic_LocalConfig_msg, &config);
     }
 
     if (saveWhat & SEGMENT_MODULECONFIG) {
@@ -1375,30 +1371,51 @@ bool NodeDB::saveToDiskNoRetry(int saveWhat)
         moduleConfig.has_ambient_lighting = true;
         moduleConfig.has_audio = true;
         moduleConfig.has_paxcounter = true;
+    }
+}
+
+bool NodeDB::saveToDiskNoRetry(int saveWhat, const PersistedState &state)
+{
+    bool success = true;
+#ifdef FSCom
+    spiLock->lock();
+    FSCom.mkdir("/prefs");
+    spiLock->unlock();
+#endif
+    if (saveWhat & SEGMENT_CONFIG) {
+        success &= saveProto(configFileName, meshtastic_LocalConfig_size, &meshtastic_LocalConfig_msg, state.config);
+    }
 
-        success &=
-            saveProto(moduleConfigFileName, meshtastic_LocalModuleConfig_size, &meshtastic_LocalModuleConfig_msg, &moduleConfig);
+    if (saveWhat & SEGMENT_MODULECONFIG) {
+        success &= saveProto(moduleConfigFileName, meshtastic_LocalModuleConfig_size, &meshtastic_LocalModuleConfig_msg,
+                             state.moduleConfig);
     }
 
     if (saveWhat & SEGMENT_CHANNELS) {
-        success &= saveChannelsToDisk();
+        success &= saveChannelsToDisk(state.channelFile);
     }
 
     if (saveWhat & SEGMENT_DEVICESTATE) {
-        success &= saveDeviceStateToDisk();
+        success &= saveDeviceStateToDisk(state.devicestate);
     }
 
     if (saveWhat & SEGMENT_NODEDATABASE) {
-        success &= saveNodeDatabaseToDisk();
+        success &= saveNodeDatabaseToDisk(state.nodeDatabase);
     }
 
     return success;
 }
 
-bool NodeDB::saveToDisk(int saveWhat)
+void NodeDB::saveToDisk(int saveWhat)
+{
+    LOG_DEBUG("Schedule save to disk %d", saveWhat);
+    prefsWriter.markDirty(saveWhat);
+}
+
+bool NodeDB::writeToDisk(int saveWhat, const PersistedState &state)
 {
     LOG_DEBUG("Save to disk %d", saveWhat);
-    bool success = saveToDiskNoRetry(saveWhat);
+    bool success = saveToDiskNoRetry(saveWhat, state);
 
     if (!success) {
         LOG_ERROR("Failed to save to disk, retrying");
@@ -1408,7 +1425,7 @@ bool NodeDB::saveToDisk(int saveWhat)
         spiLock->unlock();
 
 #endif
-        success = saveToDiskNoRetry(saveWhat);
+        success = saveToDiskNoRetry(saveWhat, state);
 
         RECORD_CRITICALERROR(success ? meshtastic_CriticalErrorCode_FLASH_CORRUPTION_RECOVERABLE
                                      : meshtastic_CriticalErrorCode_FLASH_CORRUPTION_UNRECOVERABLE);
@@ -1448,21 +1465,10 @@ uint32_t sinceReceived(const meshtastic_MeshPacket *p)
     return delta;
 }
 
-#define NUM_ONLINE_SECS (60 * 60 * 2) // 2 hrs to consider someone offline
 
 size_t NodeDB::getNumOnlineMeshNodes(bool localOnly)
 {
-    size_t numseen = 0;
-
-    // FIXME this implementation is kinda expensive
-    for (int i = 0; i < numMeshNodes; i++) {
-        if (localOnly && meshNodes->at(i).via_mqtt)
-            continue;
-        if (sinceLastSeen(&meshNodes->at(i)) < NUM_ONLINE_SECS)
-            numseen++;
-    }
-
-    return numseen;
+    return views.countHeardWithin(getTime(), NUM_ONLINE_SECS, localOnly);
 }
 
 #include "MeshModule.h"
@@ -1508,6 +1514,7 @@ void NodeDB::updatePosition(uint32_t nodeId, const meshtastic_Position &p, RxSou
             info->position.time = tmp_time;
     }
     info->has_position = true;
+    updatePositionIndex(info);
     updateGUIforNode = info;
     notifyObservers(true); // Force an update whether or not our node counts have changed
 }
@@ -1546,15 +1553,17 @@ void NodeDB::addFromContact(meshtastic_SharedContact contact)
     }
     info->num = contact.node_num;
     info->last_heard = getValidTime(RTCQualityNTP);
+    updateHeard(info);
     info->has_user = true;
     info->user = TypeConversions::ConvertToUserLite(contact.user);
+    usersVersion++;
     info->is_favorite = true;
     // Mark the node's key as manually verified to indicate trustworthiness.
     info->bitfield |= NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK;
     updateGUIforNode = info;
     powerFSM.trigger(EVENT_NODEDB_UPDATED);
     notifyObservers(true); // Force an update whether or not our node counts have changed
-    saveNodeDatabaseToDisk();
+    saveToDisk(SEGMENT_NODEDATABASE);
 }
 
 /** Update user info and channel for this node based on received user data
@@ -1609,6 +1618,7 @@ bool NodeDB::updateUser(uint32_t nodeId, meshtastic_User &p, uint8_t channelInde
     info->has_user = true;
 
     if (changed) {
+        usersVersion++;
         updateGUIforNode = info;
         powerFSM.trigger(EVENT_NODEDB_UPDATED);
         notifyObservers(true); // Force an update whether or not our node counts have changed
@@ -1656,6 +1666,8 @@ void NodeDB::updateFrom(const meshtastic_MeshPacket &mp)
             info->has_hops_away = true;
             info->hops_away = mp.hop_start - mp.hop_limit;
         }
+
+        updateHeard(info);
     }
 }
 
@@ -1691,6 +1703,7 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
     meshtastic_NodeInfoLite *lite = getMeshNode(n);
 
     if (!lite) {
+        bool evicted = false;
         if (isFull()) {
             LOG_INFO("Node database full with %i nodes and %u bytes free. Erasing oldest entry", numMeshNodes,
                      memGet.getFreeHeap());
@@ -1720,6 +1733,7 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
             }
 
             if (oldestIndex != -1) {
+                evicted = true;
                 // Shove the remaining nodes down the chain
                 for (int i = oldestIndex; i < numMeshNodes - 1; i++) {
                     meshNodes->at(i) = meshNodes->at(i + 1);
@@ -1733,6 +1747,10 @@ meshtastic_NodeInfoLite *NodeDB::getOrCreateMeshNode(NodeNum n)
         // everything is missing except the nodenum
         memset(lite, 0, sizeof(*lite));
         lite->num = n;
+        if (evicted)
+            rebuildViews();
+        else
+            views.updateHeard(meshNodes->data(), numMeshNodes - 1);
         LOG_INFO("Adding node to database with %i nodes and %u bytes free!", numMeshNodes, memGet.getFreeHeap());
     }
 
@@ -1862,7 +1880,8 @@ bool NodeDB::restorePreferences(meshtastic_AdminMessage_BackupLocation location,
                 LOG_DEBUG("Restored channels");
             }
 
-            success = saveToDisk(restoreWhat);
+            saveToDisk(restoreWhat);
+            success = flushToDisk();
             if (success) {
                 LOG_INFO("Restored preferences from backup");
             } else {
@@ -1895,9 +1914,19 @@ void recordCriticalError(meshtastic_CriticalErrorCode code, uint32_t address, co
     error_code = code;
     error_address = address;
 
+    // The packets leading up to the first one may explain what went wrong. Some errors (TRANSMIT_FAILED while the radio is
+    // stuck) are raised over and over, so don't fill the log with the same trace each time
+    static bool packetTraceDumped;
+    if (!packetTraceDumped) {
+        packetTraceDumped = true;
+        packetTrace.dump();
+    }
+
     // Currently portuino is mostly used for simulation.  Make sure the user notices something really bad happened
 #ifdef ARCH_PORTDUINO
     LOG_ERROR("A critical failure occurred, portduino is exiting");
+    if (nodeDB)
+        nodeDB->flushToDisk(); // don't lose saves still waiting in PrefsWriter
     exit(2);
 #endif
 }
@@ -8,7 +8,10 @@
 #include <vector>
 
 #include "MeshTypes.h"
+#include "NodeSpatialIndex.h"
 #include "NodeStatus.h"
+#include "NodeViews.h"
+#include "PrefsWriter.h"
 #include "configuration.h"
 #include "mesh-pb-constants.h"
 #include "mesh/generated/meshtastic/mesh.pb.h" // For CriticalErrorCode
@@ -107,13 +110,16 @@ extern meshtastic_Position localPosition;
 
 static constexpr const char *deviceStateFileName = "/prefs/device.proto";
 static constexpr const char *legacyPrefFileName = "/prefs/db.proto";
-static constexpr const char *nodeDatabaseFileName = "/prefs/nodes.proto";
+static constexpr const char *nodeDatabaseFileName = "/prefs/nodes.proto"; // before the journaled NodeStore
+static constexpr const char *nodeStoreFileName = "/prefs/nodes.jrn";
 static constexpr const char *configFileName = "/prefs/config.proto";
 static constexpr const char *uiconfigFileName = "/prefs/uiconfig.proto";
 static constexpr const char *moduleConfigFileName = "/prefs/module.proto";
 static constexpr const char *channelFileName = "/prefs/channels.proto";
 static constexpr const char *backupFileName = "/backups/backup.proto";
 
+#define NUM_ONLINE_SECS (60 * 60 * 2) // 2 hrs to consider someone offline
+
 /// Given a node, return how many seconds in the past (vs now) that we last heard from it
 uint32_t sinceLastSeen(const meshtastic_NodeInfoLite *n);
 
@@ -135,6 +141,8 @@ enum LoadFileResult {
 
 enum UserLicenseStatus { NotKnown, NotLicensed, Licensed };
 
+class NodeStore;
+
 class NodeDB
 {
     // NodeNum provisionalNodeNum; // if we are trying to find a node num this is our current attempt
@@ -158,11 +166,33 @@ class NodeDB
     /// instead just store in flash - possibly even in the initial alpha release do this hack
     NodeDB();
 
-    /// write to flash
-    /// @return true if the save was successful
-    bool saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS |
+    /// Schedule writing to flash. Saves are coalesced and done in the background shortly after, see PrefsWriter. Use
+    /// flushToDisk() to find out whether they were written
+    void saveToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS |
                                    SEGMENT_NODEDATABASE);
 
+    /// Write what saveToDisk() scheduled of these segments right now, before a reboot or sleep
+    /// @return true if the save was successful
+    bool flushToDisk(int saveWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS |
+                                    SEGMENT_NODEDATABASE)
+    {
+        return prefsWriter.flush(saveWhat);
+    }
+
+    /// Set the has_ flags which must be set on the segments we are about to save
+    void prepareForSave(int saveWhat);
+
+    /// write to flash, now and on the caller's thread. Used by PrefsWriter
+    /// @return true if the save was successful
+    bool writeToDisk(int saveWhat, const PersistedState &state);
+
+    /// The live (global) state, for writeToDisk
+    PersistedState liveState() { return {&config, &moduleConfig, &channelFile, &devicestate, &nodeDatabase}; }
+
+    /// Flash wear statistics
+    uint64_t getTotalBytesWritten() const { return prefsWriter.getTotalBytesWritten(); }
+    uint32_t getBytesWrittenLastHour() const { return prefsWriter.getBytesWrittenLastHour(); }
+
     /** Reinit radio config if needed, because either:
      * a) sometimes a buggy android app might send us bogus settings or
      * b) the client set factory_reset
@@ -241,6 +271,29 @@ class NodeDB
     virtual meshtastic_NodeInfoLite *getMeshNode(NodeNum n);
     size_t getNumMeshNodes() { return numMeshNodes; }
 
+    /// Nodes in the order of when they were last heard, kept up to date as packets arrive
+    const NodeViews &getViews() const { return views; }
+
+    /// Changes each time a node's user, and so perhaps its public key, is added or changed, or nodes are removed
+    uint32_t getUsersVersion() const { return usersVersion; }
+
+    /// Call after changing the last_heard or via_mqtt of a node outside of NodeDB
+    void updateHeard(const meshtastic_NodeInfoLite *node)
+    {
+        if (isInDB(node))
+            views.updateHeard(meshNodes->data(), node - meshNodes->data());
+    }
+
+    /// The nodes with a valid position, by where they are
+    const NodeSpatialIndex &getSpatialIndex() const { return spatialIndex; }
+
+    /// Call after changing the position of a node outside of NodeDB
+    void updatePositionIndex(const meshtastic_NodeInfoLite *node)
+    {
+        if (isInDB(node))
+            spatialIndex.update(meshNodes->data(), node - meshNodes->data());
+    }
+
     UserLicenseStatus getLicenseStatus(uint32_t nodeNum);
 
     size_t getMaxNodesAllocatedSize()
@@ -279,7 +332,12 @@ class NodeDB
                             int restoreWhat = SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_DEVICESTATE | SEGMENT_CHANNELS);
 
   private:
+    PrefsWriter prefsWriter;
+    NodeStore *nodeStore;
+    NodeViews views;
+    NodeSpatialIndex spatialIndex;
     bool duplicateWarned = false;
+    uint32_t usersVersion = 0;
     uint32_t lastNodeDbSave = 0;    // when we last saved our db to flash
     uint32_t lastBackupAttempt = 0; // when we last tried a backup automatically or manually
     /// Find a node in our DB, create an empty NodeInfoLite if missing
@@ -293,6 +351,20 @@ class NodeDB
         newStatus.notifyObservers(&status);
     }
 
+    /// Whether node points into meshNodes, rather than e.g. a copy
+    bool isInDB(const meshtastic_NodeInfoLite *node) const
+    {
+        return node >= meshNodes->data() && node < meshNodes->data() + numMeshNodes;
+    }
+
+    /// Sort the views and spatial index again after nodes were moved around
+    void rebuildViews()
+    {
+        usersVersion++;
+        views.rebuild(meshNodes->data(), numMeshNodes);
+        spatialIndex.rebuild(meshNodes->data(), numMeshNodes);
+    }
+
     /// read our db from flash
     void loadFromDisk();
 
@@ -303,13 +375,14 @@ class NodeDB
     void installDefaultDeviceState(), installDefaultNodeDatabase(), installDefaultChannels(),
         installDefaultConfig(bool preserveKey), installDefaultModuleConfig();
 
-    /// write to flash
+    /// write to flash, without retrying or raising a critical error. PrefsWriter's worker uses this
     /// @return true if the save was successful
-    bool saveToDiskNoRetry(int saveWhat);
+    bool saveToDiskNoRetry(int saveWhat, const PersistedState &state);
+    friend class PrefsWriter;
 
-    bool saveChannelsToDisk();
-    bool saveDeviceStateToDisk();
-    bool saveNodeDatabaseToDisk();
+    bool saveChannelsToDisk(const meshtastic_ChannelFile *channels);
+    bool saveDeviceStateToDisk(const meshtastic_DeviceState *state);
+    bool saveNodeDatabaseToDisk(const meshtastic_NodeDatabase *nodes);
 };
 
 extern NodeDB *nodeDB;
@@ -346,6 +419,8 @@ extern meshtastic_CriticalErrorCode error_code;
 extern uint32_t error_address;
 #define NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_SHIFT 0
 #define NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_MASK (1 << NODEINFO_BITFIELD_IS_KEY_MANUALLY_VERIFIED_SHIFT)
+#define NODEINFO_BITFIELD_CAN_DECOMPRESS_SHIFT 1
+#define NODEINFO_BITFIELD_CAN_DECOMPRESS_MASK (1 << NODEINFO_BITFIELD_CAN_DECOMPRESS_SHIFT)
 
 #define Module_Config_size                                                                                                       \
     (ModuleConfig_CannedMessageConfig_size + ModuleConfig_ExternalNotificationConfig_size + ModuleConfig_MQTTConfig_size +       \
@@ -0,0 +1,169 @@
+#include "NodeSpatialIndex.h"
+#include "gps/GeoCoord.h"
+#include <algorithm>
+
+/// Longitude cells of a row, the cell number is (lon >> NODE_GRID_SHIFT) + GRID_OFFSET
+#define GRID_ROW_BITS 12
+#define GRID_OFFSET (1 << (GRID_ROW_BITS - 1))
+
+static const int64_t MAX_LAT = 900000000, MAX_LON = 1800000000;
+
+/// GeoCoord::latLongToMeter() uses an earth radius of 6366 km, so do we: 2 * pi * 6366000 / 360 * 1e-7 meters per unit
+static const int64_t METERS_PER_DEGREE = 111107;
+
+static_assert((MAX_LON >> NODE_GRID_SHIFT) < GRID_OFFSET, "NODE_GRID_SHIFT is too small for GRID_ROW_BITS");
+
+uint32_t NodeSpatialIndex::cellOf(int32_t lat, int32_t lon)
+{
+    return ((uint32_t)((lat >> NODE_GRID_SHIFT) + GRID_OFFSET) << GRID_ROW_BITS) | ((lon >> NODE_GRID_SHIFT) + GRID_OFFSET);
+}
+
+uint16_t NodeSpatialIndex::cosLatOf(int32_t lat)
+{
+    return (uint16_t)(cosf(lat * 1e-7f * (float)M_PI / 180) * 32768 + 0.5f);
+}
+
+bool NodeSpatialIndex::hasPosition(const meshtastic_NodeInfoLite &n)
+{
+    // Same as NodeDB::hasValidPosition()
+    return n.has_position && (n.position.latitude_i != 0 || n.position.longitude_i != 0);
+}
+
+static uint32_t isqrt(uint64_t v)
+{
+    uint64_t root = 0, bit = 1ULL << 62;
+    while (bit > v)
+        bit >>= 2;
+    while (bit) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t)root;
+}
+
+uint32_t NodeSpatialIndex::distance(int32_t latA, int32_t lonA, uint16_t cosA, int32_t latB, int32_t lonB, uint16_t cosB)
+{
+    int64_t dLat = (int64_t)latB - latA, dLon = (int64_t)lonB - lonA;
+    if (dLon > MAX_LON)
+        dLon -= 2 * MAX_LON;
+    else if (dLon < -MAX_LON)
+        dLon += 2 * MAX_LON;
+
+    if (dLat > NODE_GRID_FLAT_LIMIT || dLat < -NODE_GRID_FLAT_LIMIT || dLon > NODE_GRID_FLAT_LIMIT ||
+        dLon < -NODE_GRID_FLAT_LIMIT)
+        return (uint32_t)GeoCoord::latLongToMeter(latA * 1e-7, lonA * 1e-7, latB * 1e-7, lonB * 1e-7);
+
+    // East-west distances shrink with the cos of the latitude, take the one halfway
+    int64_t x = dLon * (cosA + cosB) >> 16, y = dLat;
+    return (uint32_t)(((uint64_t)isqrt(x * x + y * y) * METERS_PER_DEGREE + 5000000) / 10000000);
+}
+
+uint32_t NodeSpatialIndex::distance(int32_t latA, int32_t lonA, int32_t latB, int32_t lonB)
+{
+    return distance(latA, lonA, cosLatOf(latA), latB, lonB, cosLatOf(latB));
+}
+
+void NodeSpatialIndex::rebuild(const meshtastic_NodeInfoLite *nodes, size_t numNodes)
+{
+    entries.clear();
+    for (size_t i = 0; i < numNodes; i++) {
+        const meshtastic_PositionLite &p = nodes[i].position;
+        if (hasPosition(nodes[i]))
+            entries.push_back({cellOf(p.latitude_i, p.longitude_i), p.latitude_i, p.longitude_i, (uint16_t)i,
+                               cosLatOf(p.latitude_i)});
+    }
+    std::sort(entries.begin(), entries.end(), [](const Entry &a, const Entry &b) { return a.cell < b.cell; });
+}
+
+void NodeSpatialIndex::update(const meshtastic_NodeInfoLite *nodes, size_t index)
+{
+    auto it = std::find_if(entries.begin(), entries.end(), [index](const Entry &e) { return e.index == index; });
+    if (it != entries.end())
+        entries.erase(it);
+    if (!hasPosition(nodes[index]))
+        return;
+
+    const meshtastic_PositionLite &p = nodes[index].position;
+    Entry e = {cellOf(p.latitude_i, p.longitude_i), p.latitude_i, p.longitude_i, (uint16_t)index, cosLatOf(p.latitude_i)};
+    entries.insert(std::upper_bound(entries.begin(), entries.end(), e,
+                                    [](const Entry &a, const Entry &b) { return a.cell < b.cell; }),
+                   e);
+}
+
+void NodeSpatialIndex::within(int32_t lat, int32_t lon, uint32_t meters, std::vector<Result> &out) const
+{
+    out.clear();
+    if (entries.empty())
+        return;
+
+    // The box around the circle, in 1e-7 degrees. Its width is taken at the edge nearest a pole, where it is widest
+    int64_t span = (int64_t)meters * 10000000 / METERS_PER_DEGREE + 1;
+    int32_t latLo = std::max<int64_t>(lat - span, -MAX_LAT), latHi = std::min<int64_t>(lat + span, MAX_LAT);
+    int32_t polar = std::max(abs(latLo), abs(latHi));
+    int64_t cosPolar = cosLatOf(polar);
+    int64_t lonSpan = cosPolar ? span * 32768 / cosPolar : 2 * MAX_LON;
+
+    // Longitude ranges to look at, two if the box crosses 180 degrees
+    int64_t ranges[2][2];
+    size_t numRanges = 1;
+    if (lonSpan >= MAX_LON) {
+        ranges[0][0] = -MAX_LON;
+        ranges[0][1] = MAX_LON;
+    } else {
+        int64_t lo = lon - lonSpan, hi = lon + lonSpan;
+        ranges[0][0] = std::max(lo, -MAX_LON);
+        ranges[0][1] = std::min(hi, MAX_LON);
+        if (lo < -MAX_LON) {
+            ranges[1][0] = lo + 2 * MAX_LON;
+            ranges[1][1] = MAX_LON;
+            numRanges = 2;
+        } else if (hi > MAX_LON) {
+            ranges[1][0] = -MAX_LON;
+            ranges[1][1] = hi - 2 * MAX_LON;
+            numRanges = 2;
+        }
+    }
+
+    uint16_t cosLat = cosLatOf(lat);
+    auto byCell = [](const Entry &e, uint32_t cell) { return e.cell < cell; };
+    for (int32_t row = latLo >> NODE_GRID_SHIFT; row <= latHi >> NODE_GRID_SHIFT; row++) {
+        for (size_t r = 0; r < numRanges; r++) {
+            // Cells of a row are next to each other in entries
+            uint32_t rowCell = (uint32_t)(row + GRID_OFFSET) << GRID_ROW_BITS;
+            uint32_t first = rowCell | (((int32_t)ranges[r][0] >> NODE_GRID_SHIFT) + GRID_OFFSET);
+            uint32_t last = rowCell | (((int32_t)ranges[r][1] >> NODE_GRID_SHIFT) + GRID_OFFSET);
+            for (auto it = std::lower_bound(entries.begin(), entries.end(), first, byCell);
+                 it != entries.end() && it->cell <= last; ++it) {
+                uint32_t d = distance(lat, lon, cosLat, it->lat, it->lon, it->cosLat);
+                if (d <= meters)
+                    out.push_back({it->index, d});
+            }
+        }
+    }
+
+    std::sort(out.begin(), out.end(), [](const Result &a, const Result &b) {
+        return a.meters < b.meters || (a.meters == b.meters && a.index < b.index);
+    });
+}
+
+void NodeSpatialIndex::nearest(int32_t lat, int32_t lon, size_t k, std::vector<Result> &out) const
+{
+    out.clear();
+    if (k == 0)
+        return;
+
+    // Widen the circle until it holds k nodes, everything outside of it is further away than those
+    const uint32_t halfCircumference = 20000000;
+    for (uint32_t meters = 1000;; meters *= 4) {
+        within(lat, lon, std::min(meters, halfCircumference), out);
+        if (out.size() >= k || meters >= halfCircumference)
+            break;
+    }
+    if (out.size() > k)
+        out.resize(k);
+}
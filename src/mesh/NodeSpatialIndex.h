@@ -0,0 +1,71 @@
+#pragma once
+
+#include "mesh/generated/meshtastic/deviceonly.pb.h"
+#include <vector>
+
+/// Grid cells are 2^NODE_GRID_SHIFT units of 1e-7 degrees, about 0.1 degree or 11.6 km north-south
+#ifndef NODE_GRID_SHIFT
+#define NODE_GRID_SHIFT 20
+#endif
+
+/// Points closer than this in latitude and longitude (1e-7 degrees) are measured on a flat approximation
+#define NODE_GRID_FLAT_LIMIT 10000000 // 1 degree
+
+/**
+ * Finds the nodes near a point without working out the distance to every node with trig.
+ *
+ * Nodes with a valid position are kept sorted by the grid cell they are in, so a query only looks at the cells its radius
+ * overlaps. Each entry keeps cos(latitude) in fixed point: distances up to about a degree are then measured on an
+ * equirectangular approximation in integers, longer ones with GeoCoord::latLongToMeter().
+ *
+ * Like NodeViews, entries refer to nodes by their index in NodeDB::meshNodes, and NodeDB rebuilds the index when it moves
+ * nodes around.
+ */
+class NodeSpatialIndex
+{
+  public:
+    struct Result {
+        uint16_t index; // In NodeDB::meshNodes
+        uint32_t meters;
+    };
+
+    /// Index all nodes[0..numNodes) with a valid position again
+    void rebuild(const meshtastic_NodeInfoLite *nodes, size_t numNodes);
+
+    /// nodes[index] has a new position, or no longer has one
+    void update(const meshtastic_NodeInfoLite *nodes, size_t index);
+
+    /// Number of nodes with a valid position
+    size_t size() const { return entries.size(); }
+
+    /// Index into NodeDB::meshNodes of one of the nodes with a valid position, in no particular order
+    uint16_t at(size_t i) const { return entries[i].index; }
+
+    /// Set out to the nodes at most meters from lat/lon (in 1e-7 degrees), nearest first
+    void within(int32_t lat, int32_t lon, uint32_t meters, std::vector<Result> &out) const;
+
+    /// Set out to the (up to) k nodes nearest to lat/lon (in 1e-7 degrees), nearest first
+    void nearest(int32_t lat, int32_t lon, size_t k, std::vector<Result> &out) const;
+
+    /// Meters between two points in 1e-7 degrees. Nearby points take a cosf() for each, the rest GeoCoord::latLongToMeter()
+    static uint32_t distance(int32_t latA, int32_t lonA, int32_t latB, int32_t lonB);
+
+    /// The same, with cos(lat) of each point from cosLatOf(), to measure many points from one without repeating its cosf()
+    static uint32_t distance(int32_t latA, int32_t lonA, uint16_t cosA, int32_t latB, int32_t lonB, uint16_t cosB);
+
+    /// cos(lat) * 32768, lat in 1e-7 degrees
+    static uint16_t cosLatOf(int32_t lat);
+
+  private:
+    struct Entry {
+        uint32_t cell;
+        int32_t lat, lon;
+        uint16_t index;
+        uint16_t cosLat; // cos(lat) * 32768
+    };
+
+    std::vector<Entry> entries; // Sorted by cell
+
+    static uint32_t cellOf(int32_t lat, int32_t lon);
+    static bool hasPosition(const meshtastic_NodeInfoLite &n);
+};
@@ -0,0 +1,381 @@
+#include "NodeStore.h"
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "SafeFile.h"
+#include "concurrency/LockGuard.h"
+#include <ErriezCRC32.h>
+#include <algorithm>
+#include <pb_decode.h>
+#include <pb_encode.h>
+#include <unordered_map>
+
+#if ARCH_PORTDUINO
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// All our targets are little endian, so records are written as the in-memory structs
+
+NodeStore::NodeStore(const char *_fileName, const char *_legacyFileName) : fileName(_fileName), legacyFileName(_legacyFileName)
+{
+}
+
+uint32_t NodeStore::recordCrc(const uint8_t *buf, size_t len)
+{
+    return crc32Buffer(buf, len);
+}
+
+size_t NodeStore::encodeRecord(uint8_t *buf, RecordType type, NodeNum num, const meshtastic_NodeInfoLite *node)
+{
+    RecordHeader header = {num, 0, type, 0};
+    if (node) {
+        pb_ostream_t stream = pb_ostream_from_buffer(buf + sizeof(header), meshtastic_NodeInfoLite_size);
+        if (!pb_encode(&stream, meshtastic_NodeInfoLite_fields, node)) {
+            LOG_ERROR("NodeStore: can't encode node 0x%x %s", num, PB_GET_ERROR(&stream));
+            return 0;
+        }
+        header.len = stream.bytes_written;
+    }
+    memcpy(buf, &header, sizeof(header));
+    size_t len = sizeof(header) + header.len;
+    uint32_t crc = recordCrc(buf, len);
+    memcpy(buf + len, &crc, sizeof(crc));
+    return len + sizeof(crc);
+}
+
+NodeStore::SavedNode *NodeStore::findSaved(NodeNum num)
+{
+    auto it = std::lower_bound(saved.begin(), saved.end(), num, [](const SavedNode &s, NodeNum n) { return s.num < n; });
+    return (it != saved.end() && it->num == num) ? &*it : NULL;
+}
+
+#if ARCH_PORTDUINO
+/// Reads the journal out of an mmap'ed file
+class MappedSource
+{
+  public:
+    explicit MappedSource(const char *path)
+    {
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void *p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED) {
+                madvise(p, st.st_size, MADV_SEQUENTIAL);
+                data = (const uint8_t *)p;
+                size = st.st_size;
+            }
+        }
+        close(fd); // the mapping stays valid
+    }
+    ~MappedSource()
+    {
+        if (data)
+            munmap((void *)data, size);
+    }
+
+    bool isOpen() const { return data != NULL; }
+
+    bool read(void *dest, size_t len)
+    {
+        if (size - pos < len)
+            return false;
+        memcpy(dest, data + pos, len);
+        pos += len;
+        return true;
+    }
+
+    size_t pos = 0;
+
+  private:
+    const uint8_t *data = NULL;
+    size_t size = 0;
+};
+#else
+/// Streams the journal from the filesystem
+class FileSource
+{
+  public:
+    explicit FileSource(const char *path) : f(FSCom.open(path, FILE_O_READ)) {}
+    ~FileSource()
+    {
+        if (f)
+            f.close();
+    }
+
+    bool isOpen() { return (bool)f; }
+
+    bool read(void *dest, size_t len)
+    {
+        if ((size_t)f.read((uint8_t *)dest, len) != len)
+            return false;
+        pos += len;
+        return true;
+    }
+
+    size_t pos = 0;
+
+  private:
+    File f;
+};
+#endif
+
+template <class Source> void NodeStore::parse(Source &src, meshtastic_NodeDatabase &db)
+{
+    uint8_t buf[maxRecordSize];
+    std::unordered_map<NodeNum, size_t> index; // num -> position in db.nodes
+    uint32_t numRecords = 0;
+
+    while (true) {
+        size_t recordStart = src.pos;
+        RecordHeader header;
+        if (!src.read(&header, sizeof(header)))
+            break; // clean end of the journal, or a truncated header
+
+        uint32_t crc;
+        if (header.len > meshtastic_NodeInfoLite_size || !src.read(buf + sizeof(header), header.len) ||
+            !src.read(&crc, sizeof(crc))) {
+            LOG_WARN("NodeStore: truncated record at %u, discard the rest", recordStart);
+            src.pos = recordStart;
+            compactionNeeded = true;
+            break;
+        }
+        memcpy(buf, &header, sizeof(header));
+        if (recordCrc(buf, sizeof(header) + header.len) != crc) {
+            LOG_WARN("NodeStore: bad CRC at %u, discard the rest", recordStart);
+            src.pos = recordStart;
+            compactionNeeded = true;
+            break;
+        }
+        numRecords++;
+
+        auto it = index.find(header.num);
+        if (header.type == RECORD_PUT) {
+            meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_default;
+            pb_istream_t stream = pb_istream_from_buffer(buf + sizeof(header), header.len);
+            if (!pb_decode(&stream, meshtastic_NodeInfoLite_fields, &node)) {
+                LOG_WARN("NodeStore: can't decode node 0x%x %s", header.num, PB_GET_ERROR(&stream));
+                continue;
+            }
+            if (it != index.end()) {
+                db.nodes[it->second] = node;
+            } else {
+                index[header.num] = db.nodes.size();
+                db.nodes.push_back(node);
+            }
+            saved.push_back({header.num, crc, false});
+        } else if (header.type == RECORD_DELETE && it != index.end()) {
+            db.nodes[it->second].num = 0; // removed below, keeping the order of the rest
+            index.erase(it);
+            saved.push_back({header.num, 0, false});
+        }
+    }
+    journalBytes = src.pos;
+
+    db.nodes.erase(std::remove_if(db.nodes.begin(), db.nodes.end(), [](const meshtastic_NodeInfoLite &n) { return n.num == 0; }),
+                   db.nodes.end());
+
+    // Only the last record for each node counts, and deleted nodes are not on disk any more
+    std::stable_sort(saved.begin(), saved.end(), [](const SavedNode &a, const SavedNode &b) { return a.num < b.num; });
+    std::vector<SavedNode> latest;
+    latest.reserve(db.nodes.size());
+    for (size_t i = 0; i < saved.size(); i++) {
+        if (i + 1 < saved.size() && saved[i + 1].num == saved[i].num)
+            continue;
+        if (index.count(saved[i].num))
+            latest.push_back(saved[i]);
+    }
+    saved.swap(latest);
+
+    LOG_INFO("NodeStore: loaded %u nodes from %u records, %u bytes", db.nodes.size(), numRecords, journalBytes);
+    // A journal mostly made of superseded records makes boot slow, rewrite it
+    if (numRecords > 2 * db.nodes.size() + 64)
+        compactionNeeded = true;
+}
+
+LoadFileResult NodeStore::load(meshtastic_NodeDatabase &db)
+{
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+
+    saved.clear();
+    journalBytes = 0;
+#if ARCH_PORTDUINO
+    std::string path = std::string(portduinoVFS->mountpoint()) + fileName;
+    MappedSource src(path.c_str());
+#else
+    FileSource src(fileName);
+#endif
+    if (!src.isOpen())
+        return LoadFileResult::NOT_FOUND;
+
+    FileHeader header;
+    if (!src.read(&header, sizeof(header)) || header.magic != NODESTORE_MAGIC ||
+        recordCrc((const uint8_t *)&header, offsetof(FileHeader, crc)) != header.crc) {
+        LOG_ERROR("NodeStore: %s has a bad header", fileName);
+        return LoadFileResult::DECODE_FAILED;
+    }
+
+    LOG_INFO("Load %s", fileName);
+    db.version = version = header.version;
+    db.nodes.clear();
+    parse(src, db);
+    return LoadFileResult::LOAD_SUCCESS;
+#else
+    LOG_ERROR("ERROR: Filesystem not implemented");
+    return LoadFileResult::NO_FILESYSTEM;
+#endif
+}
+
+bool NodeStore::save(const meshtastic_NodeDatabase &db, size_t &bytesWritten)
+{
+    bytesWritten = 0;
+#ifdef FSCom
+    {
+        concurrency::LockGuard g(spiLock);
+        if (!FSCom.exists(fileName))
+            compactionNeeded = true; // e.g. after a factory reset or reformat
+    }
+
+    for (auto &s : saved)
+        s.seen = false;
+
+    // Records for everything that changed since the last save
+    std::vector<uint8_t> changes;
+    std::vector<SavedNode> added;
+    uint8_t buf[maxRecordSize];
+    size_t liveBytes = sizeof(FileHeader);
+    size_t numChanged = 0;
+    for (const auto &node : db.nodes) {
+        if (!node.num)
+            continue; // unused slot
+        size_t len = encodeRecord(buf, RECORD_PUT, node.num, &node);
+        if (!len) {
+            compactionNeeded = true; // our view of the file is half updated now
+            return false;
+        }
+        liveBytes += len;
+
+        uint32_t crc;
+        memcpy(&crc, buf + len - sizeof(crc), sizeof(crc));
+        SavedNode *s = findSaved(node.num);
+        if (s) {
+            s->seen = true;
+            if (s->crc == crc)
+                continue;
+            s->crc = crc;
+        } else {
+            added.push_back({node.num, crc, true});
+        }
+        numChanged++;
+        if (!compactionNeeded)
+            changes.insert(changes.end(), buf, buf + len);
+    }
+
+    // Nodes which are gone from the database
+    auto gone = std::remove_if(saved.begin(), saved.end(), [&](const SavedNode &s) {
+        if (s.seen)
+            return false;
+        if (!compactionNeeded) {
+            size_t len = encodeRecord(buf, RECORD_DELETE, s.num, NULL);
+            changes.insert(changes.end(), buf, buf + len);
+        }
+        numChanged++;
+        return true;
+    });
+    saved.erase(gone, saved.end());
+    if (!added.empty()) {
+        saved.insert(saved.end(), added.begin(), added.end());
+        std::sort(saved.begin(), saved.end(), [](const SavedNode &a, const SavedNode &b) { return a.num < b.num; });
+    }
+
+    if (compactionNeeded || db.version != version || journalBytes + changes.size() > 2 * liveBytes + NODESTORE_COMPACT_SLACK) {
+        bool ok = compact(db, bytesWritten);
+        LOG_DEBUG("NodeStore: compacted %u nodes into %u bytes", saved.size(), journalBytes);
+        return ok;
+    }
+    if (changes.empty())
+        return true;
+
+    LOG_DEBUG("NodeStore: append %u changed nodes, %u bytes", numChanged, changes.size());
+    return append(changes, bytesWritten);
+#else
+    LOG_ERROR("ERROR: Filesystem not implemented");
+    return false;
+#endif
+}
+
+bool NodeStore::compact(const meshtastic_NodeDatabase &db, size_t &bytesWritten)
+{
+#ifdef FSCom
+    // The database can be too large for two copies to fit on an MCU filesystem, so only portduino replaces it atomically
+#if ARCH_PORTDUINO
+    SafeFile f(fileName, true);
+#else
+    SafeFile f(fileName, false);
+#endif
+
+    FileHeader header = {NODESTORE_MAGIC, db.version, 0};
+    header.crc = recordCrc((const uint8_t *)&header, offsetof(FileHeader, crc));
+    size_t written = f.write((const uint8_t *)&header, sizeof(header));
+
+    uint8_t buf[maxRecordSize];
+    for (const auto &node : db.nodes) {
+        if (!node.num)
+            continue;
+        size_t len = encodeRecord(buf, RECORD_PUT, node.num, &node);
+        written += f.write(buf, len);
+    }
+
+    bool ok = f.close();
+    bytesWritten += written;
+    if (!ok) {
+        LOG_ERROR("Can't write %s", fileName);
+        compactionNeeded = true;
+        return false;
+    }
+    version = db.version;
+    journalBytes = written;
+    compactionNeeded = false;
+
+    concurrency::LockGuard g(spiLock);
+    if (legacyFileName && FSCom.exists(legacyFileName)) {
+        LOG_INFO("NodeStore: remove %s, its nodes are now in %s", legacyFileName, fileName);
+        FSCom.remove(legacyFileName);
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool NodeStore::append(const std::vector<uint8_t> &records, size_t &bytesWritten)
+{
+#ifdef FSCom
+    concurrency::LockGuard g(spiLock);
+    auto f = FSCom.open(fileName, FILE_O_APPEND);
+    if (!f) {
+        LOG_ERROR("Can't open %s for append", fileName);
+        compactionNeeded = true;
+        return false;
+    }
+    size_t written = f.write(records.data(), records.size());
+    f.close();
+    bytesWritten += written;
+    journalBytes += written;
+    if (written != records.size()) {
+        // A partial record is dropped by load(), so only our in-memory view is now wrong: rewrite it all next time
+        LOG_ERROR("Can't append to %s", fileName);
+        compactionNeeded = true;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "NodeDB.h"
+#include <vector>
+
+/// Rewrite the journal once it is this much larger than twice the live records
+#ifndef NODESTORE_COMPACT_SLACK
+#define NODESTORE_COMPACT_SLACK 4096
+#endif
+
+#define NODESTORE_MAGIC 0x314a4e4d // "MNJ1"
+
+/**
+ * Log-structured storage of the node database.
+ *
+ * The file starts with a small header (magic, NodeDatabase version, CRC), followed by records of the form
+ *   [NodeNum num][uint16 len][uint8 type][uint8 reserved][len bytes NodeInfoLite protobuf][uint32 CRC32 of all before]
+ * A PUT record holds the full new state of a node, a DELETE record (len 0) removes it. The last record for a node wins.
+ *
+ * save() only appends records for nodes whose encoding changed since the last load/save, so a last_heard bump costs one
+ * short record instead of a rewrite of the whole database. Once the journal has grown well beyond the live data it is
+ * compacted: rewritten with a single PUT per node.
+ *
+ * load() applies records in order and stops at the first truncated or corrupt record (e.g. power lost during an append),
+ * keeping everything before it. The next save() then compacts the file.
+ *
+ * On portduino the journal is read through mmap, elsewhere it is streamed from the filesystem.
+ */
+class NodeStore
+{
+  public:
+    /// legacyFileName is the protobuf file written by older firmware, removed once the journal has been written
+    NodeStore(const char *fileName, const char *legacyFileName);
+
+    /// Replace db's nodes and version with the journal contents
+    LoadFileResult load(meshtastic_NodeDatabase &db);
+
+    /// Write the changes since the last load()/save(), compacting the journal if needed. Not reentrant, NodeDB only saves
+    /// from one thread at a time.
+    /// @param bytesWritten gets the number of bytes written to flash
+    /// @return true if the save was successful
+    bool save(const meshtastic_NodeDatabase &db, size_t &bytesWritten);
+
+    /// Make the next save() rewrite the whole journal, e.g. to convert from the legacy file
+    void requestCompaction() { compactionNeeded = true; }
+    bool needsCompaction() const { return compactionNeeded; }
+
+    /// Size of the journal on disk
+    size_t getJournalBytes() const { return journalBytes; }
+
+  private:
+    enum RecordType : uint8_t { RECORD_PUT = 1, RECORD_DELETE = 2 };
+
+    struct __attribute__((packed)) FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t crc;
+    };
+
+    struct __attribute__((packed)) RecordHeader {
+        NodeNum num;
+        uint16_t len;
+        uint8_t type;
+        uint8_t reserved;
+    };
+
+    static constexpr size_t maxRecordSize = sizeof(RecordHeader) + meshtastic_NodeInfoLite_size + sizeof(uint32_t);
+
+    /// What is on disk for a node: the CRC of its latest record, sorted by num
+    struct SavedNode {
+        NodeNum num;
+        uint32_t crc;
+        bool seen; // scratch for save()
+    };
+    std::vector<SavedNode> saved;
+
+    const char *fileName;
+    const char *legacyFileName;
+    uint32_t version = 0;
+    size_t journalBytes = 0;
+    bool compactionNeeded = false;
+
+    /// Encode a record into buf, returning its total length (0 on failure)
+    static size_t encodeRecord(uint8_t *buf, RecordType type, NodeNum num, const meshtastic_NodeInfoLite *node);
+    static uint32_t recordCrc(const uint8_t *buf, size_t len);
+
+    template <class Source> void parse(Source &src, meshtastic_NodeDatabase &db);
+
+    SavedNode *findSaved(NodeNum num);
+
+    /// Rewrite the journal with one PUT per node
+    bool compact(const meshtastic_NodeDatabase &db, size_t &bytesWritten);
+    /// Append already encoded records
+    bool append(const std::vector<uint8_t> &records, size_t &bytesWritten);
+};
@@ -0,0 +1,42 @@
+#include "NodeViews.h"
+#include <algorithm>
+
+void NodeViews::rebuild(const meshtastic_NodeInfoLite *nodes, size_t numNodes)
+{
+    heard.clear();
+    heard.reserve(numNodes);
+    for (size_t i = 0; i < numNodes; i++)
+        heard.push_back(toEntry(nodes, i));
+    std::stable_sort(heard.begin(), heard.end(), heardBefore);
+    version++;
+}
+
+void NodeViews::updateHeard(const meshtastic_NodeInfoLite *nodes, size_t index)
+{
+    Entry e = toEntry(nodes, index);
+    auto it = std::find_if(heard.begin(), heard.end(), [index](const Entry &h) { return h.index == index; });
+    if (it != heard.end()) {
+        if (it->lastHeard == e.lastHeard && it->viaMqtt == e.viaMqtt)
+            return;
+        heard.erase(it);
+    }
+    heard.insert(std::upper_bound(heard.begin(), heard.end(), e, heardBefore), e);
+    version++;
+}
+
+size_t NodeViews::countHeardWithin(uint32_t now, uint32_t secs, bool localOnly) const
+{
+    size_t count = 0;
+    for (const Entry &e : heard) {
+        // Same as sinceLastSeen(), a last_heard ahead of our clock counts as just heard
+        int delta = (int)(now - e.lastHeard);
+        if ((uint32_t)std::max(delta, 0) < secs) {
+            if (!localOnly || !e.viaMqtt)
+                count++;
+        } else if (e.lastHeard <= now) {
+            break; // Everyone after this was heard even longer ago
+        }
+        // Else it is so far ahead that it wraps around to long ago, keep looking
+    }
+    return count;
+}
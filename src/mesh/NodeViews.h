@@ -0,0 +1,52 @@
+#pragma once
+
+#include "mesh/generated/meshtastic/deviceonly.pb.h"
+#include <vector>
+
+/**
+ * Orderings of the node database which are kept up to date as nodes are heard, so the UI and APIs don't have to scan and
+ * sort every node each time they draw or answer.
+ *
+ * Entries refer to nodes by their index in NodeDB::meshNodes, along with a copy of what they are sorted on. NodeDB calls
+ * rebuild() whenever it moves nodes around (loading, removal, eviction) and updateHeard() when a single node changes.
+ */
+class NodeViews
+{
+  public:
+    /// Sort all nodes[0..numNodes) again
+    void rebuild(const meshtastic_NodeInfoLite *nodes, size_t numNodes);
+
+    /// nodes[index] was heard from, or was just added at the end
+    void updateHeard(const meshtastic_NodeInfoLite *nodes, size_t index);
+
+    size_t numByLastHeard() const { return heard.size(); }
+
+    /// Index into NodeDB::meshNodes of the node at this rank, most recently heard first
+    uint16_t byLastHeard(size_t rank) const { return heard[rank].index; }
+
+    /**
+     * Number of nodes heard less than secs ago, the same as counting sinceLastSeen() < secs over all nodes. Only looks at the
+     * nodes which are counted, plus one.
+     * @param localOnly if true, ignore nodes heard via MQTT
+     */
+    size_t countHeardWithin(uint32_t now, uint32_t secs, bool localOnly = false) const;
+
+    /// Changes whenever an ordering changes, so callers can keep what they derived from it until then
+    uint32_t getVersion() const { return version; }
+
+  private:
+    struct Entry {
+        uint32_t lastHeard;
+        uint16_t index;
+        bool viaMqtt;
+    };
+
+    std::vector<Entry> heard; // Most recently heard first
+    uint32_t version = 0;
+
+    static Entry toEntry(const meshtastic_NodeInfoLite *nodes, size_t index)
+    {
+        return {nodes[index].last_heard, (uint16_t)index, nodes[index].via_mqtt};
+    }
+    static bool heardBefore(const Entry &a, const Entry &b) { return a.lastHeard > b.lastHeard; }
+};
@@ -0,0 +1,110 @@
+#include "PacketTrace.h"
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "configuration.h"
+
+static_assert((PACKET_TRACE_SIZE & (PACKET_TRACE_SIZE - 1)) == 0, "PACKET_TRACE_SIZE must be a power of 2");
+static_assert(sizeof(PacketTraceRecord) == 24, "PacketTraceRecord layout is shared with bin/packet_trace.py");
+static_assert(sizeof(PacketTraceHeader) == 16, "PacketTraceHeader layout is shared with bin/packet_trace.py");
+
+PacketTrace packetTrace;
+
+void PacketTrace::record(PacketTraceEvent event, const meshtastic_MeshPacket *p, uint32_t queueDepth)
+{
+    PacketTraceRecord &r = ring[head++ & (PACKET_TRACE_SIZE - 1)];
+    r.msec = millis();
+    r.from = p->from;
+    r.to = p->to;
+    r.id = p->id;
+    r.event = event;
+    r.hopLimit = p->hop_limit;
+    r.hopStart = p->hop_start;
+    r.relayNode = p->relay_node;
+    r.nextHop = p->next_hop;
+    float snr = p->rx_snr * 4;
+    r.snr = snr > 127 ? 127 : snr < -128 ? -128 : (int8_t)snr;
+    r.queueDepth = queueDepth > UINT8_MAX ? UINT8_MAX : queueDepth;
+    r.channel = p->channel;
+}
+
+size_t PacketTrace::snapshot(PacketTraceRecord *out, size_t max) const
+{
+    uint32_t end = head;
+    size_t n = min((size_t)min(end, (uint32_t)PACKET_TRACE_SIZE), max);
+    for (size_t i = 0; i < n; i++)
+        out[i] = ring[(end - n + i) & (PACKET_TRACE_SIZE - 1)];
+    return n;
+}
+
+PacketTraceHeader PacketTrace::makeHeader(size_t numRecords) const
+{
+    PacketTraceHeader h;
+    h.magic = PACKET_TRACE_MAGIC;
+    h.version = PACKET_TRACE_VERSION;
+    h.recordSize = sizeof(PacketTraceRecord);
+    h.numRecords = numRecords;
+    h.totalEvents = head;
+    h.msec = millis();
+    return h;
+}
+
+bool PacketTrace::save(const char *filename) const
+{
+#ifdef FSCom
+    uint32_t end = head;
+    size_t n = min(end, (uint32_t)PACKET_TRACE_SIZE);
+    PacketTraceHeader h = makeHeader(n);
+
+    concurrency::LockGuard g(spiLock);
+    if (FSCom.exists(filename))
+        FSCom.remove(filename);
+    auto f = FSCom.open(filename, FILE_O_WRITE);
+    if (!f) {
+        LOG_ERROR("Can't write packet trace to %s", filename);
+        return false;
+    }
+    size_t written = f.write((const uint8_t *)&h, sizeof(h));
+    // Oldest first, which is the part of the ring after head once it has wrapped
+    size_t start = (end - n) & (PACKET_TRACE_SIZE - 1);
+    size_t firstPart = min(n, (size_t)PACKET_TRACE_SIZE - start);
+    written += f.write((const uint8_t *)&ring[start], firstPart * sizeof(PacketTraceRecord));
+    written += f.write((const uint8_t *)&ring[0], (n - firstPart) * sizeof(PacketTraceRecord));
+    f.close();
+    return written == sizeof(h) + n * sizeof(PacketTraceRecord);
+#else
+    return false;
+#endif
+}
+
+static void toHex(char *out, const void *data, size_t len)
+{
+    static const char digits[] = "0123456789abcdef";
+    const uint8_t *b = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        *out++ = digits[b[i] >> 4];
+        *out++ = digits[b[i] & 0xf];
+    }
+    *out = '\0';
+}
+
+void PacketTrace::dump() const
+{
+    // A few records per line keeps the lines short enough for every log backend
+    const size_t perLine = 4;
+    char hex[perLine * sizeof(PacketTraceRecord) * 2 + 1];
+
+    uint32_t end = head;
+    size_t n = min(end, (uint32_t)PACKET_TRACE_SIZE);
+    PacketTraceHeader h = makeHeader(n);
+    toHex(hex, &h, sizeof(h));
+    LOG_INFO("ptrace %s", hex);
+
+    PacketTraceRecord line[perLine];
+    for (size_t i = 0; i < n; i += perLine) {
+        size_t count = min(perLine, n - i);
+        for (size_t j = 0; j < count; j++)
+            line[j] = ring[(end - n + i + j) & (PACKET_TRACE_SIZE - 1)];
+        toHex(hex, line, count * sizeof(PacketTraceRecord));
+        LOG_INFO("ptrace %s", hex);
+    }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+/**
+ * A binary trace of what happened to each packet, cheap enough to leave on in production.
+ *
+ * Every decision point (RX, dupe filtering, decoding, relaying, TX queueing, sending, retransmitting) appends a fixed-size
+ * record to a ring in RAM, so after the fact one can follow a packet id through the node. Nothing is allocated and no
+ * string formatting happens when recording.
+ *
+ * The ring is saved to a snapshot file when downloaded through XModem as PACKET_TRACE_FILENAME, and written to the log as
+ * hex when the first critical error since boot is recorded or a reboot is requested. bin/packet_trace.py decodes either.
+ */
+
+/// Number of records kept, must be a power of 2
+#ifndef PACKET_TRACE_SIZE
+#if ARCH_PORTDUINO
+#define PACKET_TRACE_SIZE 1024
+#else
+#define PACKET_TRACE_SIZE 64
+#endif
+#endif
+
+/// Requesting this file over XModem returns a fresh snapshot of the trace
+#define PACKET_TRACE_FILENAME "/packettrace.bin"
+
+enum PacketTraceEvent : uint8_t {
+    PTRACE_NONE = 0,
+    PTRACE_RX,             // Received from the radio
+    PTRACE_RX_QUEUE_DROP,  // Dropped, the queue from the radio to the router was full
+    PTRACE_DUPE,           // Ignored, seen recently
+    PTRACE_DECODE_FAIL,    // Could not be decrypted or decoded
+    PTRACE_HANDLED,        // Decoded and handed to the modules
+    PTRACE_RELAY,          // Relay of a packet from someone else about to be sent
+    PTRACE_TX_QUEUED,      // Added to the TX queue
+    PTRACE_TX_QUEUE_FULL,  // Not sent, the TX queue was full of packets with the same or higher priority
+    PTRACE_TX_EVICTED,     // Dropped from the TX queue for a higher priority packet
+    PTRACE_TX_CANCEL,      // Removed from the TX queue before it was sent, usually because someone else relayed it
+    PTRACE_TX_START,       // Handed to the radio
+    PTRACE_TX_DONE,        // Radio finished sending
+    PTRACE_RETRANSMIT,     // Sent again as nobody acked it
+    PTRACE_RETRANSMIT_END, // Gave up retransmitting
+};
+
+/// One event, 24 bytes little endian. Changing the layout means bumping PACKET_TRACE_VERSION and the host decoder
+struct PacketTraceRecord {
+    uint32_t msec; // millis() at the event
+    uint32_t from;
+    uint32_t to;
+    uint32_t id;
+    uint8_t event; // PacketTraceEvent
+    uint8_t hopLimit;
+    uint8_t hopStart;
+    uint8_t relayNode;
+    uint8_t nextHop;
+    int8_t snr;         // In quarter dB, for PTRACE_RX
+    uint8_t queueDepth; // Packets in the queue the event is about, after it
+    uint8_t channel;    // Channel hash while encrypted, index once decoded
+};
+
+#define PACKET_TRACE_MAGIC 0x43525450 // "PTRC"
+#define PACKET_TRACE_VERSION 1
+
+/// Precedes the records in a saved or dumped trace
+struct PacketTraceHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t recordSize;
+    uint16_t numRecords; // Records that follow, oldest first
+    uint32_t totalEvents; // Events recorded since boot, including ones which fell out of the ring
+    uint32_t msec;        // millis() when the snapshot was taken
+};
+
+class PacketTrace
+{
+  public:
+    void record(PacketTraceEvent event, const meshtastic_MeshPacket *p, uint32_t queueDepth = 0);
+
+    /// Copy out up to max of the most recent records, oldest first. Returns how many were copied
+    size_t snapshot(PacketTraceRecord *out, size_t max) const;
+
+    /// Write the trace to a file, for downloading over XModem
+    bool save(const char *filename) const;
+
+    /// Write the trace to the log as hex lines, for when it can't be downloaded
+    void dump() const;
+
+    uint32_t getTotalEvents() const { return head; }
+
+  private:
+    PacketTraceRecord ring[PACKET_TRACE_SIZE] = {};
+    /// Records written since boot, the next one goes to ring[head % PACKET_TRACE_SIZE]
+    uint32_t head = 0;
+
+    PacketTraceHeader makeHeader(size_t numRecords) const;
+};
+
+extern PacketTrace packetTrace;
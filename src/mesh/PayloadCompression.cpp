@@ -0,0 +1,136 @@
+#include "PayloadCompression.h"
+#include "NodeDB.h"
+#include "Router.h"
+#include "compression/unishox2.h"
+#include "concurrency/LockGuard.h"
+#include "configuration.h"
+#include "meshUtils.h"
+#if ARCH_PORTDUINO
+#include "platform/portduino/PortduinoGlue.h"
+#endif
+
+// Fills the unishox2 lookup table. unishox2_compress/decompress would do that lazily, which races with DecodePool threads
+extern void init_coder();
+
+// The last few packets which arrived compressed, so we can compress them again if we relay them
+#define NUM_RECEIVED_COMPRESSED 16
+
+static struct {
+    NodeNum from;
+    PacketId id;
+} receivedCompressed[NUM_RECEIVED_COMPRESSED];
+static uint8_t nextReceivedCompressed;
+static concurrency::Lock *receivedCompressedLock;
+
+void initPayloadCompression()
+{
+    init_coder();
+    if (!receivedCompressedLock)
+        receivedCompressedLock = new concurrency::Lock();
+}
+
+static uint32_t compressedChannels()
+{
+#if ARCH_PORTDUINO
+    if (settingsMap.count(compress_channels))
+        return settingsMap[compress_channels];
+#endif
+    return PAYLOAD_COMPRESSION_CHANNELS;
+}
+
+bool isCompressiblePort(meshtastic_PortNum portnum)
+{
+    return portnum == meshtastic_PortNum_TEXT_MESSAGE_APP || portnum == meshtastic_PortNum_ATAK_FORWARDER;
+}
+
+bool shouldCompressPayload(const meshtastic_MeshPacket *p)
+{
+    if (!isCompressiblePort(p->decoded.portnum) || p->decoded.payload.size < 8 || p->channel >= 32 ||
+        !(compressedChannels() & (1 << p->channel)))
+        return false;
+
+    if (!isBroadcast(p->to)) {
+        const meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(p->to);
+        return node && (node->bitfield & NODEINFO_BITFIELD_CAN_DECOMPRESS_MASK);
+    }
+
+    // For a broadcast everybody who might hear it has to be able to read it, so skip it if anyone on this channel can't. Only
+    // nodes heard from within NUM_ONLINE_SECS count, otherwise a single node which left long ago would turn it off for good
+    for (size_t i = 1; i < nodeDB->getNumMeshNodes(); i++) {
+        const meshtastic_NodeInfoLite *node = nodeDB->getMeshNodeByIndex(i);
+        if (node->channel == p->channel && sinceLastSeen(node) < NUM_ONLINE_SECS &&
+            !(node->bitfield & NODEINFO_BITFIELD_CAN_DECOMPRESS_MASK))
+            return false;
+    }
+    return true;
+}
+
+bool compressPayload(meshtastic_Data &d)
+{
+    char compressed[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    char check[meshtastic_Constants_DATA_PAYLOAD_LEN];
+
+    // Only give it room for a result that is actually smaller, so it gives up early on payloads that don't compress
+    int len = unishox2_compress((const char *)d.payload.bytes, d.payload.size, compressed, d.payload.size - 1, USX_PSET_DFLT);
+    if (len <= 0 || len >= (int)d.payload.size)
+        return false;
+
+    // unishox2 is made for text, so make sure arbitrary bytes (TAK payloads) survive the round trip before we send them
+    int checkLen = unishox2_decompress(compressed, len, check, sizeof(check), USX_PSET_DFLT);
+    if (checkLen != (int)d.payload.size || memcmp(check, d.payload.bytes, checkLen) != 0)
+        return false;
+
+    LOG_DEBUG("Compressed payload %u -> %d bytes", d.payload.size, len);
+    memcpy(d.payload.bytes, compressed, len);
+    d.payload.size = len;
+    d.has_bitfield = true;
+    d.bitfield |= BITFIELD_COMPRESSED_MASK;
+    return true;
+}
+
+bool decompressPayload(meshtastic_Data &d)
+{
+    if (!d.has_bitfield || !(d.bitfield & BITFIELD_COMPRESSED_MASK))
+        return true;
+
+    char out[meshtastic_Constants_DATA_PAYLOAD_LEN];
+    int len = unishox2_decompress((const char *)d.payload.bytes, d.payload.size, out, sizeof(out), USX_PSET_DFLT);
+    if (len < 0 || len > (int)sizeof(out))
+        return false;
+
+    memcpy(d.payload.bytes, out, len);
+    d.payload.size = len;
+    d.bitfield &= ~BITFIELD_COMPRESSED_MASK;
+    return true;
+}
+
+bool decompressReceived(const meshtastic_MeshPacket *p, meshtastic_Data &d)
+{
+    if (d.has_bitfield && (d.bitfield & BITFIELD_COMPRESSED_MASK)) {
+        concurrency::LockGuard g(receivedCompressedLock);
+        receivedCompressed[nextReceivedCompressed].from = p->from;
+        receivedCompressed[nextReceivedCompressed].id = p->id;
+        nextReceivedCompressed = (nextReceivedCompressed + 1) % NUM_RECEIVED_COMPRESSED;
+    }
+    return decompressPayload(d);
+}
+
+bool wasReceivedCompressed(NodeNum from, PacketId id)
+{
+    concurrency::LockGuard g(receivedCompressedLock);
+    for (auto &r : receivedCompressed)
+        if (r.from == from && r.id == id)
+            return true;
+    return false;
+}
+
+void updateDecompressCapability(NodeNum n, const meshtastic_Data &d)
+{
+    meshtastic_NodeInfoLite *node = nodeDB->getMeshNode(n);
+    if (!node)
+        return;
+    if (d.has_bitfield && (d.bitfield & BITFIELD_CAN_DECOMPRESS_MASK))
+        node->bitfield |= NODEINFO_BITFIELD_CAN_DECOMPRESS_MASK;
+    else
+        node->bitfield &= ~NODEINFO_BITFIELD_CAN_DECOMPRESS_MASK;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "MeshTypes.h"
+
+/**
+ * Optional unishox2 compression of the payload of text and TAK packets we originate.
+ *
+ * A compressed payload is flagged with BITFIELD_COMPRESSED in the Data bitfield and restored by perhapsDecode(), so modules
+ * never see it. Nodes advertise that they can decompress with BITFIELD_CAN_DECOMPRESS on their NodeInfo, and we only send
+ * compressed to a destination which did, or for broadcasts when every node on that channel we heard from in the last
+ * NUM_ONLINE_SECS (two hours) did. Nodes we haven't heard from for longer, or never got a NodeInfo from, aren't asked, so they
+ * may get broadcasts they can't read.
+ *
+ * Packets which arrived compressed are compressed again when we relay them, whatever our own settings, so that the saving
+ * holds on every hop and a payload which only fit compressed still fits.
+ *
+ * Compression is opt-in per channel index: PAYLOAD_COMPRESSION_CHANNELS at build time, General.CompressChannels on portduino.
+ */
+
+/// Bitmask of channel indexes we compress on, bit 0 being the primary channel
+#ifndef PAYLOAD_COMPRESSION_CHANNELS
+#define PAYLOAD_COMPRESSION_CHANNELS 0
+#endif
+
+/// Set up the codec, before any packet may be decoded
+void initPayloadCompression();
+
+/// Is this a portnum whose payloads are text-like enough to be worth trying
+bool isCompressiblePort(meshtastic_PortNum portnum);
+
+/// Should this (decoded, not yet encrypted) packet from us be sent compressed
+bool shouldCompressPayload(const meshtastic_MeshPacket *p);
+
+/**
+ * Compress d.payload in place and flag it as such.
+ * @return false, leaving d untouched, if compressing wouldn't make the payload smaller
+ */
+bool compressPayload(meshtastic_Data &d);
+
+/**
+ * Undo compressPayload(). Payloads which were not compressed are left alone.
+ * @return false if the payload is flagged as compressed but doesn't decompress
+ */
+bool decompressPayload(meshtastic_Data &d);
+
+/**
+ * decompressPayload() for a packet we received, remembering if it came compressed so that wasReceivedCompressed() knows to
+ * compress it again when we relay it. Safe to call from DecodePool threads.
+ */
+bool decompressReceived(const meshtastic_MeshPacket *p, meshtastic_Data &d);
+
+/// Did one of the last few packets given to decompressReceived() come from this node with this id and arrive compressed
+bool wasReceivedCompressed(NodeNum from, PacketId id);
+
+/// Record whether a node can decompress, from the bitfield of a NodeInfo it sent
+void updateDecompressCapability(NodeNum n, const meshtastic_Data &d);
@@ -3,6 +3,7 @@
 #include "GPS.h"
 #endif
 
+#include "BootProfiler.h"
 #include "Channels.h"
 #include "Default.h"
 #include "FSCommon.h"
@@ -452,7 +453,11 @@ size_t PhoneAPI::getFromRadio(uint8_t *buf)
         break;
 
     case STATE_SEND_PACKETS:
-        pauseBluetoothLogging = false;
+        if (pauseBluetoothLogging) {
+            pauseBluetoothLogging = false;
+            // The client gets our log again, let it know how long we took to boot
+            bootProfiler.log();
+        }
         // Do we have a message from the mesh or packet from the local device?
         LOG_DEBUG("FromRadio=STATE_SEND_PACKETS");
         if (queueStatusPacketForPhone) {
@@ -0,0 +1,178 @@
+#include "PrefsWriter.h"
+#include "NodeDB.h"
+
+static constexpr uint32_t ONE_HOUR_MS = 60 * 60 * 1000;
+
+PrefsWriter::PrefsWriter() : concurrency::OSThread("PrefsWriter")
+{
+    hourStartMs = millis();
+#if ARCH_PORTDUINO
+    worker = std::thread([this] { workerLoop(); });
+#endif
+}
+
+PrefsWriter::~PrefsWriter()
+{
+#if ARCH_PORTDUINO
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cond.notify_all();
+    worker.join();
+#endif
+}
+
+void PrefsWriter::markDirty(int segments)
+{
+    uint32_t now = millis();
+    if (!dirty)
+        firstDirtyMs = now;
+    lastDirtyMs = now;
+    dirty |= segments;
+
+    // Restart the debounce window, but don't let a steady stream of changes postpone the write forever
+    uint32_t debounce = PREFS_SAVE_DEBOUNCE_MS;
+    uint32_t untilMax = PREFS_SAVE_MAX_DELAY_MS - min(now - firstDirtyMs, (uint32_t)PREFS_SAVE_MAX_DELAY_MS);
+    enabled = true;
+    setIntervalFromNow(min(debounce, untilMax));
+}
+
+int PrefsWriter::takeDirty(int segments)
+{
+    segments &= dirty;
+    dirty &= ~segments;
+    return segments;
+}
+
+void PrefsWriter::countBytesWritten(size_t bytes)
+{
+    totalBytesWritten += bytes;
+    bytesThisHour += bytes;
+}
+
+void PrefsWriter::rollHour()
+{
+    if (millis() - hourStartMs < ONE_HOUR_MS)
+        return;
+    hourStartMs = millis();
+#if ARCH_PORTDUINO
+    bytesLastHour = bytesThisHour.exchange(0);
+#else
+    bytesLastHour = bytesThisHour;
+    bytesThisHour = 0;
+#endif
+    LOG_INFO("Prefs written to flash: %u bytes in the last hour, %llu since boot", bytesLastHour,
+             (unsigned long long)getTotalBytesWritten());
+}
+
+int32_t PrefsWriter::runOnce()
+{
+    rollHour();
+    int32_t untilHourRoll = ONE_HOUR_MS - (millis() - hourStartMs);
+
+#if ARCH_PORTDUINO
+    int failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (busy)
+            return 100; // Check back for the result once the worker is done
+        failed = failedSegments;
+        failedSegments = 0;
+    }
+    if (failed) {
+        // The worker doesn't retry or raise critical errors, that happens here on the main thread
+        LOG_WARN("Background save of %d failed", failed);
+        dirty &= ~failed;
+        nodeDB->prepareForSave(failed);
+        nodeDB->writeToDisk(failed, nodeDB->liveState());
+    }
+#endif
+
+    if (!dirty)
+        return untilHourRoll;
+
+    uint32_t now = millis();
+    uint32_t dueMs = min(lastDirtyMs + PREFS_SAVE_DEBOUNCE_MS, firstDirtyMs + PREFS_SAVE_MAX_DELAY_MS);
+    if ((int32_t)(dueMs - now) > 0)
+        return dueMs - now;
+
+#if ARCH_PORTDUINO
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Copy what needs saving while we're on the main thread, the worker encodes and writes from the copy
+        int segments = takeDirty();
+        LOG_DEBUG("Save to disk %d in the background", segments);
+        nodeDB->prepareForSave(segments);
+        snapshot.segments = segments;
+        if (segments & SEGMENT_CONFIG)
+            snapshot.config = config;
+        if (segments & SEGMENT_MODULECONFIG)
+            snapshot.moduleConfig = moduleConfig;
+        if (segments & SEGMENT_CHANNELS)
+            snapshot.channelFile = channelFile;
+        if (segments & SEGMENT_DEVICESTATE)
+            snapshot.devicestate = devicestate;
+        if (segments & SEGMENT_NODEDATABASE)
+            snapshot.nodeDatabase = nodeDatabase;
+        busy = true;
+    }
+    cond.notify_all();
+    return 100;
+#else
+    int segments = takeDirty();
+    nodeDB->prepareForSave(segments);
+    nodeDB->writeToDisk(segments, nodeDB->liveState());
+    return untilHourRoll;
+#endif
+}
+
+bool PrefsWriter::flush(int segments)
+{
+#if ARCH_PORTDUINO
+    waitIdle();
+    int failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = failedSegments;
+        failedSegments = 0;
+    }
+    if (failed)
+        markDirty(failed); // retried along with the rest
+#endif
+    segments = takeDirty(segments);
+    if (!segments)
+        return true;
+    nodeDB->prepareForSave(segments);
+    return nodeDB->writeToDisk(segments, nodeDB->liveState());
+}
+
+#if ARCH_PORTDUINO
+void PrefsWriter::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        cond.wait(lock, [this] { return busy || stopping; });
+        if (!busy)
+            return; // stopping
+
+        // The snapshot is ours until we clear busy, so the lock isn't needed while writing
+        lock.unlock();
+        PersistedState state = {&snapshot.config, &snapshot.moduleConfig, &snapshot.channelFile, &snapshot.devicestate,
+                                &snapshot.nodeDatabase};
+        bool ok = nodeDB->saveToDiskNoRetry(snapshot.segments, state);
+        lock.lock();
+
+        if (!ok)
+            failedSegments |= snapshot.segments;
+        busy = false;
+        cond.notify_all();
+    }
+}
+
+void PrefsWriter::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this] { return !busy; });
+}
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "concurrency/OSThread.h"
+#include "configuration.h"
+#include "mesh-pb-constants.h"
+
+#if ARCH_PORTDUINO
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+/// After a segment is marked dirty, wait this long for more changes before writing
+#ifndef PREFS_SAVE_DEBOUNCE_MS
+#define PREFS_SAVE_DEBOUNCE_MS (2 * 1000)
+#endif
+
+/// But never hold back a dirty segment for longer than this, even if changes keep coming in
+#ifndef PREFS_SAVE_MAX_DELAY_MS
+#define PREFS_SAVE_MAX_DELAY_MS (15 * 1000)
+#endif
+
+/// The state that gets written to flash: either the live globals, or a copy taken for the write-behind worker
+struct PersistedState {
+    const meshtastic_LocalConfig *config;
+    const meshtastic_LocalModuleConfig *moduleConfig;
+    const meshtastic_ChannelFile *channelFile;
+    const meshtastic_DeviceState *devicestate;
+    const meshtastic_NodeDatabase *nodeDatabase;
+};
+
+/**
+ * Write-behind saving of the /prefs files for NodeDB.
+ *
+ * NodeDB::saveToDisk() only marks segments dirty here. Once no further change has come in for PREFS_SAVE_DEBOUNCE_MS (or
+ * PREFS_SAVE_MAX_DELAY_MS after the first one) the dirty segments are written together, so bursts of saves turn into a single
+ * write of each file.
+ *
+ * On MCUs the write runs from this OSThread, so outside of whatever code asked for the save. On portduino a copy of the dirty
+ * segments is taken on the main thread and a worker pthread does the encoding and file I/O. Failures are picked up again on
+ * the main thread, which retries and raises the critical error if that fails too.
+ */
+class PrefsWriter : private concurrency::OSThread
+{
+  public:
+    PrefsWriter();
+    ~PrefsWriter();
+
+    /// Mark segments (SEGMENT_* bits) as needing to be written
+    void markDirty(int segments);
+
+    /// Write the dirty segments among these (all by default) now, on the caller's thread, waiting for any write in progress
+    /// @return true if everything was written successfully
+    bool flush(int segments = ~0);
+
+    /// Segments not yet written
+    int getDirty() const { return dirty; }
+
+    /// Called by NodeDB for each file it writes, to track flash wear
+    void countBytesWritten(size_t bytes);
+
+    uint64_t getTotalBytesWritten() const { return totalBytesWritten; }
+    uint32_t getBytesWrittenLastHour() const { return bytesLastHour; }
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    int dirty = 0;
+    uint32_t firstDirtyMs = 0, lastDirtyMs = 0;
+
+#if ARCH_PORTDUINO
+    std::atomic<uint64_t> totalBytesWritten{0};
+    std::atomic<uint32_t> bytesThisHour{0};
+#else
+    uint64_t totalBytesWritten = 0;
+    uint32_t bytesThisHour = 0;
+#endif
+    uint32_t bytesLastHour = 0;
+    uint32_t hourStartMs = 0;
+
+#if ARCH_PORTDUINO
+    /// Copies of the dirty segments, owned by the worker while it writes them
+    struct Snapshot {
+        int segments = 0;
+        meshtastic_LocalConfig config;
+        meshtastic_LocalModuleConfig moduleConfig;
+        meshtastic_ChannelFile channelFile;
+        meshtastic_DeviceState devicestate;
+        meshtastic_NodeDatabase nodeDatabase;
+    };
+    Snapshot snapshot;
+    bool busy = false; // the worker owns snapshot
+    /// Segments the worker failed to write, retried on the main thread. The worker itself doesn't raise critical errors
+    int failedSegments = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::thread worker;
+
+    void workerLoop();
+    /// Wait until the worker is done with the snapshot
+    void waitIdle();
+#endif
+
+    /// Take the dirty segments among these (and clear them), returns 0 if none of them is dirty
+    int takeDirty(int segments = ~0);
+
+    void rollHour();
+};
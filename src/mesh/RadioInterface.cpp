@@ -198,7 +198,7 @@ separated by 2.16 MHz with respect to the adjacent channels. Channel zero starts
  *
  * @return num msecs for the packet
  */
-uint32_t RadioInterface::getPacketTime(uint32_t pl)
+uint32_t RadioInterface::computePacketTime(uint32_t pl)
 {
     float bandwidthHz = bw * 1000.0f;
     bool headDisable = false; // we currently always use the header
@@ -217,30 +217,49 @@ uint32_t RadioInterface::getPacketTime(uint32_t pl)
     return msecs;
 }
 
+void RadioInterface::buildAirtimeTable()
+{
+    for (uint32_t pl = 0; pl <= MAX_LORA_PAYLOAD_LEN; pl++)
+        airtimeTable[pl] = computePacketTime(pl);
+    airtimeTableBw = bw;
+    airtimeTableSf = sf;
+    airtimeTableCr = cr;
+    airtimeTablePreamble = preambleLength;
+}
+
+uint32_t RadioInterface::getPacketTime(uint32_t pl)
+{
+    if (pl > MAX_LORA_PAYLOAD_LEN)
+        return computePacketTime(pl);
+    // Some radios adjust preambleLength etc. in their init(), after applyModemConfig() built the table
+    if (bw != airtimeTableBw || sf != airtimeTableSf || cr != airtimeTableCr || preambleLength != airtimeTablePreamble)
+        buildAirtimeTable();
+    return airtimeTable[pl];
+}
+
+uint32_t RadioInterface::getPacketLength(const meshtastic_MeshPacket *p)
+{
+    if (p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag)
+        return p->encrypted.size + sizeof(PacketHeader);
+    size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
+    return numbytes + sizeof(PacketHeader);
+}
+
 uint32_t RadioInterface::getPacketTime(const meshtastic_MeshPacket *p)
 {
-    uint32_t pl = 0;
-    if (p->which_payload_variant == meshtastic_MeshPacket_encrypted_tag) {
-        pl = p->encrypted.size + sizeof(PacketHeader);
-    } else {
-        size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
-        pl = numbytes + sizeof(PacketHeader);
-    }
-    return getPacketTime(pl);
+    return getPacketTime(getPacketLength(p));
 }
 
 /** The delay to use for retransmitting dropped packets */
-uint32_t RadioInterface::getRetransmissionMsec(const meshtastic_MeshPacket *p)
+uint32_t RadioInterface::getRetransmissionMsec(uint32_t totalPacketLen)
 {
-    size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
-    uint32_t packetAirtime = getPacketTime(numbytes + sizeof(PacketHeader));
+    uint32_t packetAirtime = getPacketTime(totalPacketLen);
     // Make sure enough time has elapsed for this packet to be sent and an ACK is received.
     // LOG_DEBUG("Waiting for flooding message with airtime %d and slotTime is %d", packetAirtime, slotTimeMsec);
     float channelUtil = airTime->channelUtilizationPercent();
     uint8_t CWsize = map(channelUtil, 0, 100, CWmin, CWmax);
     // Assuming we pick max. of CWsize and there will be a client with SNR at half the range
-    return 2 * packetAirtime + (pow(2, CWsize) + 2 * CWmax + pow(2, int((CWmax + CWmin) / 2))) * slotTimeMsec +
-           PROCESSING_TIME_MSEC;
+    return 2 * packetAirtime + ((1 << CWsize) + 2 * CWmax + (1 << ((CWmax + CWmin) / 2))) * slotTimeMsec + PROCESSING_TIME_MSEC;
 }
 
 /** The delay to use when we want to send something */
@@ -567,6 +586,7 @@ void RadioInterface::applyModemConfig()
     saveFreq(freq + loraConfig.frequency_offset);
 
     slotTimeMsec = computeSlotTimeMsec();
+    buildAirtimeTable();
     preambleTimeMsec = getPacketTime((uint32_t)0);
     maxPacketTimeMsec = getPacketTime(meshtastic_Constants_DATA_PAYLOAD_LEN + sizeof(PacketHeader));
 
@@ -624,10 +644,10 @@ void RadioInterface::limitPower()
     LOG_INFO("Final Tx power: %d dBm", power);
 }
 
-void RadioInterface::deliverToReceiver(meshtastic_MeshPacket *p)
+void RadioInterface::deliverToReceiver(meshtastic_MeshPacket *p, uint32_t irqUsec)
 {
     if (router)
-        router->enqueueReceivedMessage(p);
+        router->enqueueFromRadio(p, irqUsec);
 }
 
 /***
@@ -100,14 +100,25 @@ class RadioInterface
 
     uint32_t computeSlotTimeMsec();
 
+    /// Airtime in msecs by total packet length, so getPacketTime() doesn't evaluate the LoRa formula for every packet
+    uint32_t airtimeTable[MAX_LORA_PAYLOAD_LEN + 1];
+    /// The modem settings airtimeTable was built for
+    float airtimeTableBw = 0;
+    uint8_t airtimeTableSf = 0, airtimeTableCr = 0;
+    uint16_t airtimeTablePreamble = 0;
+
+    /// Fill airtimeTable for the current bw/sf/cr/preambleLength
+    void buildAirtimeTable();
+
     /**
      * A temporary buffer used for sending/receiving packets, sized to hold the biggest buffer we might need
      * */
     RadioBuffer radioBuffer __attribute__((__aligned__));
     /**
      * Enqueue a received packet for the registered receiver
+     * @param irqUsec micros() when the radio signalled the packet
      */
-    void deliverToReceiver(meshtastic_MeshPacket *p);
+    void deliverToReceiver(meshtastic_MeshPacket *p, uint32_t irqUsec);
 
   public:
     /** pool is the pool we will alloc our rx packets from
@@ -169,7 +180,8 @@ class RadioInterface
     virtual bool reconfigure();
 
     /** The delay to use for retransmitting dropped packets */
-    uint32_t getRetransmissionMsec(const meshtastic_MeshPacket *p);
+    uint32_t getRetransmissionMsec(const meshtastic_MeshPacket *p) { return getRetransmissionMsec(getPacketLength(p)); }
+    uint32_t getRetransmissionMsec(uint32_t totalPacketLen);
 
     /** The delay to use when we want to send something */
     uint32_t getTxDelayMsec();
@@ -196,6 +208,12 @@ class RadioInterface
     uint32_t getPacketTime(const meshtastic_MeshPacket *p);
     uint32_t getPacketTime(uint32_t totalPacketLen);
 
+    /// The time-on-air formula itself, which getPacketTime() caches per packet length
+    uint32_t computePacketTime(uint32_t totalPacketLen);
+
+    /// Bytes p takes on air including the header. For a decoded packet, the size of its encoded Data
+    static uint32_t getPacketLength(const meshtastic_MeshPacket *p);
+
     /**
      * Get the channel we saved.
      */
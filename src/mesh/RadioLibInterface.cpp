@@ -1,6 +1,7 @@
 #include "RadioLibInterface.h"
 #include "MeshTypes.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
 #include "PowerMon.h"
 #include "SPILock.h"
 #include "Throttle.h"
@@ -68,6 +69,7 @@ void INTERRUPT_ATTR RadioLibInterface::isrLevel0Common(PendingISR cause)
 
 void INTERRUPT_ATTR RadioLibInterface::isrRxLevel0()
 {
+    instance->rxIrqUsec = micros();
     isrLevel0Common(ISR_RX);
 }
 
@@ -222,8 +224,10 @@ bool RadioLibInterface::isSending()
 bool RadioLibInterface::cancelSending(NodeNum from, PacketId id)
 {
     auto p = txQueue.remove(from, id);
-    if (p)
+    if (p) {
+        packetTrace.record(PTRACE_TX_CANCEL, p, txQueue.getMaxLen() - txQueue.getFree());
         packetPool.release(p); // free the packet we just removed
+    }
 
     bool result = (p != NULL);
     LOG_DEBUG("cancelSending id=0x%x, removed=%d", id, result);
@@ -383,6 +387,7 @@ void RadioLibInterface::completeSending()
         if (!isFromUs(p))
             txRelay++;
         printPacket("Completed sending", p);
+        packetTrace.record(PTRACE_TX_DONE, p, txQueue.getMaxLen() - txQueue.getFree());
 
         // We are done sending that packet, release it
         packetPool.release(p);
@@ -472,10 +477,13 @@ void RadioLibInterface::handleReceiveInterrupt()
             mp->encrypted.size = payloadLen;
 
             printPacket("Lora RX", mp);
+            packetTrace.record(PTRACE_RX, mp);
 
             airTime->logAirtime(RX_LOG, xmitMsec);
+            if (mp->relay_node != NO_RELAY_NODE)
+                airTime->logRelayAirtime(mp->relay_node, xmitMsec);
 
-            deliverToReceiver(mp);
+            deliverToReceiver(mp, rxIrqUsec);
         }
     }
 }
@@ -527,6 +535,7 @@ bool RadioLibInterface::startSend(meshtastic_MeshPacket *txp)
             enableInterrupt(isrTxLevel0);
             lastTxStart = millis();
             printPacket("Started Tx", txp);
+            packetTrace.record(PTRACE_TX_START, txp, txQueue.getMaxLen() - txQueue.getFree());
         }
 
         return res == RADIOLIB_ERR_NONE;
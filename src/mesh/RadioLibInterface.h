@@ -60,6 +60,9 @@ class RadioLibInterface : public RadioInterface, protected concurrency::Notified
 
     MeshPacketQueue txQueue = MeshPacketQueue(MAX_TX_QUEUE);
 
+    /// micros() at the last RX interrupt, so the router can measure how long a packet took to reach it
+    volatile uint32_t rxIrqUsec = 0;
+
   protected:
     /**
      * We use a meshtastic sync word, but hashed with the Channel name.  For releases before 1.2 we used 0x12 (or for very old
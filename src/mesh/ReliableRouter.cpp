@@ -14,6 +14,13 @@
  */
 ErrorCode ReliableRouter::send(meshtastic_MeshPacket *p)
 {
+    /* If we have pending retransmissions, add the airtime of this packet to it, because during that time we cannot receive an
+       (implicit) ACK. Otherwise, we might retransmit too early. Do this before adding the retransmission of p itself, which
+       must not be delayed.
+     */
+    if (!pending.empty())
+        delayRetransmissions(iface->getPacketTime(p));
+
     if (p->want_ack) {
         // If someone asks for acks on broadcast, we need the hop limit to be at least one, so that first node that receives our
         // message will rebroadcast.  But asking for hop_limit 0 in that context means the client app has no preference on hop
@@ -26,15 +33,6 @@ ErrorCode ReliableRouter::send(meshtastic_MeshPacket *p)
         startRetransmission(copy, NUM_RELIABLE_RETX);
     }
 
-    /* If we have pending retransmissions, add the airtime of this packet to it, because during that time we cannot receive an
-       (implicit) ACK. Otherwise, we might retransmit too early.
-     */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        if (i->first.id != p->id) {
-            i->second.nextTxMsec += iface->getPacketTime(p);
-        }
-    }
-
     return isBroadcast(p->to) ? FloodingRouter::send(p) : NextHopRouter::send(p);
 }
 
@@ -58,6 +56,7 @@ bool ReliableRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
             // marked as wantAck
             sendAckNak(meshtastic_Routing_Error_NONE, getFrom(p), p->id, old->packet->channel);
 
+            noteRelayed(p);
             stopRetransmission(key);
         } else {
             LOG_DEBUG("Didn't find pending packet");
@@ -69,9 +68,8 @@ bool ReliableRouter::shouldFilterReceived(const meshtastic_MeshPacket *p)
        because while receiving this packet, we could not have received an (implicit) ACK for it.
        If we don't add this, we will likely retransmit too early.
     */
-    for (auto i = pending.begin(); i != pending.end(); i++) {
-        i->second.nextTxMsec += iface->getPacketTime(p);
-    }
+    if (!pending.empty())
+        delayRetransmissions(iface->getPacketTime(p));
 
     return isBroadcast(p->to) ? FloodingRouter::shouldFilterReceived(p) : NextHopRouter::shouldFilterReceived(p);
 }
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <vector>
+
+/**
+ * Deadlines of pending retransmissions, earliest first.
+ *
+ * This is a binary min-heap of (deadline, key) on a vector, so finding the next retransmission is O(1) and scheduling one is
+ * O(log n), instead of walking every pending packet on each wake. Cancelling is O(1) because entries are never searched for:
+ * schedule() returns a ticket which the owner keeps in its own record, and an entry whose ticket no longer matches (or whose
+ * record is gone) is simply dropped when it reaches the top.
+ *
+ * Tickets are deadlines in the schedule's own time base, which differs from millis() by the sum of all delayAll() calls. That
+ * lets us push back every pending deadline at once without touching (or reordering) the heap. All comparisons are done on
+ * the difference of two times, so they keep working when millis() wraps after 49.7 days, as long as deadlines are less than
+ * 24 days apart.
+ */
+template <class Key> class RetransmitSchedule
+{
+    struct Entry {
+        uint32_t ticket;
+        Key key;
+    };
+
+    /// std heap functions build a max-heap, so "less" means "later"
+    static bool later(const Entry &a, const Entry &b) { return isAfter(a.ticket, b.ticket); }
+
+    std::vector<Entry> heap;
+
+    /// Added to every ticket to get the deadline in millis()
+    uint32_t delayMsec = 0;
+
+  public:
+    /** True if time a is after time b, allowing for the 32 bit msec counter to wrap */
+    static bool isAfter(uint32_t a, uint32_t b) { return (int32_t)(a - b) > 0; }
+
+    /** Add a deadline for key at millis() time atMsec, returns the ticket for it */
+    uint32_t schedule(const Key &key, uint32_t atMsec)
+    {
+        uint32_t ticket = atMsec - delayMsec;
+        heap.push_back(Entry{ticket, key});
+        std::push_heap(heap.begin(), heap.end(), later);
+        return ticket;
+    }
+
+    /** Push back the deadline of everything scheduled so far */
+    void delayAll(uint32_t msec) { delayMsec += msec; }
+
+    /** The millis() time of a ticket */
+    uint32_t deadline(uint32_t ticket) const { return ticket + delayMsec; }
+
+    bool empty() const { return heap.empty(); }
+
+    /** Number of entries, including the stale ones which haven't been dropped yet */
+    size_t size() const { return heap.size(); }
+
+    /** The earliest entry, the heap must not be empty */
+    const Key &nextKey() const { return heap.front().key; }
+    uint32_t nextTicket() const { return heap.front().ticket; }
+
+    /** Remove the earliest entry */
+    void pop()
+    {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        heap.pop_back();
+    }
+
+    /** Drop every entry for which isStale(key, ticket) is true, for when cancelled entries pile up. O(n). */
+    template <class F> void removeIf(F isStale)
+    {
+        heap.erase(std::remove_if(heap.begin(), heap.end(), [&](const Entry &e) { return isStale(e.key, e.ticket); }),
+                   heap.end());
+        std::make_heap(heap.begin(), heap.end(), later);
+    }
+
+    void clear()
+    {
+        heap.clear();
+        delayMsec = 0;
+    }
+};
@@ -4,6 +4,8 @@
 #include "MeshRadio.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "PacketTrace.h"
+#include "PayloadCompression.h"
 #include "RTC.h"
 #include "configuration.h"
 #include "detect/LoRaRadioType.h"
@@ -16,15 +18,13 @@
 #endif
 #include "Default.h"
 #if ARCH_PORTDUINO
+#include "DecodePool.h"
 #include "platform/portduino/PortduinoGlue.h"
 #endif
 #if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
 #include "serialization/MeshPacketSerializer.h"
 #endif
 
-#define MAX_RX_FROMRADIO                                                                                                         \
-    4 // max number of packets destined to our queue, we dispatch packets quickly so it doesn't need to be big
-
 // I think this is right, one packet for each of the three fifos + one packet being currently assembled for TX or RX
 // And every TX packet might have a retransmission packet or an ack alive at any moment
 #define MAX_PACKETS                                                                                                              \
@@ -32,7 +32,7 @@
      2) // max number of packets which can be in flight (either queued from reception or queued for sending)
 
 // static MemoryPool<MeshPacket> staticPool(MAX_PACKETS);
-static MemoryDynamic<meshtastic_MeshPacket> staticPool;
+static MemoryRefCounted<meshtastic_MeshPacket> staticPool;
 
 Allocator<meshtastic_MeshPacket> &packetPool = staticPool;
 
@@ -51,32 +51,186 @@ Router::Router() : concurrency::OSThread("Router"), fromRadioQueue(MAX_RX_FROMRA
     LOG_DEBUG("Size of SubPacket %d", sizeof(SubPacket));
     LOG_DEBUG("Size of MeshPacket %d", sizeof(MeshPacket)); */
 
+    fromRadioRing.setReader(this);
     fromRadioQueue.setReader(this);
 
     // init Lockguard for crypt operations
     assert(!cryptLock);
     cryptLock = new concurrency::Lock();
+    initPayloadCompression();
+
+#if ARCH_PORTDUINO
+    if (settingsMap[decode_threads] > 0)
+        decodePool = new DecodePool(settingsMap[decode_threads]);
+#endif
 }
 
 /**
  * do idle processing
  * Mostly looking in our incoming rxPacket queue and calling handleReceived.
+ *
+ * Packets are handled in batches of up to RX_BURST_MAX_PACKETS, for up to RX_BURST_MAX_USEC per wake. If that budget runs
+ * out with packets still queued we ask to be run again right away, so other threads get a turn in between.
  */
 int32_t Router::runOnce()
 {
-    meshtastic_MeshPacket *mp;
-    while ((mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
-        // printPacket("handle fromRadioQ", mp);
-        perhapsHandleReceived(mp);
+    uint32_t depth = rxQueueDepth();
+    if (depth) {
+        rxBurstStats.queueDepth[RxBurstStats::bucketFor(depth)]++;
+        if (depth > rxBurstStats.maxQueueDepth)
+            rxBurstStats.maxQueueDepth = depth;
+    }
+
+    uint32_t start = micros();
+    while (micros() - start < RX_BURST_MAX_USEC) {
+        fillRxBatch();
+        if (rxBatchLen == 0)
+            break;
+        rxBurstStats.batchSize[RxBurstStats::bucketFor(rxBatchLen)]++;
+
+        decodeBatch();
+        for (size_t i = 0; i < rxBatchLen; i++) {
+            // printPacket("handle fromRadioQ", rxBatch[i].p);
+            if (rxBatch[i].fromRadio)
+                rxLatencyStats.add(micros() - rxBatch[i].irqUsec);
+            perhapsHandleReceived(rxBatch[i].p);
+            // If the packet was dropped before handleReceived, the copy we made for MQTT wasn't needed after all
+            if (rxBatch[i].encrypted)
+                packetPool.release(rxBatch[i].encrypted);
+            // Both are freed now, and packets we allocate for the rest of the batch may get the same address
+            rxBatch[i].p = NULL;
+            rxBatch[i].encrypted = NULL;
+        }
+        rxBatchLen = 0;
+    }
+
+    if (!fromRadioRing.empty() || !fromRadioQueue.isEmpty()) {
+        rxBurstStats.budgetExhausted++;
+        return 0;
     }
 
     // LOG_DEBUG("Sleep forever!");
     return INT32_MAX; // Wait a long time - until we get woken for the message queue
 }
 
+void Router::fillRxBatch()
+{
+    rxBatchLen = 0;
+    RxFromRadio rx;
+    while (rxBatchLen < RX_BURST_MAX_PACKETS && fromRadioRing.pop(&rx)) {
+        rxBatch[rxBatchLen] = {rx.p, NULL, DECODE_FAILURE, true, rx.irqUsec};
+        rxBatchLen++;
+    }
+    meshtastic_MeshPacket *mp;
+    while (rxBatchLen < RX_BURST_MAX_PACKETS && (mp = fromRadioQueue.dequeuePtr(0)) != NULL) {
+        rxBatch[rxBatchLen] = {mp, NULL, DECODE_FAILURE, false, 0};
+        rxBatchLen++;
+    }
+}
+
+/// Changes whenever the node keys or channels used for decoding may have changed
+static uint32_t decodeInputsVersion()
+{
+    return nodeDB->getUsersVersion() + channels.getVersion();
+}
+
+void Router::decodeBatch()
+{
+    concurrency::LockGuard g(cryptLock);
+
+    meshtastic_MeshPacket *toDecode[RX_BURST_MAX_PACKETS];
+    DecodeState states[RX_BURST_MAX_PACKETS];
+    size_t indexes[RX_BURST_MAX_PACKETS];
+    size_t numToDecode = 0;
+
+    rxBatchVersion = decodeInputsVersion();
+    for (size_t i = 0; i < rxBatchLen; i++) {
+        meshtastic_MeshPacket *p = rxBatch[i].p;
+        // Only decode what perhapsHandleReceived() will let through. shouldFilterReceived() only drops packets we've seen
+        // recently, so check that without recording it, it still has to see them first
+        if (p->which_payload_variant != meshtastic_MeshPacket_encrypted_tag || isIgnored(p, false) ||
+            wasSeenRecently(p, false))
+            continue;
+
+        // A second copy of a packet within the same batch is a dupe too
+        bool dupeInBatch = false;
+        for (size_t j = 0; j < i; j++)
+            if (rxBatch[j].p->from == p->from && rxBatch[j].p->id == p->id)
+                dupeInBatch = true;
+        if (dupeInBatch)
+            continue;
+
+        rxBatch[i].encrypted = packetPool.allocCopy(*p);
+        toDecode[numToDecode] = p;
+        indexes[numToDecode] = i;
+        numToDecode++;
+    }
+
+#if ARCH_PORTDUINO
+    if (decodePool && numToDecode > 1)
+        decodePool->decodeAll(toDecode, states, numToDecode);
+    else
+#endif
+        for (size_t k = 0; k < numToDecode; k++)
+            states[k] = perhapsDecodeLocked(toDecode[k]);
+
+    for (size_t k = 0; k < numToDecode; k++)
+        rxBatch[indexes[k]].decodeState = states[k];
+}
+
+Router::RxBatchEntry *Router::findInBatch(const meshtastic_MeshPacket *p)
+{
+    for (size_t i = 0; i < rxBatchLen; i++)
+        if (rxBatch[i].p == p)
+            return &rxBatch[i];
+    return NULL;
+}
+
+void Router::logRxBurstStats() const
+{
+    const RxBurstStats &s = rxBurstStats;
+    LOG_INFO("RX burst: max queue depth=%u, budget exhausted=%u, queue overflows=%u", s.maxQueueDepth, s.budgetExhausted,
+             s.queueOverflows);
+    LOG_INFO("RX burst: queue depth hist [1]=%u [2-3]=%u [4-7]=%u [8-15]=%u [16-31]=%u [32+]=%u", s.queueDepth[1],
+             s.queueDepth[2], s.queueDepth[3], s.queueDepth[4], s.queueDepth[5], s.queueDepth[6] + s.queueDepth[7]);
+    LOG_INFO("RX burst: batch size hist [1]=%u [2-3]=%u [4-7]=%u [8+]=%u", s.batchSize[1], s.batchSize[2], s.batchSize[3],
+             s.batchSize[4] + s.batchSize[5] + s.batchSize[6] + s.batchSize[7]);
+
+    const AllocatorStats &pool = packetPool.getStats();
+    LOG_INFO("Packet pool: live=%u high water=%u, copies=%u (%u bytes), shared=%u", (uint32_t)pool.live,
+             (uint32_t)pool.highWater, (uint32_t)pool.copies, (uint32_t)pool.copiedBytes, (uint32_t)pool.shares);
+
+    const RxLatencyStats &l = rxLatencyStats;
+    if (l.count) {
+        uint32_t under1ms = 0, under16ms = 0, under128ms = 0;
+        for (uint8_t b = 0; b < RxLatencyStats::NUM_BUCKETS; b++) {
+            if (b <= 10)
+                under1ms += l.hist[b];
+            else if (b <= 14)
+                under16ms += l.hist[b];
+            else if (b <= 17)
+                under128ms += l.hist[b];
+        }
+        LOG_INFO("RX latency: irq to handled avg=%uus max=%uus, <1ms=%u <16ms=%u <128ms=%u longer=%u",
+                 (uint32_t)(l.totalUsec / l.count), l.maxUsec, under1ms, under16ms, under128ms,
+                 l.count - under1ms - under16ms - under128ms);
+    }
+}
+
+void Router::enqueueFromRadio(meshtastic_MeshPacket *p, uint32_t irqUsec)
+{
+    // Only the router takes packets out of the ring, so when it is full we drop this packet rather than the oldest
+    if (!fromRadioRing.push({p, irqUsec})) {
+        printPacket("fromRadio ring full, drop!", p);
+        packetTrace.record(PTRACE_RX_QUEUE_DROP, p, fromRadioRing.size());
+        packetPool.release(p);
+        rxBurstStats.queueOverflows++;
+    }
+}
+
 /**
- * RadioInterface calls this to queue up packets that have been received from the radio.  The router is now responsible for
- * freeing the packet
+ * Queue up a packet to be handled as if received, from anything but our radio.  The router is now responsible for freeing the
+ * packet
  */
 void Router::enqueueReceivedMessage(meshtastic_MeshPacket *p)
 {
@@ -86,7 +240,9 @@ void Router::enqueueReceivedMessage(meshtastic_MeshPacket *p)
         old_p = fromRadioQueue.dequeuePtr(0); // Dequeue and discard the oldest packet
         if (old_p) {
             printPacket("fromRadioQ full, drop oldest!", old_p);
+            packetTrace.record(PTRACE_RX_QUEUE_DROP, old_p, rxQueueDepth());
             packetPool.release(old_p);
+            rxBurstStats.queueOverflows++;
         }
     }
     // Nasty hack because our threading is primitive.  interfaces shouldn't need to know about routers FIXME
@@ -274,22 +430,27 @@ ErrorCode Router::send(meshtastic_MeshPacket *p)
     // If the packet is not yet encrypted, do so now
     if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag) {
         ChannelIndex chIndex = p->channel; // keep as a local because we are about to change it
-        meshtastic_MeshPacket *p_decoded = packetPool.allocCopy(*p);
+        // Only MQTT needs the packet as it was before encryption, and only if we're the original transmitter of it
+        meshtastic_MeshPacket *p_decoded = NULL;
+#if !MESHTASTIC_EXCLUDE_MQTT
+        if (moduleConfig.mqtt.enabled && isFromUs(p) && mqtt)
+            p_decoded = packetPool.allocCopy(*p);
+#endif
 
         auto encodeResult = perhapsEncode(p);
         if (encodeResult != meshtastic_Routing_Error_NONE) {
-            packetPool.release(p_decoded);
+            if (p_decoded)
+                packetPool.release(p_decoded);
             p->channel = 0; // Reset the channel to 0, so we don't use the failing hash again
             abortSendAndNak(encodeResult, p);
             return encodeResult; // FIXME - this isn't a valid ErrorCode
         }
+        if (p_decoded) {
 #if !MESHTASTIC_EXCLUDE_MQTT
-        // Only publish to MQTT if we're the original transmitter of the packet
-        if (moduleConfig.mqtt.enabled && isFromUs(p) && mqtt) {
             mqtt->onSend(*p, *p_decoded, chIndex);
-        }
 #endif
-        packetPool.release(p_decoded);
+            packetPool.release(p_decoded);
+        }
     }
 
 #if HAS_UDP_MULTICAST
@@ -331,13 +492,20 @@ void Router::sniffReceived(const meshtastic_MeshPacket *p, const meshtastic_Rout
 DecodeState perhapsDecode(meshtastic_MeshPacket *p)
 {
     concurrency::LockGuard g(cryptLock);
+    return perhapsDecodeLocked(p);
+}
 
+DecodeState perhapsDecodeLocked(meshtastic_MeshPacket *p)
+{
     if (config.device.role == meshtastic_Config_DeviceConfig_Role_REPEATER &&
         config.device.rebroadcast_mode == meshtastic_Config_DeviceConfig_RebroadcastMode_ALL_SKIP_DECODING)
         return DecodeState::DECODE_FAILURE;
 
+    // Look the sender up once, rather than walking the NodeDB for each check below
+    meshtastic_NodeInfoLite *fromNode = nodeDB->getMeshNode(p->from);
+
     if (config.device.rebroadcast_mode == meshtastic_Config_DeviceConfig_RebroadcastMode_KNOWN_ONLY &&
-        (nodeDB->getMeshNode(p->from) == NULL || !nodeDB->getMeshNode(p->from)->has_user)) {
+        (fromNode == NULL || !fromNode->has_user)) {
         LOG_DEBUG("Node 0x%x not in nodeDB-> Rebroadcast mode KNOWN_ONLY will ignore packet", p->from);
         return DecodeState::DECODE_FAILURE;
     }
@@ -345,8 +513,13 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
     if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag)
         return DecodeState::DECODE_SUCCESS; // If packet was already decoded just return
 
+    // Everything below only uses locals (rather than the static bytes[] and the crypto engine's key/nonce), so packets can
+    // be decoded on several threads at once, see DecodePool
+    uint8_t scratch[MAX_LORA_PAYLOAD_LEN + 1] __attribute__((__aligned__));
+    CryptoContext ctx;
+
     size_t rawSize = p->encrypted.size;
-    if (rawSize > sizeof(bytes)) {
+    if (rawSize > sizeof(scratch)) {
         LOG_ERROR("Packet too large to attempt decryption! (rawSize=%d > 256)", rawSize);
         return DecodeState::DECODE_FATAL;
     }
@@ -354,24 +527,23 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
     ChannelIndex chIndex = 0;
 #if !(MESHTASTIC_EXCLUDE_PKI)
     // Attempt PKI decryption first
-    if (p->channel == 0 && isToUs(p) && p->to > 0 && !isBroadcast(p->to) && nodeDB->getMeshNode(p->from) != nullptr &&
-        nodeDB->getMeshNode(p->from)->user.public_key.size > 0 && nodeDB->getMeshNode(p->to)->user.public_key.size > 0 &&
+    if (p->channel == 0 && isToUs(p) && p->to > 0 && !isBroadcast(p->to) && fromNode != nullptr &&
+        fromNode->user.public_key.size > 0 && nodeDB->getMeshNode(p->to)->user.public_key.size > 0 &&
         rawSize > MESHTASTIC_PKC_OVERHEAD) {
         LOG_DEBUG("Attempt PKI decryption");
 
-        if (crypto->decryptCurve25519(p->from, nodeDB->getMeshNode(p->from)->user.public_key, p->id, rawSize, p->encrypted.bytes,
-                                      bytes)) {
+        if (crypto->decryptCurve25519(ctx, p->from, fromNode->user.public_key, p->id, rawSize, p->encrypted.bytes, scratch)) {
             LOG_INFO("PKI Decryption worked!");
 
             meshtastic_Data decodedtmp;
             memset(&decodedtmp, 0, sizeof(decodedtmp));
             rawSize -= MESHTASTIC_PKC_OVERHEAD;
-            if (pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp) &&
-                decodedtmp.portnum != meshtastic_PortNum_UNKNOWN_APP) {
+            if (pb_decode_from_bytes(scratch, rawSize, &meshtastic_Data_msg, &decodedtmp) &&
+                decodedtmp.portnum != meshtastic_PortNum_UNKNOWN_APP && decompressReceived(p, decodedtmp)) {
                 decrypted = true;
                 LOG_INFO("Packet decrypted using PKI!");
                 p->pki_encrypted = true;
-                memcpy(&p->public_key.bytes, nodeDB->getMeshNode(p->from)->user.public_key.bytes, 32);
+                memcpy(&p->public_key.bytes, fromNode->user.public_key.bytes, 32);
                 p->public_key.size = 32;
                 p->decoded = decodedtmp;
                 p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
@@ -390,22 +562,26 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
         // Try to find a channel that works with this hash
         for (chIndex = 0; chIndex < channels.getNumChannels(); chIndex++) {
             // Try to use this hash/channel pair
-            if (channels.decryptForHash(chIndex, p->channel)) {
+            CryptoKey key;
+            if (channels.getKeyForHash(chIndex, p->channel, key)) {
+                LOG_DEBUG("Use channel %d (hash 0x%x)", chIndex, p->channel);
                 // we have to copy into a scratch buffer, because these bytes are a union with the decoded protobuf. Create a
                 // fresh copy for each decrypt attempt.
-                memcpy(bytes, p->encrypted.bytes, rawSize);
+                memcpy(scratch, p->encrypted.bytes, rawSize);
                 // Try to decrypt the packet if we can
-                crypto->decrypt(p->from, p->id, rawSize, bytes);
+                crypto->decrypt(key, ctx, p->from, p->id, rawSize, scratch);
 
-                // printBytes("plaintext", bytes, p->encrypted.size);
+                // printBytes("plaintext", scratch, p->encrypted.size);
 
                 // Take those raw bytes and convert them back into a well structured protobuf we can understand
                 meshtastic_Data decodedtmp;
                 memset(&decodedtmp, 0, sizeof(decodedtmp));
-                if (!pb_decode_from_bytes(bytes, rawSize, &meshtastic_Data_msg, &decodedtmp)) {
+                if (!pb_decode_from_bytes(scratch, rawSize, &meshtastic_Data_msg, &decodedtmp)) {
                     LOG_ERROR("Invalid protobufs in received mesh packet id=0x%08x (bad psk?)!", p->id);
                 } else if (decodedtmp.portnum == meshtastic_PortNum_UNKNOWN_APP) {
                     LOG_ERROR("Invalid portnum (bad psk?)!");
+                } else if (!decompressReceived(p, decodedtmp)) {
+                    LOG_ERROR("Invalid compressed payload in mesh packet id=0x%08x!", p->id);
                 } else {
                     p->decoded = decodedtmp;
                     p->which_payload_variant = meshtastic_MeshPacket_decoded_tag; // change type to decoded
@@ -421,26 +597,6 @@ DecodeState perhapsDecode(meshtastic_MeshPacket *p)
         if (p->decoded.has_bitfield)
             p->decoded.want_response |= p->decoded.bitfield & BITFIELD_WANT_RESPONSE_MASK;
 
-        /* Not actually ever used.
-        // Decompress if needed. jm
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP) {
-            // Decompress the payload
-            char compressed_in[meshtastic_Constants_DATA_PAYLOAD_LEN] = {};
-            char decompressed_out[meshtastic_Constants_DATA_PAYLOAD_LEN] = {};
-            int decompressed_len;
-
-            memcpy(compressed_in, p->decoded.payload.bytes, p->decoded.payload.size);
-
-            decompressed_len = unishox2_decompress_simple(compressed_in, p->decoded.payload.size, decompressed_out);
-
-            // LOG_DEBUG("**Decompressed length - %d ", decompressed_len);
-
-            memcpy(p->decoded.payload.bytes, decompressed_out, decompressed_len);
-
-            // Switch the port from PortNum_TEXT_MESSAGE_COMPRESSED_APP to PortNum_TEXT_MESSAGE_APP
-            p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
-        } */
-
         printPacket("decoded message", p);
 #if ENABLE_JSON_LOGGING
         LOG_TRACE("%s", MeshPacketSerializer::JsonSerialize(p, false).c_str());
@@ -470,44 +626,20 @@ meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p)
             p->decoded.has_bitfield = true;
             p->decoded.bitfield |= (config.lora.config_ok_to_mqtt << BITFIELD_OK_TO_MQTT_SHIFT);
             p->decoded.bitfield |= (p->decoded.want_response << BITFIELD_WANT_RESPONSE_SHIFT);
+            if (p->decoded.portnum == meshtastic_PortNum_NODEINFO_APP)
+                p->decoded.bitfield |= BITFIELD_CAN_DECOMPRESS_MASK;
         }
 
-        size_t numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
-
-        /* Not actually used, so save the cycles
-        //  TODO: Allow modules to opt into compression.
-        if (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP) {
-
-            char original_payload[meshtastic_Constants_DATA_PAYLOAD_LEN];
-            memcpy(original_payload, p->decoded.payload.bytes, p->decoded.payload.size);
-
-            char compressed_out[meshtastic_Constants_DATA_PAYLOAD_LEN] = {0};
-
-            int compressed_len;
-            compressed_len = unishox2_compress_simple(original_payload, p->decoded.payload.size, compressed_out);
-
-            LOG_DEBUG("Original length - %d ", p->decoded.payload.size);
-            LOG_DEBUG("Compressed length - %d ", compressed_len);
-            LOG_DEBUG("Original message - %s ", p->decoded.payload.bytes);
-
-            // If the compressed length is greater than or equal to the original size, don't use the compressed form
-            if (compressed_len >= p->decoded.payload.size) {
-
-                LOG_DEBUG("Not using compressing message");
-                // Set the uncompressed payload variant anyway. Shouldn't hurt?
-                // p->decoded.which_payloadVariant = Data_payload_tag;
-
-                // Otherwise we use the compressor
-            } else {
-                LOG_DEBUG("Use compressed message");
-                // Copy the compressed data into the meshpacket
-
-                p->decoded.payload.size = compressed_len;
-                memcpy(p->decoded.payload.bytes, compressed_out, compressed_len);
-
-                p->decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_COMPRESSED_APP;
-            }
-        } */
+        size_t numbytes;
+        // Relays compress again what came to us compressed, so it doesn't grow (or stop fitting) on the next hop
+        if (isFromUs(p) ? shouldCompressPayload(p) : wasReceivedCompressed(p->from, p->id)) {
+            // Compress a copy, so p->decoded stays readable if we fail below
+            meshtastic_Data compressed = p->decoded;
+            compressPayload(compressed); // left as is if it wouldn't get smaller
+            numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &compressed);
+        } else {
+            numbytes = pb_encode_to_bytes(bytes, sizeof(bytes), &meshtastic_Data_msg, &p->decoded);
+        }
 
         if (numbytes + MESHTASTIC_HEADER_LENGTH > MAX_LORA_PAYLOAD_LEN)
             return meshtastic_Routing_Error_TOO_LARGE;
@@ -617,11 +749,25 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     bool skipHandle = false;
     // Also, we should set the time from the ISR and it should have msec level resolution
     p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-    // Store a copy of encrypted packet for MQTT
-    meshtastic_MeshPacket *p_encrypted = packetPool.allocCopy(*p);
+    meshtastic_MeshPacket *p_encrypted;
+    DecodeState decodedState;
+    RxBatchEntry *batched = findInBatch(p);
+    if (batched && batched->encrypted) {
+        // Already decoded along with the rest of its batch, take over the encrypted copy
+        p_encrypted = batched->encrypted;
+        batched->encrypted = NULL;
+        decodedState = batched->decodeState;
+        // A packet handled earlier in the batch may have brought what this one needs, e.g. a NodeInfo with the public key
+        // of a following DM. A failed decrypt leaves p as it was, so try again
+        if (decodedState == DecodeState::DECODE_FAILURE && rxBatchVersion != decodeInputsVersion())
+            decodedState = perhapsDecode(p);
+    } else {
+        // Store a copy of encrypted packet for MQTT
+        p_encrypted = packetPool.allocCopy(*p);
 
-    // Take those raw bytes and convert them back into a well structured protobuf we can understand
-    auto decodedState = perhapsDecode(p);
+        // Take those raw bytes and convert them back into a well structured protobuf we can understand
+        decodedState = perhapsDecode(p);
+    }
     if (decodedState == DecodeState::DECODE_FATAL) {
         // Fatal decoding error, we can't do anything with this packet
         LOG_WARN("Fatal decode error, dropping packet");
@@ -662,6 +808,14 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     } else {
         printPacket("packet decoding failed or skipped (no PSK?)", p);
     }
+    packetTrace.record(decodedState == DecodeState::DECODE_SUCCESS ? PTRACE_HANDLED : PTRACE_DECODE_FAIL, p, rxQueueDepth());
+
+    // Account the airtime to whoever originated it, so a busy channel can be traced back to nodes and apps
+    if (src == RX_SRC_RADIO && iface && airTime) {
+        meshtastic_PortNum portnum =
+            decodedState == DecodeState::DECODE_SUCCESS ? p->decoded.portnum : meshtastic_PortNum_UNKNOWN_APP;
+        airTime->logSourceAirtime(getFrom(p), portnum, iface->getPacketTime(p_encrypted));
+    }
 
     // call modules here
     if (!skipHandle) {
@@ -683,41 +837,55 @@ void Router::handleReceived(meshtastic_MeshPacket *p, RxSource src)
     packetPool.release(p_encrypted); // Release the encrypted packet
 }
 
-void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
+bool Router::isIgnored(const meshtastic_MeshPacket *p, bool logWhy)
 {
-#if ENABLE_JSON_LOGGING
-    // Even ignored packets get logged in the trace
-    p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-    LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
-#elif ARCH_PORTDUINO
-    // Even ignored packets get logged in the trace
-    if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
-        p->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
-        LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(p).c_str());
-    }
-#endif
     // assert(radioConfig.has_preferences);
     if (is_in_repeated(config.lora.ignore_incoming, p->from)) {
-        LOG_DEBUG("Ignore msg, 0x%x is in our ignore list", p->from);
-        packetPool.release(p);
-        return;
+        if (logWhy)
+            LOG_DEBUG("Ignore msg, 0x%x is in our ignore list", p->from);
+        return true;
     }
 
     meshtastic_NodeInfoLite const *node = nodeDB->getMeshNode(p->from);
     if (node != NULL && node->is_ignored) {
-        LOG_DEBUG("Ignore msg, 0x%x is ignored", p->from);
-        packetPool.release(p);
-        return;
+        if (logWhy)
+            LOG_DEBUG("Ignore msg, 0x%x is ignored", p->from);
+        return true;
     }
 
     if (p->from == NODENUM_BROADCAST) {
-        LOG_DEBUG("Ignore msg from broadcast address");
-        packetPool.release(p);
-        return;
+        if (logWhy)
+            LOG_DEBUG("Ignore msg from broadcast address");
+        return true;
     }
 
     if (config.lora.ignore_mqtt && p->via_mqtt) {
-        LOG_DEBUG("Msg came in via MQTT from 0x%x", p->from);
+        if (logWhy)
+            LOG_DEBUG("Msg came in via MQTT from 0x%x", p->from);
+        return true;
+    }
+    return false;
+}
+
+void Router::perhapsHandleReceived(meshtastic_MeshPacket *p)
+{
+#if ENABLE_JSON_LOGGING || ARCH_PORTDUINO
+    // If it was decoded ahead as part of a batch, the trace still wants the encrypted form
+    RxBatchEntry *batched = findInBatch(p);
+    meshtastic_MeshPacket *traced = (batched && batched->encrypted) ? batched->encrypted : p;
+#endif
+#if ENABLE_JSON_LOGGING
+    // Even ignored packets get logged in the trace
+    p->rx_time = traced->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
+    LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(traced).c_str());
+#elif ARCH_PORTDUINO
+    // Even ignored packets get logged in the trace
+    if (settingsStrings[traceFilename] != "" || settingsMap[logoutputlevel] == level_trace) {
+        p->rx_time = traced->rx_time = getValidTime(RTCQualityFromNet); // store the arrival timestamp for the phone
+        LOG_TRACE("%s", MeshPacketSerializer::JsonSerializeEncrypted(traced).c_str());
+    }
+#endif
+    if (isIgnored(p, true)) {
         packetPool.release(p);
         return;
     }
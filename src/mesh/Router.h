@@ -8,6 +8,89 @@
 #include "PointerQueue.h"
 #include "RadioInterface.h"
 #include "concurrency/OSThread.h"
+#include "concurrency/SpscRing.h"
+
+// max number of packets destined to our queue, we dispatch packets quickly so it doesn't need to be big. On portduino MQTT
+// downlink and UDP multicast can deliver far faster than LoRa, so allow deeper bursts there. Must be a power of 2
+#ifndef MAX_RX_FROMRADIO
+#if ARCH_PORTDUINO
+#define MAX_RX_FROMRADIO 32
+#else
+#define MAX_RX_FROMRADIO 4
+#endif
+#endif
+
+/// Max number of received packets we pull off fromRadioQueue and decode together as one batch
+#ifndef RX_BURST_MAX_PACKETS
+#if ARCH_PORTDUINO
+#define RX_BURST_MAX_PACKETS 8
+#else
+#define RX_BURST_MAX_PACKETS 4
+#endif
+#endif
+
+/// Once a wake has spent this long on received packets we yield, even if more are queued
+#ifndef RX_BURST_MAX_USEC
+#define RX_BURST_MAX_USEC 20000
+#endif
+
+enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
+
+class DecodePool;
+
+/**
+ * Counters for how bursty our receive path is, kept as log2 bucketed histograms
+ * (bucket 0 is 0, bucket 1 is 1, bucket 2 is 2-3, bucket 3 is 4-7...)
+ */
+struct RxBurstStats {
+    static constexpr uint8_t NUM_BUCKETS = 8;
+
+    /// fromRadioQueue depth seen when the router woke up
+    uint32_t queueDepth[NUM_BUCKETS] = {0};
+    /// Number of packets handled per batch
+    uint32_t batchSize[NUM_BUCKETS] = {0};
+    /// Deepest fromRadioQueue we have seen
+    uint32_t maxQueueDepth = 0;
+    /// Number of wakes where we yielded with packets still queued
+    uint32_t budgetExhausted = 0;
+    /// Number of packets dropped because fromRadioQueue was full
+    uint32_t queueOverflows = 0;
+
+    static uint8_t bucketFor(uint32_t n)
+    {
+        uint8_t b = 0;
+        while (n && b < NUM_BUCKETS - 1) {
+            n >>= 1;
+            b++;
+        }
+        return b;
+    }
+};
+
+/**
+ * Time from the radio's RX interrupt until the router starts handling the packet, as a log2 histogram
+ * (bucket b counts latencies below 2^b usec, the last bucket also everything longer)
+ */
+struct RxLatencyStats {
+    static constexpr uint8_t NUM_BUCKETS = 20;
+
+    uint32_t hist[NUM_BUCKETS] = {0};
+    uint32_t count = 0;
+    uint32_t maxUsec = 0;
+    uint64_t totalUsec = 0;
+
+    void add(uint32_t usec)
+    {
+        uint8_t b = 0;
+        while ((usec >> b) && b < NUM_BUCKETS - 1)
+            b++;
+        hist[b]++;
+        count++;
+        totalUsec += usec;
+        if (usec > maxUsec)
+            maxUsec = usec;
+    }
+};
 
 /**
  * A mesh aware router that supports multiple interfaces.
@@ -15,8 +98,17 @@
 class Router : protected concurrency::OSThread, protected PacketHistory
 {
   private:
+    /// A packet from our radio, with micros() of its RX interrupt
+    struct RxFromRadio {
+        meshtastic_MeshPacket *p;
+        uint32_t irqUsec;
+    };
+
     /// Packets which have just arrived from the radio, ready to be processed by this service and possibly
-    /// forwarded to the phone.
+    /// forwarded to the phone. The radio is the only producer, so this needs no locking
+    concurrency::SpscRing<RxFromRadio, MAX_RX_FROMRADIO> fromRadioRing;
+
+    /// Packets to handle as if received that came from anywhere else: MQTT, UDP multicast, or ourselves
     PointerQueue<meshtastic_MeshPacket> fromRadioQueue;
 
   protected:
@@ -72,11 +164,18 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     void setReceivedMessage();
 
     /**
-     * RadioInterface calls this to queue up packets that have been received from the radio.  The router is now responsible for
-     * freeing the packet
+     * Queue up a packet to be handled as if it was received, from anything other than our radio (MQTT, UDP multicast, packets
+     * to ourselves). The router is now responsible for freeing the packet
      */
     virtual void enqueueReceivedMessage(meshtastic_MeshPacket *p);
 
+    /**
+     * RadioInterface calls this to queue up packets that have been received from the radio.  The router is now responsible for
+     * freeing the packet. Must only be called from the radio's thread
+     * @param irqUsec micros() of the RX interrupt, for getRxLatencyStats()
+     */
+    void enqueueFromRadio(meshtastic_MeshPacket *p, uint32_t irqUsec);
+
     /**
      * Send a packet on a suitable interface.  This routine will
      * later free() the packet to pool.  This routine is not allowed to stall.
@@ -91,6 +190,15 @@ class Router : protected concurrency::OSThread, protected PacketHistory
         before us */
     uint32_t rxDupe = 0, txRelayCanceled = 0;
 
+    /** Histograms of our receive queue depth and batch sizes */
+    const RxBurstStats &getRxBurstStats() const { return rxBurstStats; }
+
+    /** Histogram of how long packets from the radio waited before we handled them */
+    const RxLatencyStats &getRxLatencyStats() const { return rxLatencyStats; }
+
+    /** Log the receive burst histograms */
+    void logRxBurstStats() const;
+
   protected:
     friend class RoutingModule;
 
@@ -116,6 +224,46 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     void sendAckNak(meshtastic_Routing_Error err, NodeNum to, PacketId idFrom, ChannelIndex chIndex, uint8_t hopLimit = 0);
 
   private:
+    /// A packet pulled off fromRadioRing or fromRadioQueue as part of the current batch
+    struct RxBatchEntry {
+        meshtastic_MeshPacket *p;
+        /// Copy of the still encrypted packet for MQTT, made when we decoded ahead. NULL if we didn't decode ahead
+        meshtastic_MeshPacket *encrypted;
+        DecodeState decodeState;
+        /// Whether it came from our radio, and micros() of its RX interrupt if so
+        bool fromRadio;
+        uint32_t irqUsec;
+    };
+
+    RxBatchEntry rxBatch[RX_BURST_MAX_PACKETS];
+    size_t rxBatchLen = 0;
+    RxBurstStats rxBurstStats;
+    RxLatencyStats rxLatencyStats;
+
+    /// Packets waiting in fromRadioRing and fromRadioQueue
+    uint32_t rxQueueDepth() { return fromRadioRing.size() + fromRadioQueue.numUsed(); }
+
+    /// Fill rxBatch, radio packets first
+    void fillRxBatch();
+
+    /// Worker threads decoding batches in parallel, NULL to decode on our own thread
+    DecodePool *decodePool = NULL;
+
+    /**
+     * Decode all packets of the current batch that will certainly be handled, while holding cryptLock only once.
+     * Dupes and ignored packets are left alone, because the relay logic for those expects the packet to still be encrypted.
+     */
+    void decodeBatch();
+
+    /// decodeInputsVersion() when the current batch was decoded
+    uint32_t rxBatchVersion = 0;
+
+    /** Whether p comes from a node, or via a path, we ignore. Doesn't change any state */
+    bool isIgnored(const meshtastic_MeshPacket *p, bool logWhy);
+
+    /** Return the current batch entry for p, or NULL if p wasn't received as part of the current batch */
+    RxBatchEntry *findInBatch(const meshtastic_MeshPacket *p);
+
     /**
      * Called from loop()
      * Handle any packet that is received by an interface on this node.
@@ -140,8 +288,6 @@ class Router : protected concurrency::OSThread, protected PacketHistory
     void abortSendAndNak(meshtastic_Routing_Error err, meshtastic_MeshPacket *p);
 };
 
-enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
-
 /** FIXME - move this into a mesh packet class
  * Remove any encryption and decode the protobufs inside this packet (if necessary).
  *
@@ -149,6 +295,9 @@ enum DecodeState { DECODE_SUCCESS, DECODE_FAILURE, DECODE_FATAL };
  */
 DecodeState perhapsDecode(meshtastic_MeshPacket *p);
 
+/** Same as perhapsDecode, for callers that already hold cryptLock */
+DecodeState perhapsDecodeLocked(meshtastic_MeshPacket *p);
+
 /** Return 0 for success or a Routing_Error code for failure
  */
 meshtastic_Routing_Error perhapsEncode(meshtastic_MeshPacket *p);
@@ -162,4 +311,10 @@ PacketId generatePacketId();
 #define BITFIELD_WANT_RESPONSE_SHIFT 1
 #define BITFIELD_OK_TO_MQTT_SHIFT 0
 #define BITFIELD_WANT_RESPONSE_MASK (1 << BITFIELD_WANT_RESPONSE_SHIFT)
-#define BITFIELD_OK_TO_MQTT_MASK (1 << BITFIELD_OK_TO_MQTT_SHIFT)
\ No newline at end of file
+#define BITFIELD_OK_TO_MQTT_MASK (1 << BITFIELD_OK_TO_MQTT_SHIFT)
+// The payload was compressed by compressPayload()
+#define BITFIELD_COMPRESSED_SHIFT 2
+#define BITFIELD_COMPRESSED_MASK (1 << BITFIELD_COMPRESSED_SHIFT)
+// Set on our NodeInfo: we understand BITFIELD_COMPRESSED
+#define BITFIELD_CAN_DECOMPRESS_SHIFT 3
+#define BITFIELD_CAN_DECOMPRESS_MASK (1 << BITFIELD_CAN_DECOMPRESS_SHIFT)
\ No newline at end of file
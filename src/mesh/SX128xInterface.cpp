@@ -77,6 +77,7 @@ template <typename T> bool SX128xInterface<T>::init()
         LOG_WARN("Radio only supports 2.4GHz LoRa. Adjusting Region and rebooting");
         config.lora.region = meshtastic_Config_LoRaConfig_RegionCode_LORA_24;
         nodeDB->saveToDisk(SEGMENT_CONFIG);
+        nodeDB->flushToDisk(SEGMENT_CONFIG);
         delay(2000);
 #if defined(ARCH_ESP32)
         ESP.restart();
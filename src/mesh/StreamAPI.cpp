@@ -22,6 +22,8 @@ int32_t StreamAPI::runOncePart()
 int32_t StreamAPI::readStream()
 {
     if (!stream->available()) {
+        if (rxWakesOwner)
+            return STREAM_NOTIFIED_IDLE_MSEC;
         // Nothing available this time, if the computer has talked to us recently, poll often, otherwise let CPU sleep a long time
         bool recentRx = Throttle::isWithinTimespanMs(lastRxMsec, 2000);
         return recentRx ? 5 : 250;
@@ -138,6 +140,12 @@ void StreamAPI::emitLogRecord(meshtastic_LogRecord_Level level, const char *src,
     emitTxBuffer(pb_encode_to_bytes(txBuf + HEADER_LEN, meshtastic_FromRadio_size, &meshtastic_FromRadio_msg, &fromRadioScratch));
 }
 
+void StreamAPI::onNowHasData(uint32_t fromRadioNum)
+{
+    if (owner)
+        concurrency::wakeThread(owner);
+}
+
 /// Hookable to find out when connection changes
 void StreamAPI::onConnectionChanged(bool connected)
 {
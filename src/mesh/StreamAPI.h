@@ -8,6 +8,9 @@
 // A To/FromRadio packet + our 32 bit header
 #define MAX_STREAM_BUF_SIZE (MAX_TO_FROM_RADIO_SIZE + sizeof(uint32_t))
 
+// How often to poll an idle stream when arriving bytes wake us (see rxWakesOwner), just to notice timeouts
+#define STREAM_NOTIFIED_IDLE_MSEC 1000
+
 /**
  * A version of our 'phone' API that talks over a Stream.  So therefore well suited to use with serial links
  * or TCP connections.
@@ -70,6 +73,9 @@ class StreamAPI : public PhoneAPI
 
     virtual void onConnectionChanged(bool connected) override;
 
+    /// Wake our owner to send the new packets now, rather than on its next poll
+    virtual void onNowHasData(uint32_t fromRadioNum) override;
+
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() override = 0;
 
@@ -81,6 +87,12 @@ class StreamAPI : public PhoneAPI
     /// Are we allowed to write packets to our output stream (subclasses can turn this off - i.e. SerialConsole)
     bool canWrite = true;
 
+    /// The thread which calls runOncePart(), if set it is woken whenever there are packets for the client
+    concurrency::OSThread *owner = NULL;
+
+    /// Set by subclasses which arrange for owner to be woken when bytes arrive, so we needn't poll rapidly for them
+    bool rxWakesOwner = false;
+
     /// Subclasses can use this scratch buffer if they wish
     uint8_t txBuf[MAX_STREAM_BUF_SIZE] = {0};
 
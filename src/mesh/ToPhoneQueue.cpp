@@ -0,0 +1,153 @@
+#include "ToPhoneQueue.h"
+#include "concurrency/LockGuard.h"
+#include "configuration.h"
+#include "mesh-pb-constants.h"
+#include "mesh/generated/meshtastic/telemetry.pb.h"
+#include <pb_decode.h>
+
+ToPhoneQueue::ToPhoneQueue(size_t _maxBytes, size_t _maxLen) : maxBytes(_maxBytes), maxLen(_maxLen) {}
+
+size_t ToPhoneQueue::costOf(const meshtastic_MeshPacket *p)
+{
+    if (p->which_payload_variant == meshtastic_MeshPacket_decoded_tag)
+        return TOPHONE_PACKET_OVERHEAD + p->decoded.payload.size;
+    return TOPHONE_PACKET_OVERHEAD + p->encrypted.size;
+}
+
+uint32_t ToPhoneQueue::stateKindOf(const meshtastic_MeshPacket *p)
+{
+    // Responses are awaited by a client (matched by request_id), so they are never superseded
+    if (p->which_payload_variant != meshtastic_MeshPacket_decoded_tag || p->decoded.request_id != 0)
+        return 0;
+
+    switch (p->decoded.portnum) {
+    case meshtastic_PortNum_POSITION_APP:
+    case meshtastic_PortNum_NODEINFO_APP:
+        return p->decoded.portnum << 8;
+    case meshtastic_PortNum_TELEMETRY_APP: {
+        // Only look as far as the oneof tag, no need to decode the whole Telemetry
+        pb_istream_t stream = pb_istream_from_buffer(p->decoded.payload.bytes, p->decoded.payload.size);
+        pb_wire_type_t wireType;
+        uint32_t tag;
+        bool eof;
+        while (pb_decode_tag(&stream, &wireType, &tag, &eof)) {
+            if (tag == meshtastic_Telemetry_device_metrics_tag || tag == meshtastic_Telemetry_environment_metrics_tag)
+                return (p->decoded.portnum << 8) | tag;
+            if (!pb_skip_field(&stream, wireType))
+                break;
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+void ToPhoneQueue::eraseAt(size_t i)
+{
+    meshtastic_MeshPacket *d = queue[i];
+    usedBytes -= costOf(d);
+    queue.erase(queue.begin() + i);
+    packetPool.release(d);
+}
+
+bool ToPhoneQueue::makeRoom(const meshtastic_MeshPacket *p, size_t cost)
+{
+    bool isMessage = p->which_payload_variant == meshtastic_MeshPacket_decoded_tag &&
+                     (p->decoded.portnum == meshtastic_PortNum_TEXT_MESSAGE_APP ||
+                      p->decoded.portnum == meshtastic_PortNum_RANGE_TEST_APP ||
+                      p->decoded.portnum == meshtastic_PortNum_ROUTING_APP);
+
+    while (!queue.empty() && (usedBytes + cost > maxBytes || queue.size() >= maxLen)) {
+        // Node state is the cheapest thing to lose, the node will send it again. Otherwise only messages may push out older
+        // packets, like before
+        size_t victim = queue.size();
+        for (size_t i = 0; i < queue.size(); i++) {
+            if (stateKindOf(queue[i])) {
+                victim = i;
+                break;
+            }
+        }
+        if (victim == queue.size()) {
+            if (!isMessage)
+                return false;
+            victim = 0;
+        }
+        LOG_WARN("ToPhone queue is full, discard oldest");
+        eraseAt(victim);
+        numDropped++;
+    }
+    return true;
+}
+
+bool ToPhoneQueue::enqueue(meshtastic_MeshPacket *p)
+{
+    concurrency::LockGuard guard(&lock);
+
+    size_t cost = costOf(p);
+    uint32_t kind = stateKindOf(p);
+    if (kind) {
+        for (size_t i = 0; i < queue.size(); i++) {
+            meshtastic_MeshPacket *&queued = queue[i];
+            if (queued->from != p->from || stateKindOf(queued) != kind)
+                continue;
+            numCoalesced++;
+            if (usedBytes - costOf(queued) + cost <= maxBytes) {
+                usedBytes += cost;
+                usedBytes -= costOf(queued);
+                packetPool.release(queued);
+                queued = p; // take over its place in the queue
+                return true;
+            }
+            // The newer packet is bigger and doesn't fit, drop the old one and queue it like any other
+            eraseAt(i);
+            break;
+        }
+    }
+
+    if (!makeRoom(p, cost)) {
+        LOG_WARN("ToPhone queue is full, drop packet");
+        packetPool.release(p);
+        numDropped++;
+        return false;
+    }
+
+    queue.push_back(p);
+    usedBytes += cost;
+    return true;
+}
+
+meshtastic_MeshPacket *ToPhoneQueue::dequeue()
+{
+    concurrency::LockGuard guard(&lock);
+
+    if (queue.empty())
+        return NULL;
+    meshtastic_MeshPacket *p = queue.front();
+    queue.pop_front();
+    usedBytes -= costOf(p);
+    return p;
+}
+
+bool ToPhoneQueue::isEmpty()
+{
+    concurrency::LockGuard guard(&lock);
+    return queue.empty();
+}
+
+size_t ToPhoneQueue::numUsed()
+{
+    concurrency::LockGuard guard(&lock);
+    return queue.size();
+}
+
+NodeNum ToPhoneQueue::findDestination(PacketId id)
+{
+    concurrency::LockGuard guard(&lock);
+
+    NodeNum nodenum = 0;
+    for (auto p : queue)
+        if (p->id == id)
+            nodenum = p->to; // keep looking, the newest match wins
+    return nodenum;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "MeshTypes.h"
+#include "concurrency/Lock.h"
+
+#include <deque>
+
+/**
+ * Packets waiting to be read by the phone (or any other API client).
+ *
+ * Messages (text, routing, ...) are delivered in FIFO order. Packets which only carry the latest state of a node (position,
+ * nodeinfo, device and environment telemetry) supersede any older not yet delivered packet of the same kind from the same
+ * node: the newer packet takes the older one's place in the queue, so a reconnecting client gets current state without first
+ * wading through stale copies of it.
+ *
+ * The queue is bounded by an estimate of the bytes the client will have to read, plus a packet count cap that protects RAM.
+ * All methods are safe to call from the BLE/API task, or on portduino the PiWebServer threads, while the main thread is adding
+ * packets.
+ */
+class ToPhoneQueue
+{
+  public:
+    ToPhoneQueue(size_t maxBytes, size_t maxLen);
+
+    /** Add a packet, coalescing or evicting as needed. Returns false if p was dropped (and released) instead */
+    bool enqueue(meshtastic_MeshPacket *p);
+
+    /** Return the oldest packet, or NULL if empty */
+    meshtastic_MeshPacket *dequeue();
+
+    bool isEmpty();
+
+    size_t numUsed();
+
+    /** Find the destination of the queued packet with this id, 0 if none */
+    NodeNum findDestination(PacketId id);
+
+    /// Number of packets replaced in place by a newer one from the same node
+    uint32_t numCoalesced = 0;
+    /// Number of packets dropped or evicted because the queue was full
+    uint32_t numDropped = 0;
+
+  private:
+    std::deque<meshtastic_MeshPacket *> queue;
+    size_t maxBytes, maxLen;
+    size_t usedBytes = 0;
+    concurrency::Lock lock;
+
+    /// Our estimate of the bytes the client needs to read to get this packet
+    static size_t costOf(const meshtastic_MeshPacket *p);
+
+    /// Return a key identifying the kind of state this packet carries, or 0 if it must not be coalesced
+    static uint32_t stateKindOf(const meshtastic_MeshPacket *p);
+
+    /// Remove the packet at index i, releasing it to the pool
+    void eraseAt(size_t i);
+
+    /// Make room for a packet costing 'cost' bytes. Returns false if p should rather be dropped itself
+    bool makeRoom(const meshtastic_MeshPacket *p, size_t cost);
+};
@@ -1,20 +1,39 @@
 #include "ServerAPI.h"
 #include "configuration.h"
 #include <Arduino.h>
+#ifdef ARCH_PORTDUINO
+#include "concurrency/Reactor.h"
+#endif
 
 template <typename T>
 ServerAPI<T>::ServerAPI(T &_client) : StreamAPI(&client), concurrency::OSThread("ServerAPI"), client(_client)
 {
     LOG_INFO("Incoming API connection");
+    owner = this;
+#ifdef ARCH_PORTDUINO
+    // Run as soon as the client sends us something rather than polling the socket
+    if (concurrency::reactor.watch(client.fd(), this)) {
+        watchedFd = client.fd();
+        rxWakesOwner = true;
+    }
+#endif
 }
 
 template <typename T> ServerAPI<T>::~ServerAPI()
 {
+#ifdef ARCH_PORTDUINO
+    concurrency::reactor.unwatch(watchedFd);
+#endif
     client.stop();
 }
 
 template <typename T> void ServerAPI<T>::close()
 {
+#ifdef ARCH_PORTDUINO
+    concurrency::reactor.unwatch(watchedFd);
+    watchedFd = -1;
+    rxWakesOwner = false;
+#endif
     client.stop(); // drop tcp connection
     StreamAPI::close();
 }
@@ -12,6 +12,10 @@ template <class T> class ServerAPI : public StreamAPI, private concurrency::OSTh
 {
   private:
     T client;
+#ifdef ARCH_PORTDUINO
+    /// The client socket we asked the reactor to wake us for, or -1
+    int watchedFd = -1;
+#endif
 
   public:
     explicit ServerAPI(T &_client);
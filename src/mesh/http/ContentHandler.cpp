@@ -1,4 +1,5 @@
 #if !MESHTASTIC_EXCLUDE_WEBSERVER
+#include "BootProfiler.h"
 #include "NodeDB.h"
 #include "PowerFSM.h"
 #include "RadioLibInterface.h"
@@ -677,6 +678,16 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
     jsonObjRadio["frequency"] = new JSONValue(RadioLibInterface::instance->getFreq());
     jsonObjRadio["lora_channel"] = new JSONValue((int)RadioLibInterface::instance->getChannelNum() + 1);
 
+    // data->boot
+    JSONObject jsonObjBootPhases;
+    for (size_t i = 0; i < bootProfiler.getNumPhases(); i++) {
+        const BootPhase &phase = bootProfiler.getPhase(i);
+        jsonObjBootPhases[phase.name] = new JSONValue((int)phase.msec);
+    }
+    JSONObject jsonObjBoot;
+    jsonObjBoot["total_ms"] = new JSONValue((int)bootProfiler.getTotalMsec());
+    jsonObjBoot["phases_ms"] = new JSONValue(jsonObjBootPhases);
+
     // collect data to inner data object
     JSONObject jsonObjInner;
     jsonObjInner["airtime"] = new JSONValue(jsonObjAirtime);
@@ -685,6 +696,7 @@ void handleReport(HTTPRequest *req, HTTPResponse *res)
     jsonObjInner["power"] = new JSONValue(jsonObjPower);
     jsonObjInner["device"] = new JSONValue(jsonObjDevice);
     jsonObjInner["radio"] = new JSONValue(jsonObjRadio);
+    jsonObjInner["boot"] = new JSONValue(jsonObjBoot);
 
     // create json output structure
     JSONObject jsonObjOuter;
@@ -185,6 +185,7 @@ int32_t WebServerThread::runOnce()
     handleWebResponse();
 
     if (requestRestart && (millis() / 1000) > requestRestart) {
+        nodeDB->flushToDisk(); // don't lose saves still waiting in PrefsWriter
         ESP.restart();
     }
 
@@ -18,6 +18,18 @@
 #define MAX_RX_TOPHONE 32
 #endif
 
+/// Estimated number of bytes a client has to read per queued packet, on top of its payload
+#define TOPHONE_PACKET_OVERHEAD 48
+
+/// The most a single queued packet counts against MAX_RX_TOPHONE_BYTES
+#define TOPHONE_MAX_PACKET_COST (TOPHONE_PACKET_OVERHEAD + meshtastic_Constants_DATA_PAYLOAD_LEN)
+
+/// budget for the packets waiting for the phone, in (estimated) bytes the phone will have to read. MAX_RX_TOPHONE still caps
+/// the number of packets, to bound RAM use. By default a full queue of maximum size text messages still fits
+#ifndef MAX_RX_TOPHONE_BYTES
+#define MAX_RX_TOPHONE_BYTES (MAX_RX_TOPHONE * TOPHONE_MAX_PACKET_COST)
+#endif
+
 /// Verify baseline assumption of node size. If it increases, we need to reevaluate
 /// the impact of its memory footprint, notably on MAX_NUM_NODES.
 static_assert(sizeof(meshtastic_NodeInfoLite) <= 200, "NodeInfoLite size increased. Reconsider impact on MAX_NUM_NODES.");
@@ -37,6 +37,7 @@ mail:   marchammermann@googlemail.com
 #ifdef PORTDUINO_LINUX_HARDWARE
 #if __has_include(<ulfius.h>)
 #include "PiWebServer.h"
+#include "BootProfiler.h"
 #include "NodeDB.h"
 #include "PhoneAPI.h"
 #include "PowerFSM.h"
@@ -45,6 +46,7 @@ mail:   marchammermann@googlemail.com
 #include "graphics/Screen.h"
 #include "main.h"
 #include "mesh/wifi/WiFiAPClient.h"
+#include "serialization/JSON.h"
 #include "sleep.h"
 #include <openssl/bn.h>
 #include <openssl/evp.h>
@@ -218,6 +220,62 @@ int callback_static_file(const struct _u_request *request, struct _u_response *r
 
 static void handleWebResponse() {}
 
+// Streamed frames use the same framing as the serial and TCP API, see StreamAPI.h
+#define FRAME_START1 0x94
+#define FRAME_START2 0xc3
+#define FRAME_HEADER_LEN 4
+
+size_t HttpAPI::fillFrames(uint8_t *buf, size_t max)
+{
+    size_t used = 0;
+    while (max - used >= MAX_STREAM_BUF_SIZE) {
+        uint8_t *frame = buf + used;
+        uint32_t len = getFromRadio(frame + FRAME_HEADER_LEN);
+        if (!len)
+            break;
+        frame[0] = FRAME_START1;
+        frame[1] = FRAME_START2;
+        frame[2] = (len >> 8) & 0xff;
+        frame[3] = len & 0xff;
+        used += FRAME_HEADER_LEN + len;
+    }
+    return used;
+}
+
+size_t HttpAPI::readFrames(uint8_t *buf, size_t max, uint32_t waitMsec)
+{
+    uint32_t start = millis();
+    while (true) {
+        uint32_t epoch;
+        {
+            std::lock_guard<std::mutex> g(dataLock);
+            epoch = dataEpoch;
+        }
+        size_t used;
+        {
+            std::lock_guard<std::mutex> g(apiLock);
+            used = fillFrames(buf, max);
+        }
+        uint32_t waited = millis() - start;
+        if (used || waited >= waitMsec)
+            return used;
+
+        // Nothing for the client, so sleep until there is (no polling, an idle stream costs nothing)
+        std::unique_lock<std::mutex> g(dataLock);
+        hasData.wait_for(g, std::chrono::milliseconds(min(waitMsec - waited, (uint32_t)WEB_STREAM_RECHECK_MSEC)),
+                         [&]() { return dataEpoch != epoch; });
+    }
+}
+
+void HttpAPI::notifyData()
+{
+    {
+        std::lock_guard<std::mutex> g(dataLock);
+        dataEpoch++;
+    }
+    hasData.notify_all();
+}
+
 /*
  * Adapt the radioapi to the Webservice handleAPIv1ToRadio
  * Trigger : WebGui(SAVE)->WebServcice->phoneApi
@@ -240,15 +298,26 @@ int handleAPIv1ToRadio(const struct _u_request *req, struct _u_response *res, vo
 
     byte buffer[MAX_TO_FROM_RADIO_SIZE];
     size_t s = req->binary_body_length;
+    if (s > sizeof(buffer)) {
+        LOG_WARN("Reject %d byte ToRadio from PUT request", s);
+        ulfius_set_string_body_response(res, 413, "ToRadio too large");
+        return U_CALLBACK_COMPLETE;
+    }
 
-    memcpy(buffer, req->binary_body, MAX_TO_FROM_RADIO_SIZE);
+    memcpy(buffer, req->binary_body, s);
 
     // FIXME* Problem with portdunio loosing mountpoint maybe because of running in a real sep. thread
 
     portduinoVFS->mountpoint(configWeb.rootPath);
 
     LOG_DEBUG("Received %d bytes from PUT request", s);
-    static_cast<HttpAPI *>(user_data)->handleToRadio(buffer, s);
+    HttpAPI *api = static_cast<HttpAPI *>(user_data);
+    {
+        std::lock_guard<std::mutex> g(api->apiLock);
+        api->handleToRadio(buffer, s);
+    }
+    // Replies like config or xmodem don't come through onNowHasData(), so let any stream know now
+    api->notifyData();
     LOG_DEBUG("end web->radio  ");
     return U_CALLBACK_COMPLETE;
 }
@@ -261,7 +330,7 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
 {
 
     // LOG_DEBUG("handleAPIv1FromRadio radio -> web");
-    std::string valueAll;
+    const char *valueAll = u_map_get(req->map_url, "all");
 
     // Status code is 200 OK by default.
     ulfius_add_header_to_response(res, "Content-Type", "application/x-protobuf");
@@ -275,22 +344,22 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
         return U_CALLBACK_COMPLETE;
     }
 
+    HttpAPI *api = static_cast<HttpAPI *>(user_data);
+    std::lock_guard<std::mutex> g(api->apiLock);
     uint8_t txBuf[MAX_STREAM_BUF_SIZE];
     uint32_t len = 1;
 
-    if (valueAll == "true") {
+    if (valueAll && strcmp(valueAll, "true") == 0) {
+        // Everything we have, back to back like the ESP32 webserver does
+        std::string body;
         while (len) {
-            len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
-            ulfius_set_response_properties(res, U_OPT_STATUS, 200, U_OPT_BINARY_BODY, txBuf, len);
-            const char *tmpa = (const char *)txBuf;
-            ulfius_set_string_body_response(res, 200, tmpa);
-            // LOG_DEBUG("\n----webAPI response all:----");
-            // LOG_DEBUG(tmpa);
-            // LOG_DEBUG("");
+            len = api->getFromRadio(txBuf);
+            body.append((const char *)txBuf, len);
         }
+        ulfius_set_binary_body_response(res, 200, body.data(), body.size());
         // Otherwise, just return one protobuf
     } else {
-        len = static_cast<HttpAPI *>(user_data)->getFromRadio(txBuf);
+        len = api->getFromRadio(txBuf);
         const char *tmpa = (const char *)txBuf;
         ulfius_set_binary_body_response(res, 200, tmpa, len);
         // LOG_DEBUG("\n----webAPI response:");
@@ -302,6 +371,148 @@ int handleAPIv1FromRadio(const struct _u_request *req, struct _u_response *res,
     return U_CALLBACK_COMPLETE;
 }
 
+/// One streamed FromRadio response. The webserver may ask for less than a frame at a time, so we keep what didn't fit
+struct FromRadioStream {
+    HttpAPI *api;
+    uint8_t buf[WEB_STREAM_BLOCK_SIZE];
+    size_t len = 0;
+    size_t pos = 0;
+};
+
+static ssize_t fromRadioStreamRead(void *cls, uint64_t pos, char *buf, size_t max)
+{
+    (void)(pos);
+    FromRadioStream *stream = (FromRadioStream *)cls;
+    if (stream->pos == stream->len) {
+        stream->pos = 0;
+        stream->len = stream->api->readFrames(stream->buf, sizeof(stream->buf), WEB_STREAM_IDLE_MSEC);
+        // After a quiet spell end the response, the client just asks again
+        if (!stream->len)
+            return U_STREAM_END;
+    }
+    size_t n = min(max, stream->len - stream->pos);
+    memcpy(buf, stream->buf + stream->pos, n);
+    stream->pos += n;
+    return n;
+}
+
+static void fromRadioStreamFree(void *cls)
+{
+    delete (FromRadioStream *)cls;
+}
+
+/*
+ * Long-poll and streaming version of handleAPIv1FromRadio: the response waits until there is something for the client, then
+ * carries every FromRadio as it arrives, each with StreamAPI's 4 byte header, until there has been nothing for
+ * WEB_STREAM_IDLE_MSEC. Each waiting client just holds a sleeping webserver thread, rather than polling us.
+ */
+int handleAPIv1FromRadioStream(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    ulfius_add_header_to_response(res, "Access-Control-Allow-Origin", "*");
+    ulfius_add_header_to_response(res, "Access-Control-Allow-Methods", "GET");
+
+    if (strcmp(req->http_verb, "OPTIONS") == 0) {
+        ulfius_set_response_properties(res, U_OPT_STATUS, 204);
+        return U_CALLBACK_COMPLETE;
+    }
+
+    ulfius_add_header_to_response(res, "Content-Type", "application/octet-stream");
+    ulfius_add_header_to_response(res, "Cache-Control", "no-cache");
+    // Stop reverse proxies holding frames back
+    ulfius_add_header_to_response(res, "X-Accel-Buffering", "no");
+    FromRadioStream *stream = new FromRadioStream();
+    stream->api = static_cast<HttpAPI *>(user_data);
+    if (ulfius_set_stream_response(res, 200, fromRadioStreamRead, fromRadioStreamFree, U_STREAM_SIZE_UNKNOWN,
+                                   WEB_STREAM_BLOCK_SIZE, stream) != U_OK) {
+        LOG_ERROR("handleAPIv1FromRadioStream - Error ulfius_set_stream_response");
+        delete stream;
+        return U_CALLBACK_ERROR;
+    }
+    return U_CALLBACK_COMPLETE;
+}
+
+/*
+ * Who is using the channel: RX airtime per (source node, portnum) and per relayer, heaviest first.
+ * airtime_ms may overstate a talker by up to error_ms, see HeavyHitters. It fades by half every period, while packets counts
+ * everything heard since the talker got its slot.
+ */
+int handleJsonAirtime(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    ulfius_add_header_to_response(res, "Access-Control-Allow-Methods", "GET");
+
+    JSONObject jsonObjInner;
+    jsonObjInner["channel_utilization"] = new JSONValue(airTime->channelUtilizationPercent());
+    jsonObjInner["utilization_tx"] = new JSONValue(airTime->utilizationTXPercent());
+
+    AirTime::SourceSketch::Entry sources[AIRTIME_TOP_TALKERS];
+    size_t n = airTime->getTopSources(sources, AIRTIME_TOP_TALKERS);
+    JSONArray sourcesArray;
+    for (size_t i = 0; i < n; i++) {
+        JSONObject source;
+        char id[16];
+        snprintf(id, sizeof(id), "!%08x", AirTime::sourceNode(sources[i].key));
+        source["node"] = new JSONValue(id);
+        source["portnum"] = new JSONValue((int)AirTime::sourcePortnum(sources[i].key));
+        source["airtime_ms"] = new JSONValue((int)sources[i].weight);
+        source["error_ms"] = new JSONValue((int)sources[i].error);
+        source["packets"] = new JSONValue((int)sources[i].count);
+        sourcesArray.push_back(new JSONValue(source));
+    }
+    jsonObjInner["sources"] = new JSONValue(sourcesArray);
+
+    AirTime::RelayerSketch::Entry relayers[AIRTIME_TOP_TALKERS];
+    n = airTime->getTopRelayers(relayers, AIRTIME_TOP_TALKERS);
+    JSONArray relayersArray;
+    for (size_t i = 0; i < n; i++) {
+        JSONObject relayer;
+        relayer["relay_node"] = new JSONValue((int)relayers[i].key);
+        relayer["airtime_ms"] = new JSONValue((int)relayers[i].weight);
+        relayer["error_ms"] = new JSONValue((int)relayers[i].error);
+        relayer["packets"] = new JSONValue((int)relayers[i].count);
+        relayersArray.push_back(new JSONValue(relayer));
+    }
+    jsonObjInner["relayers"] = new JSONValue(relayersArray);
+
+    JSONObject jsonObjOuter;
+    jsonObjOuter["data"] = new JSONValue(jsonObjInner);
+    jsonObjOuter["status"] = new JSONValue("ok");
+    JSONValue *value = new JSONValue(jsonObjOuter);
+    std::string body = value->Stringify();
+    delete value;
+
+    ulfius_set_string_body_response(res, 200, body.c_str());
+    ulfius_add_header_to_response(res, "Content-Type", "application/json");
+    return U_CALLBACK_COMPLETE;
+}
+
+/*
+ * How long each part of setup() took, see BootProfiler
+ */
+int handleJsonBoot(const struct _u_request *req, struct _u_response *res, void *user_data)
+{
+    ulfius_add_header_to_response(res, "Access-Control-Allow-Methods", "GET");
+
+    JSONObject jsonObjBootPhases;
+    for (size_t i = 0; i < bootProfiler.getNumPhases(); i++) {
+        const BootPhase &phase = bootProfiler.getPhase(i);
+        jsonObjBootPhases[phase.name] = new JSONValue((int)phase.msec);
+    }
+    JSONObject jsonObjInner;
+    jsonObjInner["total_ms"] = new JSONValue((int)bootProfiler.getTotalMsec());
+    jsonObjInner["phases_ms"] = new JSONValue(jsonObjBootPhases);
+
+    JSONObject jsonObjOuter;
+    jsonObjOuter["data"] = new JSONValue(jsonObjInner);
+    jsonObjOuter["status"] = new JSONValue("ok");
+    JSONValue *value = new JSONValue(jsonObjOuter);
+    std::string body = value->Stringify();
+    delete value;
+
+    ulfius_set_string_body_response(res, 200, body.c_str());
+    ulfius_add_header_to_response(res, "Content-Type", "application/json");
+    return U_CALLBACK_COMPLETE;
+}
+
 /*
 OpenSSL RSA Key Gen
 */
@@ -499,10 +710,17 @@ PiWebServerThread::PiWebServerThread()
         u_map_put(instanceWeb.default_headers, "Access-Control-Allow-Origin", "*");
         // Maximum body size sent by the client is 1 Kb
         instanceWeb.max_post_body_size = 1024;
+        // Before the wildcard below, which would match it too
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/api/v1/fromradio/stream", 0, &handleAPIv1FromRadioStream,
+                                   &webAPI);
+        ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/fromradio/stream", 0,
+                                   &handleAPIv1FromRadioStream, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/api/v1/fromradio/*", 1, &handleAPIv1FromRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/fromradio/*", 1, &handleAPIv1FromRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "PUT", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, &webAPI);
         ulfius_add_endpoint_by_val(&instanceWeb, "OPTIONS", PREFIX, "/api/v1/toradio/*", 1, &handleAPIv1ToRadio, &webAPI);
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/json/airtime", 1, &handleJsonAirtime, NULL);
+        ulfius_add_endpoint_by_val(&instanceWeb, "GET", PREFIX, "/json/boot", 1, &handleJsonBoot, NULL);
 
         // Add callback function to all endpoints for the Web Server
         ulfius_add_endpoint_by_val(&instanceWeb, "GET", NULL, "/*", 2, &callback_static_file, &configWeb);
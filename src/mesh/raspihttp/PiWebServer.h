@@ -5,10 +5,20 @@
 #include "ulfius-cfg.h"
 #include "ulfius.h"
 #include <Arduino.h>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 
 #define STATIC_FILE_CHUNK 256
 
+// A streamed FromRadio response ends after this long without anything to send, and the client reconnects. This keeps us
+// under the idle timeouts of browsers and proxies
+#define WEB_STREAM_IDLE_MSEC (25 * 1000)
+// How often a waiting stream looks for data which arrived without onNowHasData(), like queue status or log records
+#define WEB_STREAM_RECHECK_MSEC 1000
+// How much of a streamed response we build at a time, must fit at least one frame of MAX_STREAM_BUF_SIZE
+#define WEB_STREAM_BLOCK_SIZE 4096
+
 void initWebServer();
 void createSSLCert();
 int callback_static_file(const struct _u_request *request, struct _u_response *response, void *user_data);
@@ -27,14 +37,32 @@ class HttpAPI : public PhoneAPI
 {
 
   public:
-    // Nothing here yet
+    /// Serialises the webserver's threads, which all share this one API
+    std::mutex apiLock;
+
+    /**
+     * Fill buf with as many FromRadio frames as fit, each with the 4 byte header used by StreamAPI. If there are none, wait up
+     * to waitMsec for some. Returns the number of bytes used, 0 if we timed out
+     */
+    size_t readFrames(uint8_t *buf, size_t max, uint32_t waitMsec);
+
+    /// Wake waiting readers, for when something may have queued data without telling us
+    void notifyData();
 
   private:
-    // Nothing here yet
+    std::mutex dataLock;
+    std::condition_variable hasData;
+    /// Bumped whenever there may be new data, so readers can't miss a notification while they look
+    uint32_t dataEpoch = 0;
+
+    /// Fill buf with frames, without waiting. Caller holds apiLock
+    size_t fillFrames(uint8_t *buf, size_t max);
 
   protected:
     /// Check the current underlying physical link to see if the client is currently connected
     virtual bool checkIsConnected() override { return true; } // FIXME, be smarter about this
+
+    virtual void onNowHasData(uint32_t fromRadioNum) override { notifyData(); }
 };
 
 class PiWebServerThread
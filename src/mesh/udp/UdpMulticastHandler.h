@@ -4,8 +4,12 @@
 #include "main.h"
 #include "mesh/Router.h"
 
+#ifdef ARCH_PORTDUINO
+#include "UdpMulticastSocket.h"
+#else
 #include <AsyncUDP.h>
 #include <WiFi.h>
+#endif
 
 #if HAS_ETHERNET && defined(USE_WS5500)
 #include <ETHClass2.h>
@@ -13,21 +17,45 @@
 #endif // HAS_ETHERNET
 
 #define UDP_MULTICAST_DEFAUL_PORT 4403 // Default port for UDP multicast is same as TCP api server
+#define UDP_MULTICAST_DEFAULT_GROUP "224.0.0.69"
 
 class UdpMulticastHandler final
 {
   public:
+#ifdef ARCH_PORTDUINO
+    UdpMulticastHandler() : udp(UDP_MULTICAST_DEFAULT_GROUP, UDP_MULTICAST_DEFAUL_PORT) {}
+
+    void start()
+    {
+        if (udp.isStarted())
+            return;
+        if (udp.start()) {
+            LOG_DEBUG("UDP Listening");
+        } else {
+            LOG_DEBUG("Failed to listen on UDP");
+        }
+    }
+
+    bool onSend(const meshtastic_MeshPacket *mp)
+    {
+        if (!mp) {
+            return false;
+        }
+        LOG_DEBUG("Broadcasting packet over UDP (id=%u)", mp->id);
+        return udp.send(mp);
+    }
+
+    const UdpMulticastStats &getStats() const { return udp.getStats(); }
+
+  private:
+    UdpMulticastSocket udp;
+#else
     UdpMulticastHandler() { udpIpAddress = IPAddress(224, 0, 0, 69); }
 
     void start()
     {
         if (udp.listenMulticast(udpIpAddress, UDP_MULTICAST_DEFAUL_PORT, 64)) {
-#ifndef ARCH_PORTDUINO
-            // FIXME(PORTDUINO): arduino lacks IPAddress::toString()
             LOG_DEBUG("UDP Listening on IP: %s", WiFi.localIP().toString().c_str());
-#else
-            LOG_DEBUG("UDP Listening");
-#endif
             udp.onPacket([this](AsyncUDPPacket packet) { onReceive(packet); });
         } else {
             LOG_DEBUG("Failed to listen on UDP");
@@ -37,15 +65,13 @@ class UdpMulticastHandler final
     void onReceive(AsyncUDPPacket packet)
     {
         size_t packetLength = packet.length();
-#ifndef ARCH_PORTDUINO
-        // FIXME(PORTDUINO): arduino lacks IPAddress::toString()
         LOG_DEBUG("UDP broadcast from: %s, len=%u", packet.remoteIP().toString().c_str(), packetLength);
-#endif
-        meshtastic_MeshPacket mp;
+        if (!router)
+            return;
+        // Decode straight into the pool rather than via a copy on the stack
+        UniquePacketPoolPacket p = packetPool.allocUniqueZeroed();
         LOG_DEBUG("Decoding MeshPacket from UDP len=%u", packetLength);
-        bool isPacketDecoded = pb_decode_from_bytes(packet.data(), packetLength, &meshtastic_MeshPacket_msg, &mp);
-        if (isPacketDecoded && router) {
-            UniquePacketPoolPacket p = packetPool.allocUniqueCopy(mp);
+        if (p && pb_decode_from_bytes(packet.data(), packetLength, &meshtastic_MeshPacket_msg, p.get())) {
             // Unset received SNR/RSSI
             p->rx_snr = 0;
             p->rx_rssi = 0;
@@ -58,11 +84,9 @@ class UdpMulticastHandler final
         if (!mp || !udp) {
             return false;
         }
-#ifndef ARCH_PORTDUINO
         if (WiFi.status() != WL_CONNECTED) {
             return false;
         }
-#endif
         LOG_DEBUG("Broadcasting packet over UDP (id=%u)", mp->id);
         uint8_t buffer[meshtastic_MeshPacket_size];
         size_t encodedLength = pb_encode_to_bytes(buffer, sizeof(buffer), &meshtastic_MeshPacket_msg, mp);
@@ -73,5 +97,6 @@ class UdpMulticastHandler final
   private:
     IPAddress udpIpAddress;
     AsyncUDP udp;
+#endif
 };
 #endif // HAS_UDP_MULTICAST
\ No newline at end of file
@@ -0,0 +1,212 @@
+#include "UdpMulticastSocket.h"
+
+#if HAS_UDP_MULTICAST && defined(ARCH_PORTDUINO)
+
+#include "concurrency/Reactor.h"
+#include "main.h"
+#include "mesh/MeshTypes.h"
+#include "mesh/Router.h"
+#include "mesh/mesh-pb-constants.h"
+#include <Throttle.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// FNV-1a, enough to tell our own datagrams apart from those of other nodes
+static uint32_t datagramHash(const uint8_t *buf, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++)
+        h = (h ^ buf[i]) * 16777619u;
+    return h;
+}
+
+UdpMulticastSocket::UdpMulticastSocket(const char *groupAddress, uint16_t port) : concurrency::OSThread("UdpMulticast")
+{
+    group.sin_family = AF_INET;
+    group.sin_port = htons(port);
+    inet_pton(AF_INET, groupAddress, &group.sin_addr);
+
+    for (size_t i = 0; i < UDP_BATCH_SIZE; i++) {
+        rxIov[i] = {rxBufs[i], sizeof(rxBufs[i])};
+        rxMsgs[i] = {};
+        rxMsgs[i].msg_hdr.msg_iov = &rxIov[i];
+        rxMsgs[i].msg_hdr.msg_iovlen = 1;
+
+        txIov[i] = {txBufs[i], 0};
+        txMsgs[i] = {};
+        txMsgs[i].msg_hdr.msg_iov = &txIov[i];
+        txMsgs[i].msg_hdr.msg_iovlen = 1;
+        txMsgs[i].msg_hdr.msg_name = &group;
+        txMsgs[i].msg_hdr.msg_namelen = sizeof(group);
+    }
+}
+
+UdpMulticastSocket::~UdpMulticastSocket()
+{
+    if (fd >= 0) {
+        concurrency::reactor.unwatch(fd);
+        close(fd);
+    }
+}
+
+bool UdpMulticastSocket::start()
+{
+    if (fd >= 0)
+        return true;
+
+    // Blocking, so a burst of sends waits for the kernel to free buffer space rather than failing with EAGAIN. Receives use
+    // MSG_DONTWAIT
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        LOG_ERROR("UDP socket failed, errno=%d", errno);
+        return false;
+    }
+
+    // Other meshtasticd instances on this host may listen on the same group
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in bindAddr = {};
+    bindAddr.sin_family = AF_INET;
+    bindAddr.sin_port = group.sin_port;
+    bindAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+    ip_mreq membership = {};
+    membership.imr_multiaddr = group.sin_addr;
+    membership.imr_interface.s_addr = htonl(INADDR_ANY);
+
+    if (bind(fd, (sockaddr *)&bindAddr, sizeof(bindAddr)) != 0 ||
+        setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) != 0) {
+        LOG_ERROR("UDP join of multicast group failed, errno=%d", errno);
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    concurrency::reactor.watch(fd, this);
+    // Anything which arrived before the watch was set up won't trigger it
+    enabled = true;
+    setIntervalFromNow(0);
+    return true;
+}
+
+bool UdpMulticastSocket::send(const meshtastic_MeshPacket *mp)
+{
+    if (fd < 0)
+        return false;
+
+    size_t len = pb_encode_to_bytes(txBufs[txCount], sizeof(txBufs[txCount]), &meshtastic_MeshPacket_msg, mp);
+    if (!len) {
+        stats.txErrors++;
+        return false;
+    }
+    txIov[txCount].iov_len = len;
+    sentHashes[nextSentHash] = datagramHash(txBufs[txCount], len);
+    nextSentHash = (nextSentHash + 1) % UDP_SENT_HISTORY;
+    if (++txCount == UDP_BATCH_SIZE)
+        flush();
+    else if (txCount == 1)
+        concurrency::wakeThread(this); // flush on the next pass of the main loop, collecting whatever else is sent by then
+    return true;
+}
+
+void UdpMulticastSocket::flush()
+{
+    size_t sent = 0;
+    while (sent < txCount) {
+        int n = sendmmsg(fd, &txMsgs[sent], txCount - sent, 0);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR)
+                continue;
+            // Multicast is best effort anyway, so drop what is left
+            LOG_WARN("UDP sendmmsg failed, errno=%d, drop %u packets", errno, (uint32_t)(txCount - sent));
+            stats.txErrors += txCount - sent;
+            break;
+        }
+        sent += n;
+        stats.txPackets += n;
+        stats.txBatches++;
+    }
+    txCount = 0;
+}
+
+void UdpMulticastSocket::deliver(const uint8_t *buf, size_t len)
+{
+    // Our own send, looped back. Anything else, including duplicates heard over LoRa or relayed by other nodes, goes to the
+    // router: its filters cancel our pending relays and retransmissions and take other nodes' relays of our packets as ACKs
+    uint32_t hash = datagramHash(buf, len);
+    for (auto sent : sentHashes) {
+        if (sent == hash) {
+            stats.rxLoopback++;
+            return;
+        }
+    }
+
+    meshtastic_MeshPacket *p = packetPool.allocZeroed();
+    if (!p) {
+        stats.rxNoMemory++;
+        return;
+    }
+    if (!pb_decode_from_bytes(buf, len, &meshtastic_MeshPacket_msg, p)) {
+        stats.rxBadDecode++;
+        packetPool.release(p);
+        return;
+    }
+    if (!router) {
+        packetPool.release(p);
+        return;
+    }
+    // Unset received SNR/RSSI
+    p->rx_snr = 0;
+    p->rx_rssi = 0;
+    stats.rxPackets++;
+    router->enqueueReceivedMessage(p);
+}
+
+bool UdpMulticastSocket::receiveBatch()
+{
+    int n;
+    do {
+        n = recvmmsg(fd, rxMsgs, UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0)
+        return false;
+
+    stats.rxBatches++;
+    for (int i = 0; i < n; i++)
+        deliver(rxBufs[i], rxMsgs[i].msg_len);
+    return n == UDP_BATCH_SIZE;
+}
+
+int32_t UdpMulticastSocket::runOnce()
+{
+    if (txCount)
+        flush();
+    if (fd < 0)
+        return disable();
+
+    // One batch per pass, so the router gets to empty its queue before we hand it more. The reactor only wakes us for new
+    // arrivals, so keep coming back until we have read everything.
+    if (receiveBatch())
+        return 0;
+
+    if (!Throttle::isWithinTimespanMs(lastStatsLog, UDP_STATS_LOG_MSEC)) {
+        lastStatsLog = millis();
+        logStats();
+    }
+    return UDP_STATS_LOG_MSEC;
+}
+
+void UdpMulticastSocket::logStats()
+{
+    if (stats.rxPackets + stats.rxLoopback + stats.txPackets == lastLoggedPackets)
+        return;
+    lastLoggedPackets = stats.rxPackets + stats.rxLoopback + stats.txPackets;
+    LOG_INFO("UDP rx %u packets in %u batches (%u own, %u bad, %u no memory), tx %u packets in %u batches (%u errors)",
+             stats.rxPackets, stats.rxBatches, stats.rxLoopback, stats.rxBadDecode, stats.rxNoMemory, stats.txPackets,
+             stats.txBatches, stats.txErrors);
+}
+
+#endif
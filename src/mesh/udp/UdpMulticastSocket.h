@@ -0,0 +1,96 @@
+#pragma once
+
+#include "configuration.h"
+
+#if HAS_UDP_MULTICAST && defined(ARCH_PORTDUINO)
+
+#include "concurrency/OSThread.h"
+#include "mesh/generated/meshtastic/mesh.pb.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+/// How many datagrams we move per recvmmsg()/sendmmsg() call
+#define UDP_BATCH_SIZE 16
+
+/// How often we log the counters, if anything happened
+#define UDP_STATS_LOG_MSEC (5 * 60 * 1000)
+
+/// How many of our own recent datagrams we remember, to recognise them when the kernel loops them back to us
+#define UDP_SENT_HISTORY 64
+
+struct UdpMulticastStats {
+    uint32_t rxPackets = 0;
+    uint32_t rxBatches = 0;
+    /// Our own sends, looped back by the kernel
+    uint32_t rxLoopback = 0;
+    uint32_t rxBadDecode = 0;
+    /// Dropped because the packet pool was empty
+    uint32_t rxNoMemory = 0;
+    uint32_t txPackets = 0;
+    uint32_t txBatches = 0;
+    uint32_t txErrors = 0;
+};
+
+/**
+ * The UDP multicast link on meshtasticd, where it can carry far more traffic than LoRa.
+ *
+ * Rather than AsyncUDP's thread and a callback per datagram, the socket is watched by the reactor and drained with
+ * recvmmsg() on the main thread. Datagrams are decoded straight into packet pool slots and queued for the router, whose
+ * filters deal with duplicates. Only our own sends coming back through the multicast loopback are dropped here, before
+ * decoding. Sends are encoded straight into a batch which goes out with a single sendmmsg() on the next pass of the main
+ * loop, or as soon as it is full.
+ */
+class UdpMulticastSocket : private concurrency::OSThread
+{
+  public:
+    UdpMulticastSocket(const char *groupAddress, uint16_t port);
+
+    ~UdpMulticastSocket();
+
+    /// Open the socket and join the group, returns false on failure
+    bool start();
+
+    bool isStarted() const { return fd >= 0; }
+
+    /// Queue mp for the next batch, returns false if we can't send
+    bool send(const meshtastic_MeshPacket *mp);
+
+    /// Send the current batch now
+    void flush();
+
+    const UdpMulticastStats &getStats() const { return stats; }
+
+  protected:
+    virtual int32_t runOnce() override;
+
+  private:
+    int fd = -1;
+    sockaddr_in group = {};
+    UdpMulticastStats stats;
+    uint32_t lastStatsLog = 0;
+    uint32_t lastLoggedPackets = 0;
+
+    uint8_t rxBufs[UDP_BATCH_SIZE][meshtastic_MeshPacket_size];
+    iovec rxIov[UDP_BATCH_SIZE];
+    mmsghdr rxMsgs[UDP_BATCH_SIZE];
+
+    uint8_t txBufs[UDP_BATCH_SIZE][meshtastic_MeshPacket_size];
+    iovec txIov[UDP_BATCH_SIZE];
+    mmsghdr txMsgs[UDP_BATCH_SIZE];
+    size_t txCount = 0;
+
+    /// Hashes of the datagrams we sent most recently
+    uint32_t sentHashes[UDP_SENT_HISTORY] = {};
+    size_t nextSentHash = 0;
+
+    /// Read one batch and hand it on, returns true if there may be more waiting
+    bool receiveBatch();
+
+    /// Decode one datagram into the pool and give it to the router
+    void deliver(const uint8_t *buf, size_t len);
+
+    void logStats();
+};
+
+#endif
@@ -2,6 +2,7 @@
 #include "Default.h"
 #include "MeshService.h"
 #include "NodeDB.h"
+#include "PayloadCompression.h"
 #include "RTC.h"
 #include "Router.h"
 #include "configuration.h"
@@ -18,6 +19,7 @@ bool NodeInfoModule::handleReceivedProtobuf(const meshtastic_MeshPacket &mp, mes
     snprintf(p.id, sizeof(p.id), "!%08x", getFrom(&mp));
 
     bool hasChanged = nodeDB->updateUser(getFrom(&mp), p, mp.channel);
+    updateDecompressCapability(getFrom(&mp), mp.decoded);
 
     bool wasBroadcast = isBroadcast(mp.to);
 
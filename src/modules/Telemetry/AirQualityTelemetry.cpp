@@ -10,6 +10,7 @@
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "detect/ScanI2CTwoWire.h"
 #include "main.h"
 #include <Throttle.h>
@@ -207,6 +208,7 @@ bool AirQualityTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
 {
     meshtastic_Telemetry m = meshtastic_Telemetry_init_zero;
     if (getAirQualityTelemetry(&m)) {
+        telemetryHistory.record(m);
         meshtastic_MeshPacket *p = allocDataProtobuf(m);
         p->to = dest;
         p->decoded.want_response = false;
@@ -219,7 +221,7 @@ bool AirQualityTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
         if (lastMeasurementPacket != nullptr)
             packetPool.release(lastMeasurementPacket);
 
-        lastMeasurementPacket = packetPool.allocCopy(*p);
+        lastMeasurementPacket = phoneOnly ? packetPool.share(p) : packetPool.allocCopy(*p);
         if (phoneOnly) {
             LOG_INFO("Send packet to phone");
             service->sendToPhone(p);
@@ -7,6 +7,7 @@
 #include "RTC.h"
 #include "RadioLibInterface.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "configuration.h"
 #include "main.h"
 #include "memGet.h"
@@ -39,6 +40,8 @@ int32_t DeviceTelemetryModule::runOnce()
             lastSentStatsToPhone = uptimeLastMs;
         }
     }
+    if (telemetryHistory.isDue(meshtastic_Telemetry_device_metrics_tag))
+        telemetryHistory.record(getDeviceTelemetry());
     return sendToPhoneIntervalMs;
 }
 
@@ -141,6 +144,7 @@ meshtastic_Telemetry DeviceTelemetryModule::getLocalStatsTelemetry()
     if (router) {
         telemetry.variant.local_stats.num_rx_dupe = router->rxDupe;
         telemetry.variant.local_stats.num_tx_relay_canceled = router->txRelayCanceled;
+        router->logRxBurstStats();
     }
 
     LOG_INFO("Sending local stats: uptime=%i, channel_utilization=%f, air_util_tx=%f, num_online_nodes=%i, num_total_nodes=%i",
@@ -178,6 +182,7 @@ bool DeviceTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
     p->priority = meshtastic_MeshPacket_Priority_BACKGROUND;
 
     nodeDB->updateTelemetry(nodeDB->getNodeNum(), telemetry, RX_SRC_LOCAL);
+    telemetryHistory.record(telemetry);
     if (phoneOnly) {
         LOG_INFO("Send packet to phone");
         service->sendToPhone(p);
@@ -0,0 +1,46 @@
+#include "EnvironmentAverager.h"
+
+struct AveragedField {
+    bool meshtastic_EnvironmentMetrics::*has;
+    float meshtastic_EnvironmentMetrics::*value;
+};
+
+#define AVERAGED(FIELD) {&meshtastic_EnvironmentMetrics::has_##FIELD, &meshtastic_EnvironmentMetrics::FIELD}
+
+static const AveragedField averagedFields[] = {
+    AVERAGED(temperature), AVERAGED(relative_humidity), AVERAGED(barometric_pressure), AVERAGED(gas_resistance),
+    AVERAGED(voltage),     AVERAGED(current),           AVERAGED(distance),            AVERAGED(lux),
+    AVERAGED(white_lux),   AVERAGED(ir_lux),            AVERAGED(uv_lux),              AVERAGED(weight),
+    AVERAGED(radiation),   AVERAGED(soil_temperature),
+};
+
+static_assert(sizeof(averagedFields) / sizeof(averagedFields[0]) == EnvironmentAverager::NUM_FIELDS, "update NUM_FIELDS");
+
+void EnvironmentAverager::reset()
+{
+    *this = EnvironmentAverager();
+}
+
+void EnvironmentAverager::add(const meshtastic_EnvironmentMetrics &m)
+{
+    last = m;
+    for (uint8_t i = 0; i < NUM_FIELDS; i++) {
+        if (m.*averagedFields[i].has) {
+            sums[i] += m.*averagedFields[i].value;
+            counts[i]++;
+        }
+    }
+    samples++;
+}
+
+meshtastic_EnvironmentMetrics EnvironmentAverager::get() const
+{
+    meshtastic_EnvironmentMetrics m = last;
+    for (uint8_t i = 0; i < NUM_FIELDS; i++) {
+        if (counts[i]) {
+            m.*averagedFields[i].has = true;
+            m.*averagedFields[i].value = sums[i] / counts[i];
+        }
+    }
+    return m;
+}
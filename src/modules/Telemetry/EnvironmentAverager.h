@@ -0,0 +1,32 @@
+#pragma once
+
+#include "../mesh/generated/meshtastic/telemetry.pb.h"
+
+/**
+ * Averages several environment measurements into one, for oversampling noisy sensors.
+ *
+ * Only readings of a moment are averaged: temperature, humidity, pressure, light and so on. Values a sensor already
+ * aggregates itself (IAQ, wind, rainfall) come from the last measurement.
+ */
+class EnvironmentAverager
+{
+  public:
+    /// Number of fields which are averaged
+    static const uint8_t NUM_FIELDS = 14;
+
+    void reset();
+
+    void add(const meshtastic_EnvironmentMetrics &m);
+
+    /// Number of measurements added since reset()
+    uint8_t count() const { return samples; }
+
+    /** The last measurement, with the averages in place of the single readings */
+    meshtastic_EnvironmentMetrics get() const;
+
+  private:
+    meshtastic_EnvironmentMetrics last = meshtastic_EnvironmentMetrics_init_zero;
+    float sums[NUM_FIELDS] = {};
+    uint8_t counts[NUM_FIELDS] = {};
+    uint8_t samples = 0;
+};
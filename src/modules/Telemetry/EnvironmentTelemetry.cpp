@@ -10,6 +10,7 @@
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "UnitConversions.h"
 #include "main.h"
 #include "power.h"
@@ -173,6 +174,17 @@ NullSensor pct2075Sensor;
 
 RCWL9620Sensor rcwl9620Sensor;
 CGRadSensSensor cgRadSens;
+
+/// The sensors getEnvironmentTelemetry() reads, so they can all start converting at once
+static TelemetrySensor *const environmentSensors[] = {
+    &dfRobotLarkSensor, &dfRobotGravitySensor, &sht31Sensor, &sht4xSensor, &lps22hbSensor, &shtc3Sensor, &bmp085Sensor,
+#if __has_include(<Adafruit_BME280.h>)
+    &bmp280Sensor,
+#endif
+    &bme280Sensor, &ltr390uvSensor, &bmp3xxSensor, &bme680Sensor, &dps310Sensor, &mcp9808Sensor, &ina219Sensor, &ina260Sensor,
+    &ina3221Sensor, &veml7700Sensor, &tsl2591Sensor, &opt3001Sensor, &mlx90632Sensor, &rcwl9620Sensor, &nau7802Sensor,
+    &aht10Sensor, &max17048Sensor, &cgRadSens, &pct2075Sensor,
+};
 #endif
 #ifdef T1000X_SENSOR_EN
 #include "Sensor/T1000xSensor.h"
@@ -299,30 +311,151 @@ int32_t EnvironmentTelemetryModule::runOnce()
             return disable();
         } else {
 #if !MESHTASTIC_EXCLUDE_ENVIRONMENTAL_SENSOR_EXTERNAL
+            // BSEC schedules the BME680's conversions itself and getMetrics() only reads its latest outputs, so it doesn't
+            // take part in startMeasurement()
             if (bme680Sensor.hasSensor())
                 result = bme680Sensor.runTrigger();
 #endif
         }
 
-        if (((lastSentToMesh == 0) ||
+        bool toMesh =
+            ((lastSentToMesh == 0) ||
              !Throttle::isWithinTimespanMs(lastSentToMesh, Default::getConfiguredOrDefaultMsScaled(
                                                                moduleConfig.telemetry.environment_update_interval,
                                                                default_telemetry_broadcast_interval_secs, numOnlineNodes))) &&
             airTime->isTxAllowedChannelUtil(config.device.role != meshtastic_Config_DeviceConfig_Role_SENSOR) &&
-            airTime->isTxAllowedAirUtil()) {
+            airTime->isTxAllowedAirUtil();
+        // Just send to phone when it's not our time to send to mesh yet
+        // Only send while queue is empty (phone assumed connected)
+        bool toPhone = !toMesh &&
+                       ((lastSentToPhone == 0) || !Throttle::isWithinTimespanMs(lastSentToPhone, sendToPhoneIntervalMs)) &&
+                       (service->isToPhoneQueueEmpty());
+        // Or at least take a sample for the history now and then
+        bool toHistory = !toMesh && !toPhone && telemetryHistory.isDue(meshtastic_Telemetry_environment_metrics_tag);
+
+        if (toMesh || toPhone || toHistory) {
+            // Measure first, we'll be back when the sensors are done
+            uint32_t wait = takeSample();
+            if (wait > 0)
+                return min(wait, result);
+        }
+        if (toMesh) {
             sendTelemetry();
             lastSentToMesh = millis();
-        } else if (((lastSentToPhone == 0) || !Throttle::isWithinTimespanMs(lastSentToPhone, sendToPhoneIntervalMs)) &&
-                   (service->isToPhoneQueueEmpty())) {
-            // Just send to phone when it's not our time to send to mesh yet
-            // Only send while queue is empty (phone assumed connected)
+            logSensorStats();
+        } else if (toPhone) {
             sendTelemetry(NODENUM_BROADCAST, true);
             lastSentToPhone = millis();
+        } else if (toHistory) {
+            meshtastic_Telemetry m = meshtastic_Telemetry_init_zero;
+            m.which_variant = meshtastic_Telemetry_environment_metrics_tag;
+            m.time = getTime();
+#ifdef T1000X_SENSOR_EN
+            if (t1000xSensor.getMetrics(&m))
+#else
+            if (getSample(&m))
+#endif
+                telemetryHistory.record(m);
         }
     }
     return min(sendToPhoneIntervalMs, result);
 }
 
+uint32_t EnvironmentTelemetryModule::takeSample()
+{
+#ifdef T1000X_SENSOR_EN
+    // sendTelemetry() reads it directly
+    return 0;
+#endif
+    if (sampleReady) {
+        if (Throttle::isWithinTimespanMs(sampleMsec, ENVIRONMENTAL_TELEMETRY_SAMPLE_MAX_AGE_MS))
+            return 0;
+        sampleReady = false;
+        samplesTaken = 0;
+        averager.reset();
+    }
+
+    if (!converting) {
+        uint32_t wait = 0;
+#if !MESHTASTIC_EXCLUDE_ENVIRONMENTAL_SENSOR_EXTERNAL
+        for (TelemetrySensor *sensor : environmentSensors)
+            if (sensor->hasSensor())
+                wait = max(wait, sensor->startMeasurement());
+#endif
+        converting = true;
+        conversionDoneMsec = millis() + wait;
+    }
+    int32_t remaining = (int32_t)(conversionDoneMsec - millis());
+    if (remaining > 0)
+        return remaining;
+#if !MESHTASTIC_EXCLUDE_ENVIRONMENTAL_SENSOR_EXTERNAL
+    // Some sensors can tell when they need a little longer
+    uint32_t wait = 0;
+    for (TelemetrySensor *sensor : environmentSensors)
+        if (sensor->hasSensor())
+            wait = max(wait, sensor->measurementDueIn());
+    if (wait > 0)
+        return wait;
+#endif
+    converting = false;
+
+    meshtastic_Telemetry m = meshtastic_Telemetry_init_zero;
+    if (getEnvironmentTelemetry(&m))
+        averager.add(m.variant.environment_metrics);
+    if (++samplesTaken < ENVIRONMENTAL_TELEMETRY_OVERSAMPLE)
+        return ENVIRONMENTAL_TELEMETRY_OVERSAMPLE_INTERVAL_MS;
+
+    sampleReady = true;
+    sampleMsec = millis();
+    return 0;
+}
+
+bool EnvironmentTelemetryModule::getSample(meshtastic_Telemetry *m)
+{
+    // runOnce() takes the sample before it gets here, measuring now would mean waiting for the sensors
+    if (!sampleReady)
+        return false;
+
+    bool valid = averager.count() > 0;
+    if (valid) {
+        m->variant.environment_metrics = averager.get();
+        lastSample = *m;
+        hasLastSample = true;
+    }
+    sampleReady = false;
+    samplesTaken = 0;
+    averager.reset();
+    return valid;
+}
+
+bool EnvironmentTelemetryModule::measureNow(meshtastic_Telemetry *m)
+{
+#if !MESHTASTIC_EXCLUDE_ENVIRONMENTAL_SENSOR_EXTERNAL
+    // Like the sensor libraries would, wait for the conversions right here. This only happens before our first sample.
+    uint32_t wait = 0;
+    for (TelemetrySensor *sensor : environmentSensors)
+        if (sensor->hasSensor())
+            wait = max(wait, sensor->startMeasurement());
+    delay(wait);
+    for (TelemetrySensor *sensor : environmentSensors)
+        if (sensor->hasSensor())
+            while ((wait = sensor->measurementDueIn()) > 0)
+                delay(wait);
+    // We used up any conversion takeSample() was waiting for, so it has to start over
+    converting = false;
+#endif
+    return getEnvironmentTelemetry(m);
+}
+
+void EnvironmentTelemetryModule::logSensorStats()
+{
+#if !MESHTASTIC_EXCLUDE_ENVIRONMENTAL_SENSOR_EXTERNAL
+    for (TelemetrySensor *sensor : environmentSensors)
+        if (sensor->hasSensor())
+            sensor->logReadStats();
+#endif
+}
+
 bool EnvironmentTelemetryModule::wantUIFrame()
 {
     return moduleConfig.telemetry.environment_screen_enabled;
@@ -496,129 +629,129 @@ bool EnvironmentTelemetryModule::getEnvironmentTelemetry(meshtastic_Telemetry *m
     hasSensor = true;
 #else
     if (dfRobotLarkSensor.hasSensor()) {
-        valid = valid && dfRobotLarkSensor.getMetrics(m);
+        valid = valid && dfRobotLarkSensor.readMetrics(m);
         hasSensor = true;
     }
     if (dfRobotGravitySensor.hasSensor()) {
-        valid = valid && dfRobotGravitySensor.getMetrics(m);
+        valid = valid && dfRobotGravitySensor.readMetrics(m);
         hasSensor = true;
     }
     if (sht31Sensor.hasSensor()) {
-        valid = valid && sht31Sensor.getMetrics(m);
+        valid = valid && sht31Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (sht4xSensor.hasSensor()) {
-        valid = valid && sht4xSensor.getMetrics(m);
+        valid = valid && sht4xSensor.readMetrics(m);
         hasSensor = true;
     }
     if (lps22hbSensor.hasSensor()) {
-        valid = valid && lps22hbSensor.getMetrics(m);
+        valid = valid && lps22hbSensor.readMetrics(m);
         hasSensor = true;
     }
     if (shtc3Sensor.hasSensor()) {
-        valid = valid && shtc3Sensor.getMetrics(m);
+        valid = valid && shtc3Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (bmp085Sensor.hasSensor()) {
-        valid = valid && bmp085Sensor.getMetrics(m);
+        valid = valid && bmp085Sensor.readMetrics(m);
         hasSensor = true;
     }
 #if __has_include(<Adafruit_BME280.h>)
     if (bmp280Sensor.hasSensor()) {
-        valid = valid && bmp280Sensor.getMetrics(m);
+        valid = valid && bmp280Sensor.readMetrics(m);
         hasSensor = true;
     }
 #endif
     if (bme280Sensor.hasSensor()) {
-        valid = valid && bme280Sensor.getMetrics(m);
+        valid = valid && bme280Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (ltr390uvSensor.hasSensor()) {
-        valid = valid && ltr390uvSensor.getMetrics(m);
+        valid = valid && ltr390uvSensor.readMetrics(m);
         hasSensor = true;
     }
     if (bmp3xxSensor.hasSensor()) {
-        valid = valid && bmp3xxSensor.getMetrics(m);
+        valid = valid && bmp3xxSensor.readMetrics(m);
         hasSensor = true;
     }
     if (bme680Sensor.hasSensor()) {
-        valid = valid && bme680Sensor.getMetrics(m);
+        valid = valid && bme680Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (dps310Sensor.hasSensor()) {
-        valid = valid && dps310Sensor.getMetrics(m);
+        valid = valid && dps310Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (mcp9808Sensor.hasSensor()) {
-        valid = valid && mcp9808Sensor.getMetrics(m);
+        valid = valid && mcp9808Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (ina219Sensor.hasSensor()) {
-        valid = valid && ina219Sensor.getMetrics(m);
+        valid = valid && ina219Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (ina260Sensor.hasSensor()) {
-        valid = valid && ina260Sensor.getMetrics(m);
+        valid = valid && ina260Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (ina3221Sensor.hasSensor()) {
-        valid = valid && ina3221Sensor.getMetrics(m);
+        valid = valid && ina3221Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (veml7700Sensor.hasSensor()) {
-        valid = valid && veml7700Sensor.getMetrics(m);
+        valid = valid && veml7700Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (tsl2591Sensor.hasSensor()) {
-        valid = valid && tsl2591Sensor.getMetrics(m);
+        valid = valid && tsl2591Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (opt3001Sensor.hasSensor()) {
-        valid = valid && opt3001Sensor.getMetrics(m);
+        valid = valid && opt3001Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (mlx90632Sensor.hasSensor()) {
-        valid = valid && mlx90632Sensor.getMetrics(m);
+        valid = valid && mlx90632Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (rcwl9620Sensor.hasSensor()) {
-        valid = valid && rcwl9620Sensor.getMetrics(m);
+        valid = valid && rcwl9620Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (nau7802Sensor.hasSensor()) {
-        valid = valid && nau7802Sensor.getMetrics(m);
+        valid = valid && nau7802Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (aht10Sensor.hasSensor()) {
         if (!bmp280Sensor.hasSensor() && !bmp3xxSensor.hasSensor()) {
-            valid = valid && aht10Sensor.getMetrics(m);
+            valid = valid && aht10Sensor.readMetrics(m);
             hasSensor = true;
         } else if (bmp280Sensor.hasSensor()) {
             // prefer bmp280 temp if both sensors are present, fetch only humidity
             meshtastic_Telemetry m_ahtx = meshtastic_Telemetry_init_zero;
             LOG_INFO("AHTX0+BMP280 module detected: using temp from BMP280 and humy from AHTX0");
-            aht10Sensor.getMetrics(&m_ahtx);
+            aht10Sensor.readMetrics(&m_ahtx);
             m->variant.environment_metrics.relative_humidity = m_ahtx.variant.environment_metrics.relative_humidity;
             m->variant.environment_metrics.has_relative_humidity = m_ahtx.variant.environment_metrics.has_relative_humidity;
         } else {
             // prefer bmp3xx temp if both sensors are present, fetch only humidity
             meshtastic_Telemetry m_ahtx = meshtastic_Telemetry_init_zero;
             LOG_INFO("AHTX0+BMP3XX module detected: using temp from BMP3XX and humy from AHTX0");
-            aht10Sensor.getMetrics(&m_ahtx);
+            aht10Sensor.readMetrics(&m_ahtx);
             m->variant.environment_metrics.relative_humidity = m_ahtx.variant.environment_metrics.relative_humidity;
             m->variant.environment_metrics.has_relative_humidity = m_ahtx.variant.environment_metrics.has_relative_humidity;
         }
     }
     if (max17048Sensor.hasSensor()) {
-        valid = valid && max17048Sensor.getMetrics(m);
+        valid = valid && max17048Sensor.readMetrics(m);
         hasSensor = true;
     }
     if (cgRadSens.hasSensor()) {
-        valid = valid && cgRadSens.getMetrics(m);
+        valid = valid && cgRadSens.readMetrics(m);
         hasSensor = true;
     }
     if (pct2075Sensor.hasSensor()) {
-        valid = valid && pct2075Sensor.getMetrics(m);
+        valid = valid && pct2075Sensor.readMetrics(m);
         hasSensor = true;
     }
 #ifdef HAS_RAKPROT
@@ -646,7 +779,13 @@ meshtastic_MeshPacket *EnvironmentTelemetryModule::allocReply()
         // Check for a request for environment metrics
         if (decoded->which_variant == meshtastic_Telemetry_environment_metrics_tag) {
             meshtastic_Telemetry m = meshtastic_Telemetry_init_zero;
-            if (getEnvironmentTelemetry(&m)) {
+            // Sensors which convert in the background can't be read on the spot, so answer with our last measurement
+            bool valid = hasLastSample;
+            if (valid)
+                m = lastSample;
+            else
+                valid = measureNow(&m);
+            if (valid) {
                 LOG_INFO("Environment telemetry reply to request");
                 return allocDataProtobuf(m);
             } else {
@@ -665,7 +804,7 @@ bool EnvironmentTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
 #ifdef T1000X_SENSOR_EN
     if (t1000xSensor.getMetrics(&m)) {
 #else
-    if (getEnvironmentTelemetry(&m)) {
+    if (getSample(&m)) {
 #endif
         LOG_INFO("Send: barometric_pressure=%f, current=%f, gas_resistance=%f, relative_humidity=%f, temperature=%f",
                  m.variant.environment_metrics.barometric_pressure, m.variant.environment_metrics.current,
@@ -680,6 +819,7 @@ bool EnvironmentTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
         LOG_INFO("Send: radiation=%fµR/h", m.variant.environment_metrics.radiation);
 
         sensor_read_error_count = 0;
+        telemetryHistory.record(m);
 
         meshtastic_MeshPacket *p = allocDataProtobuf(m);
         p->to = dest;
@@ -692,7 +832,8 @@ bool EnvironmentTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
         if (lastMeasurementPacket != nullptr)
             packetPool.release(lastMeasurementPacket);
 
-        lastMeasurementPacket = packetPool.allocCopy(*p);
+        // The phone queue leaves packets as they are, but sending to the mesh encrypts p in place
+        lastMeasurementPacket = phoneOnly ? packetPool.share(p) : packetPool.allocCopy(*p);
         if (phoneOnly) {
             LOG_INFO("Send packet to phone");
             service->sendToPhone(p);
@@ -8,7 +8,21 @@
 #define ENVIRONMENTAL_TELEMETRY_MODULE_ENABLE 0
 #endif
 
+/// Number of measurements averaged into each one we send, more than 1 helps with noisy sensors
+#ifndef ENVIRONMENTAL_TELEMETRY_OVERSAMPLE
+#define ENVIRONMENTAL_TELEMETRY_OVERSAMPLE 1
+#endif
+
+/// Time between the measurements we average
+#ifndef ENVIRONMENTAL_TELEMETRY_OVERSAMPLE_INTERVAL_MS
+#define ENVIRONMENTAL_TELEMETRY_OVERSAMPLE_INTERVAL_MS 1000
+#endif
+
+/// If we couldn't send a measurement for this long, it's too old and we take a new one
+#define ENVIRONMENTAL_TELEMETRY_SAMPLE_MAX_AGE_MS (30 * 1000)
+
 #include "../mesh/generated/meshtastic/telemetry.pb.h"
+#include "EnvironmentAverager.h"
 #include "NodeDB.h"
 #include "ProtobufModule.h"
 #include <OLEDDisplay.h>
@@ -46,6 +60,16 @@ class EnvironmentTelemetryModule : private concurrency::OSThread, public Protobu
     @return true if it contains valid data
     */
     bool getEnvironmentTelemetry(meshtastic_Telemetry *m);
+
+    /**
+     * Take the next step of a measurement: start all sensors converting at once, or read them once they're done. This way
+     * we never wait for a conversion.
+     * @return ms until the next step, 0 once the measurement is ready
+     */
+    uint32_t takeSample();
+
+    /** Use up the measurement from takeSample(). false if there is none, or it isn't valid */
+    bool getSample(meshtastic_Telemetry *m);
     virtual meshtastic_MeshPacket *allocReply() override;
     /**
      * Send our Telemetry into the mesh
@@ -63,6 +87,24 @@ class EnvironmentTelemetryModule : private concurrency::OSThread, public Protobu
     uint32_t lastSentToMesh = 0;
     uint32_t lastSentToPhone = 0;
     uint32_t sensor_read_error_count = 0;
+
+    // Measurements for the next packet, samplesTaken also counts the ones which weren't valid
+    EnvironmentAverager averager;
+    uint8_t samplesTaken = 0;
+    // The sensors are converting, until conversionDoneMsec
+    bool converting = false;
+    uint32_t conversionDoneMsec = 0;
+    // averager has all the measurements, since sampleMsec
+    bool sampleReady = false;
+    uint32_t sampleMsec = 0;
+    // The last valid measurement getSample() gave out, to answer requests without waiting for the sensors
+    meshtastic_Telemetry lastSample = meshtastic_Telemetry_init_zero;
+    bool hasLastSample = false;
+
+    /** Measure right away, waiting for the sensors which convert in the background */
+    bool measureNow(meshtastic_Telemetry *m);
+
+    void logSensorStats();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include "GorillaBlock.h"
+#include <string.h>
+
+/// No XOR window has been written yet, so the next changed value has to describe its own
+#define NO_WINDOW 0xFF
+
+static uint32_t floatBits(float f)
+{
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+static float bitsFloat(uint32_t v)
+{
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+void GorillaBlock::reset(uint8_t metric, uint8_t tier)
+{
+    memset(&header, 0, sizeof(header));
+    header.metric = metric;
+    header.tier = tier;
+    prevDelta = 0;
+    prevValue = 0;
+    prevLeading = NO_WINDOW;
+    prevTrailing = 0;
+}
+
+bool GorillaBlock::writeBits(uint32_t v, uint8_t n)
+{
+    if (header.bits + n > GORILLA_BLOCK_BYTES * 8)
+        return false;
+    // Bits past header.bits may be left over from a point which didn't fit, so every bit is set or cleared
+    while (n--) {
+        uint8_t mask = 0x80 >> (header.bits & 7);
+        if ((v >> n) & 1)
+            data[header.bits >> 3] |= mask;
+        else
+            data[header.bits >> 3] &= ~mask;
+        header.bits++;
+    }
+    return true;
+}
+
+bool GorillaBlock::append(uint32_t time, float value)
+{
+    uint32_t bits = floatBits(value);
+    if (header.count == 0) {
+        header.startTime = header.lastTime = time;
+        header.firstValue = value;
+        header.count = 1;
+        prevValue = bits;
+        return true;
+    }
+    if (time < header.lastTime || header.count == UINT16_MAX)
+        return false;
+
+    uint16_t startBits = header.bits;
+    bool ok;
+
+    // Change of the interval, most often 0 as samples are taken at a steady rate
+    uint32_t delta = time - header.lastTime;
+    int64_t dod = (int64_t)delta - prevDelta;
+    if (dod == 0)
+        ok = writeBits(0, 1);
+    else if (dod >= -64 && dod < 64)
+        ok = writeBits(0x2, 2) && writeBits((uint32_t)dod, 7);
+    else if (dod >= -256 && dod < 256)
+        ok = writeBits(0x6, 3) && writeBits((uint32_t)dod, 9);
+    else if (dod >= -2048 && dod < 2048)
+        ok = writeBits(0xE, 4) && writeBits((uint32_t)dod, 12);
+    else
+        ok = writeBits(0xF, 4) && writeBits(delta, 32);
+
+    // Only the bits which changed, reusing the previous window of them if they fit in it
+    uint32_t x = bits ^ prevValue;
+    uint8_t leading = prevLeading, trailing = prevTrailing;
+    if (ok && x == 0) {
+        ok = writeBits(0, 1);
+    } else if (ok) {
+        uint8_t l = __builtin_clz(x), t = __builtin_ctz(x);
+        if (prevLeading != NO_WINDOW && l >= prevLeading && t >= prevTrailing) {
+            ok = writeBits(0x2, 2) && writeBits(x >> prevTrailing, 32 - prevLeading - prevTrailing);
+        } else {
+            leading = l;
+            trailing = t;
+            uint8_t len = 32 - l - t;
+            ok = writeBits(0x3, 2) && writeBits(l, 5) && writeBits(len - 1, 5) && writeBits(x >> t, len);
+        }
+    }
+
+    if (!ok) {
+        header.bits = startBits;
+        return false;
+    }
+    header.count++;
+    header.lastTime = time;
+    prevDelta = delta;
+    prevValue = bits;
+    prevLeading = leading;
+    prevTrailing = trailing;
+    return true;
+}
+
+GorillaReader::GorillaReader(const GorillaBlockHeader &header, const uint8_t *data) : header(header), data(data) {}
+
+bool GorillaReader::readBits(uint8_t n, uint32_t &v)
+{
+    if (pos + n > header.bits)
+        return false;
+    v = 0;
+    while (n--) {
+        v = (v << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1);
+        pos++;
+    }
+    return true;
+}
+
+/// Sign extend the low n bits of v
+static int32_t fromBits(uint32_t v, uint8_t n)
+{
+    return (int32_t)(v << (32 - n)) >> (32 - n);
+}
+
+bool GorillaReader::next(uint32_t &time, float &value)
+{
+    if (read >= header.count)
+        return false;
+    if (read++ == 0) {
+        time = prevTime = header.startTime;
+        value = header.firstValue;
+        prevValue = floatBits(value);
+        return true;
+    }
+
+    uint32_t b, v;
+    uint8_t prefix = 0;
+    // Up to four 1 bits pick the size of the change of interval
+    while (prefix < 4) {
+        if (!readBits(1, b))
+            return false;
+        if (!b)
+            break;
+        prefix++;
+    }
+    static const uint8_t dodBits[] = {0, 7, 9, 12};
+    if (prefix == 4) {
+        if (!readBits(32, prevDelta))
+            return false;
+    } else if (prefix > 0) {
+        if (!readBits(dodBits[prefix], v))
+            return false;
+        prevDelta += fromBits(v, dodBits[prefix]);
+    }
+    prevTime += prevDelta;
+
+    if (!readBits(1, b))
+        return false;
+    if (b) {
+        if (!readBits(1, b))
+            return false;
+        if (b) {
+            uint32_t l, len;
+            if (!readBits(5, l) || !readBits(5, len))
+                return false;
+            len++;
+            if (l + len > 32)
+                return false;
+            prevLeading = l;
+            prevTrailing = 32 - l - len;
+        }
+        uint8_t len = 32 - prevLeading - prevTrailing;
+        if (!readBits(len, v))
+            return false;
+        prevValue ^= v << prevTrailing;
+    }
+
+    time = prevTime;
+    value = bitsFloat(prevValue);
+    return true;
+}
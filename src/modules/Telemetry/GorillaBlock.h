@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Bytes of compressed points in one block
+#ifndef GORILLA_BLOCK_BYTES
+#if ARCH_PORTDUINO
+#define GORILLA_BLOCK_BYTES 256
+#else
+#define GORILLA_BLOCK_BYTES 64
+#endif
+#endif
+
+/// Describes a block of points, and precedes its data in a saved telemetry history. 20 bytes little endian
+struct GorillaBlockHeader {
+    uint32_t startTime; // Time of the first point, in seconds
+    uint32_t lastTime;  // Time of the last point
+    float firstValue;   // Value of the first point, which is stored as is
+    uint16_t count;     // Number of points
+    uint16_t bits;      // Bits of compressed data for the points after the first
+    uint8_t metric;     // What the points are, not used by the block itself
+    uint8_t tier;       // Resolution of the points, not used by the block itself
+    uint16_t reserved;
+};
+
+/**
+ * A time series compressed the way Facebook's Gorilla does it, into a fixed buffer.
+ *
+ * Timestamps are stored as the change from the previous interval, which is a single 0 bit for samples taken at a steady
+ * rate. Values are XORed with the previous one and only the bits which differ are stored, a single 0 bit if the value
+ * didn't change. Slowly changing sensor readings take a few bits to a few bytes per point, instead of the 8 bytes of a
+ * time and a float.
+ *
+ * Each block is self-contained, so blocks can be dropped from the front of a ring or sent on their own.
+ */
+class GorillaBlock
+{
+  public:
+    GorillaBlockHeader header;
+    uint8_t data[GORILLA_BLOCK_BYTES];
+
+    void reset(uint8_t metric, uint8_t tier);
+
+    /** Append a point, false if it doesn't fit or time went backwards, so a new block has to be started */
+    bool append(uint32_t time, float value);
+
+    bool empty() const { return header.count == 0; }
+
+    /// Bytes of data in use
+    size_t dataBytes() const { return (header.bits + 7) / 8; }
+
+  private:
+    // Where the encoder left off, so the next point can be appended
+    uint32_t prevDelta;
+    uint32_t prevValue;
+    uint8_t prevLeading, prevTrailing;
+
+    bool writeBits(uint32_t v, uint8_t n);
+};
+
+/**
+ * Reads the points back out of a block, or out of a block header and its data from a saved history
+ */
+class GorillaReader
+{
+  public:
+    GorillaReader(const GorillaBlockHeader &header, const uint8_t *data);
+
+    /** The next point, false once all have been read or the data is corrupt */
+    bool next(uint32_t &time, float &value);
+
+  private:
+    const GorillaBlockHeader &header;
+    const uint8_t *data;
+    uint32_t pos = 0;
+    uint16_t read = 0;
+    uint32_t prevTime = 0, prevDelta = 0, prevValue = 0;
+    uint8_t prevLeading = 0, prevTrailing = 0;
+
+    bool readBits(uint8_t n, uint32_t &v);
+};
@@ -10,6 +10,7 @@
 #include "PowerFSM.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "UnitConversions.h"
 #include "main.h"
 #include "power.h"
@@ -83,6 +84,12 @@ int32_t HealthTelemetryModule::runOnce()
             // Only send while queue is empty (phone assumed connected)
             sendTelemetry(NODENUM_BROADCAST, true);
             lastSentToPhone = millis();
+        } else if (telemetryHistory.isDue(meshtastic_Telemetry_health_metrics_tag)) {
+            meshtastic_Telemetry m = meshtastic_Telemetry_init_zero;
+            m.which_variant = meshtastic_Telemetry_health_metrics_tag;
+            m.time = getTime();
+            if (getHealthTelemetry(&m))
+                telemetryHistory.record(m);
         }
     }
     return min(sendToPhoneIntervalMs, result);
@@ -215,6 +222,7 @@ bool HealthTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
                  m.variant.health_metrics.heart_bpm, m.variant.health_metrics.spO2);
 
         sensor_read_error_count = 0;
+        telemetryHistory.record(m);
 
         meshtastic_MeshPacket *p = allocDataProtobuf(m);
         p->to = dest;
@@ -227,7 +235,7 @@ bool HealthTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
         if (lastMeasurementPacket != nullptr)
             packetPool.release(lastMeasurementPacket);
 
-        lastMeasurementPacket = packetPool.allocCopy(*p);
+        lastMeasurementPacket = phoneOnly ? packetPool.share(p) : packetPool.allocCopy(*p);
         if (phoneOnly) {
             LOG_INFO("Send packet to phone");
             service->sendToPhone(p);
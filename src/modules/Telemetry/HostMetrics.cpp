@@ -3,7 +3,6 @@
 #include "MeshService.h"
 #if ARCH_PORTDUINO
 #include "PortduinoGlue.h"
-#include <filesystem>
 #endif
 
 int32_t HostMetricsModule::runOnce()
@@ -11,10 +10,38 @@ int32_t HostMetricsModule::runOnce()
 #if ARCH_PORTDUINO
     if (settingsMap[hostMetrics_interval] == 0) {
         return disable();
-    } else {
-        sendMetrics();
-        return 60 * 1000 * settingsMap[hostMetrics_interval];
     }
+
+    uint32_t now = millis();
+    uint32_t reportIntervalMs = 60 * 1000 * settingsMap[hostMetrics_interval];
+    if (nextSendMs == 0) {
+        // First run, after the start delay. Take a baseline sample so the first report has CPU rates to show
+        sampler.sample();
+        nextSendMs = now + sampleIntervalMs;
+        return sampleIntervalMs;
+    }
+
+    if ((int32_t)(now - nextSendMs) < 0) {
+        sampler.sample();
+        return min(sampleIntervalMs, nextSendMs - now);
+    }
+
+    // Time to report. The user command runs in a child process, poll it rather than waiting for it
+    if (settingsStrings[hostMetrics_user_command] != "") {
+        auto state = userCommand.poll();
+        if (state == HostCommandRunner::IDLE && userCommand.start(settingsStrings[hostMetrics_user_command].c_str(),
+                                                                  settingsMap[hostMetrics_user_command_timeout] * 1000))
+            return 50;
+        if (state == HostCommandRunner::RUNNING)
+            return 50;
+    }
+
+    sampler.sample();
+    sendMetrics();
+    sampler.resetAggregates();
+    userCommand.clear();
+    nextSendMs = millis() + reportIntervalMs;
+    return min(sampleIntervalMs, reportIntervalMs);
 #else
     return disable();
 #endif
@@ -69,51 +96,21 @@ meshtastic_MeshPacket *HostMetricsModule::allocReply()
 #if ARCH_PORTDUINO
 meshtastic_Telemetry HostMetricsModule::getHostMetrics()
 {
-    std::string file_line;
     meshtastic_Telemetry t = meshtastic_Telemetry_init_zero;
     t.which_variant = meshtastic_Telemetry_host_metrics_tag;
     t.variant.host_metrics = meshtastic_HostMetrics_init_zero;
 
-    if (access("/proc/uptime", R_OK) == 0) {
-        std::ifstream proc_uptime("/proc/uptime");
-        if (proc_uptime.is_open()) {
-            std::getline(proc_uptime, file_line, ' ');
-            proc_uptime.close();
-            t.variant.host_metrics.uptime_seconds = stoul(file_line);
-        }
-    }
-
-    std::filesystem::space_info root = std::filesystem::space("/");
-    t.variant.host_metrics.diskfree1_bytes = root.available;
+    // Values come from the most recent sample, taken just before sending
+    t.variant.host_metrics.uptime_seconds = sampler.uptimeSeconds;
+    t.variant.host_metrics.diskfree1_bytes = sampler.diskfreeBytes;
+    t.variant.host_metrics.freemem_bytes = sampler.freememBytes;
+    t.variant.host_metrics.load1 = sampler.load1;
+    t.variant.host_metrics.load5 = sampler.load5;
+    t.variant.host_metrics.load15 = sampler.load15;
 
-    if (access("/proc/meminfo", R_OK) == 0) {
-        std::ifstream proc_meminfo("/proc/meminfo");
-        if (proc_meminfo.is_open()) {
-            do {
-                std::getline(proc_meminfo, file_line);
-            } while (file_line.find("MemAvailable") == std::string::npos);
-            proc_meminfo.close();
-            t.variant.host_metrics.freemem_bytes = stoull(file_line.substr(file_line.find_first_of("0123456789"))) * 1024;
-        }
-    }
-    if (access("/proc/loadavg", R_OK) == 0) {
-        std::ifstream proc_loadavg("/proc/loadavg");
-        if (proc_loadavg.is_open()) {
-            std::getline(proc_loadavg, file_line, ' ');
-            t.variant.host_metrics.load1 = stof(file_line) * 100;
-            std::getline(proc_loadavg, file_line, ' ');
-            t.variant.host_metrics.load5 = stof(file_line) * 100;
-            std::getline(proc_loadavg, file_line, ' ');
-            t.variant.host_metrics.load15 = stof(file_line) * 100;
-            proc_loadavg.close();
-        }
-    }
-    if (settingsStrings[hostMetrics_user_command] != "") {
-        std::string userCommandResult = exec(settingsStrings[hostMetrics_user_command].c_str());
-        if (userCommandResult.length() > 1) {
-            strncpy(t.variant.host_metrics.user_string, userCommandResult.c_str(), 200);
-            t.variant.host_metrics.has_user_string = true;
-        }
+    if (userCommand.poll() == HostCommandRunner::DONE && strlen(userCommand.getResult()) > 1) {
+        strncpy(t.variant.host_metrics.user_string, userCommand.getResult(), sizeof(t.variant.host_metrics.user_string) - 1);
+        t.variant.host_metrics.has_user_string = true;
     }
     return t;
 }
@@ -127,6 +124,14 @@ bool HostMetricsModule::sendMetrics()
              static_cast<float>(telemetry.variant.host_metrics.load5) / 100,
              static_cast<float>(telemetry.variant.host_metrics.load15) / 100,
              telemetry.variant.host_metrics.has_user_string ? telemetry.variant.host_metrics.user_string : "");
+    // These don't fit in HostMetrics, so they're only logged
+    LOG_INFO("Host cpu%% min/avg/max=%.1f/%.1f/%.1f, meshtasticd cpu%%=%.1f/%.1f/%.1f rss=%lu/%lu/%lu KB, fds=%u, samples=%u",
+             sampler.cpuAgg.min, sampler.cpuAgg.avg(), sampler.cpuAgg.max, sampler.processCpuAgg.min,
+             sampler.processCpuAgg.avg(), sampler.processCpuAgg.max, (unsigned long)sampler.rssAgg.min / 1024,
+             (unsigned long)sampler.rssAgg.avg() / 1024, (unsigned long)sampler.rssAgg.max / 1024, sampler.openFds,
+             sampler.cpuAgg.count);
+    for (auto &thread : sampler.getThreads())
+        LOG_DEBUG("  thread %d %s cpu%%=%.1f", thread.tid, thread.name, thread.cpuPercent);
 
     meshtastic_MeshPacket *p = allocDataProtobuf(telemetry);
     p->to = NODENUM_BROADCAST;
@@ -1,6 +1,7 @@
 #pragma once
 #include "../mesh/generated/meshtastic/telemetry.pb.h"
 #include "ProtobufModule.h"
+#include "modules/Telemetry/HostMetricsSampler.h"
 
 class HostMetricsModule : private concurrency::OSThread, public ProtobufModule<meshtastic_Telemetry>
 {
@@ -34,7 +35,16 @@ class HostMetricsModule : private concurrency::OSThread, public ProtobufModule<m
   private:
     meshtastic_Telemetry getHostMetrics();
 
+#if ARCH_PORTDUINO
+    /// How often we sample between reports, so the min/avg/max aggregates mean something
+    static constexpr uint32_t sampleIntervalMs = 30 * 1000;
+
+    HostMetricsSampler sampler;
+    HostCommandRunner userCommand;
+    uint32_t nextSendMs = 0;
+#endif
+
     uint32_t lastSentToMesh = 0;
     uint32_t uptimeWrapCount;
     uint32_t uptimeLastMs;
-};
\ No newline at end of file
+};
@@ -0,0 +1,419 @@
+#include "HostMetricsSampler.h"
+
+#if ARCH_PORTDUINO
+#include <algorithm>
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Small in-place parsers, so sampling doesn't need iostreams or temporary strings
+
+static const char *skipSpaces(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\n')
+        p++;
+    return p;
+}
+
+static const char *skipField(const char *p)
+{
+    p = skipSpaces(p);
+    while (*p && *p != ' ' && *p != '\t' && *p != '\n')
+        p++;
+    return p;
+}
+
+static uint64_t parseUint(const char *&p)
+{
+    p = skipSpaces(p);
+    uint64_t v = 0;
+    while (*p >= '0' && *p <= '9')
+        v = v * 10 + (*p++ - '0');
+    return v;
+}
+
+/// Parse a decimal such as "0.52" into hundredths (52), which is how HostMetrics transports load averages
+static uint32_t parseHundredths(const char *&p)
+{
+    uint32_t v = parseUint(p) * 100;
+    if (*p == '.') {
+        p++;
+        if (*p >= '0' && *p <= '9')
+            v += (*p++ - '0') * 10;
+        if (*p >= '0' && *p <= '9')
+            v += (*p++ - '0');
+        while (*p >= '0' && *p <= '9')
+            p++;
+    }
+    return v;
+}
+
+/// Find a "Key:   value kB" line in a /proc file such as meminfo, returning the value
+static bool findKeyValue(const char *buf, const char *key, uint64_t &value)
+{
+    size_t keyLen = strlen(key);
+    for (const char *p = buf; p && *p; p = strchr(p, '\n'), p = p ? p + 1 : p) {
+        if (strncmp(p, key, keyLen) == 0 && p[keyLen] == ':') {
+            p += keyLen + 1;
+            value = parseUint(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+/// For /proc/<pid>/stat style files: return a pointer just past the "(comm)" field, copying comm if asked to
+static const char *skipComm(const char *buf, char *comm = NULL, size_t commLen = 0)
+{
+    const char *open = strchr(buf, '(');
+    const char *close = strrchr(buf, ')'); // comm can itself contain ')'
+    if (!open || !close || close < open)
+        return NULL;
+    if (comm && commLen) {
+        size_t n = close - open - 1;
+        if (n >= commLen)
+            n = commLen - 1;
+        memcpy(comm, open + 1, n);
+        comm[n] = '\0';
+    }
+    return close + 1;
+}
+
+/// utime + stime from a /proc/<pid>/stat line, these are fields 14 and 15, counting comm as field 2
+static uint64_t parseStatTicks(const char *afterComm)
+{
+    const char *p = afterComm;
+    for (int field = 3; field < 14; field++)
+        p = skipField(p);
+    uint64_t utime = parseUint(p);
+    uint64_t stime = parseUint(p);
+    return utime + stime;
+}
+
+ProcFile::ProcFile(const char *path)
+{
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        LOG_WARN("HostMetrics: can't open %s", path);
+}
+
+ProcFile::~ProcFile()
+{
+    if (fd >= 0)
+        close(fd);
+}
+
+ssize_t ProcFile::read(char *buf, size_t bufLen)
+{
+    if (fd < 0 || bufLen == 0)
+        return -1;
+    ssize_t n = pread(fd, buf, bufLen - 1, 0);
+    buf[n > 0 ? n : 0] = '\0';
+    return n;
+}
+
+HostMetricsSampler::HostMetricsSampler()
+{
+    ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (ticksPerSecond <= 0)
+        ticksPerSecond = 100;
+    pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize <= 0)
+        pageSize = 4096;
+}
+
+HostMetricsSampler::~HostMetricsSampler()
+{
+    for (auto &t : threads)
+        if (t.fd >= 0)
+            close(t.fd);
+}
+
+void HostMetricsSampler::sample()
+{
+    uint64_t now = millis();
+    float elapsedTicks = lastSampleMs ? (float)(now - lastSampleMs) * ticksPerSecond / 1000 : 0;
+    lastSampleMs = now;
+
+    sampleUptime();
+    sampleMeminfo();
+    sampleLoadavg();
+    sampleCpu();
+    sampleProcess(elapsedTicks);
+    sampleThreads(elapsedTicks);
+    sampleFds();
+    sampleDisk();
+
+    cpuAgg.add(cpuPercent);
+    processCpuAgg.add(processCpuPercent);
+    rssAgg.add(rssBytes);
+    freememAgg.add(freememBytes);
+    load1Agg.add(load1);
+}
+
+void HostMetricsSampler::resetAggregates()
+{
+    cpuAgg.reset();
+    processCpuAgg.reset();
+    rssAgg.reset();
+    freememAgg.reset();
+    load1Agg.reset();
+}
+
+void HostMetricsSampler::sampleUptime()
+{
+    char buf[64];
+    if (uptimeFile.read(buf, sizeof(buf)) > 0) {
+        const char *p = buf;
+        uptimeSeconds = parseUint(p);
+    }
+}
+
+void HostMetricsSampler::sampleMeminfo()
+{
+    // MemAvailable is within the first few lines, no need to read the whole (2+ KB) file
+    char buf[512];
+    uint64_t kb;
+    if (meminfoFile.read(buf, sizeof(buf)) > 0 && findKeyValue(buf, "MemAvailable", kb))
+        freememBytes = kb * 1024;
+}
+
+void HostMetricsSampler::sampleLoadavg()
+{
+    char buf[128];
+    if (loadavgFile.read(buf, sizeof(buf)) > 0) {
+        const char *p = buf;
+        load1 = parseHundredths(p);
+        load5 = parseHundredths(p);
+        load15 = parseHundredths(p);
+    }
+}
+
+void HostMetricsSampler::sampleCpu()
+{
+    // Only the aggregate "cpu" line at the top is needed
+    char buf[256];
+    if (statFile.read(buf, sizeof(buf)) <= 0 || strncmp(buf, "cpu ", 4) != 0)
+        return;
+
+    const char *p = buf + 4;
+    uint64_t fields[8];
+    for (auto &f : fields)
+        f = parseUint(p);
+    uint64_t idle = fields[3] + fields[4]; // idle + iowait
+    uint64_t total = 0;
+    for (auto f : fields)
+        total += f;
+
+    if (lastCpuTotal && total > lastCpuTotal) {
+        uint64_t dTotal = total - lastCpuTotal;
+        uint64_t dIdle = idle - lastCpuIdle;
+        cpuPercent = 100.0f * (dTotal - dIdle) / dTotal;
+    }
+    lastCpuTotal = total;
+    lastCpuIdle = idle;
+}
+
+void HostMetricsSampler::sampleProcess(float elapsedTicks)
+{
+    char buf[512];
+    if (selfStatFile.read(buf, sizeof(buf)) > 0) {
+        const char *p = skipComm(buf);
+        if (p) {
+            uint64_t ticks = parseStatTicks(p);
+            if (elapsedTicks > 0)
+                processCpuPercent = 100.0f * (ticks - lastProcessTicks) / elapsedTicks;
+            lastProcessTicks = ticks;
+        }
+    }
+
+    if (selfStatmFile.read(buf, sizeof(buf)) > 0) {
+        const char *p = buf;
+        parseUint(p); // total program size
+        rssBytes = parseUint(p) * pageSize;
+    }
+}
+
+void HostMetricsSampler::sampleThreads(float elapsedTicks)
+{
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir)
+        return;
+
+    // Mark everything stale, then keep only the tids we still find
+    for (auto &t : threads)
+        t.cpuPercent = -1;
+
+    char path[64];
+    char buf[512];
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (ent->d_name[0] < '0' || ent->d_name[0] > '9')
+            continue;
+        pid_t tid = atoi(ent->d_name);
+
+        HostThreadStat *t = NULL;
+        bool isNew = false;
+        for (auto &existing : threads)
+            if (existing.tid == tid)
+                t = &existing;
+        if (!t) {
+            HostThreadStat fresh;
+            fresh.tid = tid;
+            snprintf(path, sizeof(path), "/proc/self/task/%d/stat", tid);
+            fresh.fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fresh.fd < 0)
+                continue;
+            threads.push_back(fresh);
+            t = &threads.back();
+            isNew = true;
+        }
+
+        ssize_t n = pread(t->fd, buf, sizeof(buf) - 1, 0);
+        if (n <= 0)
+            continue;
+        buf[n] = '\0';
+        const char *p = skipComm(buf, t->name, sizeof(t->name));
+        if (!p)
+            continue;
+        uint64_t ticks = parseStatTicks(p);
+        t->cpuPercent = (elapsedTicks > 0 && !isNew) ? 100.0f * (ticks - t->lastTicks) / elapsedTicks : 0;
+        t->lastTicks = ticks;
+    }
+    closedir(dir);
+
+    for (auto it = threads.begin(); it != threads.end();) {
+        if (it->cpuPercent < 0) {
+            close(it->fd);
+            it = threads.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void HostMetricsSampler::sampleFds()
+{
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir)
+        return;
+    uint32_t count = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL)
+        if (ent->d_name[0] != '.')
+            count++;
+    closedir(dir);
+    openFds = count ? count - 1 : 0; // don't count the fd opendir itself is using
+}
+
+void HostMetricsSampler::sampleDisk()
+{
+    // statvfs rather than std::filesystem::space, which throws on error
+    struct statvfs vfs;
+    if (statvfs("/", &vfs) == 0)
+        diskfreeBytes = (uint64_t)vfs.f_bavail * vfs.f_frsize;
+}
+
+HostCommandRunner::~HostCommandRunner()
+{
+    if (state == RUNNING)
+        finish(true);
+}
+
+bool HostCommandRunner::start(const char *cmd, uint32_t _timeoutMs)
+{
+    if (state == RUNNING)
+        return true;
+
+    int pipefd[2];
+    if (pipe2(pipefd, O_CLOEXEC) != 0) {
+        LOG_ERROR("HostMetrics: pipe() failed");
+        return false;
+    }
+
+    pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("HostMetrics: fork() failed");
+        close(pipefd[0]);
+        close(pipefd[1]);
+        return false;
+    }
+    if (pid == 0) {
+        // Child, only async-signal-safe calls from here on. Own process group, so a timeout kills the whole pipeline
+        setpgid(0, 0);
+        dup2(pipefd[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+        _exit(127);
+    }
+
+    close(pipefd[1]);
+    fd = pipefd[0];
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    startedMs = millis();
+    timeoutMs = _timeoutMs;
+    len = 0;
+    result[0] = '\0';
+    state = RUNNING;
+    return true;
+}
+
+void HostCommandRunner::drain()
+{
+    if (fd < 0)
+        return;
+    char buf[256];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        // Keep what fits, but keep draining so the child never blocks on a full pipe
+        size_t keep = std::min((size_t)n, maxLen - 1 - len);
+        memcpy(result + len, buf, keep);
+        len += keep;
+        result[len] = '\0';
+    }
+    if (n == 0) { // EOF, the child closed stdout
+        close(fd);
+        fd = -1;
+    }
+}
+
+HostCommandRunner::State HostCommandRunner::poll()
+{
+    if (state != RUNNING)
+        return state;
+
+    drain();
+
+    if (waitpid(pid, NULL, WNOHANG) == pid) {
+        pid = -1;
+        // It may have written more between the read above and exiting
+        drain();
+        finish(false);
+    } else if (timeoutMs && millis() - startedMs > timeoutMs) {
+        LOG_WARN("HostMetrics: UserStringCommand timed out after %u ms, killed", timeoutMs);
+        finish(true);
+    }
+    return state;
+}
+
+void HostCommandRunner::finish(bool killChild)
+{
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    if (pid > 0) {
+        if (killChild)
+            if (kill(-pid, SIGKILL) != 0)
+                kill(pid, SIGKILL);
+        // Only reached after SIGKILL, so this reaps immediately
+        waitpid(pid, NULL, 0);
+        pid = -1;
+    }
+    state = DONE;
+}
+#endif
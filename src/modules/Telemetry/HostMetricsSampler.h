@@ -0,0 +1,163 @@
+#pragma once
+#include "configuration.h"
+
+#if ARCH_PORTDUINO
+#include <stdint.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/**
+ * Running min/avg/max of one metric, accumulated between two broadcasts
+ */
+struct HostMetricAggregate {
+    float min = 0;
+    float max = 0;
+    float sum = 0;
+    uint32_t count = 0;
+
+    void add(float v)
+    {
+        if (count == 0 || v < min)
+            min = v;
+        if (count == 0 || v > max)
+            max = v;
+        sum += v;
+        count++;
+    }
+
+    float avg() const { return count ? sum / count : 0; }
+
+    void reset() { *this = HostMetricAggregate(); }
+};
+
+/**
+ * A /proc (or /sys) file that we keep open for the life of the process and re-read with pread(), so sampling never
+ * goes through open()/iostreams again.
+ */
+class ProcFile
+{
+  public:
+    explicit ProcFile(const char *path);
+    ~ProcFile();
+    ProcFile(const ProcFile &) = delete;
+    ProcFile &operator=(const ProcFile &) = delete;
+
+    /// Read the whole file into buf (always NUL terminated). Returns the number of bytes read, or -1 on error
+    ssize_t read(char *buf, size_t bufLen);
+
+  private:
+    int fd;
+};
+
+/// CPU usage of one meshtasticd thread, as seen in /proc/self/task
+struct HostThreadStat {
+    pid_t tid = 0;
+    char name[16] = {0};
+    uint64_t lastTicks = 0;
+    float cpuPercent = 0;
+    int fd = -1;
+};
+
+/**
+ * Samples host and process statistics for HostMetricsModule.
+ *
+ * All parsing is done in place on a fixed buffer with no iostream or std::string involvement, and the files we need every
+ * sample are held open, so a sample costs a handful of pread() syscalls.
+ */
+class HostMetricsSampler
+{
+  public:
+    HostMetricsSampler();
+    ~HostMetricsSampler();
+
+    /// Take one sample, updating the current values and the aggregates
+    void sample();
+
+    /// Forget the aggregates, called after each broadcast
+    void resetAggregates();
+
+    // Current values, valid after the first sample()
+    uint32_t uptimeSeconds = 0;
+    uint64_t freememBytes = 0;
+    uint64_t diskfreeBytes = 0;
+    uint16_t load1 = 0, load5 = 0, load15 = 0; // in 1/100ths
+    float cpuPercent = 0;                      // whole host, all cores
+    float processCpuPercent = 0;               // meshtasticd, 100% == one core
+    uint64_t rssBytes = 0;                     // meshtasticd resident set size
+    uint32_t openFds = 0;                      // meshtasticd open file descriptors
+
+    // Aggregates since the last resetAggregates()
+    HostMetricAggregate cpuAgg, processCpuAgg, rssAgg, freememAgg, load1Agg;
+
+    const std::vector<HostThreadStat> &getThreads() const { return threads; }
+
+  private:
+    ProcFile uptimeFile{"/proc/uptime"};
+    ProcFile meminfoFile{"/proc/meminfo"};
+    ProcFile loadavgFile{"/proc/loadavg"};
+    ProcFile statFile{"/proc/stat"};
+    ProcFile selfStatFile{"/proc/self/stat"};
+    ProcFile selfStatmFile{"/proc/self/statm"};
+
+    long ticksPerSecond;
+    long pageSize;
+
+    // Previous readings, for computing rates
+    uint64_t lastCpuTotal = 0, lastCpuIdle = 0;
+    uint64_t lastProcessTicks = 0;
+    uint64_t lastSampleMs = 0;
+
+    std::vector<HostThreadStat> threads;
+
+    void sampleUptime();
+    void sampleMeminfo();
+    void sampleLoadavg();
+    void sampleCpu();
+    void sampleProcess(float elapsedTicks);
+    void sampleThreads(float elapsedTicks);
+    void sampleFds();
+    void sampleDisk();
+};
+
+/**
+ * Runs the user-supplied HostMetrics command in a child process without ever blocking the caller.
+ *
+ * start() forks the command with its stdout on a non-blocking pipe, poll() collects whatever output is ready and reaps the
+ * child. If the command runs past its timeout it is killed, so a hung script can't stall packet processing. A timeout of 0
+ * lets it run for as long as it takes.
+ */
+class HostCommandRunner
+{
+  public:
+    enum State { IDLE, RUNNING, DONE };
+
+    ~HostCommandRunner();
+
+    /// Start cmd, unless one is already running. Returns false if the child could not be started
+    bool start(const char *cmd, uint32_t timeoutMs);
+
+    /// Collect output, enforce the timeout and reap the child. Returns the state after polling
+    State poll();
+
+    /// Output of the last completed run, at most maxLen - 1 bytes
+    const char *getResult() const { return result; }
+
+    /// Go back to IDLE after a DONE result has been consumed
+    void clear() { state = IDLE; }
+
+    static constexpr size_t maxLen = 200;
+
+  private:
+    State state = IDLE;
+    pid_t pid = -1;
+    int fd = -1;
+    uint32_t startedMs = 0;
+    uint32_t timeoutMs = 0;
+    size_t len = 0;
+    char result[maxLen] = {0};
+
+    void drain();
+    void finish(bool killChild);
+};
+#endif
@@ -10,6 +10,7 @@
 #include "PowerTelemetry.h"
 #include "RTC.h"
 #include "Router.h"
+#include "TelemetryHistory.h"
 #include "main.h"
 #include "power.h"
 #include "sleep.h"
@@ -91,6 +92,12 @@ int32_t PowerTelemetryModule::runOnce()
             // Only send while queue is empty (phone assumed connected)
             sendTelemetry(NODENUM_BROADCAST, true);
             lastSentToPhone = millis();
+        } else if (telemetryHistory.isDue(meshtastic_Telemetry_power_metrics_tag)) {
+            meshtastic_Telemetry m = meshtastic_Telemetry_init_zero;
+            m.which_variant = meshtastic_Telemetry_power_metrics_tag;
+            m.time = getTime();
+            if (getPowerTelemetry(&m))
+                telemetryHistory.record(m);
         }
     }
     return min(sendToPhoneIntervalMs, sendToMeshIntervalMs);
@@ -232,6 +239,7 @@ bool PowerTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
                  m.variant.power_metrics.ch2_current, m.variant.power_metrics.ch3_voltage, m.variant.power_metrics.ch3_current);
 
         sensor_read_error_count = 0;
+        telemetryHistory.record(m);
 
         meshtastic_MeshPacket *p = allocDataProtobuf(m);
         p->to = dest;
@@ -244,7 +252,7 @@ bool PowerTelemetryModule::sendTelemetry(NodeNum dest, bool phoneOnly)
         if (lastMeasurementPacket != nullptr)
             packetPool.release(lastMeasurementPacket);
 
-        lastMeasurementPacket = packetPool.allocCopy(*p);
+        lastMeasurementPacket = phoneOnly ? packetPool.share(p) : packetPool.allocCopy(*p);
         if (phoneOnly) {
             LOG_INFO("Send packet to phone");
             service->sendToPhone(p);
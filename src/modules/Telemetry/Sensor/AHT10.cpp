@@ -29,18 +29,52 @@ int32_t AHT10Sensor::runOnce()
 
 void AHT10Sensor::setup() {}
 
+// Trigger a measurement, which takes about 80ms
+static const uint8_t aht10MeasureCmd[] = {0xAC, 0x33, 0x00};
+#define AHT10_MEASURE_MSEC 80
+#define AHT10_STATUS_BUSY 0x80
+// Some take a little longer than the datasheet says, so we give them up to 5 more polls 10ms apart
+#define AHT10_BUSY_POLL_MSEC 10
+#define AHT10_MAX_BUSY_POLLS 5
+
+uint32_t AHT10Sensor::startMeasurement()
+{
+    busyPolls = 0;
+    return triggerMeasurement(aht10MeasureCmd, sizeof(aht10MeasureCmd), AHT10_MEASURE_MSEC);
+}
+
+uint32_t AHT10Sensor::measurementDueIn()
+{
+    uint32_t due = TelemetrySensor::measurementDueIn();
+    if (due > 0 || !isMeasuring() || busyPolls >= AHT10_MAX_BUSY_POLLS)
+        return due;
+
+    uint8_t status;
+    if (readResult(&status, 1) && (status & AHT10_STATUS_BUSY)) {
+        busyPolls++;
+        return AHT10_BUSY_POLL_MSEC;
+    }
+    return 0;
+}
+
 bool AHT10Sensor::getMetrics(meshtastic_Telemetry *measurement)
 {
     LOG_DEBUG("AHT10 getMetrics");
 
-    sensors_event_t humidity, temp;
-    aht10.getEvent(&humidity, &temp);
+    // Adafruit_AHTX0 would wait for the conversion in getEvent(), so we read the result ourselves
+    uint8_t buf[6];
+    if (!takeMeasurement() || !readResult(buf, sizeof(buf)) || (buf[0] & AHT10_STATUS_BUSY)) {
+        LOG_WARN("%s: no valid measurement", sensorName);
+        return false;
+    }
+    uint32_t rawHumidity = (uint32_t)buf[1] << 12 | (uint32_t)buf[2] << 4 | buf[3] >> 4;
+    uint32_t rawTemp = (uint32_t)(buf[3] & 0x0F) << 16 | (uint32_t)buf[4] << 8 | buf[5];
 
     measurement->variant.environment_metrics.has_temperature = true;
     measurement->variant.environment_metrics.has_relative_humidity = true;
 
-    measurement->variant.environment_metrics.temperature = temp.temperature;
-    measurement->variant.environment_metrics.relative_humidity = humidity.relative_humidity;
+    measurement->variant.environment_metrics.temperature = rawTemp * 200.0f / 0x100000 - 50;
+    measurement->variant.environment_metrics.relative_humidity = rawHumidity * 100.0f / 0x100000;
 
     return true;
 }
@@ -14,6 +14,7 @@ class AHT10Sensor : public TelemetrySensor
 {
   private:
     Adafruit_AHTX0 aht10;
+    uint8_t busyPolls = 0;
 
   protected:
     virtual void setup() override;
@@ -22,6 +23,8 @@ class AHT10Sensor : public TelemetrySensor
     AHT10Sensor();
     virtual int32_t runOnce() override;
     virtual bool getMetrics(meshtastic_Telemetry *measurement) override;
+    virtual uint32_t startMeasurement() override;
+    virtual uint32_t measurementDueIn() override;
 };
 
 #endif
@@ -25,12 +25,30 @@ void SHT31Sensor::setup()
     // Set up oversampling and filter initialization
 }
 
+// Single shot, high repeatability and no clock stretching, which takes up to 15.5ms
+static const uint8_t sht31MeasureCmd[] = {0x24, 0x00};
+#define SHT31_MEASURE_MSEC 16
+
+uint32_t SHT31Sensor::startMeasurement()
+{
+    return triggerMeasurement(sht31MeasureCmd, sizeof(sht31MeasureCmd), SHT31_MEASURE_MSEC);
+}
+
 bool SHT31Sensor::getMetrics(meshtastic_Telemetry *measurement)
 {
+    // Adafruit_SHT31 would wait for the conversion in readTemperature(), so we read the result ourselves
+    uint8_t buf[6];
+    if (!takeMeasurement() || !readResult(buf, sizeof(buf)) || !sensirionCrcOk(buf) || !sensirionCrcOk(buf + 3)) {
+        LOG_WARN("%s: no valid measurement", sensorName);
+        return false;
+    }
+    uint16_t rawTemp = buf[0] << 8 | buf[1];
+    uint16_t rawHumidity = buf[3] << 8 | buf[4];
+
     measurement->variant.environment_metrics.has_temperature = true;
     measurement->variant.environment_metrics.has_relative_humidity = true;
-    measurement->variant.environment_metrics.temperature = sht31.readTemperature();
-    measurement->variant.environment_metrics.relative_humidity = sht31.readHumidity();
+    measurement->variant.environment_metrics.temperature = -45 + 175.0f * rawTemp / 65535;
+    measurement->variant.environment_metrics.relative_humidity = 100.0f * rawHumidity / 65535;
 
     return true;
 }
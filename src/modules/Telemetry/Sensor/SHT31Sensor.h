@@ -18,6 +18,7 @@ class SHT31Sensor : public TelemetrySensor
     SHT31Sensor();
     virtual int32_t runOnce() override;
     virtual bool getMetrics(meshtastic_Telemetry *measurement) override;
+    virtual uint32_t startMeasurement() override;
 };
 
 #endif
\ No newline at end of file
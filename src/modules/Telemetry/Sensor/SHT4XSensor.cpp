@@ -6,6 +6,7 @@
 #include "SHT4XSensor.h"
 #include "TelemetrySensor.h"
 #include <Adafruit_SHT4x.h>
+#include <algorithm>
 
 SHT4XSensor::SHT4XSensor() : TelemetrySensor(meshtastic_TelemetrySensorType_SHT4X, "SHT4X") {}
 
@@ -37,15 +38,32 @@ void SHT4XSensor::setup()
     // Set up oversampling and filter initialization
 }
 
+// High precision, which Adafruit_SHT4x uses by default too. Takes up to 8.3ms.
+static const uint8_t sht4xMeasureCmd[] = {0xFD};
+#define SHT4X_MEASURE_MSEC 10
+
+uint32_t SHT4XSensor::startMeasurement()
+{
+    return triggerMeasurement(sht4xMeasureCmd, sizeof(sht4xMeasureCmd), SHT4X_MEASURE_MSEC);
+}
+
 bool SHT4XSensor::getMetrics(meshtastic_Telemetry *measurement)
 {
+    // Adafruit_SHT4x would wait for the conversion in getEvent(), so we read the result ourselves
+    uint8_t buf[6];
+    if (!takeMeasurement() || !readResult(buf, sizeof(buf)) || !sensirionCrcOk(buf) || !sensirionCrcOk(buf + 3)) {
+        LOG_WARN("%s: no valid measurement", sensorName);
+        return false;
+    }
+    uint16_t rawTemp = buf[0] << 8 | buf[1];
+    uint16_t rawHumidity = buf[3] << 8 | buf[4];
+
     measurement->variant.environment_metrics.has_temperature = true;
     measurement->variant.environment_metrics.has_relative_humidity = true;
-
-    sensors_event_t humidity, temp;
-    sht4x.getEvent(&humidity, &temp);
-    measurement->variant.environment_metrics.temperature = temp.temperature;
-    measurement->variant.environment_metrics.relative_humidity = humidity.relative_humidity;
+    measurement->variant.environment_metrics.temperature = -45 + 175.0f * rawTemp / 65535;
+    // Can be a bit outside 0-100%, see the datasheet
+    float humidity = -6 + 125.0f * rawHumidity / 65535;
+    measurement->variant.environment_metrics.relative_humidity = std::min(std::max(humidity, 0.0f), 100.0f);
     return true;
 }
 
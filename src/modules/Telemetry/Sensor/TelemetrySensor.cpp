@@ -6,5 +6,78 @@
 #include "NodeDB.h"
 #include "TelemetrySensor.h"
 #include "main.h"
+#include <Wire.h>
+
+bool TelemetrySensor::writeCommand(const uint8_t *cmd, size_t len)
+{
+    TwoWire *wire = nodeTelemetrySensorsMap[sensorType].second;
+    wire->beginTransmission(nodeTelemetrySensorsMap[sensorType].first);
+    wire->write(cmd, len);
+    return wire->endTransmission() == 0;
+}
+
+bool TelemetrySensor::readResult(uint8_t *buf, size_t len)
+{
+    TwoWire *wire = nodeTelemetrySensorsMap[sensorType].second;
+    if (wire->requestFrom(nodeTelemetrySensorsMap[sensorType].first, (uint8_t)len) != len)
+        return false;
+    for (size_t i = 0; i < len; i++)
+        buf[i] = wire->read();
+    return true;
+}
+
+bool TelemetrySensor::sensirionCrcOk(const uint8_t *data)
+{
+    uint8_t crc = 0xFF;
+    for (int i = 0; i < 2; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+    }
+    return crc == data[2];
+}
+
+uint32_t TelemetrySensor::triggerMeasurement(const uint8_t *cmd, size_t len, uint32_t convertMsec)
+{
+    measuring = writeCommand(cmd, len);
+    measurementReadyMsec = millis() + convertMsec;
+    return measuring ? convertMsec : 0;
+}
+
+uint32_t TelemetrySensor::measurementDueIn()
+{
+    int32_t remaining = (int32_t)(measurementReadyMsec - millis());
+    return measuring && remaining > 0 ? remaining : 0;
+}
+
+bool TelemetrySensor::takeMeasurement()
+{
+    if (!measuring || (int32_t)(measurementReadyMsec - millis()) > 0)
+        return false;
+    measuring = false;
+    return true;
+}
+
+bool TelemetrySensor::readMetrics(meshtastic_Telemetry *measurement)
+{
+    uint32_t start = micros();
+    bool okay = getMetrics(measurement);
+    uint32_t took = micros() - start;
+
+    reads++;
+    if (!okay)
+        readFailures++;
+    readTotalUs += took;
+    if (took > readMaxUs)
+        readMaxUs = took;
+    return okay;
+}
+
+void TelemetrySensor::logReadStats() const
+{
+    if (reads)
+        LOG_DEBUG("%s: %u reads, %u failed, %u us average, %u us max", sensorName, reads, readFailures,
+                  (uint32_t)(readTotalUs / reads), readMaxUs);
+}
 
 #endif
\ No newline at end of file
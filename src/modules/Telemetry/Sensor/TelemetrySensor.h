@@ -44,6 +44,26 @@ class TelemetrySensor
     }
     virtual void setup() = 0;
 
+    /** Send a command to the sensor at its address from nodeTelemetrySensorsMap, true if it was acknowledged */
+    bool writeCommand(const uint8_t *cmd, size_t len);
+
+    /** Read a result from the sensor, true if we got all of it */
+    bool readResult(uint8_t *buf, size_t len);
+
+    /** Check a 16 bit word followed by its CRC, as Sensirion sensors send them */
+    static bool sensirionCrcOk(const uint8_t *data);
+
+    /** For startMeasurement(), send the command which starts a conversion taking up to convertMsec */
+    uint32_t triggerMeasurement(const uint8_t *cmd, size_t len, uint32_t convertMsec);
+
+    /**
+     * For getMetrics(), use up the conversion startMeasurement() began. Never waits: false if none was started or it isn't
+     * done yet, which EnvironmentTelemetryModule avoids by waiting for measurementDueIn() first
+     */
+    bool takeMeasurement();
+
+    bool isMeasuring() const { return measuring; }
+
   public:
     virtual AdminMessageHandleResult handleAdminMessage(const meshtastic_MeshPacket &mp, meshtastic_AdminMessage *request,
                                                         meshtastic_AdminMessage *response)
@@ -58,6 +78,29 @@ class TelemetrySensor
     virtual bool isRunning() { return status > 0; }
 
     virtual bool getMetrics(meshtastic_Telemetry *measurement) = 0;
+
+    /**
+     * Start a measurement and return right away, so several sensors can convert at the same time.
+     * @return ms until getMetrics() can read the result without waiting, 0 if getMetrics() does the whole measurement itself
+     */
+    virtual uint32_t startMeasurement() { return 0; }
+
+    /** ms until the conversion startMeasurement() began can be read, 0 once it can or if there is none */
+    virtual uint32_t measurementDueIn();
+
+    /** getMetrics(), keeping track of how long it takes */
+    bool readMetrics(meshtastic_Telemetry *measurement);
+
+    /** Log how long reading this sensor takes */
+    void logReadStats() const;
+
+  private:
+    bool measuring = false;
+    uint32_t measurementReadyMsec = 0;
+
+    uint32_t reads = 0, readFailures = 0;
+    uint64_t readTotalUs = 0;
+    uint32_t readMaxUs = 0;
 };
 
 #endif
\ No newline at end of file
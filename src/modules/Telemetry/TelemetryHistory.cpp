@@ -0,0 +1,224 @@
+#include "TelemetryHistory.h"
+#include "FSCommon.h"
+#include "RTC.h"
+#include "SPILock.h"
+#include "Throttle.h"
+#include "configuration.h"
+
+static_assert(sizeof(GorillaBlockHeader) == 20, "GorillaBlockHeader layout is shared with bin/telemetry_history.py");
+static_assert(sizeof(TelemetryHistoryFileHeader) == 12,
+              "TelemetryHistoryFileHeader layout is shared with bin/telemetry_history.py");
+
+/// Seconds averaged into one point of each tier
+static const uint32_t tierSeconds[THIST_NUM_TIERS] = {0, 60, 15 * 60};
+
+TelemetryHistory telemetryHistory;
+
+TelemetryHistory::~TelemetryHistory()
+{
+    for (Series *s : series)
+        delete s;
+}
+
+#define RECORD_FIELD(m, field, metric)                                                                                           \
+    if (m.has_##field)                                                                                                           \
+    record(metric, time, m.field)
+
+void TelemetryHistory::record(const meshtastic_Telemetry &t)
+{
+    uint32_t time = t.time ? t.time : getTime();
+    switch (t.which_variant) {
+    case meshtastic_Telemetry_device_metrics_tag: {
+        const meshtastic_DeviceMetrics &m = t.variant.device_metrics;
+        RECORD_FIELD(m, battery_level, THIST_BATTERY_LEVEL);
+        RECORD_FIELD(m, voltage, THIST_VOLTAGE);
+        RECORD_FIELD(m, channel_utilization, THIST_CHANNEL_UTILIZATION);
+        RECORD_FIELD(m, air_util_tx, THIST_AIR_UTIL_TX);
+        break;
+    }
+    case meshtastic_Telemetry_environment_metrics_tag: {
+        const meshtastic_EnvironmentMetrics &m = t.variant.environment_metrics;
+        RECORD_FIELD(m, temperature, THIST_TEMPERATURE);
+        RECORD_FIELD(m, relative_humidity, THIST_RELATIVE_HUMIDITY);
+        RECORD_FIELD(m, barometric_pressure, THIST_BAROMETRIC_PRESSURE);
+        RECORD_FIELD(m, gas_resistance, THIST_GAS_RESISTANCE);
+        RECORD_FIELD(m, iaq, THIST_IAQ);
+        RECORD_FIELD(m, lux, THIST_LUX);
+        RECORD_FIELD(m, voltage, THIST_ENV_VOLTAGE);
+        RECORD_FIELD(m, current, THIST_ENV_CURRENT);
+        break;
+    }
+    case meshtastic_Telemetry_power_metrics_tag: {
+        const meshtastic_PowerMetrics &m = t.variant.power_metrics;
+        RECORD_FIELD(m, ch1_voltage, THIST_CH1_VOLTAGE);
+        RECORD_FIELD(m, ch1_current, THIST_CH1_CURRENT);
+        RECORD_FIELD(m, ch2_voltage, THIST_CH2_VOLTAGE);
+        RECORD_FIELD(m, ch2_current, THIST_CH2_CURRENT);
+        RECORD_FIELD(m, ch3_voltage, THIST_CH3_VOLTAGE);
+        RECORD_FIELD(m, ch3_current, THIST_CH3_CURRENT);
+        break;
+    }
+    case meshtastic_Telemetry_air_quality_metrics_tag: {
+        const meshtastic_AirQualityMetrics &m = t.variant.air_quality_metrics;
+        RECORD_FIELD(m, pm10_standard, THIST_PM10_STANDARD);
+        RECORD_FIELD(m, pm25_standard, THIST_PM25_STANDARD);
+        RECORD_FIELD(m, pm100_standard, THIST_PM100_STANDARD);
+        RECORD_FIELD(m, co2, THIST_CO2);
+        break;
+    }
+    case meshtastic_Telemetry_health_metrics_tag: {
+        const meshtastic_HealthMetrics &m = t.variant.health_metrics;
+        RECORD_FIELD(m, heart_bpm, THIST_HEART_BPM);
+        RECORD_FIELD(m, spO2, THIST_SPO2);
+        RECORD_FIELD(m, temperature, THIST_BODY_TEMPERATURE);
+        break;
+    }
+    default:
+        return;
+    }
+    lastRecordMsec[t.which_variant] = millis();
+}
+
+bool TelemetryHistory::isDue(pb_size_t variant) const
+{
+    if (variant >= sizeof(lastRecordMsec) / sizeof(lastRecordMsec[0]))
+        return false;
+    return lastRecordMsec[variant] == 0 || !Throttle::isWithinTimespanMs(lastRecordMsec[variant], TELEMETRY_HISTORY_INTERVAL_MS);
+}
+
+TelemetryHistory::Series *TelemetryHistory::find(TelemetryHistoryMetric metric) const
+{
+    for (Series *s : series)
+        if (s && s->metric == metric)
+            return s;
+    return NULL;
+}
+
+void TelemetryHistory::record(TelemetryHistoryMetric metric, uint32_t time, float value)
+{
+    Series *s = find(metric);
+    if (!s) {
+        Series **slot = NULL;
+        for (Series *&candidate : series)
+            if (!candidate) {
+                slot = &candidate;
+                break;
+            }
+        if (!slot) {
+            LOG_DEBUG("Telemetry history full, metric %u not kept", metric);
+            return;
+        }
+        s = *slot = new Series();
+        s->metric = metric;
+    }
+
+    append(*s, THIST_RAW, time, value);
+
+    for (uint8_t tier = THIST_MINUTE; tier < THIST_NUM_TIERS; tier++) {
+        Tier &t = s->tiers[tier];
+        uint32_t bucket = time - time % tierSeconds[tier];
+        if (t.n && bucket != t.bucket) {
+            append(*s, (TelemetryHistoryTier)tier, t.bucket, t.sum / t.n);
+            t.n = 0;
+            t.sum = 0;
+        }
+        t.bucket = bucket;
+        t.sum += value;
+        t.n++;
+    }
+}
+
+void TelemetryHistory::append(Series &s, TelemetryHistoryTier tier, uint32_t time, float value)
+{
+    Tier &t = s.tiers[tier];
+    if (t.used && t.blocks[t.newest].append(time, value))
+        return;
+
+    // Start a new block, taking the place of the oldest one once the ring is full
+    if (t.used)
+        t.newest = (t.newest + 1) % TELEMETRY_HISTORY_BLOCKS;
+    if (t.used < TELEMETRY_HISTORY_BLOCKS)
+        t.used++;
+    GorillaBlock &b = t.blocks[t.newest];
+    b.reset(s.metric, tier);
+    b.append(time, value);
+}
+
+template <typename F> void TelemetryHistory::forEachBlock(uint32_t since, F f) const
+{
+    for (const Series *s : series) {
+        if (!s)
+            continue;
+        for (const Tier &t : s->tiers) {
+            // The oldest block is the one after newest once the ring is full, else the first one
+            uint8_t oldest = (t.newest + 1 + TELEMETRY_HISTORY_BLOCKS - t.used) % TELEMETRY_HISTORY_BLOCKS;
+            for (uint8_t i = 0; i < t.used; i++) {
+                const GorillaBlock &b = t.blocks[(oldest + i) % TELEMETRY_HISTORY_BLOCKS];
+                if (b.header.lastTime >= since)
+                    f(b);
+            }
+        }
+    }
+}
+
+size_t TelemetryHistory::read(TelemetryHistoryMetric metric, TelemetryHistoryTier tier, uint32_t since, uint32_t *times,
+                              float *values, size_t max) const
+{
+    size_t n = 0;
+    forEachBlock(since, [&](const GorillaBlock &b) {
+        if (b.header.metric != metric || b.header.tier != tier)
+            return;
+        GorillaReader r(b.header, b.data);
+        uint32_t time;
+        float value;
+        while (n < max && r.next(time, value)) {
+            if (time < since)
+                continue;
+            times[n] = time;
+            values[n++] = value;
+        }
+    });
+    return n;
+}
+
+bool TelemetryHistory::isHistoryFile(const char *filename, uint32_t *since)
+{
+    size_t len = strlen(TELEMETRY_HISTORY_FILENAME);
+    if (strncmp(filename, TELEMETRY_HISTORY_FILENAME, len) != 0)
+        return false;
+    const char *query = filename + len;
+    if (since)
+        *since = strncmp(query, "?since=", strlen("?since=")) == 0 ? strtoul(query + strlen("?since="), NULL, 10) : 0;
+    return *query == '\0' || *query == '?';
+}
+
+bool TelemetryHistory::save(const char *filename, uint32_t since) const
+{
+#ifdef FSCom
+    TelemetryHistoryFileHeader h = {};
+    h.magic = TELEMETRY_HISTORY_MAGIC;
+    h.version = TELEMETRY_HISTORY_VERSION;
+    h.time = getTime();
+    forEachBlock(since, [&](const GorillaBlock &) { h.numBlocks++; });
+
+    concurrency::LockGuard g(spiLock);
+    if (FSCom.exists(filename))
+        FSCom.remove(filename);
+    auto f = FSCom.open(filename, FILE_O_WRITE);
+    if (!f) {
+        LOG_ERROR("Can't write telemetry history to %s", filename);
+        return false;
+    }
+    size_t expected = sizeof(h), written = f.write((const uint8_t *)&h, sizeof(h));
+    forEachBlock(since, [&](const GorillaBlock &b) {
+        expected += sizeof(b.header) + b.dataBytes();
+        written += f.write((const uint8_t *)&b.header, sizeof(b.header));
+        written += f.write(b.data, b.dataBytes());
+    });
+    f.close();
+    LOG_INFO("Saved %u blocks of telemetry history, %u bytes", h.numBlocks, (unsigned)written);
+    return written == expected;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "../mesh/generated/meshtastic/telemetry.pb.h"
+#include "GorillaBlock.h"
+
+/**
+ * A compressed history of our own telemetry, so it can be pulled in bulk now and then instead of broadcast often.
+ *
+ * Every metric the telemetry modules measure is kept at three resolutions: each sample as taken, averaged per minute and
+ * averaged per 15 minutes. Each resolution is a ring of GorillaBlocks, the oldest block is dropped when a new one is
+ * needed, so the coarser tiers reach back much further in the same space.
+ *
+ * The history is downloaded through XModem as TELEMETRY_HISTORY_FILENAME, optionally followed by "?since=<time>" to only
+ * get blocks with points at or after that time. It is saved to a snapshot file for the transfer, which
+ * bin/telemetry_history.py decodes.
+ *
+ * Like the modules which feed it, this is only used from the main thread.
+ */
+
+/// Requesting this file over XModem returns a fresh snapshot of the history
+#define TELEMETRY_HISTORY_FILENAME "/telemetryhist.bin"
+
+/// Blocks kept per metric and tier
+#ifndef TELEMETRY_HISTORY_BLOCKS
+#if ARCH_PORTDUINO
+#define TELEMETRY_HISTORY_BLOCKS 8
+#else
+#define TELEMETRY_HISTORY_BLOCKS 2
+#endif
+#endif
+
+/// Number of metrics we have room for, the first ones measured get it
+#ifndef TELEMETRY_HISTORY_MAX_SERIES
+#if ARCH_PORTDUINO
+#define TELEMETRY_HISTORY_MAX_SERIES 32
+#else
+#define TELEMETRY_HISTORY_MAX_SERIES 8
+#endif
+#endif
+
+/// The modules take a sample for the history at least this often, even when they don't send
+#ifndef TELEMETRY_HISTORY_INTERVAL_MS
+#define TELEMETRY_HISTORY_INTERVAL_MS (60 * 1000)
+#endif
+
+enum TelemetryHistoryTier : uint8_t {
+    THIST_RAW,     // Every sample
+    THIST_MINUTE,  // Averaged per minute
+    THIST_QUARTER, // Averaged per 15 minutes
+    THIST_NUM_TIERS
+};
+
+/// What the points of a series are. Stored in saved histories, so only ever add to the end
+enum TelemetryHistoryMetric : uint8_t {
+    THIST_NONE = 0,
+    THIST_BATTERY_LEVEL,
+    THIST_VOLTAGE,
+    THIST_CHANNEL_UTILIZATION,
+    THIST_AIR_UTIL_TX,
+    THIST_TEMPERATURE,
+    THIST_RELATIVE_HUMIDITY,
+    THIST_BAROMETRIC_PRESSURE,
+    THIST_GAS_RESISTANCE,
+    THIST_IAQ,
+    THIST_LUX,
+    THIST_ENV_VOLTAGE,
+    THIST_ENV_CURRENT,
+    THIST_CH1_VOLTAGE,
+    THIST_CH1_CURRENT,
+    THIST_CH2_VOLTAGE,
+    THIST_CH2_CURRENT,
+    THIST_CH3_VOLTAGE,
+    THIST_CH3_CURRENT,
+    THIST_PM10_STANDARD,
+    THIST_PM25_STANDARD,
+    THIST_PM100_STANDARD,
+    THIST_CO2,
+    THIST_HEART_BPM,
+    THIST_SPO2,
+    THIST_BODY_TEMPERATURE,
+};
+
+#define TELEMETRY_HISTORY_MAGIC 0x54534854 // "THST"
+#define TELEMETRY_HISTORY_VERSION 1
+
+/// Precedes the blocks in a saved history, each block is a GorillaBlockHeader followed by its data
+struct TelemetryHistoryFileHeader {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t numBlocks;
+    uint32_t time; // getTime() when the snapshot was taken
+};
+
+class TelemetryHistory
+{
+  public:
+    ~TelemetryHistory();
+
+    /** Add all metrics of one of our own measurements, at t.time or now if that isn't set */
+    void record(const meshtastic_Telemetry &t);
+
+    /** Add a single point */
+    void record(TelemetryHistoryMetric metric, uint32_t time, float value);
+
+    /** Whether the module measuring this Telemetry variant should take a sample for the history */
+    bool isDue(pb_size_t variant) const;
+
+    /**
+     * Copy up to max points of a metric at or after since, oldest first, and return how many were copied. Points still
+     * being averaged into a minute or quarter are not included.
+     */
+    size_t read(TelemetryHistoryMetric metric, TelemetryHistoryTier tier, uint32_t since, uint32_t *times, float *values,
+                size_t max) const;
+
+    /** Write the blocks with points at or after since to a file */
+    bool save(const char *filename, uint32_t since = 0) const;
+
+    /** Whether an XModem download of filename should be answered with save(), and if so the since its "?since=" asks for */
+    static bool isHistoryFile(const char *filename, uint32_t *since = nullptr);
+
+  private:
+    struct Tier {
+        GorillaBlock blocks[TELEMETRY_HISTORY_BLOCKS];
+        /// blocks[newest] is being appended to, the ones before it in the ring are older
+        uint8_t newest;
+        uint8_t used;
+        // Average of the bucket being collected, except for THIST_RAW
+        uint32_t bucket;
+        float sum;
+        uint16_t n;
+    };
+
+    struct Series {
+        TelemetryHistoryMetric metric;
+        Tier tiers[THIST_NUM_TIERS];
+    };
+
+    /// Allocated the first time a metric is recorded, most nodes only have a few
+    Series *series[TELEMETRY_HISTORY_MAX_SERIES] = {};
+
+    /// millis() of the last record() per Telemetry variant tag
+    uint32_t lastRecordMsec[meshtastic_Telemetry_health_metrics_tag + 1] = {};
+
+    Series *find(TelemetryHistoryMetric metric) const;
+    void append(Series &s, TelemetryHistoryTier tier, uint32_t time, float value);
+
+    /** Call f for each block with points at or after since, oldest first within each tier */
+    template <typename F> void forEachBlock(uint32_t since, F f) const;
+};
+
+extern TelemetryHistory telemetryHistory;
@@ -34,6 +34,7 @@
 
 #include <IPAddress.h>
 #if defined(ARCH_PORTDUINO)
+#include "concurrency/Reactor.h"
 #include <netinet/in.h>
 #elif !defined(ntohl)
 #include <machine/endian.h>
@@ -569,11 +570,17 @@ int32_t MQTT::runOnce()
 
     // If connected poll rapidly, otherwise only occasionally check for a wifi connection change and ability to contact server
     if (moduleConfig.mqtt.proxy_to_client_enabled) {
+        // Nothing arrives here in proxy mode, the queue just holds what was sent before the phone took over
         publishQueuedMessages();
-        return 200;
+        return mqttQueue.isEmpty() ? MQTT_IDLE_MSEC : 200;
     }
 
     else if (!pubSub.loop()) {
+#ifdef ARCH_PORTDUINO
+        // The old socket is closed (which drops it from epoll) and a new connection may reuse its number
+        concurrency::reactor.unwatch(watchedFd);
+        watchedFd = -1;
+#endif
         if (!wantConnection)
             return 5000; // If we don't want connection now, check again in 5 secs
         else {
@@ -594,12 +601,30 @@ int32_t MQTT::runOnce()
         }
 
         powerFSM.trigger(EVENT_CONTACT_FROM_PHONE); // Suppress entering light sleep (because that would turn off bluetooth)
+#ifdef ARCH_PORTDUINO
+        // pubSub.loop() handles one message at a time, and the reactor only wakes us for new arrivals
+        if (watchServerSocket())
+            return mqttClient->available() ? 0 : MQTT_IDLE_MSEC;
+#endif
         return 20;
     }
 #endif
     return 30000;
 }
 
+#if defined(ARCH_PORTDUINO) && HAS_NETWORKING
+bool MQTT::watchServerSocket()
+{
+    // With TLS the connection is in mqttClientTLS, which has no fd to give us, so that keeps polling
+    int fd = moduleConfig.mqtt.tls_enabled ? -1 : mqttClient->fd();
+    if (fd != watchedFd) {
+        concurrency::reactor.unwatch(watchedFd);
+        watchedFd = concurrency::reactor.watch(fd, this) ? fd : -1;
+    }
+    return watchedFd >= 0;
+}
+#endif
+
 bool MQTT::isValidConfig(const meshtastic_ModuleConfig_MQTTConfig &config, MQTTClient *client)
 {
     const PubSubConfig parsed(config);
@@ -26,6 +26,10 @@
 
 #define MAX_MQTT_QUEUE 16
 
+// How often to run when nothing needs polling: in proxy mode the phone moves the data, and on meshtasticd the reactor wakes
+// us when the server sends something, so we only need to run for keepalives and map reports
+#define MQTT_IDLE_MSEC 1000
+
 /**
  * Our wrapper/singleton for sending/receiving MQTT "udp" packets.  This object isolates the MQTT protocol implementation from
  * the two components that use it: MQTTPlugin and MQTTSimInterface.
@@ -99,6 +103,13 @@ class MQTT : private concurrency::OSThread
 #endif
     PubSubClient pubSub;
     explicit MQTT(std::unique_ptr<MQTTClient> mqttClient);
+#ifdef ARCH_PORTDUINO
+    /// The server socket we asked the reactor to wake us for, or -1
+    int watchedFd = -1;
+
+    /// Make sure the reactor wakes us for the current connection, returns false if it can't
+    bool watchServerSocket();
+#endif
 #endif
 
     std::string cryptTopic = "/2/e/";   // msh/2/e/CHANNELID/NODEID
@@ -5,6 +5,7 @@
 #include "PowerFSM.h"
 
 #include "main.h"
+#include "mesh/NodeDB.h"
 #include "mesh/PhoneAPI.h"
 #include "mesh/mesh-pb-constants.h"
 #include "sleep.h"
@@ -308,6 +309,7 @@ void clearNVS()
 {
     NimBLEDevice::deleteAllBonds();
 #ifdef ARCH_ESP32
+    nodeDB->flushToDisk(); // don't lose saves still waiting in PrefsWriter
     ESP.restart();
 #endif
 }
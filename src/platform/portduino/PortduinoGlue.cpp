@@ -2,6 +2,7 @@
 #include "PortduinoGPIO.h"
 #include "SPIChip.h"
 #include "mesh/RF95Interface.h"
+#include "mesh/mesh-pb-constants.h"
 #include "sleep.h"
 #include "target_specific.h"
 
@@ -135,6 +136,14 @@ void getMacAddr(uint8_t *dmac)
     }
 }
 
+volatile sig_atomic_t stopRequested = 0;
+
+static void onStopSignal(int sig)
+{
+    stopRequested = 1;
+    signal(sig, SIG_DFL); // a second one stops us right away, in case the main loop is stuck
+}
+
 /** apps run under portduino can optionally define a portduinoSetup() to
  * use portduino specific init code (such as gpioBind) to setup portduino on their host machine,
  * before running 'arduino' code.
@@ -142,6 +151,9 @@ void getMacAddr(uint8_t *dmac)
 void portduinoSetup()
 {
     printf("Set up Meshtastic on Portduino...\n");
+    // Stopping meshtasticd goes through the regular shutdown, so saves still waiting in PrefsWriter are written
+    signal(SIGTERM, onStopSignal);
+    signal(SIGINT, onStopSignal);
     int max_GPIO = 0;
     const configNames GPIO_lines[] = {
         cs_pin,        irq_pin,        busy_pin,  reset_pin,        sx126x_ant_sw_pin,          txen_pin,
@@ -604,11 +616,20 @@ bool loadConfig(const char *configPath)
             settingsMap[hostMetrics_channel] = (yamlConfig["HostMetrics"]["Channel"]).as<int>(0);
             settingsMap[hostMetrics_interval] = (yamlConfig["HostMetrics"]["ReportInterval"]).as<int>(0);
             settingsStrings[hostMetrics_user_command] = (yamlConfig["HostMetrics"]["UserStringCommand"]).as<std::string>("");
+            settingsMap[hostMetrics_user_command_timeout] = (yamlConfig["HostMetrics"]["UserStringCommandTimeout"]).as<int>(5);
         }
 
         if (yamlConfig["General"]) {
             settingsMap[maxnodes] = (yamlConfig["General"]["MaxNodes"]).as<int>(200);
             settingsMap[maxtophone] = (yamlConfig["General"]["MaxMessageQueue"]).as<int>(100);
+            settingsMap[maxtophone_bytes] =
+                (yamlConfig["General"]["MaxMessageQueueBytes"]).as<int>(settingsMap[maxtophone] * TOPHONE_MAX_PACKET_COST);
+            settingsMap[decode_threads] = (yamlConfig["General"]["DecodeThreads"]).as<int>(0);
+            if (yamlConfig["General"]["CompressChannels"]) {
+                settingsMap[compress_channels] = 0;
+                for (auto channel : yamlConfig["General"]["CompressChannels"])
+                    settingsMap[compress_channels] |= 1 << channel.as<int>();
+            }
             settingsStrings[config_directory] = (yamlConfig["General"]["ConfigDirectory"]).as<std::string>("");
             settingsStrings[available_directory] =
                 (yamlConfig["General"]["AvailableDirectory"]).as<std::string>("/etc/meshtasticd/available.d/");
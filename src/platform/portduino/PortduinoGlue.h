@@ -1,4 +1,5 @@
 #pragma once
+#include <csignal>
 #include <fstream>
 #include <map>
 #include <unordered_map>
@@ -96,6 +97,7 @@ enum configNames {
     websslkeypath,
     websslcertpath,
     maxtophone,
+    maxtophone_bytes,
     maxnodes,
     ascii_logs,
     config_directory,
@@ -103,7 +105,10 @@ enum configNames {
     mac_address,
     hostMetrics_interval,
     hostMetrics_channel,
-    hostMetrics_user_command
+    hostMetrics_user_command,
+    hostMetrics_user_command_timeout,
+    decode_threads,
+    compress_channels
 };
 enum { no_screen, x11, fb, st7789, st7735, st7735s, st7796, ili9341, ili9342, ili9486, ili9488, hx8357d };
 enum { no_touchscreen, xpt2046, stmpe610, gt911, ft5x06 };
@@ -112,6 +117,8 @@ enum { level_error, level_warn, level_info, level_debug, level_trace };
 extern std::map<configNames, int> settingsMap;
 extern std::map<configNames, std::string> settingsStrings;
 extern std::ofstream traceFile;
+/// Set by SIGTERM/SIGINT, powerCommandsCheck() then shuts down cleanly
+extern volatile sig_atomic_t stopRequested;
 extern Ch341Hal *ch341Hal;
 int initGPIOPin(int pinNum, std::string gpioChipname, int line);
 bool loadConfig(const char *configPath);
@@ -1,5 +1,6 @@
 #include "SimRadio.h"
 #include "MeshService.h"
+#include "PacketTrace.h"
 #include "Router.h"
 
 SimRadio::SimRadio() : NotifiedWorkerThread("SimRadio")
@@ -91,6 +92,7 @@ void SimRadio::completeSending()
         if (!isFromUs(p))
             txRelay++;
         printPacket("Completed sending", p);
+        packetTrace.record(PTRACE_TX_DONE, p, txQueue.getMaxLen() - txQueue.getFree());
 
         // We are done sending that packet, release it
         packetPool.release(p);
@@ -131,8 +133,10 @@ bool SimRadio::isChannelActive()
 bool SimRadio::cancelSending(NodeNum from, PacketId id)
 {
     auto p = txQueue.remove(from, id);
-    if (p)
+    if (p) {
+        packetTrace.record(PTRACE_TX_CANCEL, p, txQueue.getMaxLen() - txQueue.getFree());
         packetPool.release(p); // free the packet we just removed
+    }
 
     bool result = (p != NULL);
     LOG_DEBUG("cancelSending id=0x%x, removed=%d", id, result);
@@ -201,6 +205,7 @@ void SimRadio::onNotify(uint32_t notification)
 void SimRadio::startSend(meshtastic_MeshPacket *txp)
 {
     printPacket("Start low level send", txp);
+    packetTrace.record(PTRACE_TX_START, txp, txQueue.getMaxLen() - txQueue.getFree());
     isReceiving = false;
     size_t numbytes = beginSending(txp);
     meshtastic_MeshPacket *p = packetPool.allocCopy(*txp);
@@ -305,15 +310,19 @@ void SimRadio::handleReceiveInterrupt()
     LOG_DEBUG("HANDLE RECEIVE INTERRUPT");
     rxGood++;
 
-    meshtastic_MeshPacket *mp = packetPool.allocCopy(*receivingPacket); // keep a copy in packetPool
-    packetPool.release(receivingPacket);                                // release the original
+    // receivingPacket is already from packetPool, so hand it on rather than copying it
+    meshtastic_MeshPacket *mp = receivingPacket;
     receivingPacket = nullptr;
 
     printPacket("Lora RX", mp);
+    packetTrace.record(PTRACE_RX, mp);
 
-    airTime->logAirtime(RX_LOG, getPacketTime(mp));
+    uint32_t airtimeMsec = getPacketTime(mp);
+    airTime->logAirtime(RX_LOG, airtimeMsec);
+    if (mp->relay_node != NO_RELAY_NODE)
+        airTime->logRelayAirtime(mp->relay_node, airtimeMsec);
 
-    deliverToReceiver(mp);
+    deliverToReceiver(mp, micros());
 }
 
 size_t SimRadio::getPacketLength(meshtastic_MeshPacket *mp)
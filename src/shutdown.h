@@ -2,11 +2,13 @@
 #include "configuration.h"
 #include "graphics/Screen.h"
 #include "main.h"
+#include "mesh/NodeDB.h"
 #include "power.h"
 #include "sleep.h"
 #if defined(ARCH_PORTDUINO)
 #include "api/WiFiServerAPI.h"
 #include "input/LinuxInputImpl.h"
+#include "platform/portduino/PortduinoGlue.h"
 
 #endif
 
@@ -15,6 +17,8 @@ void powerCommandsCheck()
     if (rebootAtMsec && millis() > rebootAtMsec) {
         LOG_INFO("Rebooting");
         notifyReboot.notifyObservers(NULL);
+        if (nodeDB)
+            nodeDB->flushToDisk(); // don't lose saves still waiting in PrefsWriter
 #if defined(ARCH_ESP32)
         ESP.restart();
 #elif defined(ARCH_NRF52)
@@ -46,8 +50,17 @@ void powerCommandsCheck()
     }
 #endif
 
+#if defined(ARCH_PORTDUINO)
+    if (stopRequested && !shutdownAtMsec) {
+        LOG_INFO("Stop requested by signal");
+        shutdownAtMsec = millis();
+    }
+#endif
+
     if (shutdownAtMsec && millis() > shutdownAtMsec) {
         LOG_INFO("Shut down from admin command");
+        if (nodeDB)
+            nodeDB->flushToDisk();
 #if defined(ARCH_NRF52) || defined(ARCH_ESP32) || defined(ARCH_RP2040)
         playShutdownMelody();
         power->shutdown();
@@ -226,6 +226,10 @@ void doDeepSleep(uint32_t msecToWake, bool skipPreflight = false, bool skipSaveN
 
     if (!skipSaveNodeDb) {
         nodeDB->saveToDisk();
+        nodeDB->flushToDisk();
+    } else {
+        // Config changes used to be written as they were made, don't lose those still waiting in PrefsWriter
+        nodeDB->flushToDisk(SEGMENT_CONFIG | SEGMENT_MODULECONFIG | SEGMENT_CHANNELS | SEGMENT_DEVICESTATE);
     }
 
 #ifdef PIN_POWER_EN
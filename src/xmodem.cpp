@@ -49,7 +49,9 @@
  **********************************************************************************************************************/
 
 #include "xmodem.h"
+#include "PacketTrace.h"
 #include "SPILock.h"
+#include "modules/Telemetry/TelemetryHistory.h"
 
 #ifdef FSCom
 
@@ -57,6 +59,42 @@ XModemAdapter xModem;
 
 XModemAdapter::XModemAdapter() {}
 
+/// CRC-16/CCITT (polynomial 0x1021, initial value 0) of every possible top byte
+static const uint16_t crc16Table[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+    0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+    0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+    0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+    0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+    0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+    0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+    0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+    0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+    0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+    0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+    0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+    0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+    0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+    0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+    0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+    0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+    0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+    0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+    0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+    0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+    0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+    0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+    0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+    0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+    0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+    0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+    0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+    0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0,
+};
+
 /**
  * Calculates the CRC-16 CCITT checksum of the given buffer.
  *
@@ -66,17 +104,9 @@ XModemAdapter::XModemAdapter() {}
  */
 unsigned short XModemAdapter::crc16_ccitt(const pb_byte_t *buffer, int length)
 {
-    unsigned short crc16 = 0;
-    while (length != 0) {
-        crc16 = (unsigned char)(crc16 >> 8) | (crc16 << 8);
-        crc16 ^= *buffer;
-        crc16 ^= (unsigned char)(crc16 & 0xff) >> 4;
-        crc16 ^= (crc16 << 8) << 4;
-        crc16 ^= ((crc16 & 0xff) << 4) << 1;
-        buffer++;
-        length--;
-    }
-
+    uint16_t crc16 = 0;
+    while (length-- > 0)
+        crc16 = (crc16 << 8) ^ crc16Table[(crc16 >> 8) ^ *buffer++];
     return crc16;
 }
 
@@ -96,20 +126,244 @@ int XModemAdapter::check(const pb_byte_t *buf, int sz, unsigned short tcrc)
 
 void XModemAdapter::sendControl(meshtastic_XModem_Control c)
 {
-    xmodemStore = meshtastic_XModem_init_zero;
-    xmodemStore.control = c;
-    LOG_DEBUG("XModem: Notify Send control %d", c);
-    packetReady.notifyObservers(packetno);
+    queue(c);
+}
+
+void XModemAdapter::queue(meshtastic_XModem_Control c, uint16_t seq, uint16_t crc16)
+{
+    for (size_t i = 0; i < outboxCount; i++) {
+        Outgoing &o = outbox[(outboxHead + i) % OUTBOX_SIZE];
+        // A data block which is already waiting doesn't need to go twice, and a newer (cumulative) ACK replaces an older one
+        if (o.control == c && (o.seq == seq || (windowed && c == meshtastic_XModem_Control_ACK && seq > o.seq))) {
+            o.seq = seq;
+            o.crc16 = crc16;
+            return;
+        }
+    }
+    if (outboxCount == OUTBOX_SIZE) {
+        LOG_WARN("XModem: Outbox full, drop control %d seq %u", c, seq);
+        return;
+    }
+    outbox[(outboxHead + outboxCount) % OUTBOX_SIZE] = {c, seq, crc16};
+    outboxCount++;
+    if (c != meshtastic_XModem_Control_SOH)
+        LOG_DEBUG("XModem: Notify Send control %d", c);
+    packetReady.notifyObservers(seq);
 }
 
 meshtastic_XModem XModemAdapter::getForPhone()
 {
-    return xmodemStore;
+    // Skip retransmits of blocks which got acked meanwhile, their window slot holds a later block by now
+    while (outboxCount && outbox[outboxHead].control == meshtastic_XModem_Control_SOH &&
+           window[outbox[outboxHead].seq % windowSize].seq != outbox[outboxHead].seq)
+        resetForPhone();
+    if (outboxCount == 0)
+        return meshtastic_XModem_init_zero;
+
+    const Outgoing &o = outbox[outboxHead];
+    if (o.control == meshtastic_XModem_Control_SOH)
+        return window[o.seq % windowSize];
+
+    meshtastic_XModem p = meshtastic_XModem_init_zero;
+    p.control = o.control;
+    p.seq = o.seq;
+    p.crc16 = o.crc16;
+    return p;
 }
 
 void XModemAdapter::resetForPhone()
 {
-    xmodemStore = meshtastic_XModem_init_zero;
+    if (outboxCount) {
+        outboxHead = (outboxHead + 1) % OUTBOX_SIZE;
+        outboxCount--;
+    }
+}
+
+void XModemAdapter::closeFile()
+{
+    spiLock->lock();
+    file.flush();
+    file.close();
+    if (sendingSnapshot)
+        FSCom.remove(XMODEM_SNAPSHOT_FILENAME);
+    spiLock->unlock();
+    sendingSnapshot = false;
+}
+
+void XModemAdapter::startReceive(uint8_t requestedWindow)
+{
+    spiLock->lock();
+    file = FSCom.open(filename, FILE_O_WRITE);
+    spiLock->unlock();
+    if (!file) {
+        sendControl(meshtastic_XModem_Control_NAK);
+        isReceiving = false;
+        return;
+    }
+
+    // We hold on to up to half the window before writing, so a windowed client may send half our slots ahead
+    windowed = requestedWindow > 0;
+    windowSize = windowed ? min(2 * requestedWindow, XMODEM_MAX_WINDOW) : 1;
+    memset(received, 0, sizeof(received));
+    isReceiving = true;
+    packetno = 1;
+    writtenSeq = 1;
+    // Tell a windowed client how many blocks it may send ahead
+    queue(meshtastic_XModem_Control_ACK, 0, windowed ? windowSize / 2 : 0);
+}
+
+void XModemAdapter::startTransmit(uint8_t requestedWindow)
+{
+    LOG_INFO("XModem: Transmit file %s", filename);
+    // Not real files, take a snapshot of the trace or the telemetry history as it is right now. The requested name may have
+    // a query in it, so all of them go to the same snapshot file
+    uint32_t since;
+    sendingSnapshot = true;
+    if (strcmp(filename, PACKET_TRACE_FILENAME) == 0)
+        packetTrace.save(XMODEM_SNAPSHOT_FILENAME);
+    else if (TelemetryHistory::isHistoryFile(filename, &since))
+        telemetryHistory.save(XMODEM_SNAPSHOT_FILENAME, since);
+    else
+        sendingSnapshot = false;
+    spiLock->lock();
+    file = FSCom.open(sendingSnapshot ? XMODEM_SNAPSHOT_FILENAME : filename, FILE_O_READ);
+    spiLock->unlock();
+    if (!file) {
+        closeFile();
+        sendControl(meshtastic_XModem_Control_NAK);
+        isTransmitting = false;
+        return;
+    }
+
+    windowed = requestedWindow > 0;
+    windowSize = windowed ? min(requestedWindow, (uint8_t)XMODEM_MAX_WINDOW) : 1;
+    isTransmitting = true;
+    retrans = MAXRETRANS;
+    packetno = 1;
+    nextSeq = 1;
+    lastSeq = 0;
+    fillWindow();
+}
+
+void XModemAdapter::fillWindow()
+{
+    uint16_t first = nextSeq;
+    spiLock->lock();
+    while (!lastSeq && nextSeq < packetno + windowSize) {
+        meshtastic_XModem &block = window[nextSeq % windowSize];
+        block = meshtastic_XModem_init_zero;
+        block.control = meshtastic_XModem_Control_SOH;
+        block.seq = nextSeq;
+        block.buffer.size = file.read(block.buffer.bytes, BLOCK_SIZE);
+        // A short (possibly empty) block ends the file, we send EOT once it is acked
+        if (block.buffer.size < BLOCK_SIZE)
+            lastSeq = nextSeq;
+        nextSeq++;
+    }
+    spiLock->unlock();
+
+    for (uint16_t seq = first; seq != nextSeq; seq++) {
+        meshtastic_XModem &block = window[seq % windowSize];
+        block.crc16 = crc16_ccitt(block.buffer.bytes, block.buffer.size);
+        LOG_DEBUG("XModem: Notify Send packet %d, %d Bytes", seq, block.buffer.size);
+        queue(meshtastic_XModem_Control_SOH, seq);
+    }
+}
+
+void XModemAdapter::handleAck(uint16_t seq)
+{
+    if (!isTransmitting) {
+        // just received something weird.
+        sendControl(meshtastic_XModem_Control_CAN);
+        return;
+    }
+    if (!windowed)
+        seq = packetno;
+    if (seq < packetno || seq >= nextSeq)
+        return; // stale or bogus ACK, the blocks after it are still on their way
+
+    retrans = MAXRETRANS; // reset retransmit counter
+    packetno = seq + 1;
+    if (lastSeq && packetno > lastSeq) {
+        sendControl(meshtastic_XModem_Control_EOT);
+        closeFile();
+        LOG_INFO("XModem: Finished send file %s", filename);
+        isTransmitting = false;
+        return;
+    }
+    fillWindow();
+}
+
+void XModemAdapter::handleNak(uint16_t seq)
+{
+    if (!isTransmitting) {
+        // just received something weird.
+        sendControl(meshtastic_XModem_Control_CAN);
+        return;
+    }
+    if (--retrans <= 0) {
+        sendControl(meshtastic_XModem_Control_CAN);
+        closeFile();
+        LOG_INFO("XModem: Retransmit timeout, cancel file %s", filename);
+        isTransmitting = false;
+        return;
+    }
+    if (!windowed || seq == 0)
+        seq = packetno;
+    // Send the same block again, we still have it in the window
+    if (seq >= packetno && seq < nextSeq) {
+        LOG_DEBUG("XModem: NAK Notify Send packet %d", seq);
+        queue(meshtastic_XModem_Control_SOH, seq);
+    }
+}
+
+void XModemAdapter::handleData(const meshtastic_XModem &p)
+{
+    uint16_t seq = p.seq;
+    if (!check(p.buffer.bytes, p.buffer.size, p.crc16)) {
+        queue(meshtastic_XModem_Control_NAK, windowed ? seq : 0);
+        return;
+    }
+    if (windowed && seq < packetno) {
+        // A retransmit of something we already have, so our ACK got lost
+        queue(meshtastic_XModem_Control_ACK, packetno - 1);
+        return;
+    }
+    if (seq < writtenSeq || seq >= writtenSeq + windowSize) {
+        queue(meshtastic_XModem_Control_NAK, windowed ? packetno : 0);
+        return;
+    }
+
+    window[seq % windowSize] = p;
+    received[seq % windowSize] = true;
+    uint16_t before = packetno;
+    while (packetno < writtenSeq + windowSize && received[packetno % windowSize])
+        packetno++;
+
+    if (seq > packetno) {
+        // Selective NAK: ask for the block we are missing, the ones after it are kept
+        queue(meshtastic_XModem_Control_NAK, packetno);
+    }
+    // Write half a window at a time
+    if (packetno - writtenSeq >= max(1, windowSize / 2))
+        flushReceived();
+    if (packetno != before)
+        queue(meshtastic_XModem_Control_ACK, windowed ? packetno - 1 : 0);
+}
+
+void XModemAdapter::flushReceived()
+{
+    if (packetno == writtenSeq)
+        return;
+
+    spiLock->lock();
+    for (uint16_t seq = writtenSeq; seq != packetno; seq++) {
+        meshtastic_XModem &block = window[seq % windowSize];
+        file.write(block.buffer.bytes, block.buffer.size);
+        received[seq % windowSize] = false;
+    }
+    spiLock->unlock();
+    writtenSeq = packetno;
 }
 
 void XModemAdapter::handlePacket(meshtastic_XModem xmodemPacket)
@@ -118,157 +372,51 @@ void XModemAdapter::handlePacket(meshtastic_XModem xmodemPacket)
     case meshtastic_XModem_Control_SOH:
     case meshtastic_XModem_Control_STX:
         if ((xmodemPacket.seq == 0) && !isReceiving && !isTransmitting) {
-            // NULL packet has the destination filename
+            // NULL packet has the destination filename, and in crc16 the window the client would like
             memcpy(filename, &xmodemPacket.buffer.bytes, xmodemPacket.buffer.size);
+            outboxCount = 0;
 
-            if (xmodemPacket.control == meshtastic_XModem_Control_SOH) { // Receive this file and put to Flash
-                spiLock->lock();
-                file = FSCom.open(filename, FILE_O_WRITE);
-                spiLock->unlock();
-                if (file) {
-                    sendControl(meshtastic_XModem_Control_ACK);
-                    isReceiving = true;
-                    packetno = 1;
-                    break;
-                }
-                sendControl(meshtastic_XModem_Control_NAK);
-                isReceiving = false;
-                break;
-            } else { // Transmit this file from Flash
-                LOG_INFO("XModem: Transmit file %s", filename);
-                spiLock->lock();
-                file = FSCom.open(filename, FILE_O_READ);
-                spiLock->unlock();
-                if (file) {
-                    packetno = 1;
-                    isTransmitting = true;
-                    xmodemStore = meshtastic_XModem_init_zero;
-                    xmodemStore.control = meshtastic_XModem_Control_SOH;
-                    xmodemStore.seq = packetno;
-                    spiLock->lock();
-                    xmodemStore.buffer.size = file.read(xmodemStore.buffer.bytes, sizeof(meshtastic_XModem_buffer_t::bytes));
-                    spiLock->unlock();
-                    xmodemStore.crc16 = crc16_ccitt(xmodemStore.buffer.bytes, xmodemStore.buffer.size);
-                    LOG_DEBUG("XModem: STX Notify Send packet %d, %d Bytes", packetno, xmodemStore.buffer.size);
-                    if (xmodemStore.buffer.size < sizeof(meshtastic_XModem_buffer_t::bytes)) {
-                        isEOT = true;
-                        // send EOT on next Ack
-                    }
-                    packetReady.notifyObservers(packetno);
-                    break;
-                }
-                sendControl(meshtastic_XModem_Control_NAK);
-                isTransmitting = false;
-                break;
-            }
-        } else {
-            if (isReceiving) {
-                // normal file data packet
-                if ((xmodemPacket.seq == packetno) &&
-                    check(xmodemPacket.buffer.bytes, xmodemPacket.buffer.size, xmodemPacket.crc16)) {
-                    // valid packet
-                    spiLock->lock();
-                    file.write(xmodemPacket.buffer.bytes, xmodemPacket.buffer.size);
-                    spiLock->unlock();
-                    sendControl(meshtastic_XModem_Control_ACK);
-                    packetno++;
-                    break;
-                }
-                // invalid packet
-                sendControl(meshtastic_XModem_Control_NAK);
-                break;
-            } else if (isTransmitting) {
-                // just received something weird.
-                sendControl(meshtastic_XModem_Control_CAN);
-                isTransmitting = false;
-                break;
-            }
+            if (xmodemPacket.control == meshtastic_XModem_Control_SOH) // Receive this file and put to Flash
+                startReceive(min(xmodemPacket.crc16, (uint16_t)UINT8_MAX));
+            else // Transmit this file from Flash
+                startTransmit(min(xmodemPacket.crc16, (uint16_t)UINT8_MAX));
+        } else if (isReceiving) {
+            // normal file data packet
+            handleData(xmodemPacket);
+        } else if (isTransmitting) {
+            // just received something weird.
+            sendControl(meshtastic_XModem_Control_CAN);
+            closeFile();
+            isTransmitting = false;
         }
         break;
     case meshtastic_XModem_Control_EOT:
         // End of transmission
+        if (isReceiving)
+            flushReceived();
         sendControl(meshtastic_XModem_Control_ACK);
-        spiLock->lock();
-        file.flush();
-        file.close();
-        spiLock->unlock();
+        closeFile();
         isReceiving = false;
         break;
     case meshtastic_XModem_Control_CAN:
-        // Cancel transmission and remove file
+        // Cancel transmission, and remove the file if it was coming to us
         sendControl(meshtastic_XModem_Control_ACK);
-        spiLock->lock();
-        file.flush();
-        file.close();
-
-        FSCom.remove(filename);
-        spiLock->unlock();
-        isReceiving = false;
-        break;
-    case meshtastic_XModem_Control_ACK:
-        // Acknowledge Send the next packet
-        if (isTransmitting) {
-            if (isEOT) {
-                sendControl(meshtastic_XModem_Control_EOT);
-                spiLock->lock();
-                file.close();
-                spiLock->unlock();
-                LOG_INFO("XModem: Finished send file %s", filename);
-                isTransmitting = false;
-                isEOT = false;
-                break;
-            }
-            retrans = MAXRETRANS; // reset retransmit counter
-            packetno++;
-            xmodemStore = meshtastic_XModem_init_zero;
-            xmodemStore.control = meshtastic_XModem_Control_SOH;
-            xmodemStore.seq = packetno;
+        closeFile();
+        if (!isTransmitting) {
             spiLock->lock();
-            xmodemStore.buffer.size = file.read(xmodemStore.buffer.bytes, sizeof(meshtastic_XModem_buffer_t::bytes));
+            FSCom.remove(filename);
             spiLock->unlock();
-            xmodemStore.crc16 = crc16_ccitt(xmodemStore.buffer.bytes, xmodemStore.buffer.size);
-            LOG_DEBUG("XModem: ACK Notify Send packet %d, %d Bytes", packetno, xmodemStore.buffer.size);
-            if (xmodemStore.buffer.size < sizeof(meshtastic_XModem_buffer_t::bytes)) {
-                isEOT = true;
-                // send EOT on next Ack
-            }
-            packetReady.notifyObservers(packetno);
-        } else {
-            // just received something weird.
-            sendControl(meshtastic_XModem_Control_CAN);
         }
+        isReceiving = false;
+        isTransmitting = false;
+        break;
+    case meshtastic_XModem_Control_ACK:
+        // Acknowledge Send the next packet(s)
+        handleAck(xmodemPacket.seq);
         break;
     case meshtastic_XModem_Control_NAK:
         // Negative acknowledge. Send the same buffer again
-        if (isTransmitting) {
-            if (--retrans <= 0) {
-                sendControl(meshtastic_XModem_Control_CAN);
-                spiLock->lock();
-                file.close();
-                spiLock->unlock();
-                LOG_INFO("XModem: Retransmit timeout, cancel file %s", filename);
-                isTransmitting = false;
-                break;
-            }
-            xmodemStore = meshtastic_XModem_init_zero;
-            xmodemStore.control = meshtastic_XModem_Control_SOH;
-            xmodemStore.seq = packetno;
-            spiLock->lock();
-            file.seek((packetno - 1) * sizeof(meshtastic_XModem_buffer_t::bytes));
-
-            xmodemStore.buffer.size = file.read(xmodemStore.buffer.bytes, sizeof(meshtastic_XModem_buffer_t::bytes));
-            spiLock->unlock();
-            xmodemStore.crc16 = crc16_ccitt(xmodemStore.buffer.bytes, xmodemStore.buffer.size);
-            LOG_DEBUG("XModem: NAK Notify Send packet %d, %d Bytes", packetno, xmodemStore.buffer.size);
-            if (xmodemStore.buffer.size < sizeof(meshtastic_XModem_buffer_t::bytes)) {
-                isEOT = true;
-                // send EOT on next Ack
-            }
-            packetReady.notifyObservers(packetno);
-        } else {
-            // just received something weird.
-            sendControl(meshtastic_XModem_Control_CAN);
-        }
+        handleNak(xmodemPacket.seq);
         break;
     default:
         // Unknown control character
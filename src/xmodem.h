@@ -38,6 +38,17 @@
 
 #define MAXRETRANS 25
 
+/**
+ * Most blocks in flight at once. A client asks for a windowed transfer by putting its window size in the crc16 field of the
+ * filename packet, old clients leave that 0 and get the original stop-and-wait behaviour.
+ */
+#ifndef XMODEM_MAX_WINDOW
+#define XMODEM_MAX_WINDOW 8
+#endif
+
+/// Downloads of the packet trace and the telemetry history are sent from a snapshot in this file, removed once they end
+#define XMODEM_SNAPSHOT_FILENAME "/xmodemsnap.bin"
+
 #ifdef FSCom
 
 class XModemAdapter
@@ -49,17 +60,47 @@ class XModemAdapter
     XModemAdapter();
 
     void handlePacket(meshtastic_XModem xmodemPacket);
+    /// The next packet for the phone, control NUL if there is none
     meshtastic_XModem getForPhone();
+    /// The packet returned by getForPhone() was taken
     void resetForPhone();
 
   private:
+    static constexpr size_t BLOCK_SIZE = sizeof(meshtastic_XModem_buffer_t::bytes);
+
     bool isReceiving = false;
     bool isTransmitting = false;
-    bool isEOT = false;
+    /// The file we are transmitting is XMODEM_SNAPSHOT_FILENAME
+    bool sendingSnapshot = false;
 
     int retrans = MAXRETRANS;
 
+    /// In windowed mode ACK and NAK carry the sequence number they refer to, ACKs are cumulative
+    bool windowed = false;
+    uint8_t windowSize = 1;
+
+    /// Transmitting: the oldest block not yet acked. Receiving: the next block we don't have yet, we acked all before it
     uint16_t packetno = 0;
+    /// Transmitting: the next block to read from the file
+    uint16_t nextSeq = 0;
+    /// Transmitting: the short block which ends the file, 0 while we haven't read it
+    uint16_t lastSeq = 0;
+    /// Receiving: the next block to write to the file
+    uint16_t writtenSeq = 0;
+
+    /// Transmitting: blocks sent but not yet acked. Receiving: blocks received but not yet written. Indexed by seq % windowSize
+    meshtastic_XModem window[XMODEM_MAX_WINDOW];
+    bool received[XMODEM_MAX_WINDOW] = {false};
+
+    /// What we still have to hand to the phone. Data blocks are copied from window[] when they are taken
+    struct Outgoing {
+        meshtastic_XModem_Control control;
+        uint16_t seq;
+        uint16_t crc16;
+    };
+    static constexpr size_t OUTBOX_SIZE = XMODEM_MAX_WINDOW + 2;
+    Outgoing outbox[OUTBOX_SIZE];
+    size_t outboxHead = 0, outboxCount = 0;
 
 #if defined(ARCH_NRF52) || defined(ARCH_STM32WL)
     File file = File(FSCom);
@@ -69,12 +110,23 @@ class XModemAdapter
 
     char filename[sizeof(meshtastic_XModem_buffer_t::bytes)] = {0};
 
+    void startTransmit(uint8_t requestedWindow);
+    void startReceive(uint8_t requestedWindow);
+    /// Read blocks until the window is full, holding spiLock once
+    void fillWindow();
+    void handleData(const meshtastic_XModem &p);
+    /// Write the blocks received in order so far, holding spiLock once
+    void flushReceived();
+    void handleAck(uint16_t seq);
+    void handleNak(uint16_t seq);
+    void queue(meshtastic_XModem_Control c, uint16_t seq = 0, uint16_t crc16 = 0);
+    void closeFile();
+
   protected:
-    meshtastic_XModem xmodemStore = meshtastic_XModem_init_zero;
     unsigned short crc16_ccitt(const pb_byte_t *buffer, int length);
     int check(const pb_byte_t *buf, int sz, unsigned short tcrc);
     void sendControl(meshtastic_XModem_Control c);
 };
 
 extern XModemAdapter xModem;
-#endif // FSCom
\ No newline at end of file
+#endif // FSCom
@@ -0,0 +1,202 @@
+#include "Channels.h"
+#include "CryptoEngine.h"
+#include "MeshTypes.h"
+#include "NodeDB.h"
+#include "Router.h"
+#include "TestUtil.h"
+#include "mesh/PayloadCompression.h"
+#include <unity.h>
+
+// Typical traffic on a public channel
+static const char *chatCorpus[] = {
+    "Good morning mesh!",
+    "Anyone copy? Testing from the hilltop repeater",
+    "ok",
+    "On my way, be there in 10 minutes",
+    "Can you hear me now? Signal report please",
+    "Heading back to the car, battery is at 20%",
+    "Weather is getting worse up here, wind picking up from the west",
+    "Thanks for the relay, got your message loud and clear",
+    "Meet at the trailhead parking lot at 0800 tomorrow",
+    "Does anyone have the channel settings for the event net?",
+    "New node online in the north valley, running LONG_FAST with a 5dBi antenna",
+    "I'm at the aid station near mile 14, we need more water and ice",
+    "Test test test 1 2 3",
+    "Who is running the router on the ridge? It's been rebooting every hour",
+    "Roger that. Standing by on the secondary channel.",
+    "Firmware update went fine, everything came back up after the reboot",
+};
+
+// ATAK GeoChat and position CoT, as sent over ATAK_FORWARDER
+static const char *takCorpus[] = {
+    "<event version=\"2.0\" uid=\"GeoChat.ANDROID-1234.All Chat Rooms.5f2c\" type=\"b-t-f\" how=\"h-g-i-g-o\">"
+    "<point lat=\"37.7749\" lon=\"-122.4194\" hae=\"9999999.0\" ce=\"9999999.0\" le=\"9999999.0\"/>"
+    "<detail><__chat chatroom=\"All Chat Rooms\" senderCallsign=\"ALPHA-1\"/><remarks>Moving to rally point</remarks>"
+    "</detail></event>",
+    "<event version=\"2.0\" uid=\"ANDROID-1234\" type=\"a-f-G-U-C\" how=\"m-g\">"
+    "<point lat=\"37.7750\" lon=\"-122.4195\" hae=\"12.0\" ce=\"5.0\" le=\"9999999.0\"/>"
+    "<detail><contact callsign=\"ALPHA-1\"/><__group name=\"Cyan\" role=\"Team Member\"/></detail></event>",
+};
+
+static meshtastic_Data makeData(const char *text, meshtastic_PortNum portnum)
+{
+    meshtastic_Data d = meshtastic_Data_init_default;
+    d.portnum = portnum;
+    d.payload.size = min(strlen(text), sizeof(d.payload.bytes));
+    memcpy(d.payload.bytes, text, d.payload.size);
+    return d;
+}
+
+static void checkRoundTrip(const meshtastic_Data &orig)
+{
+    meshtastic_Data d = orig;
+    if (compressPayload(d)) {
+        TEST_ASSERT_LESS_THAN(orig.payload.size, d.payload.size);
+        TEST_ASSERT_TRUE(d.bitfield & BITFIELD_COMPRESSED_MASK);
+    } else {
+        TEST_ASSERT_EQUAL(orig.payload.size, d.payload.size);
+        TEST_ASSERT_EQUAL(orig.bitfield, d.bitfield);
+    }
+    TEST_ASSERT_TRUE(decompressPayload(d));
+    TEST_ASSERT_EQUAL(orig.payload.size, d.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY(orig.payload.bytes, d.payload.bytes, orig.payload.size);
+    TEST_ASSERT_FALSE(d.bitfield & BITFIELD_COMPRESSED_MASK);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_roundtrip_corpus(void)
+{
+    for (auto text : chatCorpus)
+        checkRoundTrip(makeData(text, meshtastic_PortNum_TEXT_MESSAGE_APP));
+    for (auto text : takCorpus)
+        checkRoundTrip(makeData(text, meshtastic_PortNum_ATAK_FORWARDER));
+}
+
+void test_incompressible_payload_left_alone(void)
+{
+    meshtastic_Data d = meshtastic_Data_init_default;
+    d.portnum = meshtastic_PortNum_ATAK_FORWARDER;
+    d.payload.size = 64;
+    for (size_t i = 0; i < d.payload.size; i++)
+        d.payload.bytes[i] = (uint8_t)(i * 167 + 13);
+    meshtastic_Data orig = d;
+    TEST_ASSERT_FALSE(compressPayload(d));
+    TEST_ASSERT_FALSE(d.has_bitfield);
+    TEST_ASSERT_EQUAL_MEMORY(orig.payload.bytes, d.payload.bytes, orig.payload.size);
+}
+
+void test_uncompressed_payload_passes_through(void)
+{
+    meshtastic_Data d = makeData("plain text", meshtastic_PortNum_TEXT_MESSAGE_APP);
+    d.has_bitfield = true;
+    d.bitfield = BITFIELD_OK_TO_MQTT_MASK;
+    TEST_ASSERT_TRUE(decompressPayload(d));
+    TEST_ASSERT_EQUAL(10, d.payload.size);
+}
+
+// A near-limit text reply from another node arrives compressed. It only fits on air compressed, so we have to relay it that way
+void test_relay_keeps_compression(void)
+{
+    std::string text;
+    while (text.size() < meshtastic_Constants_DATA_PAYLOAD_LEN)
+        text += chatCorpus[text.size() % (sizeof(chatCorpus) / sizeof(chatCorpus[0]))];
+    meshtastic_Data orig = makeData(text.c_str(), meshtastic_PortNum_TEXT_MESSAGE_APP);
+    orig.reply_id = 0x2a2a2a2a;
+    TEST_ASSERT_EQUAL(meshtastic_Constants_DATA_PAYLOAD_LEN, orig.payload.size);
+
+    // What the sender puts on air
+    meshtastic_Data sent = orig;
+    TEST_ASSERT_TRUE(compressPayload(sent));
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = 0x13b2d662;
+    p.hop_limit = 3;
+    p.channel = channels.setActiveByIndex(0);
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    p.encrypted.size = pb_encode_to_bytes(p.encrypted.bytes, sizeof(p.encrypted.bytes), &meshtastic_Data_msg, &sent);
+    crypto->encryptPacket(p.from, p.id, p.encrypted.size, p.encrypted.bytes);
+
+    TEST_ASSERT_EQUAL(DecodeState::DECODE_SUCCESS, perhapsDecode(&p));
+    TEST_ASSERT_EQUAL(orig.payload.size, p.decoded.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY(orig.payload.bytes, p.decoded.payload.bytes, orig.payload.size);
+    TEST_ASSERT_TRUE(wasReceivedCompressed(p.from, p.id));
+
+    // Relaying it, as FloodingRouter does with a copy of the decoded packet
+    meshtastic_MeshPacket relayed = p;
+    relayed.hop_limit--;
+    TEST_ASSERT_EQUAL(meshtastic_Routing_Error_NONE, perhapsEncode(&relayed));
+
+    // The next hop reads the same text
+    TEST_ASSERT_EQUAL(DecodeState::DECODE_SUCCESS, perhapsDecode(&relayed));
+    TEST_ASSERT_EQUAL(orig.payload.size, relayed.decoded.payload.size);
+    TEST_ASSERT_EQUAL_MEMORY(orig.payload.bytes, relayed.decoded.payload.bytes, orig.payload.size);
+    TEST_ASSERT_EQUAL(orig.reply_id, relayed.decoded.reply_id);
+
+    // Whereas sent on uncompressed it wouldn't fit
+    meshtastic_MeshPacket other = p;
+    other.id++;
+    TEST_ASSERT_FALSE(wasReceivedCompressed(other.from, other.id));
+    TEST_ASSERT_EQUAL(meshtastic_Routing_Error_TOO_LARGE, perhapsEncode(&other));
+}
+
+static void benchmark(const char *name, const char *const *corpus, size_t count, meshtastic_PortNum portnum)
+{
+    const int rounds = 200;
+    size_t origBytes = 0, compressedBytes = 0;
+    uint32_t compressUs = 0, decompressUs = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            meshtastic_Data d = makeData(corpus[i], portnum);
+            if (r == 0)
+                origBytes += d.payload.size;
+            uint32_t start = micros();
+            compressPayload(d);
+            compressUs += micros() - start;
+            if (r == 0)
+                compressedBytes += d.payload.size;
+            start = micros();
+            decompressPayload(d);
+            decompressUs += micros() - start;
+        }
+    }
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%s: %u -> %u bytes (%u%%), compress %u us/msg, decompress %u us/msg", name, (unsigned)origBytes,
+             (unsigned)compressedBytes, (unsigned)(100 * compressedBytes / origBytes), compressUs / (rounds * (uint32_t)count),
+             decompressUs / (rounds * (uint32_t)count));
+    TEST_MESSAGE(msg);
+}
+
+void test_compression_benchmark(void)
+{
+    benchmark("chat", chatCorpus, sizeof(chatCorpus) / sizeof(chatCorpus[0]), meshtastic_PortNum_TEXT_MESSAGE_APP);
+    benchmark("TAK", takCorpus, sizeof(takCorpus) / sizeof(takCorpus[0]), meshtastic_PortNum_ATAK_FORWARDER);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    initPayloadCompression();
+    cryptLock = new concurrency::Lock();
+    nodeDB = new NodeDB();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_roundtrip_corpus);
+    RUN_TEST(test_incompressible_payload_left_alone);
+    RUN_TEST(test_uncompressed_payload_passes_through);
+    RUN_TEST(test_relay_keeps_compression);
+    RUN_TEST(test_compression_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,162 @@
+// trunk-ignore-all(gitleaks): These are dummy values. Not real secrets.
+#include "CryptoEngine.h"
+#include "RadioInterface.h"
+#include "TestUtil.h"
+#include <thread>
+#include <unity.h>
+#include <vector>
+
+static const size_t NUM_PACKETS = 2000;
+static const size_t PAYLOAD_LEN = 64;
+static const unsigned NUM_THREADS = 4;
+
+struct TestPacket {
+    uint32_t from;
+    uint64_t id;
+    uint8_t plain[PAYLOAD_LEN];
+    uint8_t encrypted[PAYLOAD_LEN + MESHTASTIC_PKC_OVERHEAD];
+};
+
+static std::vector<TestPacket> channelPackets, pkiPackets;
+static CryptoKey channelKey;
+static meshtastic_UserLite_public_key_t publicKey;
+
+static void fillPlain(TestPacket &t, size_t i)
+{
+    t.from = 0x1000 + (i % 37);
+    t.id = 0x13b2d662 + i;
+    for (size_t b = 0; b < PAYLOAD_LEN; b++)
+        t.plain[b] = (uint8_t)(i * 31 + b);
+}
+
+/// Decrypt packets [first, first + count) with their own context, as DecodePool workers do. Returns the number which matched.
+static size_t decryptChannel(size_t first, size_t count)
+{
+    CryptoContext ctx;
+    uint8_t scratch[PAYLOAD_LEN] __attribute__((__aligned__));
+    size_t ok = 0;
+    for (size_t i = first; i < first + count; i++) {
+        TestPacket &t = channelPackets[i];
+        memcpy(scratch, t.encrypted, PAYLOAD_LEN);
+        crypto->decrypt(channelKey, ctx, t.from, t.id, PAYLOAD_LEN, scratch);
+        if (memcmp(scratch, t.plain, PAYLOAD_LEN) == 0)
+            ok++;
+    }
+    return ok;
+}
+
+static size_t decryptPKI(size_t first, size_t count)
+{
+    CryptoContext ctx;
+    uint8_t scratch[PAYLOAD_LEN + MESHTASTIC_PKC_OVERHEAD] __attribute__((__aligned__));
+    size_t ok = 0;
+    for (size_t i = first; i < first + count; i++) {
+        TestPacket &t = pkiPackets[i];
+        if (crypto->decryptCurve25519(ctx, t.from, publicKey, t.id, PAYLOAD_LEN + MESHTASTIC_PKC_OVERHEAD, t.encrypted,
+                                      scratch) &&
+            memcmp(scratch, t.plain, PAYLOAD_LEN) == 0)
+            ok++;
+    }
+    return ok;
+}
+
+/// Run fn over all packets split across numThreads threads, returning the total matched and the elapsed ms
+static size_t runThreaded(size_t (*fn)(size_t, size_t), size_t numPackets, unsigned numThreads, uint32_t &elapsedMs)
+{
+    std::vector<std::thread> threads;
+    std::vector<size_t> results(numThreads);
+    size_t perThread = numPackets / numThreads;
+
+    uint32_t start = millis();
+    for (unsigned t = 0; t < numThreads; t++)
+        threads.emplace_back([&, t] { results[t] = fn(t * perThread, perThread); });
+    for (auto &t : threads)
+        t.join();
+    elapsedMs = millis() - start;
+
+    size_t total = 0;
+    for (auto r : results)
+        total += r;
+    return total;
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_parallel_channel_decrypt(void)
+{
+    uint32_t serialMs, parallelMs;
+    TEST_ASSERT_EQUAL(NUM_PACKETS, runThreaded(decryptChannel, NUM_PACKETS, 1, serialMs));
+    TEST_ASSERT_EQUAL(NUM_PACKETS, runThreaded(decryptChannel, NUM_PACKETS, NUM_THREADS, parallelMs));
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%u channel packets: 1 thread %u ms, %u threads %u ms", (unsigned)NUM_PACKETS, serialMs,
+             NUM_THREADS, parallelMs);
+    TEST_MESSAGE(msg);
+}
+
+void test_parallel_pki_decrypt(void)
+{
+    uint32_t serialMs, parallelMs;
+    size_t n = pkiPackets.size();
+    TEST_ASSERT_EQUAL(n, runThreaded(decryptPKI, n, 1, serialMs));
+    TEST_ASSERT_EQUAL(n, runThreaded(decryptPKI, n, NUM_THREADS, parallelMs));
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%u PKI packets: 1 thread %u ms, %u threads %u ms", (unsigned)n, serialMs, NUM_THREADS,
+             parallelMs);
+    TEST_MESSAGE(msg);
+}
+
+/// The legacy entry points, which use the engine's own key and nonce, must still agree with the reentrant ones
+void test_default_context_unchanged(void)
+{
+    TestPacket &t = channelPackets[7];
+    uint8_t scratch[PAYLOAD_LEN];
+    memcpy(scratch, t.encrypted, PAYLOAD_LEN);
+    crypto->setKey(channelKey);
+    crypto->decrypt(t.from, t.id, PAYLOAD_LEN, scratch);
+    TEST_ASSERT_EQUAL_MEMORY(t.plain, scratch, PAYLOAD_LEN);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    channelKey.length = 16;
+    for (uint8_t i = 0; i < 16; i++)
+        channelKey.bytes[i] = i + 1;
+    crypto->setKey(channelKey);
+    channelPackets.resize(NUM_PACKETS);
+    for (size_t i = 0; i < NUM_PACKETS; i++) {
+        TestPacket &t = channelPackets[i];
+        fillPlain(t, i);
+        memcpy(t.encrypted, t.plain, PAYLOAD_LEN);
+        crypto->encryptPacket(t.from, t.id, PAYLOAD_LEN, t.encrypted);
+    }
+
+    // Encrypting to our own public key gives the same shared key on both ends
+    uint8_t privateKey[32];
+    crypto->generateKeyPair(publicKey.bytes, privateKey);
+    publicKey.size = 32;
+    pkiPackets.resize(NUM_PACKETS / 10);
+    for (size_t i = 0; i < pkiPackets.size(); i++) {
+        TestPacket &t = pkiPackets[i];
+        fillPlain(t, i);
+        crypto->encryptCurve25519(0, t.from, publicKey, t.id, PAYLOAD_LEN, t.plain, t.encrypted);
+    }
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_parallel_channel_decrypt);
+    RUN_TEST(test_parallel_pki_decrypt);
+    RUN_TEST(test_default_context_unchanged);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,68 @@
+#include "TestUtil.h"
+#include "modules/Telemetry/EnvironmentAverager.h"
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static meshtastic_EnvironmentMetrics reading(float temperature, float pressure, uint16_t iaq)
+{
+    meshtastic_EnvironmentMetrics m = meshtastic_EnvironmentMetrics_init_zero;
+    m.has_temperature = true;
+    m.temperature = temperature;
+    m.has_barometric_pressure = pressure != 0;
+    m.barometric_pressure = pressure;
+    m.has_iaq = true;
+    m.iaq = iaq;
+    return m;
+}
+
+void test_averages_readings(void)
+{
+    EnvironmentAverager avg;
+    avg.add(reading(20.0f, 1000.0f, 50));
+    avg.add(reading(21.0f, 1002.0f, 60));
+    avg.add(reading(22.5f, 1004.0f, 70));
+    TEST_ASSERT_EQUAL(3, avg.count());
+
+    meshtastic_EnvironmentMetrics m = avg.get();
+    TEST_ASSERT_TRUE(m.has_temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 21.1667f, m.temperature);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 1002.0f, m.barometric_pressure);
+    // IAQ is filtered by the sensor already, so it's the last one
+    TEST_ASSERT_EQUAL(70, m.iaq);
+    TEST_ASSERT_FALSE(m.has_relative_humidity);
+}
+
+void test_missing_readings(void)
+{
+    EnvironmentAverager avg;
+    avg.add(reading(10.0f, 990.0f, 0));
+    avg.add(reading(12.0f, 0, 0)); // pressure sensor didn't answer this time
+    meshtastic_EnvironmentMetrics m = avg.get();
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 11.0f, m.temperature);
+    TEST_ASSERT_TRUE(m.has_barometric_pressure);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 990.0f, m.barometric_pressure);
+
+    avg.reset();
+    TEST_ASSERT_EQUAL(0, avg.count());
+    TEST_ASSERT_FALSE(avg.get().has_temperature);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_averages_readings);
+    RUN_TEST(test_missing_readings);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
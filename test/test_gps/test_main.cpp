@@ -0,0 +1,230 @@
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "gps/GPS.h"
+#include <string.h>
+#include <string>
+#include <unity.h>
+#include <vector>
+
+/// A serial port with a GPS module behind it, which answers what we write to it
+class SimulatedSerial : public HardwareSerial
+{
+  public:
+    enum Module { NONE, L76K, UBLOX8 };
+
+    Module module = NONE;
+    unsigned long baud = 0;
+    std::string tx;
+    std::vector<uint8_t> rx;
+    size_t rxPos = 0;
+
+    void begin(unsigned long b) override { baud = b; }
+    void begin(unsigned long b, uint16_t) override { baud = b; }
+    void end() override {}
+    int available() override { return rx.size() - rxPos; }
+    int peek() override { return available() ? rx[rxPos] : -1; }
+    int read() override { return available() ? rx[rxPos++] : -1; }
+    void flush() override {}
+    size_t write(uint8_t c) override
+    {
+        tx.push_back(c);
+        return 1;
+    }
+    size_t write(const uint8_t *buf, size_t len) override
+    {
+        tx.append((const char *)buf, len);
+        return len;
+    }
+    operator bool() override { return true; }
+
+    /// Answer everything written since the last call
+    void respond()
+    {
+        if (module == L76K && baud == 115200) {
+            // Its configuration is plain NMEA, nothing to ack
+            if (tx.find("$PCAS06,0*1B") != std::string::npos)
+                reply("$GPTXT,01,01,02,SW=URANUS5,V5.3.0.0*1D\r\n");
+        } else if (module == UBLOX8 && baud == 9600) {
+            for (size_t i = 0; i + 4 <= tx.size(); i++)
+                if ((uint8_t)tx[i] == 0xB5 && (uint8_t)tx[i + 1] == 0x62) {
+                    uint8_t cls = tx[i + 2], id = tx[i + 3];
+                    if (cls == 0x0A && id == 0x04) {
+                        // UBX-MON-VER: software and hardware version, then one extension
+                        std::vector<uint8_t> ver(30 + 10 + 30, 0);
+                        memcpy(&ver[0], "ROM SPG 3.01", 12);
+                        memcpy(&ver[30], "00080000", 8);
+                        memcpy(&ver[40], "PROTVER=18.00", 13);
+                        replyUBX(0x0A, 0x04, ver.data(), ver.size());
+                    } else {
+                        const uint8_t ack[] = {cls, id};
+                        replyUBX(0x05, 0x01, ack, sizeof(ack));
+                    }
+                }
+        }
+        tx.clear();
+    }
+
+  private:
+    void reply(const char *s) { rx.insert(rx.end(), s, s + strlen(s)); }
+
+    void replyUBX(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+    {
+        std::vector<uint8_t> f = {0xB5, 0x62, cls, id, (uint8_t)(len & 0xFF), (uint8_t)(len >> 8)};
+        f.insert(f.end(), payload, payload + len);
+        uint8_t a = 0, b = 0;
+        for (size_t i = 2; i < f.size(); i++) {
+            a += f[i];
+            b += a;
+        }
+        f.push_back(a);
+        f.push_back(b);
+        rx.insert(rx.end(), f.begin(), f.end());
+    }
+};
+
+static SimulatedSerial *serial;
+
+class GpsInitTest
+{
+  public:
+    GPS *gps;
+    uint32_t longestCallMsec = 0;
+    std::string sent; // everything we wrote to the module
+
+    explicit GpsInitTest(SimulatedSerial::Module module)
+    {
+        serial->module = module;
+        serial->tx.clear();
+        serial->rx.clear();
+        serial->rxPos = 0;
+        GPS::_serial_gps = serial;
+        gps = new GPS();
+        gps->tx_gpio = 1;
+        gps->restartInit(); // Init state is partly static, from the tests before
+    }
+
+    ~GpsInitTest() { delete gps; }
+
+    /**
+     * Call runInit() like runOnce() does until it is done, or wants to wait a while between baud rates
+     * @return true if it is done
+     */
+    bool run()
+    {
+        while (true) {
+            uint32_t start = millis();
+            int32_t wait = gps->runInit();
+            if (millis() - start > longestCallMsec)
+                longestCallMsec = millis() - start;
+            sent += serial->tx;
+            serial->respond();
+            if (wait == 0)
+                return true;
+            if (wait >= 2000)
+                return false;
+            delay(wait);
+        }
+    }
+
+    GnssModel_t model() const { return gps->gnssModel; }
+    int baud() const { return gps->initBaud; }
+    bool connected() const { return gps->isConnected(); }
+    void forgetCache() { gps->forgetCachedModel(); }
+
+    /// What runOnce() does when the cached model doesn't answer
+    void restart()
+    {
+        gps->forgetCachedModel();
+        gps->restartInit();
+        sent.clear();
+    }
+};
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_no_module(void)
+{
+    GpsInitTest t(SimulatedSerial::NONE);
+    t.forgetCache();
+    // Nothing answers at the first baud rate, so it moves on to the next one
+    TEST_ASSERT_FALSE(t.run());
+    TEST_ASSERT_EQUAL(GNSS_MODEL_UNKNOWN, t.model());
+    TEST_ASSERT_FALSE(t.connected());
+    TEST_ASSERT_TRUE(t.sent.find("$PCAS06,0*1B") != std::string::npos);
+    // Waiting for answers never held up the main loop
+    TEST_ASSERT_LESS_THAN(50, t.longestCallMsec);
+}
+
+void test_l76k(void)
+{
+    GpsInitTest t(SimulatedSerial::L76K);
+    t.forgetCache();
+    // Not at 9600, found at 115200
+    TEST_ASSERT_FALSE(t.run());
+    TEST_ASSERT_TRUE(t.run());
+    TEST_ASSERT_EQUAL(GNSS_MODEL_MTK, t.model());
+    TEST_ASSERT_EQUAL(115200, t.baud());
+    TEST_ASSERT_TRUE(t.connected());
+    TEST_ASSERT_LESS_THAN(50, t.longestCallMsec);
+}
+
+void test_ublox8(void)
+{
+    GpsInitTest t(SimulatedSerial::UBLOX8);
+    t.forgetCache();
+    TEST_ASSERT_TRUE(t.run());
+    TEST_ASSERT_EQUAL(GNSS_MODEL_UBLOX8, t.model());
+    TEST_ASSERT_EQUAL(9600, t.baud());
+    TEST_ASSERT_TRUE(t.connected());
+    TEST_ASSERT_LESS_THAN(50, t.longestCallMsec);
+}
+
+void test_cached_model_skips_probe(void)
+{
+    // test_ublox8 left the model in the cache
+    GpsInitTest t(SimulatedSerial::UBLOX8);
+    TEST_ASSERT_TRUE(t.run());
+    TEST_ASSERT_EQUAL(GNSS_MODEL_UBLOX8, t.model());
+    TEST_ASSERT_TRUE(t.connected());
+    TEST_ASSERT_TRUE(t.sent.find("$PCAS06") == std::string::npos);
+    TEST_ASSERT_TRUE(t.sent.find("$PDTINFO") == std::string::npos);
+}
+
+void test_restart_probes_again(void)
+{
+    // The cache says U-blox 8, but there's an L76K now. Once runOnce() gives up on the cached model it restarts init
+    GpsInitTest t(SimulatedSerial::L76K);
+    TEST_ASSERT_TRUE(t.run());
+    TEST_ASSERT_EQUAL(GNSS_MODEL_UBLOX8, t.model());
+
+    t.restart();
+    TEST_ASSERT_FALSE(t.run());
+    TEST_ASSERT_TRUE(t.run());
+    TEST_ASSERT_EQUAL(GNSS_MODEL_MTK, t.model());
+    TEST_ASSERT_TRUE(t.sent.find("$PCAS06,0*1B") != std::string::npos);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    initSPI();
+    serial = new SimulatedSerial();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_no_module);
+    RUN_TEST(test_l76k);
+    RUN_TEST(test_ublox8);
+    RUN_TEST(test_cached_model_skips_probe);
+    RUN_TEST(test_restart_probes_again);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
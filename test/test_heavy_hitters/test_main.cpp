@@ -0,0 +1,118 @@
+#include "HeavyHitters.h"
+#include "TestUtil.h"
+#include "airtime.h"
+#include <map>
+#include <unity.h>
+
+typedef HeavyHitters<uint64_t, 8> Sketch;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_exact_when_fewer_keys_than_slots(void)
+{
+    Sketch s;
+    for (uint64_t k = 1; k <= 5; k++)
+        for (uint64_t i = 0; i < k; i++)
+            s.add(k, 100);
+
+    Sketch::Entry top[8];
+    TEST_ASSERT_EQUAL(5, s.top(top, 8));
+    for (size_t i = 0; i < 5; i++) {
+        TEST_ASSERT_EQUAL(5 - i, top[i].key);
+        TEST_ASSERT_EQUAL(100 * (5 - i), top[i].weight);
+        TEST_ASSERT_EQUAL(0, top[i].error);
+        TEST_ASSERT_EQUAL(5 - i, top[i].count);
+    }
+    TEST_ASSERT_EQUAL(1500, s.getTotal());
+
+    // Asking for fewer still gives the heaviest
+    TEST_ASSERT_EQUAL(2, s.top(top, 2));
+    TEST_ASSERT_EQUAL(5, top[0].key);
+    TEST_ASSERT_EQUAL(4, top[1].key);
+}
+
+void test_heavy_hitters_survive_many_small_keys(void)
+{
+    // Three chatty nodes among a thousand which each send once, interleaved like real traffic
+    Sketch s;
+    std::map<uint64_t, uint32_t> exact;
+    uint64_t noisy = 1000;
+    for (int round = 0; round < 1000; round++) {
+        s.add(1, 400);
+        exact[1] += 400;
+        if (round % 2 == 0) {
+            s.add(2, 300);
+            exact[2] += 300;
+        }
+        if (round % 4 == 0) {
+            s.add(3, 500);
+            exact[3] += 500;
+        }
+        s.add(noisy, 60);
+        exact[noisy++] += 60;
+    }
+
+    Sketch::Entry top[8];
+    size_t n = s.top(top, 8);
+    TEST_ASSERT_EQUAL(8, n);
+    TEST_ASSERT_EQUAL(1, top[0].key);
+    TEST_ASSERT_EQUAL(2, top[1].key);
+    TEST_ASSERT_EQUAL(3, top[2].key);
+
+    // Space-Saving never underestimates, and overestimates by at most error, which is at most total / N
+    for (size_t i = 0; i < n; i++) {
+        uint32_t truth = exact[top[i].key];
+        TEST_ASSERT_GREATER_OR_EQUAL(truth, top[i].weight);
+        TEST_ASSERT_LESS_OR_EQUAL(truth + top[i].error, top[i].weight);
+        TEST_ASSERT_LESS_OR_EQUAL(s.getTotal() / 8, top[i].error);
+    }
+}
+
+void test_decay(void)
+{
+    Sketch s;
+    s.add(1, 1000);
+    s.add(2, 1);
+    s.decay();
+
+    Sketch::Entry top[8];
+    TEST_ASSERT_EQUAL(1, s.top(top, 8));
+    TEST_ASSERT_EQUAL(1, top[0].key);
+    TEST_ASSERT_EQUAL(500, top[0].weight);
+    // The packet count is not a weight, it stays as it was
+    TEST_ASSERT_EQUAL(1, top[0].count);
+    TEST_ASSERT_EQUAL(500, s.getTotal());
+
+    s.clear();
+    TEST_ASSERT_EQUAL(0, s.top(top, 8));
+    TEST_ASSERT_EQUAL(0, s.getTotal());
+}
+
+void test_source_key(void)
+{
+    uint64_t key = AirTime::sourceKey(0xdeadbeef, meshtastic_PortNum_TEXT_MESSAGE_APP);
+    TEST_ASSERT_EQUAL_HEX32(0xdeadbeef, AirTime::sourceNode(key));
+    TEST_ASSERT_EQUAL(meshtastic_PortNum_TEXT_MESSAGE_APP, AirTime::sourcePortnum(key));
+    TEST_ASSERT_NOT_EQUAL(key, AirTime::sourceKey(0xdeadbeef, meshtastic_PortNum_POSITION_APP));
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_exact_when_fewer_keys_than_slots);
+    RUN_TEST(test_heavy_hitters_survive_many_small_keys);
+    RUN_TEST(test_decay);
+    RUN_TEST(test_source_key);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
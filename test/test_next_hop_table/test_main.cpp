@@ -0,0 +1,263 @@
+#include "NextHopTable.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+static const NodeNum dest = 0x1234;
+static const uint32_t minute = 60 * 1000;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_best_by_score(void)
+{
+    NextHopTable *t = new NextHopTable();
+    TEST_ASSERT_EQUAL(NO_NEXT_HOP_PREFERENCE, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, 0));
+
+    t->recordSuccess(dest, 0x11, 5, 0);
+    t->recordSuccess(dest, 0x22, 5, 0);
+    t->recordSuccess(dest, 0x22, 5, 1000);
+    TEST_ASSERT_EQUAL_HEX8(0x22, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, 1000));
+
+    // Never the node which handed us the packet
+    TEST_ASSERT_EQUAL_HEX8(0x11, t->getBest(dest, 0x22, 1000));
+
+    // Same score, better SNR wins
+    t->recordSuccess(0x5678, 0x11, -10, 0);
+    t->recordSuccess(0x5678, 0x22, 3, 0);
+    TEST_ASSERT_EQUAL_HEX8(0x22, t->getBest(0x5678, NO_NEXT_HOP_PREFERENCE, 0));
+    TEST_ASSERT_EQUAL(2, t->size());
+    delete t;
+}
+
+void test_failure_walks_candidates(void)
+{
+    NextHopTable *t = new NextHopTable();
+    // 0x11 is the freshest and best
+    const uint32_t start = NEXT_HOP_HALF_LIFE_MSEC, now = start + minute;
+    t->recordSuccess(dest, 0x22, 5, 0);
+    t->recordSuccess(dest, 0x33, 5, 0);
+    t->recordSuccess(dest, 0x11, 5, start);
+    t->recordSuccess(dest, 0x11, 5, start);
+    TEST_ASSERT_EQUAL_HEX8(0x11, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, start));
+
+    // One failure could be a collision, two in a row and we try the others
+    t->recordFailure(dest, 0x11, now);
+    TEST_ASSERT_EQUAL_HEX8(0x11, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now));
+    t->recordFailure(dest, 0x11, now);
+    uint8_t second = t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now);
+    TEST_ASSERT_TRUE(second == 0x22 || second == 0x33);
+    t->recordFailure(dest, second, now);
+    t->recordFailure(dest, second, now);
+    uint8_t third = t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now);
+    TEST_ASSERT_TRUE(third != second && third != 0x11);
+
+    // Once all of them failed we still get one, unless we want a reliable one
+    t->recordFailure(dest, third, now);
+    t->recordFailure(dest, third, now);
+    TEST_ASSERT_NOT_EQUAL(NO_NEXT_HOP_PREFERENCE, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now));
+    TEST_ASSERT_EQUAL(NO_NEXT_HOP_PREFERENCE, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now, NEXT_HOP_MIN_SCORE, false));
+
+    // Until they've been gone for a while
+    TEST_ASSERT_EQUAL_HEX8(0x11, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now + NEXT_HOP_FAIL_HOLDOFF_MSEC, NEXT_HOP_MIN_SCORE,
+                                            false));
+
+    // An implicit ACK clears the hold off
+    t->recordRelayed(dest, third, now);
+    TEST_ASSERT_EQUAL_HEX8(third, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now));
+    delete t;
+}
+
+void test_retry_avoids_failed_hop(void)
+{
+    NextHopTable *t = new NextHopTable();
+    // 0x11 is good enough to still score above NEXT_HOP_LAST_TRY_SCORE after failing once, 0x22 is fine too
+    t->recordSuccess(dest, 0x11, 5, 0);
+    t->recordSuccess(dest, 0x11, 5, 0);
+    t->recordSuccess(dest, 0x11, 5, 0);
+    t->recordSuccess(dest, 0x22, 5, 0);
+    TEST_ASSERT_EQUAL_HEX8(0x11, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, 0));
+
+    // Even on the last try we don't ask 0x11 again
+    TEST_ASSERT_EQUAL_HEX8(0x22, t->retryHop(dest, 0x11, true, minute));
+    TEST_ASSERT_GREATER_OR_EQUAL(NEXT_HOP_LAST_TRY_SCORE, NextHopTable::score(t->find(dest)->candidates[0], minute));
+
+    // Earlier retransmissions give it another chance, one failure is likely a collision
+    const NodeNum dest2 = 0x5678;
+    t->recordSuccess(dest2, 0x11, 5, 0);
+    t->recordSuccess(dest2, 0x11, 5, 0);
+    t->recordSuccess(dest2, 0x11, 5, 0);
+    t->recordSuccess(dest2, 0x22, 5, 0);
+    t->recordFailure(dest2, 0x22, 0);
+    TEST_ASSERT_EQUAL_HEX8(0x11, t->retryHop(dest2, 0x11, false, minute));
+    // If the other one isn't reliable enough, the last try floods
+    TEST_ASSERT_EQUAL(NO_NEXT_HOP_PREFERENCE, t->retryHop(dest2, 0x11, true, minute));
+    delete t;
+}
+
+void test_aging_and_replacement(void)
+{
+    NextHopTable *t = new NextHopTable();
+    for (uint8_t relay = 1; relay <= NEXT_HOP_CANDIDATES; relay++)
+        t->recordSuccess(dest, relay, 0, 0);
+    const NextHopCandidate &c = t->find(dest)->candidates[0];
+    TEST_ASSERT_EQUAL(NEXT_HOP_INITIAL_SCORE, NextHopTable::score(c, 0));
+    TEST_ASSERT_EQUAL(NEXT_HOP_INITIAL_SCORE / 2, NextHopTable::score(c, NEXT_HOP_HALF_LIFE_MSEC));
+    // Too old to be used
+    TEST_ASSERT_EQUAL(NO_NEXT_HOP_PREFERENCE, t->getBest(dest, NO_NEXT_HOP_PREFERENCE, 3 * NEXT_HOP_HALF_LIFE_MSEC));
+
+    // A new candidate takes the place of the worst one
+    t->recordFailure(dest, 2, minute);
+    t->recordSuccess(dest, 0x44, 0, minute);
+    auto r = t->find(dest);
+    TEST_ASSERT_EQUAL(NEXT_HOP_CANDIDATES, r->numCandidates);
+    for (uint8_t i = 0; i < r->numCandidates; i++)
+        TEST_ASSERT_NOT_EQUAL(2, r->candidates[i].relay);
+    delete t;
+}
+
+void test_full_table_drops_oldest(void)
+{
+    NextHopTable *t = new NextHopTable();
+    for (NodeNum n = 1; n <= NEXT_HOP_TABLE_SIZE; n++)
+        t->recordSuccess(n, 0x11, 0, n * 1000);
+    t->recordSuccess(NEXT_HOP_TABLE_SIZE + 1, 0x11, 0, (NEXT_HOP_TABLE_SIZE + 1) * 1000);
+    TEST_ASSERT_EQUAL(NEXT_HOP_TABLE_SIZE, t->size());
+    TEST_ASSERT_NULL(t->find(1));
+    TEST_ASSERT_NOT_NULL(t->find(2));
+    TEST_ASSERT_NOT_NULL(t->find(NEXT_HOP_TABLE_SIZE + 1));
+    delete t;
+}
+
+/**
+ * A sender with three possible relays towards a destination, which each drop out for a while now and then (they move, run out
+ * of battery or are busy with someone else's traffic). Each message gets the original send and two retransmissions, like
+ * ReliableRouter does. A flood is rebroadcast by the whole mesh, a directed send only by the next hop.
+ */
+struct SimResult {
+    uint32_t delivered = 0, floods = 0, transmissions = 0;
+};
+
+static const uint8_t simRelays[] = {0x11, 0x22, 0x33};
+static const uint32_t simQuality[] = {95, 80, 60}; // Percent of our packets each relay forwards when it's around
+static const uint32_t simMeshSize = 10, simMessages = 20000, simRetries = 2;
+
+static uint32_t simRandom(uint32_t *state)
+{
+    *state = *state * 1664525 + 1013904223;
+    return *state >> 8;
+}
+
+static bool simChance(uint32_t *state, uint32_t percent)
+{
+    return simRandom(state) % 100 < percent;
+}
+
+static SimResult simulate(bool useTable)
+{
+    NextHopTable *t = new NextHopTable();
+    uint8_t single = NO_NEXT_HOP_PREFERENCE; // What NextHopRouter used to remember
+    uint32_t quality[3];
+    uint32_t awayUntil[3] = {0, 0, 0};
+    // Separate random numbers for the relays coming and going, so both strategies see the same mesh
+    uint32_t meshRnd = 1, rnd = 2;
+    SimResult res;
+
+    for (uint32_t m = 0; m < simMessages; m++) {
+        uint32_t now = m * minute;
+        for (uint32_t i = 0; i < 3; i++) {
+            if (now >= awayUntil[i] && simChance(&meshRnd, 3))
+                awayUntil[i] = now + (5 + simRandom(&meshRnd) % 15) * minute;
+            quality[i] = now < awayUntil[i] ? 0 : simQuality[i];
+        }
+
+        uint8_t asked = NO_NEXT_HOP_PREFERENCE;
+        for (uint32_t attempt = 0; attempt <= simRetries; attempt++) {
+            bool isLast = attempt == simRetries;
+            uint8_t hop;
+            if (useTable) {
+                if (attempt == 0)
+                    hop = t->getBest(dest, NO_NEXT_HOP_PREFERENCE, now);
+                else
+                    hop = t->retryHop(dest, asked, isLast, now);
+            } else {
+                if (isLast)
+                    single = NO_NEXT_HOP_PREFERENCE;
+                hop = single;
+            }
+            asked = hop;
+
+            uint8_t ackVia = NO_NEXT_HOP_PREFERENCE;
+            if (hop == NO_NEXT_HOP_PREFERENCE) {
+                res.floods++;
+                res.transmissions += simMeshSize;
+                // The ACK comes back through whichever relay got there first
+                uint32_t first = simRandom(&rnd) % 3;
+                for (uint32_t i = first; i < first + 3; i++)
+                    if (ackVia == NO_NEXT_HOP_PREFERENCE && simChance(&rnd, quality[i % 3]))
+                        ackVia = simRelays[i % 3];
+            } else {
+                uint32_t i = 0;
+                while (simRelays[i] != hop)
+                    i++;
+                res.transmissions++;
+                if (simChance(&rnd, quality[i])) {
+                    res.transmissions++;
+                    ackVia = hop;
+                }
+            }
+
+            if (ackVia != NO_NEXT_HOP_PREFERENCE) {
+                res.delivered++;
+                if (useTable)
+                    t->recordSuccess(dest, ackVia, 0, now);
+                else
+                    single = ackVia;
+                break;
+            }
+        }
+    }
+    delete t;
+    return res;
+}
+
+void test_simulated_delivery_vs_airtime(void)
+{
+    SimResult single = simulate(false), table = simulate(true);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "single next hop: delivered %u%%, %u floods, %u.%u tx per message",
+             (unsigned)(single.delivered * 100 / simMessages), (unsigned)single.floods,
+             (unsigned)(single.transmissions / simMessages), (unsigned)(single.transmissions * 10 / simMessages % 10));
+    TEST_MESSAGE(msg);
+    snprintf(msg, sizeof(msg), "next hop table:  delivered %u%%, %u floods, %u.%u tx per message",
+             (unsigned)(table.delivered * 100 / simMessages), (unsigned)table.floods,
+             (unsigned)(table.transmissions / simMessages), (unsigned)(table.transmissions * 10 / simMessages % 10));
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_LESS_THAN(single.floods, table.floods);
+    TEST_ASSERT_LESS_THAN(single.transmissions, table.transmissions);
+    // Fewer floods shouldn't cost us deliveries
+    TEST_ASSERT_GREATER_OR_EQUAL(single.delivered - simMessages / 100, table.delivered);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_best_by_score);
+    RUN_TEST(test_failure_walks_candidates);
+    RUN_TEST(test_retry_avoids_failed_hop);
+    RUN_TEST(test_aging_and_replacement);
+    RUN_TEST(test_full_table_drops_oldest);
+    RUN_TEST(test_simulated_delivery_vs_airtime);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
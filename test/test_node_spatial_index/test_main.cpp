@@ -0,0 +1,219 @@
+#include "TestUtil.h"
+#include "gps/GeoCoord.h"
+#include "mesh/NodeSpatialIndex.h"
+#include <algorithm>
+#include <unity.h>
+#include <vector>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static uint32_t seed = 1;
+static int32_t rnd(int32_t range)
+{
+    seed = seed * 1103515245 + 12345;
+    return (int32_t)((seed >> 8) % (2 * (uint32_t)range + 1)) - range;
+}
+
+/// A synthetic map: most nodes in a few towns, some along a long corridor, a few across the antimeridian and near a pole
+static std::vector<meshtastic_NodeInfoLite> makeMap(size_t n)
+{
+    static const int32_t towns[][2] = {{525200000, 134000000}, {480000000, 115000000}, {-337000000, 1512000000}};
+    std::vector<meshtastic_NodeInfoLite> nodes(n);
+    for (size_t i = 0; i < n; i++) {
+        meshtastic_NodeInfoLite &node = nodes[i];
+        node.num = 1000 + i;
+        node.has_position = i % 10 != 9; // Some don't have a position
+        int32_t lat, lon;
+        if (i % 50 == 0) {
+            lat = 150000000 + rnd(50000000);
+            lon = 1799000000 + rnd(1000000);
+            if (lon > 1800000000)
+                lon -= 3600000000LL;
+        } else if (i % 50 == 1) {
+            lat = 890000000 + rnd(9000000);
+            lon = rnd(1800000000);
+        } else if (i % 5 == 0) {
+            lat = 500000000 + rnd(30000000);
+            lon = 100000000 + rnd(100000000);
+        } else {
+            const int32_t *town = towns[i % 3];
+            lat = town[0] + rnd(1000000);
+            lon = town[1] + rnd(1500000);
+        }
+        node.position.latitude_i = lat;
+        node.position.longitude_i = lon;
+    }
+    return nodes;
+}
+
+/// What within() should return, by measuring the distance to every node
+static std::vector<NodeSpatialIndex::Result> scan(const std::vector<meshtastic_NodeInfoLite> &nodes, int32_t lat, int32_t lon,
+                                                  uint32_t meters)
+{
+    std::vector<NodeSpatialIndex::Result> out;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const meshtastic_PositionLite &p = nodes[i].position;
+        if (!nodes[i].has_position || (!p.latitude_i && !p.longitude_i))
+            continue;
+        uint32_t d = NodeSpatialIndex::distance(lat, lon, p.latitude_i, p.longitude_i);
+        if (d <= meters)
+            out.push_back({(uint16_t)i, d});
+    }
+    std::sort(out.begin(), out.end(), [](const NodeSpatialIndex::Result &a, const NodeSpatialIndex::Result &b) {
+        return a.meters < b.meters || (a.meters == b.meters && a.index < b.index);
+    });
+    return out;
+}
+
+static void assertSame(const std::vector<NodeSpatialIndex::Result> &expected, const std::vector<NodeSpatialIndex::Result> &actual)
+{
+    TEST_ASSERT_EQUAL(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        TEST_ASSERT_EQUAL(expected[i].index, actual[i].index);
+        TEST_ASSERT_EQUAL_UINT32(expected[i].meters, actual[i].meters);
+    }
+}
+
+void test_distance(void)
+{
+    // Against the great circle distance, on short and long ranges, and across the antimeridian
+    const int32_t points[][4] = {{525200000, 134000000, 525300000, 134100000},   {525200000, 134000000, 530000000, 140000000},
+                                 {-337000000, 1512000000, -338000000, 1510000000}, {0, 1799990000, 0, -1799990000},
+                                 {480000000, 115000000, 520000000, 134000000},     {700000000, 200000000, 705000000, 209000000}};
+    for (const int32_t *p : points) {
+        float expected = GeoCoord::latLongToMeter(p[0] * 1e-7, p[1] * 1e-7, p[2] * 1e-7, p[3] * 1e-7);
+        uint32_t d = NodeSpatialIndex::distance(p[0], p[1], p[2], p[3]);
+        TEST_ASSERT_UINT32_WITHIN(expected / 200 + 2, (uint32_t)expected, d);
+        TEST_ASSERT_EQUAL_UINT32(d, NodeSpatialIndex::distance(p[2], p[3], p[0], p[1]));
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, NodeSpatialIndex::distance(525200000, 134000000, 525200000, 134000000));
+}
+
+void test_within_and_nearest(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes = makeMap(2000);
+    NodeSpatialIndex index;
+    index.rebuild(nodes.data(), nodes.size());
+
+    const int32_t queries[][2] = {{525200000, 134000000}, {150000000, 1800000000}, {150000000, -1799500000},
+                                  {895000000, 0},         {-337000000, 1512000000}, {0, 0}};
+    const uint32_t radii[] = {0, 500, 5000, 50000, 300000, 3000000, 20000000};
+    std::vector<NodeSpatialIndex::Result> found;
+    for (const int32_t *q : queries) {
+        for (uint32_t meters : radii) {
+            index.within(q[0], q[1], meters, found);
+            assertSame(scan(nodes, q[0], q[1], meters), found);
+        }
+        for (size_t k : {1, 7, 100}) {
+            index.nearest(q[0], q[1], k, found);
+            std::vector<NodeSpatialIndex::Result> expected = scan(nodes, q[0], q[1], UINT32_MAX);
+            expected.resize(std::min(k, expected.size()));
+            assertSame(expected, found);
+        }
+    }
+}
+
+void test_update(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes = makeMap(100);
+    NodeSpatialIndex index;
+    index.rebuild(nodes.data(), nodes.size());
+    size_t indexed = index.size();
+
+    // Move a node to the other side of the world
+    nodes[3].position.latitude_i = -450000000;
+    nodes[3].position.longitude_i = -700000000;
+    index.update(nodes.data(), 3);
+    TEST_ASSERT_EQUAL(indexed, index.size());
+    std::vector<NodeSpatialIndex::Result> found;
+    index.nearest(-450000000, -700000000, 1, found);
+    TEST_ASSERT_EQUAL(1, found.size());
+    TEST_ASSERT_EQUAL(3, found[0].index);
+    TEST_ASSERT_EQUAL_UINT32(0, found[0].meters);
+
+    // Then it loses its position
+    nodes[3].has_position = false;
+    index.update(nodes.data(), 3);
+    TEST_ASSERT_EQUAL(indexed - 1, index.size());
+    index.within(-450000000, -700000000, 100000, found);
+    TEST_ASSERT_EQUAL(0, found.size());
+
+    // A node which had no position gets one
+    nodes[9].has_position = true;
+    index.update(nodes.data(), 9);
+    TEST_ASSERT_EQUAL(indexed, index.size());
+    const meshtastic_PositionLite &p = nodes[9].position;
+    index.within(p.latitude_i, p.longitude_i, 20000, found);
+    assertSame(scan(nodes, p.latitude_i, p.longitude_i, 20000), found);
+}
+
+void test_benchmark(void)
+{
+    const uint32_t numNodes = 5000, rounds = 200;
+    std::vector<meshtastic_NodeInfoLite> nodes = makeMap(numNodes);
+    NodeSpatialIndex index;
+    uint32_t start = micros();
+    index.rebuild(nodes.data(), nodes.size());
+    uint32_t rebuildUs = micros() - start;
+
+    // Nodes within 5 km of a point in a town, with the index and by measuring the distance to every node with trig
+    std::vector<NodeSpatialIndex::Result> found;
+    start = micros();
+    for (size_t r = 0; r < rounds; r++)
+        index.within(nodes[r * 3 + 2].position.latitude_i, nodes[r * 3 + 2].position.longitude_i, 5000, found);
+    uint32_t withinUs = micros() - start;
+
+    size_t scanned = 0;
+    start = micros();
+    for (size_t r = 0; r < rounds; r++) {
+        const meshtastic_PositionLite &q = nodes[r * 3 + 2].position;
+        for (const meshtastic_NodeInfoLite &n : nodes) {
+            const meshtastic_PositionLite &p = n.position;
+            float d =
+                GeoCoord::latLongToMeter(q.latitude_i * 1e-7, q.longitude_i * 1e-7, p.latitude_i * 1e-7, p.longitude_i * 1e-7);
+            if (n.has_position && d <= 5000)
+                scanned++;
+        }
+    }
+    uint32_t scanUs = micros() - start;
+
+    start = micros();
+    for (size_t r = 0; r < rounds; r++)
+        index.nearest(nodes[r * 3 + 2].position.latitude_i, nodes[r * 3 + 2].position.longitude_i, 10, found);
+    uint32_t nearestUs = micros() - start;
+
+    start = micros();
+    for (size_t r = 0; r < rounds; r++) {
+        nodes[r].position.latitude_i += 1000;
+        index.update(nodes.data(), r);
+    }
+    uint32_t updateUs = micros() - start;
+
+    char msg[200];
+    snprintf(msg, sizeof(msg),
+             "%u nodes: rebuild %u us, within 5 km %u us (trig scan %u us), 10 nearest %u us, update %u us, %u found per query",
+             (unsigned)numNodes, (unsigned)rebuildUs, (unsigned)(withinUs / rounds), (unsigned)(scanUs / rounds),
+             (unsigned)(nearestUs / rounds), (unsigned)(updateUs / rounds), (unsigned)(scanned / rounds));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_distance);
+    RUN_TEST(test_within_and_nearest);
+    RUN_TEST(test_update);
+    RUN_TEST(test_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,99 @@
+#include "TestUtil.h"
+#include "mesh/NodeViews.h"
+#include <unity.h>
+#include <vector>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static const uint32_t now = 1700000000;
+
+/// Count like NodeDB::getNumOnlineMeshNodes() used to, over every node
+static size_t scanHeardWithin(const std::vector<meshtastic_NodeInfoLite> &nodes, uint32_t secs, bool localOnly)
+{
+    size_t count = 0;
+    for (const meshtastic_NodeInfoLite &n : nodes) {
+        int delta = (int)(now - n.last_heard);
+        if (delta < 0)
+            delta = 0;
+        if ((!localOnly || !n.via_mqtt) && (uint32_t)delta < secs)
+            count++;
+    }
+    return count;
+}
+
+static void checkOrder(const NodeViews &views, const std::vector<meshtastic_NodeInfoLite> &nodes)
+{
+    TEST_ASSERT_EQUAL(nodes.size(), views.numByLastHeard());
+    for (size_t rank = 1; rank < views.numByLastHeard(); rank++)
+        TEST_ASSERT_TRUE(nodes[views.byLastHeard(rank - 1)].last_heard >= nodes[views.byLastHeard(rank)].last_heard);
+}
+
+void test_order_follows_updates(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(50);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i].num = 100 + i;
+        nodes[i].last_heard = now - (i * 7919) % 20000;
+    }
+    NodeViews views;
+    views.rebuild(nodes.data(), nodes.size());
+    checkOrder(views, nodes);
+
+    // Hearing from a node moves it to the front
+    uint32_t version = views.getVersion();
+    nodes[17].last_heard = now + 1;
+    views.updateHeard(nodes.data(), 17);
+    TEST_ASSERT_EQUAL(17, views.byLastHeard(0));
+    TEST_ASSERT_NOT_EQUAL(version, views.getVersion());
+    checkOrder(views, nodes);
+
+    // Nothing changed, nothing to redraw
+    version = views.getVersion();
+    views.updateHeard(nodes.data(), 17);
+    TEST_ASSERT_EQUAL(version, views.getVersion());
+
+    // A new node nobody heard yet goes last
+    nodes.push_back(meshtastic_NodeInfoLite());
+    views.updateHeard(nodes.data(), nodes.size() - 1);
+    TEST_ASSERT_EQUAL(nodes.size() - 1, views.byLastHeard(nodes.size() - 1));
+    checkOrder(views, nodes);
+}
+
+void test_count_matches_scan(void)
+{
+    std::vector<meshtastic_NodeInfoLite> nodes(300);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        nodes[i].last_heard = now - (i * 104729) % 30000;
+        nodes[i].via_mqtt = i % 3 == 0;
+    }
+    nodes[5].last_heard = now + 100;        // Clock slightly behind
+    nodes[6].last_heard = now + 0x90000000; // Garbage, wraps to long ago
+    nodes[7].last_heard = 0;                // Never heard
+    NodeViews views;
+    views.rebuild(nodes.data(), nodes.size());
+
+    const uint32_t periods[] = {0, 1, 120, 2 * 60 * 60, 8 * 60 * 60};
+    for (uint32_t secs : periods) {
+        TEST_ASSERT_EQUAL(scanHeardWithin(nodes, secs, false), views.countHeardWithin(now, secs));
+        TEST_ASSERT_EQUAL(scanHeardWithin(nodes, secs, true), views.countHeardWithin(now, secs, true));
+    }
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_order_follows_updates);
+    RUN_TEST(test_count_matches_scan);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
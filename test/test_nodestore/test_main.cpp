@@ -0,0 +1,173 @@
+#include "FSCommon.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "mesh/NodeStore.h"
+#include <unity.h>
+
+static const char *testFileName = "/prefs/test_nodes.jrn";
+
+static meshtastic_NodeInfoLite makeNode(NodeNum num)
+{
+    meshtastic_NodeInfoLite node = meshtastic_NodeInfoLite_init_default;
+    node.num = num;
+    node.last_heard = 1700000000 + num;
+    node.snr = 5.25f;
+    node.has_user = true;
+    snprintf(node.user.long_name, sizeof(node.user.long_name), "Node %u", num);
+    snprintf(node.user.short_name, sizeof(node.user.short_name), "%04x", num & 0xffff);
+    node.has_position = true;
+    node.position.latitude_i = 520000000 + num;
+    node.position.longitude_i = 40000000 - num;
+    return node;
+}
+
+static void makeDatabase(meshtastic_NodeDatabase &db, size_t count)
+{
+    db.version = 24;
+    db.nodes.clear();
+    for (size_t i = 0; i < count; i++)
+        db.nodes.push_back(makeNode(0x1000 + i));
+}
+
+void setUp(void)
+{
+    FSCom.mkdir("/prefs");
+    FSCom.remove(testFileName);
+}
+
+void tearDown(void)
+{
+    FSCom.remove(testFileName);
+}
+
+void test_roundtrip(void)
+{
+    meshtastic_NodeDatabase db;
+    makeDatabase(db, 50);
+    db.nodes.push_back(meshtastic_NodeInfoLite_init_default); // unused slots are not stored
+
+    NodeStore store(testFileName, NULL);
+    size_t written;
+    TEST_ASSERT_TRUE(store.save(db, written));
+    TEST_ASSERT_GREATER_THAN(0, written);
+
+    meshtastic_NodeDatabase loaded;
+    NodeStore store2(testFileName, NULL);
+    TEST_ASSERT_EQUAL(LoadFileResult::LOAD_SUCCESS, store2.load(loaded));
+    TEST_ASSERT_EQUAL(db.version, loaded.version);
+    TEST_ASSERT_EQUAL(50, loaded.nodes.size());
+    TEST_ASSERT_EQUAL(0x1000 + 7, loaded.nodes[7].num);
+    TEST_ASSERT_EQUAL_STRING(db.nodes[7].user.long_name, loaded.nodes[7].user.long_name);
+    TEST_ASSERT_FALSE(store2.needsCompaction());
+}
+
+void test_incremental_save(void)
+{
+    meshtastic_NodeDatabase db;
+    makeDatabase(db, 200);
+
+    NodeStore store(testFileName, NULL);
+    size_t written;
+    TEST_ASSERT_TRUE(store.save(db, written));
+    size_t fullBytes = written;
+
+    // Nothing changed, nothing written
+    TEST_ASSERT_TRUE(store.save(db, written));
+    TEST_ASSERT_EQUAL(0, written);
+
+    // One node heard again and one removed: only two short records get appended
+    db.nodes[10].last_heard += 60;
+    NodeNum removed = db.nodes[20].num;
+    db.nodes.erase(db.nodes.begin() + 20);
+    TEST_ASSERT_TRUE(store.save(db, written));
+    TEST_ASSERT_GREATER_THAN(0, written);
+    TEST_ASSERT_LESS_THAN(fullBytes / 50, written);
+
+    meshtastic_NodeDatabase loaded;
+    NodeStore store2(testFileName, NULL);
+    TEST_ASSERT_EQUAL(LoadFileResult::LOAD_SUCCESS, store2.load(loaded));
+    TEST_ASSERT_EQUAL(199, loaded.nodes.size());
+    TEST_ASSERT_EQUAL(db.nodes[10].last_heard, loaded.nodes[10].last_heard);
+    for (auto &n : loaded.nodes)
+        TEST_ASSERT_NOT_EQUAL(removed, n.num);
+}
+
+void test_truncated_tail_recovery(void)
+{
+    meshtastic_NodeDatabase db;
+    makeDatabase(db, 20);
+
+    NodeStore store(testFileName, NULL);
+    size_t written;
+    TEST_ASSERT_TRUE(store.save(db, written));
+    db.nodes[3].last_heard += 60;
+    TEST_ASSERT_TRUE(store.save(db, written));
+
+    // Simulate power loss in the middle of the last append
+    size_t goodBytes = store.getJournalBytes() - written;
+    auto f = FSCom.open(testFileName, FILE_O_READ);
+    std::vector<uint8_t> contents(f.size());
+    f.read(contents.data(), contents.size());
+    f.close();
+    contents.resize(contents.size() - 3);
+    f = FSCom.open(testFileName, FILE_O_WRITE);
+    f.write(contents.data(), contents.size());
+    f.close();
+
+    meshtastic_NodeDatabase loaded;
+    NodeStore store2(testFileName, NULL);
+    TEST_ASSERT_EQUAL(LoadFileResult::LOAD_SUCCESS, store2.load(loaded));
+    TEST_ASSERT_EQUAL(20, loaded.nodes.size());
+    TEST_ASSERT_EQUAL(db.nodes[3].last_heard - 60, loaded.nodes[3].last_heard);
+    TEST_ASSERT_EQUAL(goodBytes, store2.getJournalBytes());
+    TEST_ASSERT_TRUE(store2.needsCompaction());
+}
+
+void test_boot_10k_nodes(void)
+{
+    meshtastic_NodeDatabase db;
+    makeDatabase(db, 10000);
+
+    NodeStore store(testFileName, NULL);
+    size_t written;
+    uint32_t start = millis();
+    TEST_ASSERT_TRUE(store.save(db, written));
+    uint32_t saveMs = millis() - start;
+
+    db.nodes[1234].last_heard += 60;
+    start = millis();
+    TEST_ASSERT_TRUE(store.save(db, written));
+    uint32_t incrementalMs = millis() - start;
+    size_t incrementalBytes = written;
+
+    meshtastic_NodeDatabase loaded;
+    NodeStore store2(testFileName, NULL);
+    start = millis();
+    TEST_ASSERT_EQUAL(LoadFileResult::LOAD_SUCCESS, store2.load(loaded));
+    uint32_t loadMs = millis() - start;
+    TEST_ASSERT_EQUAL(10000, loaded.nodes.size());
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "10k nodes: full save %u ms (%u bytes), one node changed %u ms (%u bytes), boot load %u ms", saveMs,
+             (unsigned)store.getJournalBytes(), incrementalMs, (unsigned)incrementalBytes, loadMs);
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    initSPI();
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_roundtrip);
+    RUN_TEST(test_incremental_save);
+    RUN_TEST(test_truncated_tail_recovery);
+    RUN_TEST(test_boot_10k_nodes);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,105 @@
+#include "MeshTypes.h"
+#include "TestUtil.h"
+#include <thread>
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_share_keeps_one_copy(void)
+{
+    MemoryRefCounted<meshtastic_MeshPacket> pool;
+    meshtastic_MeshPacket *p = pool.allocZeroed();
+    p->id = 1234;
+
+    meshtastic_MeshPacket *q = pool.share(p);
+    TEST_ASSERT_EQUAL_PTR(p, q);
+    TEST_ASSERT_EQUAL(1, pool.getStats().live);
+
+    // The first release leaves it for the other holder
+    pool.release(p);
+    TEST_ASSERT_EQUAL(1, pool.getStats().live);
+    TEST_ASSERT_EQUAL(1234, q->id);
+
+    pool.release(q);
+    TEST_ASSERT_EQUAL(0, pool.getStats().live);
+    TEST_ASSERT_EQUAL(1, pool.getStats().shares);
+    TEST_ASSERT_EQUAL(0, pool.getStats().copies);
+}
+
+void test_stats(void)
+{
+    MemoryRefCounted<meshtastic_MeshPacket> pool;
+    meshtastic_MeshPacket *a = pool.allocZeroed();
+    meshtastic_MeshPacket *b = pool.allocCopy(*a);
+    meshtastic_MeshPacket *c = pool.allocCopy(*b);
+    pool.release(a);
+    pool.release(b);
+    meshtastic_MeshPacket *d = pool.allocZeroed();
+
+    const AllocatorStats &s = pool.getStats();
+    TEST_ASSERT_EQUAL(2, s.live);
+    TEST_ASSERT_EQUAL(3, s.highWater);
+    TEST_ASSERT_EQUAL(2, s.copies);
+    TEST_ASSERT_EQUAL(2 * sizeof(meshtastic_MeshPacket), s.copiedBytes);
+    pool.release(c);
+    pool.release(d);
+}
+
+void test_dynamic_share_copies(void)
+{
+    // Allocators without reference counts still give each holder its own object
+    MemoryDynamic<meshtastic_MeshPacket> pool;
+    meshtastic_MeshPacket *p = pool.allocZeroed();
+    p->id = 42;
+    meshtastic_MeshPacket *q = pool.share(p);
+    TEST_ASSERT_NOT_EQUAL(p, q);
+    TEST_ASSERT_EQUAL(42, q->id);
+    TEST_ASSERT_EQUAL(1, pool.getStats().copies);
+    pool.release(p);
+    pool.release(q);
+}
+
+void test_stats_from_threads(void)
+{
+    // Packets are allocated and released by several threads at once on portduino, no count may get lost
+    MemoryRefCounted<meshtastic_MeshPacket> pool;
+    const int perThread = 2000;
+    auto work = [&pool]() {
+        for (int i = 0; i < perThread; i++) {
+            meshtastic_MeshPacket *p = pool.allocZeroed();
+            meshtastic_MeshPacket *q = pool.share(p);
+            pool.release(p);
+            pool.release(q);
+        }
+    };
+    std::thread t1(work), t2(work), t3(work), t4(work);
+    t1.join();
+    t2.join();
+    t3.join();
+    t4.join();
+
+    TEST_ASSERT_EQUAL(0, pool.getStats().live);
+    TEST_ASSERT_EQUAL(4 * perThread, pool.getStats().shares);
+    TEST_ASSERT_TRUE(pool.getStats().highWater >= 1 && pool.getStats().highWater <= 4);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_share_keeps_one_copy);
+    RUN_TEST(test_stats);
+    RUN_TEST(test_dynamic_share_copies);
+    RUN_TEST(test_stats_from_threads);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,141 @@
+#include "FSCommon.h"
+#include "PacketTrace.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+static const char *testFileName = "/prefs/packettrace_test.bin";
+
+static meshtastic_MeshPacket makePacket(PacketId id)
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = id;
+    p.hop_limit = 2;
+    p.hop_start = 3;
+    p.relay_node = 0x44;
+    p.rx_snr = -7.5;
+    return p;
+}
+
+void setUp(void)
+{
+    FSCom.mkdir("/prefs");
+    FSCom.remove(testFileName);
+}
+
+void tearDown(void)
+{
+    FSCom.remove(testFileName);
+}
+
+void test_record_fields(void)
+{
+    PacketTrace *trace = new PacketTrace();
+    meshtastic_MeshPacket p = makePacket(42);
+    trace->record(PTRACE_RX, &p, 300);
+
+    PacketTraceRecord r;
+    TEST_ASSERT_EQUAL(1, trace->snapshot(&r, 1));
+    TEST_ASSERT_EQUAL(PTRACE_RX, r.event);
+    TEST_ASSERT_EQUAL_HEX32(0x11223344, r.from);
+    TEST_ASSERT_EQUAL(42, r.id);
+    TEST_ASSERT_EQUAL(2, r.hopLimit);
+    TEST_ASSERT_EQUAL(3, r.hopStart);
+    TEST_ASSERT_EQUAL_HEX8(0x44, r.relayNode);
+    TEST_ASSERT_EQUAL(-30, r.snr);
+    TEST_ASSERT_EQUAL(UINT8_MAX, r.queueDepth);
+    delete trace;
+}
+
+void test_ring_keeps_most_recent_in_order(void)
+{
+    PacketTrace *trace = new PacketTrace();
+    const uint32_t events = PACKET_TRACE_SIZE * 2 + 5;
+    for (uint32_t i = 0; i < events; i++) {
+        meshtastic_MeshPacket p = makePacket(i);
+        trace->record(PTRACE_TX_QUEUED, &p);
+    }
+    TEST_ASSERT_EQUAL(events, trace->getTotalEvents());
+
+    PacketTraceRecord *records = new PacketTraceRecord[PACKET_TRACE_SIZE];
+    TEST_ASSERT_EQUAL(PACKET_TRACE_SIZE, trace->snapshot(records, PACKET_TRACE_SIZE));
+    for (uint32_t i = 0; i < PACKET_TRACE_SIZE; i++)
+        TEST_ASSERT_EQUAL(events - PACKET_TRACE_SIZE + i, records[i].id);
+
+    // A smaller buffer gets the newest ones
+    TEST_ASSERT_EQUAL(3, trace->snapshot(records, 3));
+    TEST_ASSERT_EQUAL(events - 3, records[0].id);
+    TEST_ASSERT_EQUAL(events - 1, records[2].id);
+    delete[] records;
+    delete trace;
+}
+
+void test_save(void)
+{
+    PacketTrace *trace = new PacketTrace();
+    const uint32_t events = PACKET_TRACE_SIZE + 3;
+    for (uint32_t i = 0; i < events; i++) {
+        meshtastic_MeshPacket p = makePacket(i);
+        trace->record(PTRACE_TX_DONE, &p);
+    }
+    TEST_ASSERT_TRUE(trace->save(testFileName));
+
+    auto f = FSCom.open(testFileName, FILE_O_READ);
+    PacketTraceHeader h;
+    TEST_ASSERT_EQUAL(sizeof(h), f.read((uint8_t *)&h, sizeof(h)));
+    TEST_ASSERT_EQUAL_HEX32(PACKET_TRACE_MAGIC, h.magic);
+    TEST_ASSERT_EQUAL(PACKET_TRACE_VERSION, h.version);
+    TEST_ASSERT_EQUAL(sizeof(PacketTraceRecord), h.recordSize);
+    TEST_ASSERT_EQUAL(PACKET_TRACE_SIZE, h.numRecords);
+    TEST_ASSERT_EQUAL(events, h.totalEvents);
+
+    // Oldest first across the point where the ring wrapped
+    PacketTraceRecord r;
+    for (uint32_t i = 0; i < PACKET_TRACE_SIZE; i++) {
+        TEST_ASSERT_EQUAL(sizeof(r), f.read((uint8_t *)&r, sizeof(r)));
+        TEST_ASSERT_EQUAL(events - PACKET_TRACE_SIZE + i, r.id);
+    }
+    TEST_ASSERT_EQUAL(0, f.available());
+    f.close();
+    delete trace;
+}
+
+void test_record_overhead(void)
+{
+    PacketTrace *trace = new PacketTrace();
+    meshtastic_MeshPacket p = makePacket(1);
+    const uint32_t rounds = 100000;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < rounds; i++) {
+        p.id = i;
+        trace->record(PTRACE_RX, &p, i);
+    }
+    uint32_t elapsed = micros() - start;
+
+    char msg[80];
+    snprintf(msg, sizeof(msg), "record(): %u ns per event", (unsigned)((uint64_t)elapsed * 1000 / rounds));
+    TEST_MESSAGE(msg);
+    delete trace;
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    initSPI();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_record_fields);
+    RUN_TEST(test_ring_keeps_most_recent_in_order);
+    RUN_TEST(test_save);
+    RUN_TEST(test_record_overhead);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
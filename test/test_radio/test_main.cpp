@@ -0,0 +1,139 @@
+#include "MeshRadio.h"
+#include "RadioInterface.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+class TestRadio : public RadioInterface
+{
+  public:
+    virtual ErrorCode send(meshtastic_MeshPacket *p) override
+    {
+        packetPool.release(p);
+        return ERRNO_OK;
+    }
+
+    void setModem(float _bw, uint8_t _sf, uint8_t _cr, uint16_t _preambleLength)
+    {
+        bw = _bw;
+        sf = _sf;
+        cr = _cr;
+        preambleLength = _preambleLength;
+    }
+};
+
+struct ModemSettings {
+    const char *name;
+    float bw;
+    uint8_t sf;
+    uint8_t cr;
+};
+
+// Copied from RadioInterface::applyModemConfig(), both the sub-GHz and the wideLora (2.4 GHz) bandwidths
+static const ModemSettings presets[] = {
+    {"SHORT_TURBO", 500, 7, 5},      {"SHORT_FAST", 250, 7, 5},      {"SHORT_SLOW", 250, 8, 5},
+    {"MEDIUM_FAST", 250, 9, 5},      {"MEDIUM_SLOW", 250, 10, 5},    {"LONG_FAST", 250, 11, 5},
+    {"LONG_MODERATE", 125, 11, 8},   {"LONG_SLOW", 125, 12, 8},      {"SHORT_TURBO_24", 1625, 7, 5},
+    {"SHORT_FAST_24", 812.5, 7, 5},  {"SHORT_SLOW_24", 812.5, 8, 5}, {"MEDIUM_FAST_24", 812.5, 9, 5},
+    {"MEDIUM_SLOW_24", 812.5, 10, 5}, {"LONG_FAST_24", 812.5, 11, 5}, {"LONG_MODERATE_24", 406.25, 11, 8},
+    {"LONG_SLOW_24", 406.25, 12, 8},  {"CUSTOM_31K", 31.25, 12, 8},
+};
+
+/// The formula as RadioInterface::getPacketTime() evaluated it for every call before it used a table
+static uint32_t referencePacketTime(const ModemSettings &m, uint16_t preambleLength, uint32_t pl)
+{
+    float bandwidthHz = m.bw * 1000.0f;
+    bool headDisable = false;
+    float tSym = (1 << m.sf) / bandwidthHz;
+
+    bool lowDataOptEn = tSym > 16e-3 ? true : false;
+
+    float tPreamble = (preambleLength + 4.25f) * tSym;
+    float numPayloadSym =
+        8 + max(ceilf(((8.0f * pl - 4 * m.sf + 28 + 16 - 20 * headDisable) / (4 * (m.sf - 2 * lowDataOptEn))) * m.cr), 0.0f);
+    float tPayload = numPayloadSym * tSym;
+    float tPacket = tPreamble + tPayload;
+
+    return tPacket * 1000;
+}
+
+static TestRadio *radio;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_airtime_table_matches_formula(void)
+{
+    const uint16_t preambleLengths[] = {16, 12};
+    char msg[64];
+    for (auto &m : presets) {
+        for (auto preambleLength : preambleLengths) {
+            radio->setModem(m.bw, m.sf, m.cr, preambleLength);
+            for (uint32_t pl = 0; pl <= MAX_LORA_PAYLOAD_LEN; pl++) {
+                snprintf(msg, sizeof(msg), "%s preamble %u len %u", m.name, preambleLength, pl);
+                TEST_ASSERT_EQUAL_UINT32_MESSAGE(referencePacketTime(m, preambleLength, pl), radio->getPacketTime(pl), msg);
+            }
+        }
+    }
+}
+
+void test_airtime_of_packets(void)
+{
+    radio->setModem(250, 11, 5, 16);
+
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_default;
+    p.which_payload_variant = meshtastic_MeshPacket_encrypted_tag;
+    p.encrypted.size = 40;
+    TEST_ASSERT_EQUAL_UINT32(40 + sizeof(PacketHeader), RadioInterface::getPacketLength(&p));
+    TEST_ASSERT_EQUAL_UINT32(referencePacketTime(presets[5], 16, 40 + sizeof(PacketHeader)), radio->getPacketTime(&p));
+
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p.decoded.payload.size = 10;
+    memset(p.decoded.payload.bytes, 'x', 10);
+    // portnum (2 bytes) + payload (2 + 10 bytes)
+    TEST_ASSERT_EQUAL_UINT32(14 + sizeof(PacketHeader), RadioInterface::getPacketLength(&p));
+}
+
+void test_airtime_benchmark(void)
+{
+    const uint32_t iterations = 1000000;
+    radio->setModem(250, 11, 5, 16);
+    const ModemSettings &m = presets[5];
+
+    volatile uint32_t sink = 0;
+    uint32_t start = millis();
+    for (uint32_t i = 0; i < iterations; i++)
+        sink += referencePacketTime(m, 16, i & MAX_LORA_PAYLOAD_LEN);
+    uint32_t formulaMs = millis() - start;
+
+    start = millis();
+    for (uint32_t i = 0; i < iterations; i++)
+        sink += radio->getPacketTime(i & MAX_LORA_PAYLOAD_LEN);
+    uint32_t tableMs = millis() - start;
+
+    char msg[128];
+    snprintf(msg, sizeof(msg), "%u airtime lookups: formula %u ms, table %u ms", iterations, formulaMs, tableMs);
+    TEST_MESSAGE(msg);
+    (void)sink;
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    initRegion();
+    radio = new TestRadio();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_airtime_table_matches_formula);
+    RUN_TEST(test_airtime_of_packets);
+    RUN_TEST(test_airtime_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
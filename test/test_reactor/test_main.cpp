@@ -0,0 +1,168 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#ifdef ARCH_PORTDUINO
+#include "concurrency/OSThread.h"
+#include "concurrency/Reactor.h"
+#include <atomic>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using concurrency::reactor;
+
+/// Plays the part of an API connection: reads whatever the client sent and hands it on, like StreamAPI does to the router
+class SocketReader : public concurrency::OSThread
+{
+  public:
+    int fd;
+    int32_t idleMsec;
+    std::atomic<bool> handled{false};
+    uint32_t handledUsec = 0;
+
+    SocketReader(int _fd, int32_t _idleMsec) : concurrency::OSThread("SocketReader"), fd(_fd), idleMsec(_idleMsec) {}
+
+  protected:
+    int32_t runOnce() override
+    {
+        uint8_t buf[64];
+        bool got = false;
+        while (::read(fd, buf, sizeof(buf)) > 0)
+            got = true;
+        if (got) {
+            handledUsec = micros();
+            handled = true;
+        }
+        return idleMsec;
+    }
+};
+
+static int sockets[2];
+
+void setUp(void)
+{
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, sockets));
+    fcntl(sockets[1], F_SETFL, O_NONBLOCK);
+    // Don't let a wakeup left over from the previous test end a wait early
+    while (reactor.wait(0))
+        ;
+}
+
+void tearDown(void)
+{
+    close(sockets[0]);
+    close(sockets[1]);
+}
+
+void test_wake_ends_wait(void)
+{
+    std::thread waker([]() {
+        delay(20);
+        reactor.wake();
+    });
+    uint32_t start = millis();
+    TEST_ASSERT_TRUE(reactor.wait(2000));
+    TEST_ASSERT_LESS_THAN(1000, millis() - start);
+    waker.join();
+}
+
+void test_wake_before_wait_is_kept(void)
+{
+    reactor.wake();
+    TEST_ASSERT_TRUE(reactor.wait(1000));
+    TEST_ASSERT_FALSE(reactor.wait(10));
+}
+
+void test_readable_fd_wakes_owner(void)
+{
+    SocketReader reader(sockets[1], 1000);
+    reader.setIntervalFromNow(100000);
+    TEST_ASSERT_TRUE(reactor.watch(sockets[1], &reader));
+
+    TEST_ASSERT_EQUAL(1, write(sockets[0], "x", 1));
+    TEST_ASSERT_TRUE(reactor.wait(1000));
+    TEST_ASSERT_TRUE(reader.shouldRun(millis()));
+
+    // Once unwatched the owner is left alone
+    reactor.unwatch(sockets[1]);
+    reader.setIntervalFromNow(100000);
+    TEST_ASSERT_EQUAL(1, write(sockets[0], "y", 1));
+    TEST_ASSERT_FALSE(reactor.wait(50));
+    TEST_ASSERT_FALSE(reader.shouldRun(millis()));
+}
+
+/// Average usecs from a client write until the reader has handled it, running the scheduler like loop() in main.cpp
+static uint32_t measureLatency(SocketReader *reader, int rounds)
+{
+    uint64_t total = 0;
+    for (int i = 0; i < rounds; i++) {
+        reader->handled = false;
+        std::atomic<uint32_t> writtenUsec{0};
+        // Write at an arbitrary point of the reader's idle interval, as a real client would
+        std::thread client([&]() {
+            delay(10 + (i * 37) % 100);
+            writtenUsec = micros();
+            ssize_t r = write(sockets[0], "x", 1);
+            (void)r;
+        });
+        while (!reader->handled) {
+            long delayMsec = concurrency::mainController.runOrDelay();
+            if (!reader->handled)
+                concurrency::mainDelay.delay(delayMsec);
+        }
+        client.join();
+        total += reader->handledUsec - writtenUsec;
+    }
+    return total / rounds;
+}
+
+void test_latency_benchmark(void)
+{
+    const int rounds = 20;
+
+    // What StreamAPI did for an idle client before
+    SocketReader *polled = new SocketReader(sockets[1], 250);
+    uint32_t polledUs = measureLatency(polled, rounds);
+    delete polled;
+
+    SocketReader *watched = new SocketReader(sockets[1], 1000);
+    TEST_ASSERT_TRUE(reactor.watch(sockets[1], watched));
+    uint32_t watchedUs = measureLatency(watched, rounds);
+    reactor.unwatch(sockets[1]);
+    delete watched;
+
+    char msg[100];
+    snprintf(msg, sizeof(msg), "client write to handled: polled %u us, reactor %u us", polledUs, watchedUs);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_LESS_THAN(polledUs, watchedUs);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_wake_ends_wait);
+    RUN_TEST(test_wake_before_wait_is_kept);
+    RUN_TEST(test_readable_fd_wakes_owner);
+    RUN_TEST(test_latency_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires the portduino reactor");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+
+void loop() {}
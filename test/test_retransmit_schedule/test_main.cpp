@@ -0,0 +1,142 @@
+#include "RetransmitSchedule.h"
+#include "TestUtil.h"
+#include <unity.h>
+#include <unordered_map>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/** Pop everything, returning the keys in the order they came out */
+static std::vector<uint32_t> drain(RetransmitSchedule<uint32_t> &s)
+{
+    std::vector<uint32_t> keys;
+    while (!s.empty()) {
+        keys.push_back(s.nextKey());
+        s.pop();
+    }
+    return keys;
+}
+
+void test_earliest_first(void)
+{
+    RetransmitSchedule<uint32_t> s;
+    const uint32_t at[] = {500, 100, 900, 300, 700, 200};
+    for (uint32_t i = 0; i < 6; i++)
+        s.schedule(i, at[i]);
+
+    auto keys = drain(s);
+    const uint32_t expected[] = {1, 5, 3, 0, 4, 2};
+    TEST_ASSERT_EQUAL(6, keys.size());
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, keys.data(), 6);
+}
+
+void test_millis_wrap(void)
+{
+    RetransmitSchedule<uint32_t> s;
+    // Scheduled just before millis() wraps, and just after
+    s.schedule(1, UINT32_MAX - 100);
+    s.schedule(2, 50);
+    s.schedule(3, UINT32_MAX - 10);
+
+    TEST_ASSERT_TRUE(RetransmitSchedule<uint32_t>::isAfter(50, UINT32_MAX - 10));
+    auto keys = drain(s);
+    const uint32_t expected[] = {1, 3, 2};
+    TEST_ASSERT_EQUAL_UINT32_ARRAY(expected, keys.data(), 3);
+}
+
+void test_delay_all(void)
+{
+    RetransmitSchedule<uint32_t> s;
+    uint32_t a = s.schedule(1, 1000);
+    s.delayAll(300);
+    // Scheduled after the delay, so not affected by it
+    uint32_t b = s.schedule(2, 1200);
+
+    TEST_ASSERT_EQUAL(1300, s.deadline(a));
+    TEST_ASSERT_EQUAL(1200, s.deadline(b));
+    TEST_ASSERT_EQUAL(2, s.nextKey());
+    TEST_ASSERT_EQUAL(1200, s.deadline(s.nextTicket()));
+}
+
+void test_cancel_is_lazy(void)
+{
+    RetransmitSchedule<uint32_t> s;
+    // The owner's records, key -> ticket, like NextHopRouter::pending
+    std::unordered_map<uint32_t, uint32_t> live;
+    for (uint32_t i = 0; i < 100; i++)
+        live[i] = s.schedule(i, 1000 + i);
+    // Reschedule some, cancel others
+    for (uint32_t i = 0; i < 100; i += 2)
+        live[i] = s.schedule(i, 5000 + i);
+    for (uint32_t i = 1; i < 100; i += 4)
+        live.erase(i);
+    TEST_ASSERT_EQUAL(150, s.size());
+
+    auto isStale = [&](const uint32_t &key, uint32_t ticket) {
+        auto it = live.find(key);
+        return it == live.end() || it->second != ticket;
+    };
+    s.removeIf(isStale);
+    TEST_ASSERT_EQUAL(live.size(), s.size());
+
+    // What is left comes out in deadline order, and all of it is live
+    uint32_t last = 0;
+    while (!s.empty()) {
+        TEST_ASSERT_FALSE(isStale(s.nextKey(), s.nextTicket()));
+        TEST_ASSERT_FALSE(RetransmitSchedule<uint32_t>::isAfter(last, s.nextTicket()));
+        last = s.nextTicket();
+        s.pop();
+    }
+}
+
+void test_next_due_benchmark(void)
+{
+    const uint32_t inFlight = 500, rounds = 2000;
+    RetransmitSchedule<uint32_t> s;
+    std::unordered_map<uint32_t, uint32_t> live;
+    for (uint32_t i = 0; i < inFlight; i++)
+        live[i] = s.schedule(i, 10000 + i * 7);
+
+    // Finding the next retransmission by walking every pending record, which is what we used to do on each wake
+    volatile uint32_t sink = 0;
+    uint32_t start = micros();
+    for (uint32_t r = 0; r < rounds; r++) {
+        uint32_t earliest = UINT32_MAX;
+        for (auto &it : live)
+            earliest = min(earliest, it.second);
+        sink = earliest;
+    }
+    uint32_t scanUs = micros() - start;
+
+    start = micros();
+    for (uint32_t r = 0; r < rounds; r++)
+        sink = s.nextTicket();
+    uint32_t heapUs = micros() - start;
+    (void)sink;
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "next due of %u in flight: map scan %u ns, schedule %u ns", (unsigned)inFlight,
+             (unsigned)((uint64_t)scanUs * 1000 / rounds), (unsigned)((uint64_t)heapUs * 1000 / rounds));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_earliest_first);
+    RUN_TEST(test_millis_wrap);
+    RUN_TEST(test_delay_all);
+    RUN_TEST(test_cancel_is_lazy);
+    RUN_TEST(test_next_due_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,107 @@
+#include "MeshTypes.h"
+#include "PointerQueue.h"
+#include "TestUtil.h"
+#include "concurrency/SpscRing.h"
+#include <thread>
+#include <unity.h>
+
+using concurrency::SpscRing;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_fifo_and_bounds(void)
+{
+    SpscRing<uint32_t, 4> ring;
+    uint32_t v;
+    TEST_ASSERT_TRUE(ring.empty());
+    TEST_ASSERT_FALSE(ring.pop(&v));
+
+    // Go around the ring a few times, each time filling it up
+    uint32_t next = 0, expect = 0;
+    for (int round = 0; round < 5; round++) {
+        while (ring.push(next))
+            next++;
+        TEST_ASSERT_EQUAL(4, ring.size());
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_TRUE(ring.pop(&v));
+            TEST_ASSERT_EQUAL(expect++, v);
+        }
+    }
+    while (ring.pop(&v))
+        TEST_ASSERT_EQUAL(expect++, v);
+    TEST_ASSERT_EQUAL(next, expect);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_two_threads(void)
+{
+    static SpscRing<uint32_t, 32> ring;
+    const uint32_t count = 1000000;
+
+    std::thread producer([&]() {
+        for (uint32_t i = 0; i < count; i++)
+            while (!ring.push(i))
+                std::this_thread::yield();
+    });
+
+    // Everything arrives, once, in order
+    uint32_t expect = 0, v;
+    bool inOrder = true;
+    while (expect < count) {
+        if (ring.pop(&v))
+            inOrder &= (v == expect++);
+        else
+            std::this_thread::yield();
+    }
+    producer.join();
+    TEST_ASSERT_TRUE(inOrder);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_enqueue_benchmark(void)
+{
+    const uint32_t rounds = 200000;
+    meshtastic_MeshPacket packet;
+    meshtastic_MeshPacket *p;
+
+    SpscRing<meshtastic_MeshPacket *, 32> ring;
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < rounds; i++) {
+        ring.push(&packet);
+        ring.pop(&p);
+    }
+    uint32_t ringUs = micros() - start;
+
+    PointerQueue<meshtastic_MeshPacket> queue(32);
+    start = micros();
+    for (uint32_t i = 0; i < rounds; i++) {
+        queue.enqueue(&packet, 0);
+        queue.dequeuePtr(0);
+    }
+    uint32_t queueUs = micros() - start;
+
+    char msg[120];
+    snprintf(msg, sizeof(msg), "push+pop: SpscRing %u ns, PointerQueue %u ns", (unsigned)((uint64_t)ringUs * 1000 / rounds),
+             (unsigned)((uint64_t)queueUs * 1000 / rounds));
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_fifo_and_bounds);
+    RUN_TEST(test_two_threads);
+    RUN_TEST(test_enqueue_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
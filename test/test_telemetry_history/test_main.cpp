@@ -0,0 +1,163 @@
+#include "TestUtil.h"
+#include "modules/Telemetry/TelemetryHistory.h"
+#include <unity.h>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+/** Append points until the block is full, then check they all come back exactly */
+static void checkRoundTrip(const uint32_t *times, const float *values, size_t n)
+{
+    GorillaBlock b;
+    b.reset(THIST_TEMPERATURE, THIST_RAW);
+    size_t appended = 0;
+    while (appended < n && b.append(times[appended], values[appended]))
+        appended++;
+    TEST_ASSERT_EQUAL(appended, b.header.count);
+
+    GorillaReader r(b.header, b.data);
+    uint32_t time;
+    float value;
+    for (size_t i = 0; i < appended; i++) {
+        TEST_ASSERT_TRUE(r.next(time, value));
+        TEST_ASSERT_EQUAL_UINT32(times[i], time);
+        TEST_ASSERT_EQUAL_MEMORY(&values[i], &value, sizeof(value));
+    }
+    TEST_ASSERT_FALSE(r.next(time, value));
+}
+
+void test_round_trip(void)
+{
+    uint32_t times[200];
+    float values[200];
+
+    // Steady samples of a slowly changing temperature
+    for (int i = 0; i < 200; i++) {
+        times[i] = 1700000000 + i * 60;
+        values[i] = 21.5f + (i / 10) * 0.1f;
+    }
+    checkRoundTrip(times, values, 200);
+
+    // Jittery intervals, a clock jump, negative and odd values
+    uint32_t t = 100;
+    for (int i = 0; i < 200; i++) {
+        t += (i == 50) ? 1700000000 : 30 + (i * 7919) % 400;
+        times[i] = t;
+        values[i] = (i % 3 == 0) ? -(float)i / 3 : 1000.0f / (i + 1);
+    }
+    checkRoundTrip(times, values, 200);
+}
+
+void test_compression(void)
+{
+    // A battery level which changes now and then, sampled every minute, takes a couple of bits per point
+    GorillaBlock b;
+    b.reset(THIST_BATTERY_LEVEL, THIST_RAW);
+    uint16_t n = 0;
+    while (b.append(1700000000 + n * 60, 100 - n / 20))
+        n++;
+    TEST_ASSERT_GREATER_THAN(GORILLA_BLOCK_BYTES * 2, n);
+
+    // Time going backwards needs a new block
+    b.reset(THIST_BATTERY_LEVEL, THIST_RAW);
+    TEST_ASSERT_TRUE(b.append(1700000000, 50));
+    TEST_ASSERT_FALSE(b.append(1600000000, 50));
+}
+
+void test_tiers(void)
+{
+    TelemetryHistory *h = new TelemetryHistory();
+    const uint32_t start = 1700000000 - 1700000000 % 900;
+    // A sample every 15 seconds for an hour, the value being the minute it was taken in
+    for (uint32_t i = 0; i < 4 * 60; i++)
+        h->record(THIST_VOLTAGE, start + i * 15, (float)(i / 4));
+
+    uint32_t times[64];
+    float values[64];
+    size_t n = h->read(THIST_VOLTAGE, THIST_MINUTE, 0, times, values, 64);
+    // The last minute is still being averaged
+    TEST_ASSERT_EQUAL(59, n);
+    for (size_t i = 0; i < n; i++) {
+        TEST_ASSERT_EQUAL_UINT32(start + i * 60, times[i]);
+        TEST_ASSERT_EQUAL_FLOAT((float)i, values[i]);
+    }
+
+    n = h->read(THIST_VOLTAGE, THIST_QUARTER, 0, times, values, 64);
+    TEST_ASSERT_EQUAL(3, n);
+    TEST_ASSERT_EQUAL_UINT32(start + 900, times[1]);
+    TEST_ASSERT_EQUAL_FLOAT(22, values[1]);
+
+    n = h->read(THIST_VOLTAGE, THIST_MINUTE, start + 30 * 60, times, values, 64);
+    TEST_ASSERT_EQUAL(29, n);
+    TEST_ASSERT_EQUAL_UINT32(start + 30 * 60, times[0]);
+    delete h;
+}
+
+void test_ring_keeps_newest(void)
+{
+    TelemetryHistory *h = new TelemetryHistory();
+    // Noisy values so blocks fill quickly
+    const uint32_t start = 1700000000, samples = 5000;
+    for (uint32_t i = 0; i < samples; i++)
+        h->record(THIST_TEMPERATURE, start + i * 60, 20 + (float)((i * 7919) % 1000) / 97);
+
+    static uint32_t times[samples];
+    static float values[samples];
+    size_t n = h->read(THIST_TEMPERATURE, THIST_RAW, 0, times, values, samples);
+    TEST_ASSERT_GREATER_THAN(0, n);
+    TEST_ASSERT_LESS_THAN(samples, n);
+    TEST_ASSERT_EQUAL_UINT32(start + (samples - 1) * 60, times[n - 1]);
+    for (size_t i = 1; i < n; i++)
+        TEST_ASSERT_EQUAL_UINT32(times[i - 1] + 60, times[i]);
+
+    // The 15 minute tier reaches back further
+    static uint32_t quarterTimes[samples];
+    TEST_ASSERT_GREATER_THAN(0, h->read(THIST_TEMPERATURE, THIST_QUARTER, 0, quarterTimes, values, samples));
+    TEST_ASSERT_LESS_THAN(times[0], quarterTimes[0]);
+    delete h;
+}
+
+void test_record_telemetry(void)
+{
+    TelemetryHistory *h = new TelemetryHistory();
+    TEST_ASSERT_TRUE(h->isDue(meshtastic_Telemetry_device_metrics_tag));
+
+    meshtastic_Telemetry t = meshtastic_Telemetry_init_zero;
+    t.which_variant = meshtastic_Telemetry_device_metrics_tag;
+    t.time = 1700000000;
+    t.variant.device_metrics.has_battery_level = true;
+    t.variant.device_metrics.battery_level = 87;
+    t.variant.device_metrics.voltage = 4.1f; // Not set, so not recorded
+    h->record(t);
+    TEST_ASSERT_FALSE(h->isDue(meshtastic_Telemetry_device_metrics_tag));
+    TEST_ASSERT_TRUE(h->isDue(meshtastic_Telemetry_environment_metrics_tag));
+
+    uint32_t time;
+    float value;
+    TEST_ASSERT_EQUAL(1, h->read(THIST_BATTERY_LEVEL, THIST_RAW, 0, &time, &value, 1));
+    TEST_ASSERT_EQUAL_UINT32(1700000000, time);
+    TEST_ASSERT_EQUAL_FLOAT(87, value);
+    TEST_ASSERT_EQUAL(0, h->read(THIST_VOLTAGE, THIST_RAW, 0, &time, &value, 1));
+    delete h;
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_compression);
+    RUN_TEST(test_tiers);
+    RUN_TEST(test_ring_keeps_newest);
+    RUN_TEST(test_record_telemetry);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,173 @@
+#include "TestUtil.h"
+#include "gps/UBXFrameParser.h"
+#include <string.h>
+#include <unity.h>
+#include <vector>
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+static std::vector<uint8_t> makeFrame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+    std::vector<uint8_t> f = {0xB5, 0x62, cls, id, (uint8_t)(len & 0xFF), (uint8_t)(len >> 8)};
+    f.insert(f.end(), payload, payload + len);
+    uint8_t a = 0, b = 0;
+    for (size_t i = 2; i < f.size(); i++) {
+        a += f[i];
+        b += a;
+    }
+    f.push_back(a);
+    f.push_back(b);
+    return f;
+}
+
+static void putU4(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        p[i] = v >> (8 * i);
+}
+
+/** Feed bytes, collecting what is passed on to NMEA and counting complete frames */
+static std::string feedAll(UBXFrameParser &parser, const std::vector<uint8_t> &bytes, int *frames)
+{
+    std::string passed;
+    for (uint8_t c : bytes) {
+        auto r = parser.feed(c);
+        if (r == UBXFrameParser::UBX_PASS)
+            passed += (char)c;
+        else if (r == UBXFrameParser::UBX_FRAME)
+            (*frames)++;
+    }
+    return passed;
+}
+
+void test_nmea_passes_through(void)
+{
+    UBXFrameParser parser;
+    const char *nmea = "$GNRMC,123519,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*6A\r\n";
+    int frames = 0;
+    std::string passed = feedAll(parser, std::vector<uint8_t>(nmea, nmea + strlen(nmea)), &frames);
+    TEST_ASSERT_EQUAL_STRING(nmea, passed.c_str());
+    TEST_ASSERT_EQUAL(0, frames);
+}
+
+void test_frame_between_sentences(void)
+{
+    UBXFrameParser parser;
+    const char *gga = "$GNGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n";
+    const uint8_t ack[] = {0x06, 0x01};
+    std::vector<uint8_t> bytes(gga, gga + strlen(gga));
+    auto frame = makeFrame(0x05, 0x01, ack, sizeof(ack));
+    bytes.insert(bytes.end(), frame.begin(), frame.end());
+    bytes.insert(bytes.end(), gga, gga + strlen(gga));
+
+    int frames = 0;
+    std::string passed = feedAll(parser, bytes, &frames);
+    TEST_ASSERT_EQUAL(1, frames);
+    TEST_ASSERT_EQUAL(std::string(gga) + gga, passed);
+    TEST_ASSERT_EQUAL_HEX8(0x05, parser.msgClass());
+    TEST_ASSERT_EQUAL_HEX8(0x01, parser.msgId());
+    TEST_ASSERT_EQUAL(2, parser.length());
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(ack, parser.payload(), 2);
+}
+
+void test_bad_checksum_and_noise(void)
+{
+    UBXFrameParser parser;
+    const uint8_t payload[] = {1, 2, 3, 4};
+    auto frame = makeFrame(0x01, 0x07, payload, sizeof(payload));
+    frame.back() ^= 0xFF;
+    // A length nobody sends, after which we have to resync on the next frame
+    std::vector<uint8_t> noise = {0xB5, 0x62, 0x01, 0x07, 0xFF, 0xFF};
+    frame.insert(frame.end(), noise.begin(), noise.end());
+    auto good = makeFrame(0x01, 0x07, payload, sizeof(payload));
+    frame.insert(frame.end(), good.begin(), good.end());
+
+    int frames = 0;
+    feedAll(parser, frame, &frames);
+    TEST_ASSERT_EQUAL(1, frames);
+    TEST_ASSERT_EQUAL(1, parser.frames());
+    TEST_ASSERT_EQUAL(2, parser.checksumFailures());
+}
+
+void test_long_frame_is_skipped(void)
+{
+    UBXFrameParser parser;
+    std::vector<uint8_t> payload(UBX_MAX_PAYLOAD + 50, 0x24); // '$', which must not leak to NMEA
+    int frames = 0;
+    std::string passed = feedAll(parser, makeFrame(0x0A, 0x04, payload.data(), payload.size()), &frames);
+    TEST_ASSERT_EQUAL(0, frames);
+    TEST_ASSERT_EQUAL(0, passed.size());
+    TEST_ASSERT_EQUAL(1, parser.frames());
+}
+
+void test_decode_nav_pvt(void)
+{
+    uint8_t pvt[UBX_NAV_PVT_LEN] = {0};
+    pvt[4] = 2024 & 0xFF;
+    pvt[5] = 2024 >> 8;
+    pvt[6] = 7;    // month
+    pvt[7] = 14;   // day
+    pvt[8] = 12;   // hour
+    pvt[9] = 34;   // min
+    pvt[10] = 56;  // sec
+    pvt[11] = 0x07;
+    pvt[20] = 3;   // 3D
+    pvt[21] = 0x01;
+    pvt[23] = 11;
+    putU4(pvt + 24, (uint32_t)-1223456789); // lon
+    putU4(pvt + 28, 473456789);             // lat
+    putU4(pvt + 32, 600000);
+    putU4(pvt + 36, 550000);
+    putU4(pvt + 60, 1500);
+    putU4(pvt + 64, 9000000);
+    pvt[76] = 150;
+
+    UBXFrameParser parser;
+    auto frame = makeFrame(UBX_CLASS_NAV, UBX_NAV_PVT, pvt, sizeof(pvt));
+    int frames = 0;
+    feedAll(parser, frame, &frames);
+    TEST_ASSERT_EQUAL(1, frames);
+
+    UBXNavPvt out;
+    TEST_ASSERT_TRUE(decodeNavPvt(parser.payload(), parser.length(), out));
+    TEST_ASSERT_EQUAL(2024, out.year);
+    TEST_ASSERT_EQUAL(7, out.month);
+    TEST_ASSERT_EQUAL(14, out.day);
+    TEST_ASSERT_EQUAL(56, out.second);
+    TEST_ASSERT_TRUE(out.timeValid);
+    TEST_ASSERT_TRUE(out.fixOk);
+    TEST_ASSERT_FALSE(out.diffSoln);
+    TEST_ASSERT_EQUAL(3, out.fixType);
+    TEST_ASSERT_EQUAL(11, out.numSV);
+    TEST_ASSERT_EQUAL(-1223456789, out.longitude_i);
+    TEST_ASSERT_EQUAL(473456789, out.latitude_i);
+    TEST_ASSERT_EQUAL(600000, out.heightMm);
+    TEST_ASSERT_EQUAL(550000, out.hMSLMm);
+    TEST_ASSERT_EQUAL(1500, out.groundSpeedMmS);
+    TEST_ASSERT_EQUAL(9000000, out.headMot);
+    TEST_ASSERT_EQUAL(150, out.pDOP);
+
+    TEST_ASSERT_FALSE(decodeNavPvt(parser.payload(), 40, out));
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_nmea_passes_through);
+    RUN_TEST(test_frame_between_sentences);
+    RUN_TEST(test_bad_checksum_and_noise);
+    RUN_TEST(test_long_frame_is_skipped);
+    RUN_TEST(test_decode_nav_pvt);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -0,0 +1,209 @@
+#include "DebugConfiguration.h"
+#include "TestUtil.h"
+#include <unity.h>
+
+#if defined(ARCH_PORTDUINO) && HAS_UDP_MULTICAST
+#include "concurrency/OSThread.h"
+#include "mesh/NodeDB.h"
+#include "mesh/Router.h"
+#include "mesh/udp/UdpMulticastSocket.h"
+
+#include <arpa/inet.h>
+#include <map>
+#include <unistd.h>
+
+// Not the real port, so we don't talk to a meshtasticd running on this machine
+#define TEST_GROUP "224.0.0.69"
+#define TEST_PORT 14403
+
+// Minimal router which records what it was given in its packet history, like the real one does when handling packets
+class MockRouter : public Router
+{
+  public:
+    ~MockRouter()
+    {
+        // cryptLock is created in the constructor for Router.
+        delete cryptLock;
+        cryptLock = NULL;
+    }
+    void enqueueReceivedMessage(meshtastic_MeshPacket *p) override
+    {
+        wasSeenRecently(p);
+        received[p->id]++;
+        lastSnr = p->rx_snr;
+        packetPool.release(p);
+    }
+    std::map<PacketId, uint32_t> received; // How many times each packet id reached us
+    float lastSnr = 0;
+};
+
+static MockRouter *mockRouter;
+static UdpMulticastSocket *a, *b;
+static PacketId nextId = 1;
+
+static meshtastic_MeshPacket makePacket()
+{
+    meshtastic_MeshPacket p = meshtastic_MeshPacket_init_zero;
+    p.from = 0x11223344;
+    p.to = NODENUM_BROADCAST;
+    p.id = nextId++;
+    p.rx_snr = 5.5;
+    p.hop_limit = 3;
+    p.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    p.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    p.decoded.payload.size = 20;
+    memset(p.decoded.payload.bytes, 'x', p.decoded.payload.size);
+    return p;
+}
+
+static uint32_t handled(const UdpMulticastSocket *s)
+{
+    return s->getStats().rxPackets + s->getStats().rxLoopback;
+}
+
+// Run the main loop until conditionMet returns true or 4 seconds elapse
+static bool loopUntil(std::function<bool()> conditionMet)
+{
+    uint32_t start = millis();
+    while (millis() - start < 4000) {
+        long delayMsec = concurrency::mainController.runOrDelay();
+        if (conditionMet())
+            return true;
+        concurrency::mainDelay.delay(std::min(delayMsec, 5L));
+    }
+    return false;
+}
+
+void setUp(void)
+{
+    mockRouter = new MockRouter();
+    router = mockRouter;
+    a = new UdpMulticastSocket(TEST_GROUP, TEST_PORT);
+    b = new UdpMulticastSocket(TEST_GROUP, TEST_PORT);
+    TEST_ASSERT_TRUE(a->start());
+    TEST_ASSERT_TRUE(b->start());
+}
+
+void tearDown(void)
+{
+    delete a;
+    delete b;
+    router = NULL;
+    delete mockRouter;
+}
+
+// Multicast loops back, so every send reaches both sockets and the sender must drop its own copy
+void test_roundtrip_and_loopback(void)
+{
+    PacketId first = nextId;
+    for (int i = 0; i < 3; i++) {
+        meshtastic_MeshPacket p = makePacket();
+        TEST_ASSERT_TRUE(a->send(&p));
+    }
+    TEST_ASSERT_TRUE(loopUntil([] { return handled(a) == 3 && handled(b) == 3; }));
+
+    // Sent on the next pass of the loop, all together
+    TEST_ASSERT_EQUAL(3, a->getStats().txPackets);
+    TEST_ASSERT_EQUAL(1, a->getStats().txBatches);
+
+    TEST_ASSERT_EQUAL(3, mockRouter->received.size());
+    for (PacketId id = first; id < first + 3; id++)
+        TEST_ASSERT_EQUAL(1, mockRouter->received[id]);
+    TEST_ASSERT_EQUAL(3, a->getStats().rxLoopback);
+    TEST_ASSERT_EQUAL(0, b->getStats().rxLoopback);
+    TEST_ASSERT_EQUAL(0, mockRouter->lastSnr);
+}
+
+// Another node's relay of a packet we sent is a duplicate, but the router needs it (implicit ACK, cancelling retransmissions)
+void test_relayed_copy_reaches_router(void)
+{
+    meshtastic_MeshPacket p = makePacket();
+    TEST_ASSERT_TRUE(a->send(&p));
+    TEST_ASSERT_TRUE(loopUntil([] { return handled(b) == 1; }));
+
+    meshtastic_MeshPacket relayed = p;
+    relayed.hop_limit--;
+    relayed.relay_node = 0x22;
+    TEST_ASSERT_TRUE(b->send(&relayed));
+    TEST_ASSERT_TRUE(loopUntil([] { return handled(a) == 2 && handled(b) == 2; }));
+
+    TEST_ASSERT_EQUAL(2, mockRouter->received[p.id]);
+    TEST_ASSERT_EQUAL(1, a->getStats().rxLoopback);
+    TEST_ASSERT_EQUAL(1, b->getStats().rxLoopback);
+}
+
+void test_bad_datagram(void)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(TEST_PORT);
+    inet_pton(AF_INET, TEST_GROUP, &to.sin_addr);
+    const uint8_t junk[] = {0xff, 0xff, 0xff, 0xff, 0xff};
+    TEST_ASSERT_EQUAL(sizeof(junk), sendto(fd, junk, sizeof(junk), 0, (sockaddr *)&to, sizeof(to)));
+    close(fd);
+
+    TEST_ASSERT_TRUE(loopUntil([] { return b->getStats().rxBadDecode == 1; }));
+    TEST_ASSERT_EQUAL(0, mockRouter->received.size());
+}
+
+/// Send count packets from a to b, flushing after every perFlush of them, and return packets per second
+static uint32_t measureThroughput(uint32_t count, uint32_t perFlush)
+{
+    uint32_t start = micros();
+    uint32_t target = handled(b) + count;
+    for (uint32_t sent = 0; sent < count;) {
+        for (uint32_t i = 0; i < perFlush && sent < count; i++, sent++) {
+            meshtastic_MeshPacket p = makePacket();
+            a->send(&p);
+        }
+        a->flush();
+        // Let the receivers keep up, so we measure the sockets rather than drops from a full receive buffer
+        concurrency::mainDelay.delay(0);
+        concurrency::mainController.runOrDelay();
+    }
+    TEST_ASSERT_TRUE(loopUntil([target] { return handled(b) >= target; }));
+    uint32_t elapsed = micros() - start;
+    return (uint64_t)count * 1000000 / (elapsed ? elapsed : 1);
+}
+
+void test_throughput_benchmark(void)
+{
+    const uint32_t count = 4000;
+    uint32_t single = measureThroughput(count, 1);
+    uint32_t batched = measureThroughput(count, UDP_BATCH_SIZE);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "a to b: %u packets/s one per sendmmsg, %u packets/s %u per sendmmsg, rx %u packets in %u batches",
+             single, batched, UDP_BATCH_SIZE, b->getStats().rxPackets + b->getStats().rxLoopback, b->getStats().rxBatches);
+    TEST_MESSAGE(msg);
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    nodeDB = new NodeDB();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_roundtrip_and_loopback);
+    RUN_TEST(test_relayed_copy_reaches_router);
+    RUN_TEST(test_bad_datagram);
+    RUN_TEST(test_throughput_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+#else
+void setup()
+{
+    initializeTestEnvironment();
+    LOG_WARN("This test requires UDP multicast on portduino");
+    UNITY_BEGIN();
+    UNITY_END();
+}
+#endif
+
+void loop() {}
@@ -0,0 +1,282 @@
+#include "FSCommon.h"
+#include "PacketTrace.h"
+#include "SPILock.h"
+#include "TestUtil.h"
+#include "modules/Telemetry/TelemetryHistory.h"
+#include "xmodem.h"
+#include <map>
+#include <unity.h>
+#include <vector>
+
+static const char *testFileName = "/prefs/xmodem_test.bin";
+static const size_t BLOCK = sizeof(meshtastic_XModem_buffer_t::bytes);
+/// Round trip we assume for the benchmark, typical for BLE
+static const uint32_t LINK_RTT_MS = 30;
+
+class TestXModem : public XModemAdapter
+{
+  public:
+    uint16_t crc(const uint8_t *buf, int len) { return crc16_ccitt(buf, len); }
+
+    std::vector<meshtastic_XModem> drain()
+    {
+        std::vector<meshtastic_XModem> v;
+        while (true) {
+            meshtastic_XModem p = getForPhone();
+            if (p.control == meshtastic_XModem_Control_NUL)
+                return v;
+            resetForPhone();
+            v.push_back(p);
+        }
+    }
+};
+
+static TestXModem *xm;
+
+static meshtastic_XModem makePacket(meshtastic_XModem_Control c, uint16_t seq = 0, uint16_t crc16 = 0)
+{
+    meshtastic_XModem p = meshtastic_XModem_init_zero;
+    p.control = c;
+    p.seq = seq;
+    p.crc16 = crc16;
+    return p;
+}
+
+static meshtastic_XModem makeBlock(const std::vector<uint8_t> &data, uint16_t seq)
+{
+    meshtastic_XModem b = makePacket(meshtastic_XModem_Control_SOH, seq);
+    size_t off = (seq - 1) * BLOCK;
+    b.buffer.size = min(BLOCK, data.size() - off);
+    memcpy(b.buffer.bytes, data.data() + off, b.buffer.size);
+    b.crc16 = xm->crc(b.buffer.bytes, b.buffer.size);
+    return b;
+}
+
+/// Upload data acting as the client, returning how many times we had to wait for the node
+static uint32_t upload(const std::vector<uint8_t> &data, uint16_t window)
+{
+    meshtastic_XModem start = makePacket(meshtastic_XModem_Control_SOH, 0, window);
+    strcpy((char *)start.buffer.bytes, testFileName);
+    start.buffer.size = strlen(testFileName) + 1;
+    xm->handlePacket(start);
+    auto reply = xm->drain();
+    TEST_ASSERT_EQUAL(1, reply.size());
+    TEST_ASSERT_EQUAL(meshtastic_XModem_Control_ACK, reply[0].control);
+    uint16_t accepted = window ? reply[0].crc16 : 1;
+    TEST_ASSERT_GREATER_THAN(0, accepted);
+
+    uint16_t numBlocks = (data.size() + BLOCK - 1) / BLOCK;
+    uint16_t base = 1, next = 1;
+    uint32_t waits = 0;
+    while (base <= numBlocks) {
+        while (next <= numBlocks && next < base + accepted)
+            xm->handlePacket(makeBlock(data, next++));
+        waits++;
+        for (auto &r : xm->drain()) {
+            if (r.control == meshtastic_XModem_Control_ACK)
+                base = window ? max(base, (uint16_t)(r.seq + 1)) : base + 1;
+            else if (r.control == meshtastic_XModem_Control_NAK)
+                xm->handlePacket(makeBlock(data, window ? r.seq : base));
+        }
+        TEST_ASSERT_LESS_THAN(100000, waits);
+    }
+    xm->handlePacket(makePacket(meshtastic_XModem_Control_EOT));
+    xm->drain();
+    return waits;
+}
+
+/// Download the file acting as a client which keeps blocks received out of order
+static uint32_t download(std::vector<uint8_t> &out, uint16_t window, const char *fileName = testFileName)
+{
+    meshtastic_XModem start = makePacket(meshtastic_XModem_Control_STX, 0, window);
+    strcpy((char *)start.buffer.bytes, fileName);
+    start.buffer.size = strlen(fileName) + 1;
+    xm->handlePacket(start);
+
+    std::map<uint16_t, meshtastic_XModem> held;
+    uint16_t expect = 1;
+    uint32_t waits = 0;
+    while (true) {
+        waits++;
+        TEST_ASSERT_LESS_THAN(100000, waits);
+        bool progressed = false;
+        for (auto &b : xm->drain()) {
+            if (b.control == meshtastic_XModem_Control_EOT)
+                return waits;
+            TEST_ASSERT_EQUAL(meshtastic_XModem_Control_SOH, b.control);
+            TEST_ASSERT_EQUAL_HEX16(xm->crc(b.buffer.bytes, b.buffer.size), b.crc16);
+            if (b.seq >= expect)
+                held[b.seq] = b;
+            while (held.count(expect)) {
+                out.insert(out.end(), held[expect].buffer.bytes, held[expect].buffer.bytes + held[expect].buffer.size);
+                held.erase(expect++);
+                progressed = true;
+                if (!window)
+                    xm->handlePacket(makePacket(meshtastic_XModem_Control_ACK));
+            }
+        }
+        if (window && progressed)
+            xm->handlePacket(makePacket(meshtastic_XModem_Control_ACK, expect - 1));
+        else if (!progressed)
+            xm->handlePacket(makePacket(meshtastic_XModem_Control_NAK, window ? expect : 0));
+    }
+}
+
+static std::vector<uint8_t> makeData(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (uint8_t)(i * 131 + (i >> 8));
+    return data;
+}
+
+static std::vector<uint8_t> readFile()
+{
+    auto f = FSCom.open(testFileName, FILE_O_READ);
+    std::vector<uint8_t> contents(f.size());
+    f.read(contents.data(), contents.size());
+    f.close();
+    return contents;
+}
+
+void setUp(void)
+{
+    FSCom.mkdir("/prefs");
+    FSCom.remove(testFileName);
+}
+
+void tearDown(void)
+{
+    FSCom.remove(testFileName);
+}
+
+void test_crc16(void)
+{
+    TEST_ASSERT_EQUAL_HEX16(0x31c3, xm->crc((const uint8_t *)"123456789", 9));
+    TEST_ASSERT_EQUAL_HEX16(0, xm->crc(NULL, 0));
+}
+
+void test_stop_and_wait_roundtrip(void)
+{
+    // Sizes around block boundaries, a file ending on one gets an empty last block
+    const size_t sizes[] = {0, 100, BLOCK, 3 * BLOCK + 1};
+    for (size_t size : sizes) {
+        auto data = makeData(size);
+        upload(data, 0);
+        TEST_ASSERT_TRUE(readFile() == data);
+        std::vector<uint8_t> got;
+        download(got, 0);
+        TEST_ASSERT_TRUE(got == data);
+    }
+}
+
+void test_windowed_roundtrip(void)
+{
+    const size_t sizes[] = {0, 100, BLOCK, 20 * BLOCK + 5};
+    for (size_t size : sizes) {
+        auto data = makeData(size);
+        upload(data, XMODEM_MAX_WINDOW);
+        TEST_ASSERT_TRUE(readFile() == data);
+        std::vector<uint8_t> got;
+        download(got, XMODEM_MAX_WINDOW);
+        TEST_ASSERT_TRUE(got == data);
+    }
+}
+
+void test_windowed_selective_nak(void)
+{
+    auto data = makeData(10 * BLOCK);
+    upload(data, 4);
+
+    meshtastic_XModem start = makePacket(meshtastic_XModem_Control_STX, 0, 4);
+    strcpy((char *)start.buffer.bytes, testFileName);
+    start.buffer.size = strlen(testFileName) + 1;
+    xm->handlePacket(start);
+    auto first = xm->drain();
+    TEST_ASSERT_EQUAL(4, first.size());
+
+    // Block 2 got lost: acking block 1 moves the window on to block 5, and the NAK brings back only block 2
+    xm->handlePacket(makePacket(meshtastic_XModem_Control_ACK, 1));
+    xm->handlePacket(makePacket(meshtastic_XModem_Control_NAK, 2));
+    auto resent = xm->drain();
+    TEST_ASSERT_EQUAL(2, resent.size());
+    TEST_ASSERT_EQUAL(5, resent[0].seq);
+    TEST_ASSERT_EQUAL(2, resent[1].seq);
+
+    xm->handlePacket(makePacket(meshtastic_XModem_Control_CAN));
+    xm->drain();
+}
+
+// The trace and the history are sent from a snapshot, which must not outlive the transfer
+void test_snapshot_removed(void)
+{
+    const char *names[] = {PACKET_TRACE_FILENAME, TELEMETRY_HISTORY_FILENAME, TELEMETRY_HISTORY_FILENAME "?since=1700000000"};
+    for (auto name : names) {
+        std::vector<uint8_t> got;
+        download(got, XMODEM_MAX_WINDOW, name);
+        TEST_ASSERT_GREATER_THAN(0, got.size());
+        TEST_ASSERT_FALSE(FSCom.exists(XMODEM_SNAPSHOT_FILENAME));
+        TEST_ASSERT_FALSE(FSCom.exists(name));
+    }
+
+    // Cancelled before it is done
+    meshtastic_XModem start = makePacket(meshtastic_XModem_Control_STX, 0, 1);
+    strcpy((char *)start.buffer.bytes, PACKET_TRACE_FILENAME);
+    start.buffer.size = strlen(PACKET_TRACE_FILENAME) + 1;
+    xm->handlePacket(start);
+    xm->drain();
+    TEST_ASSERT_TRUE(FSCom.exists(XMODEM_SNAPSHOT_FILENAME));
+    xm->handlePacket(makePacket(meshtastic_XModem_Control_CAN));
+    xm->drain();
+    TEST_ASSERT_FALSE(FSCom.exists(XMODEM_SNAPSHOT_FILENAME));
+}
+
+void test_loopback_benchmark(void)
+{
+    auto data = makeData(64 * 1024);
+    char msg[160];
+
+    const uint16_t windows[] = {0, XMODEM_MAX_WINDOW};
+    for (uint16_t window : windows) {
+        uint32_t start = millis();
+        uint32_t upWaits = upload(data, window);
+        uint32_t upMs = millis() - start;
+
+        std::vector<uint8_t> got;
+        start = millis();
+        uint32_t downWaits = download(got, window);
+        uint32_t downMs = millis() - start;
+        TEST_ASSERT_TRUE(got == data);
+
+        // What it would take over a link with LINK_RTT_MS between each wait
+        uint32_t upLinkMs = upMs + upWaits * LINK_RTT_MS, downLinkMs = downMs + downWaits * LINK_RTT_MS;
+        snprintf(msg, sizeof(msg),
+                 "window %u, 64 KiB: upload %u ms, %u waits (%u B/s at %u ms RTT), download %u ms, %u waits (%u B/s)", window,
+                 upMs, upWaits, (unsigned)(data.size() * 1000 / upLinkMs), LINK_RTT_MS, downMs, downWaits,
+                 (unsigned)(data.size() * 1000 / downLinkMs));
+        TEST_MESSAGE(msg);
+    }
+}
+
+void setup()
+{
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(10);
+    delay(2000);
+
+    initializeTestEnvironment();
+    initSPI();
+    xm = new TestXModem();
+
+    UNITY_BEGIN(); // IMPORTANT LINE!
+    RUN_TEST(test_crc16);
+    RUN_TEST(test_stop_and_wait_roundtrip);
+    RUN_TEST(test_windowed_roundtrip);
+    RUN_TEST(test_windowed_selective_nak);
+    RUN_TEST(test_snapshot_removed);
+    RUN_TEST(test_loopback_benchmark);
+    exit(UNITY_END()); // stop unit testing
+}
+
+void loop() {}
@@ -2,4 +2,5 @@
 #define CANNED_MESSAGE_MODULE_ENABLE 1
 #define HAS_GPS 1
 #define MAX_RX_TOPHONE settingsMap[maxtophone]
+#define MAX_RX_TOPHONE_BYTES settingsMap[maxtophone_bytes]
 #define MAX_NUM_NODES settingsMap[maxnodes]
\ No newline at end of file